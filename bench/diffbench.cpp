@@ -0,0 +1,153 @@
+#include <dvcs/diff.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Taille par défaut de l'ancienne version du fichier comparé
+constexpr const std::size_t DEFAULT_SIZE_MB = 64;
+
+// Une ligne sur EDIT_INTERVAL (en moyenne) est modifiée, retirée ou suivie d'une
+// ligne ajoutée dans la nouvelle version
+constexpr const std::size_t EDIT_INTERVAL = 100;
+
+// Nombre de répétitions d'une mesure. On conserve la meilleure.
+constexpr const int NB_REPETITIONS = 3;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Mesure la durée, en secondes, de <function>
+////////////////////////////////////////////////////////////////////////////////////
+double MeasureSeconds(const std::function<void()> &function)
+{
+    double bestSeconds = std::numeric_limits<double>::max();
+    for (int iRepetition = 0; iRepetition < NB_REPETITIONS; ++iRepetition)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        bestSeconds = std::min(bestSeconds, elapsed.count());
+    }
+    return bestSeconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ligne ressemblant à du code source: une indentation et quelques mots, ou une
+// ligne vide ou une accolade (lignes fréquentes qui ne doivent pas servir d'ancres)
+////////////////////////////////////////////////////////////////////////////////////
+std::string GenerateLine(std::mt19937 &generator)
+{
+    static const std::array<const char *, 16> words{"auto",  "const", "return", "if",  "for",   "value", "index", "count",
+                                                    "data",  "size",  "std",    "::",  "(",     ")",     "=",     ";"};
+    std::uniform_int_distribution<int> kindDistribution{0, 9};
+    const int kind = kindDistribution(generator);
+    if (kind == 0)
+    {
+        return "\n";
+    }
+    if (kind == 1)
+    {
+        return "}\n";
+    }
+
+    std::uniform_int_distribution<std::size_t> wordDistribution{0, words.size() - 1};
+    std::uniform_int_distribution<int> countDistribution{2, 10};
+    std::string line(4U * static_cast<std::size_t>(kind % 4), ' ');
+    for (int iWord = countDistribution(generator); iWord > 0; --iWord)
+    {
+        line += words[wordDistribution(generator)];
+        line += ' ';
+    }
+    line += std::to_string(generator());
+    line += '\n';
+    return line;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////
+// Point d'entrée du banc d'essai.
+// usage: diffbench [<size in MB>]
+////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+    const std::size_t sizeMB = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : DEFAULT_SIZE_MB;
+    if (sizeMB == 0)
+    {
+        fmt::print(std::cout, "usage: diffbench [<size in MB>]\n");
+        return 1;
+    }
+
+    // La nouvelle version est dérivée de l'ancienne par des modifications éparses
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<std::size_t> editDistribution{0, 3U * EDIT_INTERVAL - 1U};
+    std::string oldData;
+    std::string newData;
+    while (oldData.size() < sizeMB * 1024U * 1024U)
+    {
+        const auto line = GenerateLine(generator);
+        oldData += line;
+        switch (editDistribution(generator))
+        {
+        case 0: // Modifiée
+            newData += GenerateLine(generator);
+            break;
+        case 1: // Retirée
+            break;
+        case 2: // Suivie d'une ligne ajoutée
+            newData += line;
+            newData += GenerateLine(generator);
+            break;
+        default:
+            newData += line;
+            break;
+        }
+    }
+
+    fmt::print(std::cout, "comparing two versions of a {0} MB file (best of {1})\n\n", sizeMB, NB_REPETITIONS);
+    fmt::print(std::cout, "{0:<24} {1:>10} {2:>8}\n", "split and hash lines", "lines", "GB/s");
+    for (const auto backend : {dvcs::LineScanBackend::Generic, dvcs::LineScanBackend::SSE2, dvcs::LineScanBackend::AVX2})
+    {
+        if (!dvcs::IsLineScanBackendSupported(backend))
+        {
+            fmt::print(std::cout, "{0:<24} {1:>10} {2:>8}\n", dvcs::GetLineScanBackendName(backend), "n/a", "n/a");
+            continue;
+        }
+
+        std::size_t nbLines{};
+        const double seconds = MeasureSeconds([&]() {
+            const dvcs::DiffText text{oldData, backend};
+            nbLines = text.GetNbLines();
+        });
+        fmt::print(std::cout, "{0:<24} {1:>10} {2:>8.3f}\n", dvcs::GetLineScanBackendName(backend), nbLines,
+                   static_cast<double>(oldData.size()) / seconds / 1e9);
+    }
+
+    const dvcs::DiffText oldText{oldData};
+    const dvcs::DiffText newText{newData};
+    fmt::print(std::cout, "\n{0:<24} {1:>10} {2:>8} {3:>12}\n", "algorithm", "changes", "seconds", "output (MB)");
+    for (const auto algorithm : {dvcs::DiffAlgorithm::Myers, dvcs::DiffAlgorithm::Histogram})
+    {
+        std::vector<dvcs::DiffChange> changes;
+        const double seconds = MeasureSeconds([&]() { changes = dvcs::ComputeDiff(oldText, newText, algorithm); });
+
+        std::string output;
+        dvcs::WriteUnifiedDiff(oldText, newText, changes, dvcs::DEFAULT_DIFF_CONTEXT, output);
+        fmt::print(std::cout, "{0:<24} {1:>10} {2:>8.3f} {3:>12.2f}\n", dvcs::GetDiffAlgorithmName(algorithm), changes.size(), seconds,
+                   static_cast<double>(output.size()) / (1024.0 * 1024.0));
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <dvcs/hash.h>
+
+#include <boost/uuid/detail/sha1.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Quantité de données hachées par défaut pour chacune des implémentations
+constexpr const std::size_t DEFAULT_SIZE_MB = 256;
+
+// Taille des morceaux fournis aux moteurs, soit celle utilisée lors d'un add
+constexpr const std::size_t CHUNK_SIZE = 64U * 1024U;
+
+// Nombre de répétitions d'une mesure. On conserve la meilleure.
+constexpr const int NB_REPETITIONS = 3;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Mesure le débit, en Go/s, de <hashFn> appliquée à tous les morceaux de <data>.
+////////////////////////////////////////////////////////////////////////////////////
+double MeasureThroughput(const std::vector<char> &data, const std::function<void(const char *, std::size_t)> &hashFn)
+{
+    double bestSeconds = std::numeric_limits<double>::max();
+    for (int iRepetition = 0; iRepetition < NB_REPETITIONS; ++iRepetition)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        hashFn(data.data(), data.size());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        bestSeconds = std::min(bestSeconds, elapsed.count());
+    }
+    return static_cast<double>(data.size()) / bestSeconds / 1e9;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Implémentation utilisée jusqu'ici par DVCSUS (Boost.UUID)
+////////////////////////////////////////////////////////////////////////////////////
+void HashWithBoost(const char *pData, std::size_t size)
+{
+    boost::uuids::detail::sha1 sha1;
+    for (std::size_t offset = 0; offset < size; offset += CHUNK_SIZE)
+    {
+        sha1.process_bytes(pData + offset, std::min(CHUNK_SIZE, size - offset));
+    }
+    unsigned int digest[5] = {0}; // NOLINT
+    sha1.get_digest(digest);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////
+// Point d'entrée du banc d'essai.
+// usage: hashbench [<size in MB>]
+////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+    const std::size_t sizeMB = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : DEFAULT_SIZE_MB;
+    if (sizeMB == 0)
+    {
+        fmt::print(std::cout, "usage: hashbench [<size in MB>]\n");
+        return 1;
+    }
+
+    // Des données aléatoires, pour que rien ne puisse être deviné par le processeur
+    std::vector<char> data(sizeMB * 1024U * 1024U);
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<int> distribution{0, 255};
+    for (auto &byte : data)
+    {
+        byte = static_cast<char>(distribution(generator));
+    }
+
+    fmt::print(std::cout, "hashing {0} MB in {1} KB chunks (best of {2})\n\n", sizeMB, CHUNK_SIZE / 1024U, NB_REPETITIONS);
+    fmt::print(std::cout, "{0:<8} {1:<10} {2:>8}\n", "algo", "backend", "GB/s");
+    fmt::print(std::cout, "{0:<8} {1:<10} {2:>8.3f}\n", "sha1", "boost", MeasureThroughput(data, HashWithBoost));
+
+    for (const auto algorithm : {dvcs::HashAlgorithm::SHA1, dvcs::HashAlgorithm::SHA256})
+    {
+        for (const auto backend : {dvcs::HashBackend::Generic, dvcs::HashBackend::SHANI})
+        {
+            auto pEngine = dvcs::CreateHashEngine(algorithm, backend);
+            if (pEngine == nullptr)
+            {
+                fmt::print(std::cout, "{0:<8} {1:<10} {2:>8}\n", dvcs::GetHashAlgorithmName(algorithm), dvcs::GetHashBackendName(backend),
+                           "n/a");
+                continue;
+            }
+
+            const double throughput = MeasureThroughput(data, [&pEngine](const char *pData, std::size_t size) {
+                for (std::size_t offset = 0; offset < size; offset += CHUNK_SIZE)
+                {
+                    pEngine->Update(pData + offset, std::min(CHUNK_SIZE, size - offset));
+                }
+                [[maybe_unused]] const auto hash = pEngine->Finalize();
+            });
+            fmt::print(std::cout, "{0:<8} {1:<10} {2:>8.3f}\n", dvcs::GetHashAlgorithmName(algorithm), dvcs::GetHashBackendName(backend), throughput);
+        }
+    }
+
+    return 0;
+}
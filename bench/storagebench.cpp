@@ -0,0 +1,129 @@
+#include <dvcs/commands.h>
+#include <dvcs/paths.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Nombre de fichiers ajoutés par défaut pour chacun des profils
+constexpr const std::size_t DEFAULT_NB_FILES = 2000;
+
+// Taille des fichiers: surtout des petits fichiers sources, quelques gros fichiers
+constexpr const std::size_t SMALL_FILE_SIZE = 4U * 1024U;
+constexpr const std::size_t LARGE_FILE_SIZE = 2U * 1024U * 1024U;
+constexpr const std::size_t LARGE_FILE_RATIO = 100;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Mesure la durée, en secondes, de <fn>. La sortie standard est mise de côté le
+// temps de la mesure pour ne pas nuire à la lisibilité des résultats.
+////////////////////////////////////////////////////////////////////////////////////
+double MeasureSeconds(const std::function<bool()> &fn)
+{
+    std::ostringstream discardedOutput;
+    auto *pCoutBuffer = std::cout.rdbuf(discardedOutput.rdbuf());
+    const auto startTime = std::chrono::steady_clock::now();
+    const bool isSuccess = fn();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::cout.rdbuf(pCoutBuffer);
+    return isSuccess ? elapsed.count() : -1.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit <nbFiles> fichiers au contenu en partie aléatoire dans le répertoire
+// courant.
+////////////////////////////////////////////////////////////////////////////////////
+void WriteFiles(std::size_t nbFiles)
+{
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<int> distribution{'a', 'z'};
+    for (std::size_t iFile = 0; iFile < nbFiles; ++iFile)
+    {
+        const std::size_t size = ((iFile % LARGE_FILE_RATIO) == 0) ? LARGE_FILE_SIZE : SMALL_FILE_SIZE;
+        std::string content(size, ' ');
+        // Une lettre aléatoire sur huit: les données restent compressibles
+        for (std::size_t iByte = 0; iByte < size; iByte += 8)
+        {
+            content[iByte] = static_cast<char>(distribution(generator));
+        }
+        std::ofstream{fmt::format("file{}.txt", iFile), std::ios::binary} << content;
+    }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////
+// Point d'entrée du banc d'essai.
+// Pour chacun des profils de stockage, on mesure l'ajout et le commit d'un ensemble
+// de fichiers dans un nouveau dépôt, puis le pull de ce dépôt dans un autre dépôt
+// utilisant le même profil (lecture des objets d'un côté, écriture de l'autre).
+// usage: storagebench [<nb files>]
+////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+    const std::size_t nbFiles = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : DEFAULT_NB_FILES;
+    if (nbFiles == 0)
+    {
+        fmt::print(std::cout, "usage: storagebench [<nb files>]\n");
+        return 1;
+    }
+
+    const auto initialPath = fs::current_path();
+    const auto benchPath = fs::temp_directory_path() / "dvcsus-storagebench";
+
+    fmt::print(std::cout, "adding {0} files ({1} KB, 1 in {2} is {3} MB) in {4}\n\n", nbFiles, SMALL_FILE_SIZE / 1024U, LARGE_FILE_RATIO,
+               LARGE_FILE_SIZE / 1024U / 1024U, benchPath.string());
+    fmt::print(std::cout, "{0:<10} {1:>10} {2:>10} {3:>10}\n", "profile", "add (s)", "commit (s)", "pull (s)");
+
+    for (const auto profile : {dvcs::StorageProfile::Durable, dvcs::StorageProfile::FastCI, dvcs::StorageProfile::BulkImport})
+    {
+        // Chaque profil part d'un répertoire vide
+        fs::current_path(initialPath);
+        fs::remove_all(benchPath);
+        const auto sourcePath = benchPath / "source";
+        const auto destinationPath = benchPath / "destination";
+        fs::create_directories(sourcePath);
+        fs::create_directories(destinationPath);
+
+        fs::current_path(sourcePath);
+        WriteFiles(nbFiles);
+        dvcs::Repository source;
+        if (MeasureSeconds([&source, &sourcePath, profile] { return dvcs::Init(dvcs::HashAlgorithm::SHA1, profile) && source.Open(sourcePath); }) < 0)
+        {
+            return 1;
+        }
+        const double addSeconds = MeasureSeconds([&source] { return dvcs::Add(source, std::vector<fs::path>{"."}); });
+        const double commitSeconds = MeasureSeconds([&source] { return dvcs::Commit(source, "Bench", "bench@dvcsus", "Bench"); });
+
+        fs::current_path(destinationPath);
+        dvcs::Repository destination;
+        const auto initDestination = [&destination, &destinationPath, &sourcePath, profile] {
+            return dvcs::Init(dvcs::HashAlgorithm::SHA1, profile) && destination.Open(destinationPath) &&
+                   dvcs::SetRemote(destination, sourcePath / dvcs::REPO_DB_PATH);
+        };
+        if (MeasureSeconds(initDestination) < 0)
+        {
+            return 1;
+        }
+        const double pullSeconds = MeasureSeconds([&destination] { return dvcs::Pull(destination); });
+
+        fmt::print(std::cout, "{0:<10} {1:>10.3f} {2:>10.3f} {3:>10.3f}\n", dvcs::GetStorageProfileName(profile), addSeconds, commitSeconds,
+                   pullSeconds);
+    }
+
+    fs::current_path(initialPath);
+    fs::remove_all(benchPath);
+
+    return 0;
+}
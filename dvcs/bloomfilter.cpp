@@ -0,0 +1,89 @@
+#include "bloomfilter.h"
+
+#include <algorithm>
+
+namespace
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Empreinte de 64 bits d'une clé: FNV-1a suivi du mélange final de SplitMix64 pour
+// que chacun des bits dépende de tous les octets de la clé. Elle ne doit jamais
+// changer puisque les filtres stockés en dépendent.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::uint64_t ComputeKeyHash(std::string_view value) noexcept
+{
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const char character : value)
+    {
+        hash ^= static_cast<std::uint8_t>(character);
+        hash *= 0x100000001B3ULL;
+    }
+    hash = (hash ^ (hash >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27U)) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31U);
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+BloomKey::BloomKey(std::string_view value) noexcept
+{
+    const auto hash = ComputeKeyHash(value);
+    m_firstHash = static_cast<std::uint32_t>(hash);
+    m_secondHash = static_cast<std::uint32_t>(hash >> 32U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les sondes sont dérivées des deux moitiés de l'empreinte par double hachage
+// (Kirsch et Mitzenmacher, 2006), ce qui équivaut à autant de fonctions de hachage
+// indépendantes.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::size_t BloomKey::GetBitPosition(std::size_t iProbe, std::size_t nbBits) const noexcept
+{
+    const auto hash = static_cast<std::uint64_t>(m_firstHash) + (iProbe * static_cast<std::uint64_t>(m_secondHash));
+    return static_cast<std::size_t>(hash % nbBits);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Un filtre a au moins un octet, même vide, et un filtre de trop de clés n'a qu'un
+// octet dont tous les bits sont à 1.
+////////////////////////////////////////////////////////////////////////////////////
+BloomFilter::BloomFilter(std::size_t nbKeys)
+    : m_bits(nbKeys > BLOOM_MAX_KEYS ? 1U : std::max<std::size_t>(1U, ((nbKeys * BLOOM_BITS_PER_KEY) + 7U) / 8U),
+             nbKeys > BLOOM_MAX_KEYS ? 0xFFU : 0U)
+{
+}
+
+void BloomFilter::Add(const BloomKey &key) noexcept
+{
+    const auto nbBits = m_bits.size() * 8U;
+    for (std::size_t iProbe = 0; iProbe < BLOOM_NB_PROBES; ++iProbe)
+    {
+        const auto position = key.GetBitPosition(iProbe, nbBits);
+        m_bits[position / 8U] |= static_cast<std::uint8_t>(1U << (position % 8U));
+    }
+}
+
+[[nodiscard]] bool BloomFilter::MayContain(std::span<const std::uint8_t> bits, const BloomKey &key) noexcept
+{
+    // Un filtre illisible n'exclut aucune clé
+    if (bits.empty())
+    {
+        return true;
+    }
+
+    const auto nbBits = bits.size() * 8U;
+    for (std::size_t iProbe = 0; iProbe < BLOOM_NB_PROBES; ++iProbe)
+    {
+        const auto position = key.GetBitPosition(iProbe, nbBits);
+        if ((bits[position / 8U] & (1U << (position % 8U))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace dvcs
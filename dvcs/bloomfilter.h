@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace dvcs
+{
+
+// Nombre de bits par clé et nombre de bits consultés par clé d'un filtre: environ
+// 1% de faux positifs
+constexpr const std::size_t BLOOM_BITS_PER_KEY = 10U;
+constexpr const std::size_t BLOOM_NB_PROBES = 7U;
+
+// Nombre maximal de clés d'un filtre. Au-delà, le filtre est saturé: il contient
+// toutes les clés possibles.
+constexpr const std::size_t BLOOM_MAX_KEYS = 512U;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Empreinte d'une clé, dont sont dérivés les bits qu'elle occupe dans un filtre.
+// Elle est calculée une seule fois pour être cherchée dans plusieurs filtres.
+////////////////////////////////////////////////////////////////////////////////////
+class BloomKey
+{
+  public:
+    explicit BloomKey(std::string_view value) noexcept;
+
+    // Position du bit consulté par la sonde <iProbe> dans un filtre de <nbBits> bits
+    [[nodiscard]] std::size_t GetBitPosition(std::size_t iProbe, std::size_t nbBits) const noexcept;
+
+  private:
+    std::uint32_t m_firstHash{};
+    std::uint32_t m_secondHash{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Filtre de Bloom: un ensemble de clés qui répond sans erreur qu'une clé absente
+// n'en fait pas partie, mais qui peut répondre à tort qu'elle en fait partie.
+// Les bits d'un filtre sont stockés tels quels, sa taille se déduisant de leur
+// nombre: les positions des clés ne doivent donc jamais changer (voir BloomKey).
+////////////////////////////////////////////////////////////////////////////////////
+class BloomFilter
+{
+  public:
+    // Filtre vide dimensionné pour <nbKeys> clés
+    explicit BloomFilter(std::size_t nbKeys);
+
+    void Add(const BloomKey &key) noexcept;
+    [[nodiscard]] std::span<const std::uint8_t> GetBits() const noexcept { return m_bits; }
+
+    // Indique si la clé <key> peut faire partie du filtre dont les bits sont <bits>
+    [[nodiscard]] static bool MayContain(std::span<const std::uint8_t> bits, const BloomKey &key) noexcept;
+
+  private:
+    std::vector<std::uint8_t> m_bits;
+};
+
+} // namespace dvcs
@@ -0,0 +1,327 @@
+#include "bundle.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// Signature d'un bundle, suivie de la version du format.
+// Historique:
+// 1. Format initial.
+// 2. Un commit est accompagné du commit qu'il a fusionné, s'il y a lieu.
+// 3. Les objets d'un commit sont accompagnés de leur chemin.
+// 4. Un commit peut retirer un fichier, qui n'a alors pas d'objet.
+constexpr const std::array<char, 8> BUNDLE_SIGNATURE{'D', 'V', 'C', 'S', 'B', 'N', 'D', 'L'};
+constexpr const std::uint32_t BUNDLE_FORMAT_VERSION = 4;
+
+// Alignement des parties d'un enregistrement
+constexpr const std::size_t BUNDLE_ALIGNMENT = 8;
+
+// Taille de l'en-tête d'un enregistrement: type (et 3 octets réservés), taille des
+// champs, taille des données
+constexpr const std::size_t RECORD_HEADER_SIZE = 16;
+
+// Borne sur la taille des champs d'un enregistrement, pour ne pas allouer n'importe
+// quoi à la lecture d'un fichier corrompu
+constexpr const std::uint32_t MAX_FIELDS_SIZE = 16U * 1024U * 1024U;
+
+// Taille des lectures faites pour sauter des données
+constexpr const std::size_t SKIP_BUFFER_SIZE = 64U * 1024U;
+
+[[nodiscard]] std::size_t GetPaddingSize(std::uint64_t size) noexcept
+{
+    return static_cast<std::size_t>((BUNDLE_ALIGNMENT - (size % BUNDLE_ALIGNMENT)) % BUNDLE_ALIGNMENT);
+}
+
+template <typename TValue>
+void StoreLittleEndian(TValue value, char *pBytes) noexcept
+{
+    for (std::size_t iByte = 0; iByte < sizeof(TValue); ++iByte)
+    {
+        pBytes[iByte] = static_cast<char>((value >> (8U * iByte)) & 0xFFU);
+    }
+}
+
+template <typename TValue>
+[[nodiscard]] TValue LoadLittleEndian(const char *pBytes) noexcept
+{
+    TValue value{};
+    for (std::size_t iByte = 0; iByte < sizeof(TValue); ++iByte)
+    {
+        value |= static_cast<TValue>(static_cast<std::uint8_t>(pBytes[iByte])) << (8U * iByte);
+    }
+    return value;
+}
+
+// zlib ne traite que des tailles de 32 bits à la fois
+[[nodiscard]] std::uint32_t UpdateCRC(std::uint32_t crc, const void *pData, std::size_t size) noexcept
+{
+    const auto *pBytes = static_cast<const Bytef *>(pData);
+    while (size > 0)
+    {
+        const auto blockSize = static_cast<uInt>(std::min<std::size_t>(size, 1U << 30U));
+        crc = static_cast<std::uint32_t>(crc32(crc, pBytes, blockSize));
+        pBytes += blockSize;
+        size -= blockSize;
+    }
+    return crc;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+void BundleFieldsWriter::AddU8(std::uint8_t value) { m_fields.push_back(static_cast<char>(value)); }
+
+void BundleFieldsWriter::AddU32(std::uint32_t value)
+{
+    std::array<char, sizeof(value)> bytes{};
+    StoreLittleEndian(value, bytes.data());
+    m_fields.insert(m_fields.end(), bytes.cbegin(), bytes.cend());
+}
+
+void BundleFieldsWriter::AddU64(std::uint64_t value)
+{
+    std::array<char, sizeof(value)> bytes{};
+    StoreLittleEndian(value, bytes.data());
+    m_fields.insert(m_fields.end(), bytes.cbegin(), bytes.cend());
+}
+
+void BundleFieldsWriter::AddString(std::string_view value)
+{
+    AddU32(static_cast<std::uint32_t>(value.size()));
+    m_fields.insert(m_fields.end(), value.cbegin(), value.cend());
+}
+
+void BundleFieldsWriter::AddHash(const THash &hash)
+{
+    AddU8(static_cast<std::uint8_t>(hash.size()));
+    m_fields.insert(m_fields.end(), hash.data(), hash.data() + hash.size());
+}
+
+void BundleFieldsWriter::AddNoHash() { AddU8(0); }
+
+[[nodiscard]] bool BundleFieldsReader::ReadBytes(void *pData, std::size_t size) noexcept
+{
+    RETURN_IF(size > (m_fields.size() - m_offset), false);
+    std::memcpy(pData, m_fields.data() + m_offset, size);
+    m_offset += size;
+    return true;
+}
+
+[[nodiscard]] bool BundleFieldsReader::ReadU8(std::uint8_t &value) noexcept { return ReadBytes(&value, sizeof(value)); }
+
+[[nodiscard]] bool BundleFieldsReader::ReadU32(std::uint32_t &value) noexcept
+{
+    std::array<char, sizeof(value)> bytes{};
+    RETURN_IF(!ReadBytes(bytes.data(), bytes.size()), false);
+    value = LoadLittleEndian<std::uint32_t>(bytes.data());
+    return true;
+}
+
+[[nodiscard]] bool BundleFieldsReader::ReadU64(std::uint64_t &value) noexcept
+{
+    std::array<char, sizeof(value)> bytes{};
+    RETURN_IF(!ReadBytes(bytes.data(), bytes.size()), false);
+    value = LoadLittleEndian<std::uint64_t>(bytes.data());
+    return true;
+}
+
+[[nodiscard]] bool BundleFieldsReader::ReadString(std::string &value)
+{
+    std::uint32_t size{};
+    RETURN_IF(!ReadU32(size) || (size > (m_fields.size() - m_offset)), false);
+    value.assign(m_fields.data() + m_offset, size);
+    m_offset += size;
+    return true;
+}
+
+[[nodiscard]] bool BundleFieldsReader::ReadHash(THash &hash, bool &isPresent) noexcept
+{
+    std::uint8_t size{};
+    RETURN_IF(!ReadU8(size) || (size > MAX_HASH_SIZE), false);
+    isPresent = size > 0;
+    hash = THash{size};
+    return ReadBytes(hash.data(), size);
+}
+
+[[nodiscard]] bool BundleWriter::Write(const void *pData, std::size_t size) noexcept
+{
+    m_output.write(static_cast<const char *>(pData), static_cast<std::streamsize>(size));
+    return m_output.good();
+}
+
+[[nodiscard]] bool BundleWriter::WriteSignature() noexcept
+{
+    std::array<char, BUNDLE_SIGNATURE.size() + 2 * sizeof(std::uint32_t)> signature{};
+    std::copy(BUNDLE_SIGNATURE.cbegin(), BUNDLE_SIGNATURE.cend(), signature.begin());
+    StoreLittleEndian(BUNDLE_FORMAT_VERSION, signature.data() + BUNDLE_SIGNATURE.size());
+    return Write(signature.data(), signature.size());
+}
+
+[[nodiscard]] bool BundleWriter::BeginRecord(BundleRecordType type, const std::vector<char> &fields, std::uint64_t dataSize) noexcept
+{
+    RETURN_IF(m_isInRecord || (fields.size() > MAX_FIELDS_SIZE), false);
+
+    std::array<char, RECORD_HEADER_SIZE> header{};
+    header[0] = static_cast<char>(type);
+    StoreLittleEndian(static_cast<std::uint32_t>(fields.size()), header.data() + 4);
+    StoreLittleEndian(dataSize, header.data() + 8);
+
+    const std::array<char, BUNDLE_ALIGNMENT> padding{};
+    m_crc = UpdateCRC(UpdateCRC(0, header.data(), header.size()), fields.data(), fields.size());
+    RETURN_IF(!Write(header.data(), header.size()) || !Write(fields.data(), fields.size()) ||
+                  !Write(padding.data(), GetPaddingSize(fields.size())),
+              false);
+
+    m_dataSize = dataSize;
+    m_nbDataWritten = 0;
+    m_isInRecord = true;
+    ++m_nbRecords[static_cast<std::size_t>(type) - 1];
+    return true;
+}
+
+[[nodiscard]] bool BundleWriter::WriteData(const void *pData, std::size_t size) noexcept
+{
+    RETURN_IF(!m_isInRecord || (size > (m_dataSize - m_nbDataWritten)), false);
+    m_crc = UpdateCRC(m_crc, pData, size);
+    m_nbDataWritten += size;
+    return Write(pData, size);
+}
+
+[[nodiscard]] bool BundleWriter::EndRecord() noexcept
+{
+    RETURN_IF(!m_isInRecord || (m_nbDataWritten != m_dataSize), false);
+
+    std::array<char, BUNDLE_ALIGNMENT> trailer{};
+    StoreLittleEndian(m_crc, trailer.data());
+    const std::array<char, BUNDLE_ALIGNMENT> padding{};
+    RETURN_IF(!Write(padding.data(), GetPaddingSize(m_dataSize)) || !Write(trailer.data(), trailer.size()), false);
+
+    m_isInRecord = false;
+    return true;
+}
+
+[[nodiscard]] bool BundleWriter::Finish() noexcept
+{
+    try
+    {
+        std::vector<char> fields;
+        BundleFieldsWriter fieldsWriter{fields};
+        for (const auto nbRecords : m_nbRecords)
+        {
+            fieldsWriter.AddU64(nbRecords);
+        }
+        RETURN_IF(!BeginRecord(BundleRecordType::End, fields, 0) || !EndRecord(), false);
+        m_output.flush();
+        return m_output.good();
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+[[nodiscard]] std::uint64_t BundleWriter::GetNbRecords(BundleRecordType type) const noexcept
+{
+    return m_nbRecords[static_cast<std::size_t>(type) - 1];
+}
+
+[[nodiscard]] bool BundleReader::Read(void *pData, std::size_t size) noexcept
+{
+    m_input.read(static_cast<char *>(pData), static_cast<std::streamsize>(size));
+    return m_input.good() && (static_cast<std::size_t>(m_input.gcount()) == size);
+}
+
+[[nodiscard]] bool BundleReader::ReadSignature() noexcept
+{
+    std::array<char, BUNDLE_SIGNATURE.size() + 2 * sizeof(std::uint32_t)> signature{};
+    RETURN_IF(!Read(signature.data(), signature.size()), false);
+    return std::equal(BUNDLE_SIGNATURE.cbegin(), BUNDLE_SIGNATURE.cend(), signature.cbegin()) &&
+           (LoadLittleEndian<std::uint32_t>(signature.data() + BUNDLE_SIGNATURE.size()) == BUNDLE_FORMAT_VERSION);
+}
+
+[[nodiscard]] bool BundleReader::ReadRecord(BundleRecord &record)
+{
+    RETURN_IF(m_isInRecord || m_isComplete, false);
+
+    std::array<char, RECORD_HEADER_SIZE> header{};
+    RETURN_IF(!Read(header.data(), header.size()), false);
+    const auto type = static_cast<std::uint8_t>(header[0]);
+    const auto fieldsSize = LoadLittleEndian<std::uint32_t>(header.data() + 4);
+    RETURN_IF((type == 0) || (type > NB_BUNDLE_RECORD_TYPES) || (fieldsSize > MAX_FIELDS_SIZE), false);
+
+    record.m_type = static_cast<BundleRecordType>(type);
+    record.m_dataSize = LoadLittleEndian<std::uint64_t>(header.data() + 8);
+    record.m_fields.resize(fieldsSize);
+    std::array<char, BUNDLE_ALIGNMENT> padding{};
+    RETURN_IF(!Read(record.m_fields.data(), fieldsSize) || !Read(padding.data(), GetPaddingSize(fieldsSize)), false);
+
+    m_crc = UpdateCRC(UpdateCRC(0, header.data(), header.size()), record.m_fields.data(), record.m_fields.size());
+    m_dataSize = record.m_dataSize;
+    m_nbDataRead = 0;
+    m_isInRecord = true;
+
+    if (record.m_type != BundleRecordType::End)
+    {
+        ++m_nbRecords[type - 1];
+        return true;
+    }
+
+    // Le bundle est complet si l'enregistrement End est intact et qu'aucun autre
+    // enregistrement n'a été perdu en chemin
+    RETURN_IF((record.m_dataSize != 0) || !EndRecord(), false);
+    BundleFieldsReader fieldsReader{record.m_fields};
+    for (std::size_t iType = 0; iType < NB_BUNDLE_RECORD_TYPES - 1; ++iType)
+    {
+        std::uint64_t nbRecords{};
+        RETURN_IF(!fieldsReader.ReadU64(nbRecords) || (nbRecords != m_nbRecords[iType]), false);
+    }
+    m_isComplete = true;
+    return true;
+}
+
+[[nodiscard]] bool BundleReader::ReadData(void *pData, std::size_t size) noexcept
+{
+    RETURN_IF(!m_isInRecord || (size > (m_dataSize - m_nbDataRead)), false);
+    RETURN_IF(!Read(pData, size), false);
+    m_crc = UpdateCRC(m_crc, pData, size);
+    m_nbDataRead += size;
+    return true;
+}
+
+[[nodiscard]] bool BundleReader::SkipData() noexcept
+{
+    std::array<char, SKIP_BUFFER_SIZE> buffer{};
+    while (m_nbDataRead < m_dataSize)
+    {
+        RETURN_IF(!ReadData(buffer.data(), static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), m_dataSize - m_nbDataRead))), false);
+    }
+    return true;
+}
+
+[[nodiscard]] bool BundleReader::EndRecord() noexcept
+{
+    RETURN_IF(!m_isInRecord || (m_nbDataRead != m_dataSize), false);
+
+    std::array<char, BUNDLE_ALIGNMENT> padding{};
+    std::array<char, BUNDLE_ALIGNMENT> trailer{};
+    RETURN_IF(!Read(padding.data(), GetPaddingSize(m_dataSize)) || !Read(trailer.data(), trailer.size()), false);
+
+    m_isInRecord = false;
+    return LoadLittleEndian<std::uint32_t>(trailer.data()) == m_crc;
+}
+
+} // namespace dvcs
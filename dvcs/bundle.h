@@ -0,0 +1,167 @@
+#pragma once
+
+#include "hash.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Types des enregistrements d'un bundle.
+// NOTE: Les valeurs sont écrites dans les bundles et ne doivent donc jamais changer.
+// Champs de chacun des types (les données suivent les champs):
+//  Header:       algorithme de hachage
+//  Prerequisite: hash d'un commit que le destinataire doit déjà avoir
+//  Dictionary:   identifiant; données: contenu du dictionnaire
+//  Chunk:        hash, taille, codec; données: contenu compressé
+//  Object:       hash, path, taille, codec, base, profondeur, présence du contenu,
+//                hash des morceaux; données: contenu compressé
+//  Commit:       hash, parent, commit fusionné, auteur, courriel, message,
+//                branches; données: fichiers du commit, l'un à la suite de
+//                l'autre (chemin encodé comme une chaîne, puis hash de l'objet,
+//                absent d'un fichier retiré)
+//  Branch:       nom, commit de tête
+//  End:          nombre d'enregistrements de chacun des types
+////////////////////////////////////////////////////////////////////////////////////
+enum class BundleRecordType : std::uint8_t
+{
+    Header = 1,
+    Prerequisite = 2,
+    Dictionary = 3,
+    Chunk = 4,
+    Object = 5,
+    Commit = 6,
+    Branch = 7,
+    End = 8
+};
+
+constexpr const std::size_t NB_BUNDLE_RECORD_TYPES = static_cast<std::size_t>(BundleRecordType::End);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Enregistrement lu d'un bundle: ses champs sont chargés en mémoire, alors que ses
+// données, potentiellement volumineuses, sont lues à la demande.
+////////////////////////////////////////////////////////////////////////////////////
+struct BundleRecord
+{
+    BundleRecordType m_type{};
+    std::vector<char> m_fields;
+    std::uint64_t m_dataSize{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Encodage des champs d'un enregistrement (petit-boutiste)
+////////////////////////////////////////////////////////////////////////////////////
+class BundleFieldsWriter
+{
+  public:
+    explicit BundleFieldsWriter(std::vector<char> &fields) noexcept : m_fields{fields} { m_fields.clear(); }
+
+    void AddU8(std::uint8_t value);
+    void AddU32(std::uint32_t value);
+    void AddU64(std::uint64_t value);
+    void AddString(std::string_view value);
+    void AddHash(const THash &hash);
+    void AddNoHash(); // Hash absent (NULL)
+
+  private:
+    std::vector<char> &m_fields;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Décodage des champs d'un enregistrement. Toute lecture au-delà des champs échoue.
+////////////////////////////////////////////////////////////////////////////////////
+class BundleFieldsReader
+{
+  public:
+    explicit BundleFieldsReader(const std::vector<char> &fields) noexcept : m_fields{fields} {}
+
+    [[nodiscard]] bool ReadU8(std::uint8_t &value) noexcept;
+    [[nodiscard]] bool ReadU32(std::uint32_t &value) noexcept;
+    [[nodiscard]] bool ReadU64(std::uint64_t &value) noexcept;
+    [[nodiscard]] bool ReadString(std::string &value);
+    [[nodiscard]] bool ReadHash(THash &hash, bool &isPresent) noexcept;
+    [[nodiscard]] bool IsAtEnd() const noexcept { return m_offset == m_fields.size(); }
+
+  private:
+    [[nodiscard]] bool ReadBytes(void *pData, std::size_t size) noexcept;
+
+    const std::vector<char> &m_fields;
+    std::size_t m_offset{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écriture séquentielle d'un bundle.
+// Un bundle est une suite d'enregistrements, précédée d'une signature et terminée
+// par un enregistrement End qui permet de détecter un bundle tronqué. Chaque
+// enregistrement est composé d'un en-tête de taille fixe, de ses champs, de ses
+// données puis de la somme de contrôle (CRC32) de ses champs et de ses données.
+// Toutes les parties sont alignées sur 8 octets: un bundle projeté en mémoire peut
+// donc être lu sur place.
+// La taille des données d'un enregistrement est connue d'avance, ce qui permet de
+// les écrire (et de les lire) par morceaux, à mémoire constante.
+////////////////////////////////////////////////////////////////////////////////////
+class BundleWriter
+{
+  public:
+    explicit BundleWriter(std::ostream &output) noexcept : m_output{output} {}
+
+    [[nodiscard]] bool WriteSignature() noexcept;
+    [[nodiscard]] bool BeginRecord(BundleRecordType type, const std::vector<char> &fields, std::uint64_t dataSize) noexcept;
+    [[nodiscard]] bool WriteData(const void *pData, std::size_t size) noexcept;
+    [[nodiscard]] bool EndRecord() noexcept;
+
+    // Termine le bundle à l'aide de l'enregistrement End
+    [[nodiscard]] bool Finish() noexcept;
+
+    [[nodiscard]] std::uint64_t GetNbRecords(BundleRecordType type) const noexcept;
+
+  private:
+    [[nodiscard]] bool Write(const void *pData, std::size_t size) noexcept;
+
+    std::ostream &m_output;
+    std::uint32_t m_crc{};
+    std::uint64_t m_dataSize{};
+    std::uint64_t m_nbDataWritten{};
+    bool m_isInRecord{false};
+    std::array<std::uint64_t, NB_BUNDLE_RECORD_TYPES> m_nbRecords{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lecture séquentielle d'un bundle.
+// Les sommes de contrôle sont validées à la fin de chacun des enregistrements et le
+// nombre d'enregistrements lus l'est à la rencontre de l'enregistrement End.
+////////////////////////////////////////////////////////////////////////////////////
+class BundleReader
+{
+  public:
+    explicit BundleReader(std::istream &input) noexcept : m_input{input} {}
+
+    [[nodiscard]] bool ReadSignature() noexcept;
+    [[nodiscard]] bool ReadRecord(BundleRecord &record);
+    [[nodiscard]] bool ReadData(void *pData, std::size_t size) noexcept;
+    [[nodiscard]] bool SkipData() noexcept;
+    [[nodiscard]] bool EndRecord() noexcept;
+
+    // Le bundle a été lu au complet et est valide
+    [[nodiscard]] bool IsComplete() const noexcept { return m_isComplete; }
+
+  private:
+    [[nodiscard]] bool Read(void *pData, std::size_t size) noexcept;
+
+    std::istream &m_input;
+    std::uint32_t m_crc{};
+    std::uint64_t m_dataSize{};
+    std::uint64_t m_nbDataRead{};
+    bool m_isInRecord{false};
+    bool m_isComplete{false};
+    std::array<std::uint64_t, NB_BUNDLE_RECORD_TYPES> m_nbRecords{};
+};
+
+} // namespace dvcs
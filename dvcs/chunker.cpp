@@ -0,0 +1,138 @@
+#include "chunker.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <istream>
+
+namespace
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Table de l'empreinte Gear: une valeur pseudo-aléatoire de 64 bits par octet.
+// Elle est générée à la compilation (SplitMix64) pour que les frontières des
+// morceaux, et donc le stockage, ne changent jamais d'une version à l'autre.
+////////////////////////////////////////////////////////////////////////////////////
+constexpr std::array<std::uint64_t, 256> MakeGearTable() noexcept
+{
+    std::array<std::uint64_t, 256> table{};
+    std::uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (auto &value : table)
+    {
+        state += 0x9E3779B97F4A7C15ULL;
+        std::uint64_t mixed = state;
+        mixed = (mixed ^ (mixed >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+        mixed = (mixed ^ (mixed >> 27U)) * 0x94D049BB133111EBULL;
+        value = mixed ^ (mixed >> 31U);
+    }
+    return table;
+}
+
+constexpr const std::array<std::uint64_t, 256> GEAR_TABLE = MakeGearTable();
+
+// Masque dont les <nbBits> bits de poids fort sont à 1. Ce sont ces bits qui
+// dépendent du plus grand nombre d'octets dans l'empreinte Gear.
+constexpr std::uint64_t MakeMask(int nbBits) noexcept { return ~0ULL << (64 - nbBits); }
+
+// Normalisation du découpage: avant la taille visée, une frontière est plus
+// difficile à trouver (plus de bits), après, elle l'est moins. La distribution des
+// tailles des morceaux se resserre ainsi autour de la taille visée.
+constexpr const int AVERAGE_CHUNK_BITS = std::bit_width(dvcs::AVERAGE_CHUNK_SIZE) - 1;
+constexpr const std::uint64_t SMALL_CHUNK_MASK = MakeMask(AVERAGE_CHUNK_BITS + 2);
+constexpr const std::uint64_t LARGE_CHUNK_MASK = MakeMask(AVERAGE_CHUNK_BITS - 2);
+
+} // namespace
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Position de la fin du premier morceau des données <pData> de taille <size>.
+// Les données doivent contenir au moins MAX_CHUNK_SIZE octets, à moins d'être les
+// dernières d'un flux.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::size_t FindChunkEnd(const std::uint8_t *pData, std::size_t size) noexcept
+{
+    if (size <= MIN_CHUNK_SIZE)
+    {
+        return size;
+    }
+
+    size = std::min(size, MAX_CHUNK_SIZE);
+    const std::size_t normalSize = std::min(size, AVERAGE_CHUNK_SIZE);
+
+    // Une frontière ne peut se trouver avant la taille minimale: inutile de
+    // calculer l'empreinte des premiers octets.
+    std::uint64_t fingerprint{};
+    std::size_t iByte = MIN_CHUNK_SIZE;
+    for (; iByte < normalSize; ++iByte)
+    {
+        fingerprint = (fingerprint << 1U) + GEAR_TABLE[pData[iByte]];
+        if ((fingerprint & SMALL_CHUNK_MASK) == 0)
+        {
+            return iByte;
+        }
+    }
+    for (; iByte < size; ++iByte)
+    {
+        fingerprint = (fingerprint << 1U) + GEAR_TABLE[pData[iByte]];
+        if ((fingerprint & LARGE_CHUNK_MASK) == 0)
+        {
+            return iByte;
+        }
+    }
+    return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Découpe le flux <input> en morceaux <chunks> et calcule au passage le hash <hash>
+// de l'ensemble des données selon l'algorithme <algorithm>. Les hash des morceaux
+// sont calculés à l'aide du même algorithme.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ChunkStream(std::istream &input, HashAlgorithm algorithm, std::vector<Chunk> &chunks, THash &hash)
+{
+    chunks.clear();
+    if (!input.good())
+    {
+        return false;
+    }
+
+    auto pStreamEngine = CreateHashEngine(algorithm);
+    auto pChunkEngine = CreateHashEngine(algorithm);
+
+    // Le tampon contient toujours au moins un morceau complet, sauf à la fin du flux
+    std::vector<std::uint8_t> buffer(2 * MAX_CHUNK_SIZE);
+    std::size_t nbBuffered{};
+    std::uintmax_t offset{};
+    bool isEndOfStream = false;
+    while (!isEndOfStream || (nbBuffered > 0))
+    {
+        if (!isEndOfStream && (nbBuffered < MAX_CHUNK_SIZE))
+        {
+            input.read(reinterpret_cast<char *>(buffer.data() + nbBuffered), static_cast<std::streamsize>(buffer.size() - nbBuffered));
+            if (input.bad())
+            {
+                return false;
+            }
+            const auto nbRead = static_cast<std::size_t>(input.gcount());
+            pStreamEngine->Update(buffer.data() + nbBuffered, nbRead);
+            nbBuffered += nbRead;
+            isEndOfStream = input.eof();
+            continue;
+        }
+
+        const std::size_t chunkSize = FindChunkEnd(buffer.data(), nbBuffered);
+        pChunkEngine->Update(buffer.data(), chunkSize);
+        chunks.push_back({offset, chunkSize, pChunkEngine->Finalize()});
+
+        offset += chunkSize;
+        nbBuffered -= chunkSize;
+        std::memmove(buffer.data(), buffer.data() + chunkSize, nbBuffered);
+    }
+
+    hash = pStreamEngine->Finalize();
+    return true;
+}
+
+} // namespace dvcs
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace dvcs
+{
+
+// Bornes et taille visée des morceaux produits par le découpage d'un flux
+constexpr const std::size_t MIN_CHUNK_SIZE = 16U * 1024U;
+constexpr const std::size_t AVERAGE_CHUNK_SIZE = 64U * 1024U;
+constexpr const std::size_t MAX_CHUNK_SIZE = 256U * 1024U;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Morceau d'un objet découpé selon son contenu
+////////////////////////////////////////////////////////////////////////////////////
+struct Chunk
+{
+    std::uintmax_t m_offset{}; // Position du morceau dans les données brutes de l'objet
+    std::size_t m_size{};
+    THash m_hash{}; // Hash des données brutes du morceau
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Découpage de données selon leur contenu (FastCDC).
+// Les frontières des morceaux sont déterminées par une empreinte roulante (Gear)
+// calculée sur les derniers octets lus plutôt que par des positions fixes. Une
+// insertion ou une suppression ne modifie donc que les morceaux qui la touchent:
+// les suivants retrouvent les mêmes frontières et, par le fait même, le même hash.
+// Voir: https://www.usenix.org/conference/atc16/technical-sessions/presentation/xia
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::size_t FindChunkEnd(const std::uint8_t *pData, std::size_t size) noexcept;
+
+// Découpe le flux <input> en morceaux <chunks> et calcule au passage le hash <hash>
+// de l'ensemble des données. La mémoire utilisée est constante.
+[[nodiscard]] bool ChunkStream(std::istream &input, HashAlgorithm algorithm, std::vector<Chunk> &chunks, THash &hash);
+
+} // namespace dvcs
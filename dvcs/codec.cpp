@@ -0,0 +1,778 @@
+#include "codec.h"
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <lz4frame.h>
+#include <zdict.h>
+#include <zstd.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <ostream>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// Taille des morceaux lus lors d'une compression par morceaux
+constexpr const std::size_t CHUNK_SIZE = 64U * 1024U;
+
+// Le sondage d'entropie ne porte que sur le début des données...
+constexpr const std::size_t ENTROPY_SAMPLE_SIZE = 64U * 1024U;
+
+// ... et n'est pas significatif sur de trop petits échantillons
+constexpr const std::size_t MIN_ENTROPY_SAMPLE_SIZE = 512U;
+
+// Au-delà de ce seuil (en bits par octet), les données sont considérées comme étant
+// déjà compressées (images, archives, etc.). Le maximum théorique est de 8.
+constexpr const double INCOMPRESSIBLE_ENTROPY = 7.5;
+
+// Bornes de la fenêtre de zstd lors de la compression d'un delta. La borne
+// supérieure (128 Mo) est la plus grande fenêtre acceptée par défaut par les
+// décompresseurs zstd.
+constexpr const int MIN_DELTA_WINDOW_LOG = 10;
+constexpr const int MAX_DELTA_WINDOW_LOG = 27;
+
+// Taille de fenêtre à partir de laquelle la recherche de longues correspondances
+// est activée: sans elle, zstd ne retrouve qu'une partie de l'objet de base.
+constexpr const int LONG_DELTA_WINDOW_LOG = 23;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Informations sur un codec
+////////////////////////////////////////////////////////////////////////////////////
+struct CodecInfo
+{
+    dvcs::Codec m_codec;
+    std::string_view m_name;
+    int m_minLevel;
+    int m_maxLevel;
+    int m_defaultLevel;
+};
+
+// Niveaux de lz4: 1 et 2 utilisent l'algorithme rapide, 3 à 12 LZ4HC
+constexpr const std::array<CodecInfo, 4> CODEC_INFOS{{{dvcs::Codec::Zlib, "zlib", 1, 9, 6},
+                                                      {dvcs::Codec::Store, "store", 0, 0, 0},
+                                                      {dvcs::Codec::Zstd, "zstd", 1, 22, 3},
+                                                      {dvcs::Codec::LZ4, "lz4", 1, 12, 1}}};
+
+[[nodiscard]] const CodecInfo &GetCodecInfo(dvcs::Codec codec) noexcept
+{
+    return *std::find_if(CODEC_INFOS.cbegin(), CODEC_INFOS.cend(), [codec](const CodecInfo &info) { return info.m_codec == codec; });
+}
+
+using TZstdCompressionContextPtr = std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)>;
+using TZstdDecompressionContextPtr = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>;
+using TZstdCompressionDictionaryPtr = std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)>;
+using TZstdDecompressionDictionaryPtr = std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Puits Boost.IOStreams écrivant les données reçues dans un flux tout en
+// comptant leur nombre.
+////////////////////////////////////////////////////////////////////////////////////
+class CountingSink
+{
+  public:
+    using char_type = char;
+    using category = boost::iostreams::sink_tag;
+
+    CountingSink(std::ostream &outputStream, std::uintmax_t &nbBytes) : m_pOutputStream{&outputStream}, m_pNbBytes{&nbBytes} {}
+
+    std::streamsize write(const char *pData, std::streamsize size)
+    {
+        m_pOutputStream->write(pData, size);
+        RETURN_IF(!m_pOutputStream->good(), -1);
+        *m_pNbBytes += static_cast<std::uintmax_t>(size);
+        return size;
+    }
+
+  private:
+    // NOTE: Les périphériques Boost.IOStreams sont copiés, d'où les pointeurs
+    std::ostream *m_pOutputStream;
+    std::uintmax_t *m_pNbBytes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Préférences de lz4 correspondant au niveau de compression <level>.
+// Le format de trame est utilisé pour que les données puissent être traitées par
+// morceaux et décompressées sans connaître leur taille à l'avance.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] LZ4F_preferences_t GetLZ4Preferences(int level, std::size_t contentSize) noexcept
+{
+    LZ4F_preferences_t preferences{};
+    preferences.compressionLevel = level;
+    preferences.frameInfo.contentSize = contentSize;
+    return preferences;
+}
+
+[[nodiscard]] bool CompressZlib(int level, const void *pData, std::size_t size, std::vector<char> &contents)
+{
+    namespace bios = boost::iostreams;
+
+    bios::filtering_ostream compressingStream;
+    compressingStream.push(bios::zlib_compressor(bios::zlib_params(level)));
+    compressingStream.push(bios::back_inserter(contents));
+    compressingStream.exceptions(std::ios::badbit | std::ios::failbit);
+    compressingStream.write(static_cast<const char *>(pData), static_cast<std::streamsize>(size));
+    // NOTE: La fermeture du flux vide les tampons du compresseur
+    compressingStream.reset();
+    return true;
+}
+
+[[nodiscard]] bool CompressZstd(int level, const void *pData, std::size_t size, std::vector<char> &contents, const ZSTD_CDict *pDictionary) noexcept
+{
+    contents.resize(ZSTD_compressBound(size));
+    std::size_t result{};
+    if (pDictionary == nullptr)
+    {
+        result = ZSTD_compress(contents.data(), contents.size(), pData, size, level);
+    }
+    else
+    {
+        // NOTE: Le niveau de compression est celui avec lequel le dictionnaire a été préparé
+        TZstdCompressionContextPtr pContext{ZSTD_createCCtx(), ZSTD_freeCCtx};
+        RETURN_IF(pContext == nullptr, false);
+        result = ZSTD_compress_usingCDict(pContext.get(), contents.data(), contents.size(), pData, size, pDictionary);
+    }
+    if (ZSTD_isError(result) != 0)
+    {
+        fmt::print(std::cerr, "zstd error: {}\n", ZSTD_getErrorName(result));
+        return false;
+    }
+    contents.resize(result);
+    return true;
+}
+
+[[nodiscard]] bool CompressLZ4(int level, const void *pData, std::size_t size, std::vector<char> &contents) noexcept
+{
+    const auto preferences = GetLZ4Preferences(level, size);
+    contents.resize(LZ4F_compressFrameBound(size, &preferences));
+    const std::size_t result = LZ4F_compressFrame(contents.data(), contents.size(), pData, size, &preferences);
+    if (LZ4F_isError(result) != 0)
+    {
+        fmt::print(std::cerr, "lz4 error: {}\n", LZ4F_getErrorName(result));
+        return false;
+    }
+    contents.resize(result);
+    return true;
+}
+
+[[nodiscard]] bool DecompressZlib(const void *pContent, std::size_t size, std::vector<char> &rawData)
+{
+    namespace bios = boost::iostreams;
+
+    RETURN_IF((pContent == nullptr) || (size == 0), false);
+    bios::filtering_istream decompressingStream;
+    decompressingStream.push(bios::zlib_decompressor());
+    decompressingStream.push(bios::array_source{static_cast<const char *>(pContent), size});
+    bios::copy(decompressingStream, bios::back_inserter(rawData));
+    return true;
+}
+
+[[nodiscard]] bool DecompressZstdFrame(ZSTD_DCtx *pContext, const void *pContent, std::size_t size, std::vector<char> &rawData)
+{
+    // La taille des données brutes n'est pas connue si elles ont été compressées par morceaux
+    const auto contentSize = ZSTD_getFrameContentSize(pContent, size);
+    RETURN_IF(contentSize == ZSTD_CONTENTSIZE_ERROR, false);
+    if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        rawData.reserve(static_cast<std::size_t>(contentSize));
+    }
+
+    std::vector<char> buffer(ZSTD_DStreamOutSize());
+    ZSTD_inBuffer input{pContent, size, 0};
+    ZSTD_outBuffer output{};
+    std::size_t result{};
+    do
+    {
+        output = ZSTD_outBuffer{buffer.data(), buffer.size(), 0};
+        result = ZSTD_decompressStream(pContext, &output, &input);
+        if (ZSTD_isError(result) != 0)
+        {
+            fmt::print(std::cerr, "zstd error: {}\n", ZSTD_getErrorName(result));
+            return false;
+        }
+        rawData.insert(rawData.end(), buffer.data(), buffer.data() + output.pos);
+    } while ((input.pos < input.size) || (output.pos == output.size));
+
+    // Une trame incomplète laisse le décompresseur en attente de données
+    return result == 0;
+}
+
+[[nodiscard]] bool DecompressZstd(const void *pContent, std::size_t size, std::vector<char> &rawData, const ZSTD_DDict *pDictionary)
+{
+    TZstdDecompressionContextPtr pContext{ZSTD_createDCtx(), ZSTD_freeDCtx};
+    RETURN_IF(pContext == nullptr, false);
+    RETURN_IF((pDictionary != nullptr) && (ZSTD_isError(ZSTD_DCtx_refDDict(pContext.get(), pDictionary)) != 0), false);
+    return DecompressZstdFrame(pContext.get(), pContent, size, rawData);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Taille de la fenêtre (en puissance de 2) permettant à zstd de trouver des
+// correspondances dans l'ensemble d'un objet de base de taille <baseSize> lors
+// de la compression d'un objet de taille <size>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] int GetDeltaWindowLog(std::size_t baseSize, std::size_t size) noexcept
+{
+    const auto windowSize = static_cast<std::uint64_t>(baseSize) + size;
+    return std::clamp(static_cast<int>(std::bit_width(windowSize)), MIN_DELTA_WINDOW_LOG, MAX_DELTA_WINDOW_LOG);
+}
+
+[[nodiscard]] bool DecompressLZ4(const void *pContent, std::size_t size, std::vector<char> &rawData)
+{
+    LZ4F_dctx *pContextHandle = nullptr;
+    RETURN_IF(LZ4F_isError(LZ4F_createDecompressionContext(&pContextHandle, LZ4F_VERSION)) != 0, false);
+    std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)> pContext{pContextHandle, LZ4F_freeDecompressionContext};
+
+    std::array<char, CHUNK_SIZE> buffer{};
+    const auto *pSource = static_cast<const char *>(pContent);
+    const char *pSourceEnd = pSource + size;
+    std::size_t result = 1;
+    while (result != 0)
+    {
+        std::size_t nbRead = static_cast<std::size_t>(pSourceEnd - pSource);
+        std::size_t nbWritten = buffer.size();
+        result = LZ4F_decompress(pContext.get(), buffer.data(), &nbWritten, pSource, &nbRead, nullptr);
+        if (LZ4F_isError(result) != 0)
+        {
+            fmt::print(std::cerr, "lz4 error: {}\n", LZ4F_getErrorName(result));
+            return false;
+        }
+        pSource += nbRead;
+        rawData.insert(rawData.end(), buffer.data(), buffer.data() + nbWritten);
+
+        // Plus rien à lire ni à écrire alors que la trame n'est pas terminée
+        RETURN_IF((result != 0) && (nbRead == 0) && (nbWritten == 0), false);
+    }
+    return true;
+}
+
+[[nodiscard]] bool CompressZlibStream(int level, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    namespace bios = boost::iostreams;
+
+    bios::filtering_ostream compressingStream;
+    compressingStream.push(bios::zlib_compressor(bios::zlib_params(level)));
+    compressingStream.push(CountingSink{output, nbWritten});
+    // NOTE: copy ferme les deux flux, ce qui vide les tampons du compresseur
+    bios::copy(input, compressingStream, CHUNK_SIZE);
+    return output.good();
+}
+
+[[nodiscard]] bool CompressZstdStream(int level, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    TZstdCompressionContextPtr pContext{ZSTD_createCCtx(), ZSTD_freeCCtx};
+    RETURN_IF(pContext == nullptr, false);
+    RETURN_IF(ZSTD_isError(ZSTD_CCtx_setParameter(pContext.get(), ZSTD_c_compressionLevel, level)) != 0, false);
+
+    std::array<char, CHUNK_SIZE> inputBuffer{};
+    std::vector<char> outputBuffer(ZSTD_CStreamOutSize());
+    bool isLastChunk = false;
+    while (!isLastChunk)
+    {
+        input.read(inputBuffer.data(), inputBuffer.size());
+        RETURN_IF(input.bad(), false);
+        isLastChunk = input.eof();
+
+        // Le dernier morceau termine la trame, ce qui peut nécessiter plusieurs appels
+        const ZSTD_EndDirective directive = isLastChunk ? ZSTD_e_end : ZSTD_e_continue;
+        ZSTD_inBuffer inBuffer{inputBuffer.data(), static_cast<std::size_t>(input.gcount()), 0};
+        bool isDone = false;
+        while (!isDone)
+        {
+            ZSTD_outBuffer outBuffer{outputBuffer.data(), outputBuffer.size(), 0};
+            const std::size_t remaining = ZSTD_compressStream2(pContext.get(), &outBuffer, &inBuffer, directive);
+            if (ZSTD_isError(remaining) != 0)
+            {
+                fmt::print(std::cerr, "zstd error: {}\n", ZSTD_getErrorName(remaining));
+                return false;
+            }
+            RETURN_IF(!output.write(outputBuffer.data(), static_cast<std::streamsize>(outBuffer.pos)), false);
+            nbWritten += outBuffer.pos;
+            isDone = isLastChunk ? (remaining == 0) : (inBuffer.pos == inBuffer.size);
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool CompressLZ4Stream(int level, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    LZ4F_cctx *pContextHandle = nullptr;
+    RETURN_IF(LZ4F_isError(LZ4F_createCompressionContext(&pContextHandle, LZ4F_VERSION)) != 0, false);
+    std::unique_ptr<LZ4F_cctx, decltype(&LZ4F_freeCompressionContext)> pContext{pContextHandle, LZ4F_freeCompressionContext};
+
+    const auto preferences = GetLZ4Preferences(level, 0);
+    std::array<char, CHUNK_SIZE> inputBuffer{};
+    std::vector<char> outputBuffer(std::max<std::size_t>(LZ4F_compressBound(inputBuffer.size(), &preferences), LZ4F_HEADER_SIZE_MAX));
+
+    auto writeOutput = [&output, &outputBuffer, &nbWritten](std::size_t result) {
+        if (LZ4F_isError(result) != 0)
+        {
+            fmt::print(std::cerr, "lz4 error: {}\n", LZ4F_getErrorName(result));
+            return false;
+        }
+        RETURN_IF(!output.write(outputBuffer.data(), static_cast<std::streamsize>(result)), false);
+        nbWritten += result;
+        return true;
+    };
+
+    RETURN_IF(!writeOutput(LZ4F_compressBegin(pContext.get(), outputBuffer.data(), outputBuffer.size(), &preferences)), false);
+    while (input.read(inputBuffer.data(), inputBuffer.size()) || (input.gcount() > 0))
+    {
+        RETURN_IF(!writeOutput(LZ4F_compressUpdate(pContext.get(), outputBuffer.data(), outputBuffer.size(), inputBuffer.data(),
+                                                   static_cast<std::size_t>(input.gcount()), nullptr)),
+                  false);
+    }
+    RETURN_IF(input.bad(), false);
+    return writeOutput(LZ4F_compressEnd(pContext.get(), outputBuffer.data(), outputBuffer.size(), nullptr));
+}
+
+[[nodiscard]] bool CopyStream(std::istream &input, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    std::array<char, CHUNK_SIZE> buffer{};
+    while (input.read(buffer.data(), buffer.size()) || (input.gcount() > 0))
+    {
+        RETURN_IF(!output.write(buffer.data(), input.gcount()), false);
+        nbWritten += static_cast<std::uintmax_t>(input.gcount());
+    }
+    return !input.bad();
+}
+
+[[nodiscard]] bool DecompressZlibStream(std::istream &input, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    namespace bios = boost::iostreams;
+
+    bios::filtering_istream decompressingStream;
+    decompressingStream.push(bios::zlib_decompressor());
+    decompressingStream.push(input);
+    bios::copy(decompressingStream, CountingSink{output, nbWritten}, CHUNK_SIZE);
+    return output.good();
+}
+
+[[nodiscard]] bool DecompressZstdStream(std::istream &input, std::ostream &output, std::uintmax_t &nbWritten, const ZSTD_DDict *pDictionary)
+{
+    TZstdDecompressionContextPtr pContext{ZSTD_createDCtx(), ZSTD_freeDCtx};
+    RETURN_IF(pContext == nullptr, false);
+    RETURN_IF((pDictionary != nullptr) && (ZSTD_isError(ZSTD_DCtx_refDDict(pContext.get(), pDictionary)) != 0), false);
+
+    std::array<char, CHUNK_SIZE> inputBuffer{};
+    std::vector<char> outputBuffer(ZSTD_DStreamOutSize());
+    std::size_t result = 1;
+    while (input.read(inputBuffer.data(), inputBuffer.size()) || (input.gcount() > 0))
+    {
+        ZSTD_inBuffer inBuffer{inputBuffer.data(), static_cast<std::size_t>(input.gcount()), 0};
+        ZSTD_outBuffer outBuffer{};
+        do
+        {
+            outBuffer = ZSTD_outBuffer{outputBuffer.data(), outputBuffer.size(), 0};
+            result = ZSTD_decompressStream(pContext.get(), &outBuffer, &inBuffer);
+            if (ZSTD_isError(result) != 0)
+            {
+                fmt::print(std::cerr, "zstd error: {}\n", ZSTD_getErrorName(result));
+                return false;
+            }
+            RETURN_IF(!output.write(outputBuffer.data(), static_cast<std::streamsize>(outBuffer.pos)), false);
+            nbWritten += outBuffer.pos;
+        } while ((inBuffer.pos < inBuffer.size) || (outBuffer.pos == outBuffer.size));
+    }
+
+    // Une trame incomplète laisse le décompresseur en attente de données
+    return !input.bad() && (result == 0);
+}
+
+[[nodiscard]] bool DecompressLZ4Stream(std::istream &input, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    LZ4F_dctx *pContextHandle = nullptr;
+    RETURN_IF(LZ4F_isError(LZ4F_createDecompressionContext(&pContextHandle, LZ4F_VERSION)) != 0, false);
+    std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)> pContext{pContextHandle, LZ4F_freeDecompressionContext};
+
+    std::array<char, CHUNK_SIZE> inputBuffer{};
+    std::array<char, CHUNK_SIZE> outputBuffer{};
+    std::size_t result = 1;
+    while (input.read(inputBuffer.data(), inputBuffer.size()) || (input.gcount() > 0))
+    {
+        const char *pSource = inputBuffer.data();
+        const char *pSourceEnd = pSource + input.gcount();
+        std::size_t nbDecompressed{};
+        do
+        {
+            std::size_t nbRead = static_cast<std::size_t>(pSourceEnd - pSource);
+            nbDecompressed = outputBuffer.size();
+            result = LZ4F_decompress(pContext.get(), outputBuffer.data(), &nbDecompressed, pSource, &nbRead, nullptr);
+            if (LZ4F_isError(result) != 0)
+            {
+                fmt::print(std::cerr, "lz4 error: {}\n", LZ4F_getErrorName(result));
+                return false;
+            }
+            pSource += nbRead;
+            RETURN_IF(!output.write(outputBuffer.data(), static_cast<std::streamsize>(nbDecompressed)), false);
+            nbWritten += nbDecompressed;
+        } while ((pSource < pSourceEnd) || (nbDecompressed == outputBuffer.size()));
+    }
+
+    // Une trame qui n'est pas terminée a été tronquée
+    return !input.bad() && (result == 0);
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+struct CompressionDictionary::Digested
+{
+    TZstdCompressionDictionaryPtr m_pCompressionDictionary{nullptr, ZSTD_freeCDict};
+    TZstdDecompressionDictionaryPtr m_pDecompressionDictionary{nullptr, ZSTD_freeDDict};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Prépare le dictionnaire <content> pour la compression au niveau <level> et pour
+// la décompression. Un dictionnaire qui n'a pas été produit par TrainDictionary
+// est invalide.
+////////////////////////////////////////////////////////////////////////////////////
+CompressionDictionary::CompressionDictionary(std::vector<char> content, int level)
+    : m_content{std::move(content)}, m_id{static_cast<std::uint32_t>(ZDICT_getDictID(m_content.data(), m_content.size()))},
+      m_pDigested{std::make_unique<Digested>()}
+{
+    if (m_id != 0)
+    {
+        m_pDigested->m_pCompressionDictionary.reset(ZSTD_createCDict(m_content.data(), m_content.size(), level));
+        m_pDigested->m_pDecompressionDictionary.reset(ZSTD_createDDict(m_content.data(), m_content.size()));
+    }
+}
+
+CompressionDictionary::~CompressionDictionary() = default;
+
+[[nodiscard]] bool CompressionDictionary::IsValid() const noexcept
+{
+    return (m_id != 0) && (m_pDigested->m_pCompressionDictionary != nullptr) && (m_pDigested->m_pDecompressionDictionary != nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Représentation textuelle des paramètres de compression <settings>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::string ToString(const CompressionSettings &settings)
+{
+    const auto &info = GetCodecInfo(settings.m_codec);
+    return (info.m_minLevel == info.m_maxLevel) ? std::string{info.m_name} : fmt::format("{0}:{1}", info.m_name, settings.m_level);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Interprète les paramètres de compression <text> de la forme <codec>[:<niveau>].
+// Sans niveau, le niveau par défaut du codec est utilisé.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ParseCompressionSettings(std::string_view text, CompressionSettings &settings) noexcept
+{
+    const auto separatorPos = text.find(':');
+    const auto name = text.substr(0, separatorPos);
+    const auto infoIt = std::find_if(CODEC_INFOS.cbegin(), CODEC_INFOS.cend(), [name](const CodecInfo &info) { return info.m_name == name; });
+    RETURN_IF(infoIt == CODEC_INFOS.cend(), false);
+
+    int level = infoIt->m_defaultLevel;
+    if (separatorPos != std::string_view::npos)
+    {
+        const auto levelText = text.substr(separatorPos + 1);
+        const auto [pEnd, errorCode] = std::from_chars(levelText.data(), levelText.data() + levelText.size(), level);
+        RETURN_IF((errorCode != std::errc{}) || (pEnd != levelText.data() + levelText.size()), false);
+    }
+    RETURN_IF((level < infoIt->m_minLevel) || (level > infoIt->m_maxLevel), false);
+
+    settings = CompressionSettings{infoIt->m_codec, level};
+    return true;
+}
+
+[[nodiscard]] std::string_view GetCodecName(Codec codec) noexcept { return GetCodecInfo(codec).m_name; }
+
+[[nodiscard]] bool IsValidCodec(int value) noexcept
+{
+    return std::any_of(CODEC_INFOS.cbegin(), CODEC_INFOS.cend(), [value](const CodecInfo &info) { return static_cast<int>(info.m_codec) == value; });
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Transforme les données brutes <pData> de taille <size> en données compressées
+// <contents> selon les paramètres <settings>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Compress(const CompressionSettings &settings, const void *pData, std::size_t size, std::vector<char> &contents,
+                            const CompressionDictionary *pDictionary) noexcept
+{
+    contents.clear();
+    try
+    {
+        switch (settings.m_codec)
+        {
+        case Codec::Zlib:
+            return CompressZlib(settings.m_level, pData, size, contents);
+        case Codec::Store:
+            contents.assign(static_cast<const char *>(pData), static_cast<const char *>(pData) + size);
+            return true;
+        case Codec::Zstd:
+            return CompressZstd(settings.m_level, pData, size, contents,
+                                (pDictionary != nullptr) ? pDictionary->GetDigested().m_pCompressionDictionary.get() : nullptr);
+        case Codec::LZ4:
+            return CompressLZ4(settings.m_level, pData, size, contents);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retrouve les données brutes <rawData> à partir des données <pContent> de taille
+// <size> produites par le codec <codec>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Decompress(Codec codec, const void *pContent, std::size_t size, std::vector<char> &rawData,
+                              const CompressionDictionary *pDictionary) noexcept
+{
+    rawData.clear();
+    try
+    {
+        switch (codec)
+        {
+        case Codec::Zlib:
+            return DecompressZlib(pContent, size, rawData);
+        case Codec::Store:
+            rawData.assign(static_cast<const char *>(pContent), static_cast<const char *>(pContent) + size);
+            return true;
+        case Codec::Zstd:
+            return DecompressZstd(pContent, size, rawData,
+                                  (pDictionary != nullptr) ? pDictionary->GetDigested().m_pDecompressionDictionary.get() : nullptr);
+        case Codec::LZ4:
+            return DecompressLZ4(pContent, size, rawData);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compresse les données brutes <pData> de taille <size> sous forme de delta par
+// rapport aux données brutes <pBase> de taille <baseSize> d'un autre objet. Le
+// résultat <contents> est une trame zstd ne pouvant être décompressée qu'à l'aide
+// de ces mêmes données de base.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CompressDelta(int level, const void *pBase, std::size_t baseSize, const void *pData, std::size_t size,
+                                 std::vector<char> &contents) noexcept
+{
+    contents.clear();
+    try
+    {
+        TZstdCompressionContextPtr pContext{ZSTD_createCCtx(), ZSTD_freeCCtx};
+        RETURN_IF(pContext == nullptr, false);
+
+        const int windowLog = GetDeltaWindowLog(baseSize, size);
+        RETURN_IF(ZSTD_isError(ZSTD_CCtx_setParameter(pContext.get(), ZSTD_c_compressionLevel, level)) != 0, false);
+        RETURN_IF(ZSTD_isError(ZSTD_CCtx_setParameter(pContext.get(), ZSTD_c_windowLog, windowLog)) != 0, false);
+        if (windowLog >= LONG_DELTA_WINDOW_LOG)
+        {
+            RETURN_IF(ZSTD_isError(ZSTD_CCtx_setParameter(pContext.get(), ZSTD_c_enableLongDistanceMatching, 1)) != 0, false);
+        }
+        RETURN_IF(ZSTD_isError(ZSTD_CCtx_refPrefix(pContext.get(), pBase, baseSize)) != 0, false);
+
+        contents.resize(ZSTD_compressBound(size));
+        const std::size_t result = ZSTD_compress2(pContext.get(), contents.data(), contents.size(), pData, size);
+        if (ZSTD_isError(result) != 0)
+        {
+            fmt::print(std::cerr, "zstd error: {}\n", ZSTD_getErrorName(result));
+            return false;
+        }
+        contents.resize(result);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retrouve les données brutes <rawData> à partir du delta <pContent> de taille
+// <size> et des données brutes <pBase> de taille <baseSize> de son objet de base.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool DecompressDelta(const void *pBase, std::size_t baseSize, const void *pContent, std::size_t size,
+                                   std::vector<char> &rawData) noexcept
+{
+    rawData.clear();
+    try
+    {
+        TZstdDecompressionContextPtr pContext{ZSTD_createDCtx(), ZSTD_freeDCtx};
+        RETURN_IF(pContext == nullptr, false);
+        RETURN_IF(ZSTD_isError(ZSTD_DCtx_setParameter(pContext.get(), ZSTD_d_windowLogMax, MAX_DELTA_WINDOW_LOG)) != 0, false);
+        RETURN_IF(ZSTD_isError(ZSTD_DCtx_refPrefix(pContext.get(), pBase, baseSize)) != 0, false);
+        return DecompressZstdFrame(pContext.get(), pContent, size, rawData);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Identifiant du dictionnaire ayant servi à produire les données <pContent> de
+// taille <size> avec le codec <codec>. 0 si aucun dictionnaire n'est requis.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::uint32_t GetDictionaryId(Codec codec, const void *pContent, std::size_t size) noexcept
+{
+    RETURN_IF((codec != Codec::Zstd) || (size == 0), 0);
+    return ZSTD_getDictID_fromFrame(pContent, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Entraîne un dictionnaire <dictionary> d'au plus <capacity> octets à partir des
+// échantillons <samples>. L'entraînement échoue s'il y a trop peu d'échantillons
+// ou s'ils sont trop petits.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool TrainDictionary(const std::vector<std::vector<char>> &samples, std::size_t capacity, std::vector<char> &dictionary) noexcept
+{
+    try
+    {
+        // zdict attend tous les échantillons les uns à la suite des autres
+        std::vector<char> samplesBuffer;
+        std::vector<std::size_t> sampleSizes;
+        sampleSizes.reserve(samples.size());
+        for (const auto &sample : samples)
+        {
+            samplesBuffer.insert(samplesBuffer.end(), sample.cbegin(), sample.cend());
+            sampleSizes.push_back(sample.size());
+        }
+
+        dictionary.resize(capacity);
+        const std::size_t result = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samplesBuffer.data(), sampleSizes.data(),
+                                                         static_cast<unsigned int>(sampleSizes.size()));
+        if (ZDICT_isError(result) != 0)
+        {
+            fmt::print(std::cerr, "zstd error: {}\n", ZDICT_getErrorName(result));
+            return false;
+        }
+        dictionary.resize(result);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compresse par morceaux les données du flux <input> vers le flux <output> selon
+// les paramètres <settings>. <nbWritten> reçoit le nombre d'octets produits.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CompressStream(const CompressionSettings &settings, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten) noexcept
+{
+    nbWritten = 0;
+    RETURN_IF(!input.good() || !output.good(), false);
+    try
+    {
+        switch (settings.m_codec)
+        {
+        case Codec::Zlib:
+            return CompressZlibStream(settings.m_level, input, output, nbWritten);
+        case Codec::Store:
+            return CopyStream(input, output, nbWritten);
+        case Codec::Zstd:
+            return CompressZstdStream(settings.m_level, input, output, nbWritten);
+        case Codec::LZ4:
+            return CompressLZ4Stream(settings.m_level, input, output, nbWritten);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Décompresse par morceaux les données du flux <input>, produites par le codec
+// <codec>, vers le flux <output>. <nbWritten> reçoit le nombre d'octets produits.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool DecompressStream(Codec codec, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten,
+                                    const CompressionDictionary *pDictionary) noexcept
+{
+    nbWritten = 0;
+    RETURN_IF(!input.good() || !output.good(), false);
+    try
+    {
+        switch (codec)
+        {
+        case Codec::Zlib:
+            return DecompressZlibStream(input, output, nbWritten);
+        case Codec::Store:
+            return CopyStream(input, output, nbWritten);
+        case Codec::Zstd:
+            return DecompressZstdStream(input, output, nbWritten,
+                                        (pDictionary != nullptr) ? pDictionary->GetDigested().m_pDecompressionDictionary.get() : nullptr);
+        case Codec::LZ4:
+            return DecompressLZ4Stream(input, output, nbWritten);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Entropie de Shannon, en bits par octet, de la distribution des octets des
+// données <pData> de taille <size>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] double ComputeEntropy(const void *pData, std::size_t size) noexcept
+{
+    RETURN_IF(size == 0, 0.0);
+
+    std::array<std::size_t, 256> histogram{};
+    const auto *pBytes = static_cast<const std::uint8_t *>(pData);
+    for (std::size_t iByte = 0; iByte < size; ++iByte)
+    {
+        ++histogram[pBytes[iByte]];
+    }
+
+    double entropy{};
+    for (const auto count : histogram)
+    {
+        if (count > 0)
+        {
+            const double probability = static_cast<double>(count) / static_cast<double>(size);
+            entropy -= probability * std::log2(probability);
+        }
+    }
+    return entropy;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Sonde le début des données <pData> de taille <size> pour déterminer si elles
+// sont vraisemblablement déjà compressées, auquel cas il est inutile d'essayer
+// de les compresser à nouveau.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool IsLikelyIncompressible(const void *pData, std::size_t size) noexcept
+{
+    RETURN_IF(size < MIN_ENTROPY_SAMPLE_SIZE, false);
+    return ComputeEntropy(pData, std::min(size, ENTROPY_SAMPLE_SIZE)) > INCOMPRESSIBLE_ENTROPY;
+}
+
+} // namespace dvcs
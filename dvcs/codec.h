@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Format des données d'un objet.
+// NOTE: Les valeurs sont stockées dans la colonne Codec de la table Objects et ne
+//       doivent donc jamais changer.
+////////////////////////////////////////////////////////////////////////////////////
+enum class Codec
+{
+    Zlib = 0, // Format historique de DVCSUS
+    Store = 1, // Données brutes, pour les contenus incompressibles
+    Zstd = 2,
+    LZ4 = 3
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Paramètres de compression des nouveaux objets d'un dépôt.
+// Sous forme textuelle: <codec>[:<niveau>] (ex: zstd:19, lz4, store)
+////////////////////////////////////////////////////////////////////////////////////
+struct CompressionSettings
+{
+    Codec m_codec{Codec::Zstd};
+    int m_level{3};
+
+    auto operator<=>(const CompressionSettings &) const = default;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Dictionnaire zstd entraîné sur le contenu d'un dépôt.
+// Les petits objets se ressemblant souvent beaucoup (fichiers sources, etc.), les
+// compresser à l'aide d'un dictionnaire commun améliore grandement le ratio.
+// L'identifiant du dictionnaire est consigné dans chacune des trames produites à
+// l'aide de celui-ci, ce qui permet de le retrouver lors de la décompression.
+// Une fois créé, un dictionnaire peut être partagé par plusieurs fils d'exécution.
+////////////////////////////////////////////////////////////////////////////////////
+class CompressionDictionary
+{
+  public:
+    CompressionDictionary(std::vector<char> content, int level);
+    CompressionDictionary(const CompressionDictionary &) = delete;
+    CompressionDictionary &operator=(const CompressionDictionary &) = delete;
+    ~CompressionDictionary();
+
+    [[nodiscard]] std::uint32_t GetId() const noexcept { return m_id; }
+    [[nodiscard]] const std::vector<char> &GetContent() const noexcept { return m_content; }
+    [[nodiscard]] bool IsValid() const noexcept;
+
+    // Versions du dictionnaire prêtes à l'emploi pour zstd (détail d'implémentation)
+    struct Digested;
+    [[nodiscard]] const Digested &GetDigested() const noexcept { return *m_pDigested; }
+
+  private:
+    std::vector<char> m_content;
+    std::uint32_t m_id{};
+    std::unique_ptr<Digested> m_pDigested;
+};
+
+[[nodiscard]] std::string ToString(const CompressionSettings &settings);
+[[nodiscard]] bool ParseCompressionSettings(std::string_view text, CompressionSettings &settings) noexcept;
+[[nodiscard]] std::string_view GetCodecName(Codec codec) noexcept;
+[[nodiscard]] bool IsValidCodec(int value) noexcept;
+
+// Compression et décompression d'ensembles de données contigus.
+// Le dictionnaire n'est utilisé qu'avec zstd.
+[[nodiscard]] bool Compress(const CompressionSettings &settings, const void *pData, std::size_t size, std::vector<char> &contents,
+                            const CompressionDictionary *pDictionary = nullptr) noexcept;
+[[nodiscard]] bool Decompress(Codec codec, const void *pContent, std::size_t size, std::vector<char> &rawData,
+                              const CompressionDictionary *pDictionary = nullptr) noexcept;
+
+// Compression d'un objet sous forme de delta par rapport à un autre (zstd seulement)
+[[nodiscard]] bool CompressDelta(int level, const void *pBase, std::size_t baseSize, const void *pData, std::size_t size,
+                                 std::vector<char> &contents) noexcept;
+[[nodiscard]] bool DecompressDelta(const void *pBase, std::size_t baseSize, const void *pContent, std::size_t size,
+                                   std::vector<char> &rawData) noexcept;
+
+// Taille maximale de l'entête d'une trame, qui suffit à GetDictionaryId
+constexpr const std::size_t MAX_FRAME_HEADER_SIZE = 18U;
+
+// Identifiant du dictionnaire requis pour décompresser <pContent> (0 si aucun)
+[[nodiscard]] std::uint32_t GetDictionaryId(Codec codec, const void *pContent, std::size_t size) noexcept;
+
+// Entraînement d'un dictionnaire d'au plus <capacity> octets sur les échantillons <samples>
+[[nodiscard]] bool TrainDictionary(const std::vector<std::vector<char>> &samples, std::size_t capacity, std::vector<char> &dictionary) noexcept;
+
+// Compression et décompression par morceaux, à mémoire constante
+[[nodiscard]] bool CompressStream(const CompressionSettings &settings, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten) noexcept;
+[[nodiscard]] bool DecompressStream(Codec codec, std::istream &input, std::ostream &output, std::uintmax_t &nbWritten,
+                                    const CompressionDictionary *pDictionary = nullptr) noexcept;
+
+// Sondage rapide du contenu permettant d'éviter de compresser pour rien
+[[nodiscard]] double ComputeEntropy(const void *pData, std::size_t size) noexcept;
+[[nodiscard]] bool IsLikelyIncompressible(const void *pData, std::size_t size) noexcept;
+
+} // namespace dvcs
@@ -1,26 +1,57 @@
 #include "commands.h"
+#include "bloomfilter.h"
+#include "bundle.h"
+#include "chunker.h"
+#include "codec.h"
+#include "commitgraph.h"
+#include "database.h"
+#include "filediff.h"
+#include "filemonitor.h"
+#include "hash.h"
+#include "merge.h"
+#include "network.h"
 #include "paths.h"
+#include "protocol.h"
+#include "storage.h"
+#include "tempfile.h"
+#include "threadpool.h"
+#include "tree.h"
+#include "worktree.h"
 
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/stream.hpp>
-#include <boost/uuid/sha1.hpp>
-
+#include <dirent.h>
+#include <fcntl.h>
 #include <filesystem>
 #include <sqlite3.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
 #include <concepts>
+#include <cstring>
 #include <fstream>
-
-using TDatabasePtr = std::unique_ptr<sqlite3, decltype(&sqlite3_close)>;
-using TStatementPtr = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>;
-using TCallback = int (*)(void *, int, char **, char **);
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <set>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
 
 #define RETURN_IF(cond, val)                                                                                                                         \
     if (cond)                                                                                                                                        \
@@ -40,128 +71,564 @@ enum class TransferDirection
     ToRemote
 };
 
+// Préfixe du nom de la branche qui conserve la tête d'une branche distante dont
+// l'historique a divergé de celui de la branche locale
+constexpr const std::string_view REMOTE_BRANCH_PREFIX = "remote/";
+
+////////////////////////////////////////////////////////////////////////////////////
+// Traitement de la tête d'une branche reçue d'un autre dépôt lorsque l'historique
+// de la branche locale a divergé du sien
+////////////////////////////////////////////////////////////////////////////////////
+enum class DivergedBranchPolicy
+{
+    Reject, // Le transfert échoue: la branche doit d'abord être fusionnée (push)
+    Track   // La tête reçue est conservée sous REMOTE_BRANCH_PREFIX (pull, unbundle)
+};
+
+// Têtes des branches (nom et commit) reçues d'un autre dépôt
+using TBranchHeads = std::vector<std::pair<std::string, dvcs::THash>>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Mise à jour des têtes des branches d'un dépôt par celles reçues d'un autre
+// dépôt: l'ascendance des têtes est donnée par le graphe des commits <m_graph> du
+// dépôt, stocké à <m_graphPath> (voir UpdateBranchHead)
+////////////////////////////////////////////////////////////////////////////////////
+struct BranchHeadsUpdate
+{
+    dvcs::CommitGraph &m_graph;
+    fs::path m_graphPath{};
+    DivergedBranchPolicy m_policy{};
+    std::string m_rejectedBranch{}; // Branche refusée, le cas échéant (DivergedBranchPolicy::Reject)
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Objet en voie d'être inséré dans la zone de staging.
+// Un objet est identifié par le hash de son contenu brut, ce qui permet de savoir
+// s'il est déjà connu avant même de le compresser.
+// Les données des gros objets ne sont pas conservées en mémoire: leur version
+// compressée est plutôt déversée dans un fichier temporaire (<m_spoolFile>) qui
+// sera copié par morceaux dans la base de données. Un gros objet incompressible
+// est quant à lui copié directement à partir de son fichier (<m_contentPath>).
+// Un objet découpé en morceaux n'a pas de contenu propre: seuls ses morceaux
+// (<m_chunks>) encore inconnus sont lus, compressés et insérés.
+////////////////////////////////////////////////////////////////////////////////////
+struct StagedObject
+{
+    fs::path m_path;                   // Chemin d'accès relatif au répertoire du dépôt
+    std::uintmax_t m_size{};           // Taille des données brutes
+    dvcs::THash m_hash{};              // Hash des données brutes
+    bool m_isValid{false};             // Faux si une erreur est survenue lors du traitement de l'objet
+    bool m_isKnown{false};             // L'objet se trouve déjà dans le dépôt ou la zone de staging
+    std::vector<char> m_rawData{};       // Données brutes (petits objets seulement)
+    std::vector<char> m_content{};       // Données à stocker (petits objets seulement)
+    dvcs::Codec m_codec{dvcs::Codec::Store}; // Codec ayant produit les données à stocker
+    dvcs::TemporaryFile m_spoolFile{};
+    fs::path m_contentPath{};            // Fichier contenant les données à stocker (gros objets seulement)
+    std::uintmax_t m_contentSize{};      // Taille des données contenues dans <m_contentPath>
+    std::optional<dvcs::THash> m_baseHash{}; // Objet de base si les données à stocker sont un delta
+    std::vector<char> m_baseData{};      // Données brutes de l'objet de base
+    int m_depth{};                       // Longueur de la chaîne de deltas
+    bool m_isChunked{false};             // L'objet est stocké sous forme de liste de morceaux
+    std::vector<dvcs::Chunk> m_chunks{}; // Morceaux des données brutes (objets découpés seulement)
+};
+
 ////////////////////////////////////////////////////////////////////////////////////
-// Association entre des données compressées et le hash de ces données
+// Fichier à ajouter à la zone de staging
 ////////////////////////////////////////////////////////////////////////////////////
-struct HashedCompressedData
+struct FileToAdd
 {
-    std::string m_hash;
-    std::vector<char> m_compressedData;
+    fs::path m_path;
+    std::uintmax_t m_size{};
+
+    auto operator<=>(const FileToAdd &) const = default;
 };
 
+// Un lot d'objets à ajouter est limité en nombre d'objets et en taille totale pour
+// borner la mémoire utilisée par les données compressées en attente d'insertion.
+constexpr const std::size_t MAX_BATCH_COUNT = 1024;
+constexpr const std::uintmax_t MAX_BATCH_SIZE = 64U * 1024U * 1024U;
+
+// Taille à partir de laquelle un fichier est traité par morceaux pour que la mémoire
+// utilisée reste constante peu importe la taille du fichier.
+constexpr const std::uintmax_t STREAMING_THRESHOLD = 8U * 1024U * 1024U;
+
+// Un dictionnaire de compression ne profite qu'aux petits objets. Les plus gros
+// ne servent donc pas à l'entraîner et sont compressés sans dictionnaire.
+constexpr const std::uintmax_t MAX_DICTIONARY_OBJECT_SIZE = 128U * 1024U;
+
+// Nombre minimal d'échantillons nécessaires pour entraîner un dictionnaire
+constexpr const std::size_t MIN_DICTIONARY_SAMPLES = 16;
+
+// Taille maximale d'un dictionnaire (celle recommandée par zstd). Un dictionnaire
+// est aussi limité au dixième de la taille des échantillons.
+constexpr const std::size_t MAX_DICTIONARY_SIZE = 110U * 1024U;
+constexpr const std::size_t MIN_DICTIONARY_SIZE = 1024U;
+
+// Les deltas sont calculés en mémoire, ce qui limite la taille des objets visés
+constexpr const std::uintmax_t MAX_DELTA_OBJECT_SIZE = 32U * 1024U * 1024U;
+
+// Un delta au moins aussi petit que cette fraction des données brutes est gardé
+// sans même le comparer à la compression de l'objet au complet.
+constexpr const std::size_t SMALL_DELTA_RATIO = 16;
+
+// Lorsque le découpage selon le contenu est activé, les fichiers d'au moins cette
+// taille sont stockés sous forme de liste de morceaux partagés entre les objets.
+constexpr const std::uintmax_t CHUNKING_THRESHOLD = 1024U * 1024U;
+
+// Nombre de morceaux d'un objet lus et compressés à la fois
+constexpr const std::size_t CHUNK_WINDOW_COUNT = 64;
+
+// Version courante du schéma des bases de données d'un dépôt.
+// Historique:
+// 1. Schéma initial. Les hash sont stockés sous forme hexadécimale.
+// 2. Les hash sont stockés sous forme binaire et les tables de liaison n'ont
+//    plus de rowid.
+// 3. Le codec ayant produit le contenu d'un objet est conservé avec celui-ci.
+// 4. Ajout des dictionnaires de compression.
+// 5. Un objet peut être stocké sous forme de delta par rapport à un objet de base.
+// 6. Un objet peut être stocké sous forme de liste de morceaux.
+// 7. Ajout des index secondaires requis par le parcours de l'historique.
+// 8. Ajout du cache des attributs des fichiers de l'arbre de travail.
+// 9. Ajout du journal des modifications rapportées par le moniteur de fichiers.
+// 10. Ajout des arbres des commits.
+// 11. Ajout des filtres des chemins modifiés par les commits.
+// 12. Un commit de fusion a un second parent: le commit qu'il a fusionné.
+// 13. Les chemins des fichiers d'un commit sont consignés avec ses objets et ceux
+//     de la zone de staging sont séparés de leur contenu.
+// 14. Un commit (ou la zone de staging) peut retirer un fichier.
+// 15. Les fichiers d'une fusion en cours sont consignés jusqu'à leur ajout.
+constexpr const int SCHEMA_VERSION = 15;
+
+// Tables du dépôt.
+// NOTE: Objects conserve son rowid puisque ses rangées contiennent de gros blobs
+//       (pour lesquels SQLite déconseille WITHOUT ROWID) et que les entrées/sorties
+//       incrémentales de SQLite requièrent un rowid.
+// NOTE: Le codec par défaut d'un objet (0) est zlib, le format historique.
+// NOTE: Le contenu d'un objet ayant une base (Base) est un delta par rapport aux
+//       données brutes de celle-ci. Depth est la longueur de la chaîne de deltas
+//       menant à un objet stocké au complet.
+// NOTE: Un dictionnaire est identifié par son identifiant zstd, qui est consigné
+//       dans le contenu des objets compressés à l'aide de celui-ci. Les anciens
+//       dictionnaires sont conservés puisque des objets peuvent en dépendre. Le
+//       dictionnaire courant est désigné par la métadonnée Dictionary.
+// NOTE: Un objet dont le contenu est NULL est découpé en morceaux (Chunks). Un
+//       morceau est identifié par le hash de ses données brutes, ce qui permet de
+//       le partager entre les objets. ObjectsChunks donne l'ordre des morceaux
+//       de chacun de ces objets.
+// NOTE: Les clés primaires des tables de liaison servent les recherches dans un
+//       sens (les objets d'un commit, les commits d'une branche, etc.). Les index
+//       secondaires servent le sens inverse (les commits contenant un objet, les
+//       enfants d'un commit, etc.). Comme ces tables n'ont pas de rowid, un index
+//       contient aussi la clé primaire: il suffit à lui seul à la recherche.
+// NOTE: Un arbre (TreesEntries) liste le contenu d'un répertoire d'un commit: ses
+//       fichiers (des objets) et ses sous-répertoires (d'autres arbres). Il est
+//       identifié par le hash de ses entrées, qui comprennent le hash de ses
+//       sous-arbres: un répertoire inchangé d'un commit à l'autre est donc partagé
+//       par ceux-ci. CommitsTrees donne l'arbre racine de chacun des commits.
+//       Les arbres ne sont pas transférés d'un dépôt à l'autre puisqu'ils se
+//       déduisent des objets des commits (voir GetCommitTree).
+// NOTE: CommitsPathFilters donne pour chacun des commits un filtre de Bloom (voir
+//       BloomFilter) des chemins de ses objets et des répertoires qui les
+//       contiennent. Il permet d'écarter la plupart des commits qui n'ont pas
+//       touché un chemin sans consulter leurs objets (voir WritePathFilter).
+// NOTE: CommitsObjects donne les fichiers d'un commit: le chemin de chacun et
+//       l'objet de son contenu. Un même objet peut donc se trouver à plusieurs
+//       chemins. Un fichier retiré par le commit n'a pas d'objet (NULL). Le
+//       chemin d'un objet (Objects.Path) n'est que celui sous lequel son contenu
+//       a été ajouté la première fois: il sert à trouver la base d'un delta (voir
+//       FindDeltaBase).
+// NOTE: Le parent d'un commit (ParentHash) est le commit courant au moment de sa
+//       création: ses objets sont ceux qui ont changé depuis celui-ci. Un commit
+//       de fusion a aussi le commit qu'il a fusionné (MergeParentHash, voir
+//       Merge).
+constexpr const char *REPO_TABLES_QUERY = "CREATE TABLE Metadata("
+                                          "   Name   TEXT NOT NULL PRIMARY KEY,"
+                                          "   Value  NOT NULL) WITHOUT ROWID;"
+                                          "CREATE TABLE Objects("
+                                          "   Hash    BLOB    NOT NULL PRIMARY KEY,"
+                                          "   Path    TEXT    NOT NULL,"
+                                          "   Size    INTEGER NOT NULL,"
+                                          "   Content BLOB,"
+                                          "   Codec   INTEGER NOT NULL DEFAULT 0,"
+                                          "   Base    BLOB,"
+                                          "   Depth   INTEGER NOT NULL DEFAULT 0);"
+                                          "CREATE INDEX ObjectsPath ON Objects(Path);"
+                                          "CREATE TABLE Dictionaries("
+                                          "   Id      INTEGER NOT NULL PRIMARY KEY,"
+                                          "   Content BLOB    NOT NULL);"
+                                          "CREATE TABLE Chunks("
+                                          "   Hash    BLOB    NOT NULL PRIMARY KEY,"
+                                          "   Size    INTEGER NOT NULL,"
+                                          "   Content BLOB    NOT NULL,"
+                                          "   Codec   INTEGER NOT NULL);"
+                                          "CREATE TABLE ObjectsChunks("
+                                          "   ObjectHash BLOB    NOT NULL,"
+                                          "   Position   INTEGER NOT NULL,"
+                                          "   ChunkHash  BLOB    NOT NULL,"
+                                          "   PRIMARY KEY (ObjectHash, Position)) WITHOUT ROWID;"
+                                          "CREATE INDEX ObjectsChunksChunkHash ON ObjectsChunks(ChunkHash);"
+                                          "CREATE TABLE Commits("
+                                          "   Hash            BLOB NOT NULL PRIMARY KEY,"
+                                          "   ParentHash      BLOB,"
+                                          "   Author          TEXT NOT NULL,"
+                                          "   Email           TEXT NOT NULL,"
+                                          "   Message         TEXT NOT NULL,"
+                                          "   MergeParentHash BLOB) WITHOUT ROWID;"
+                                          "CREATE INDEX CommitsParentHash ON Commits(ParentHash);"
+                                          "CREATE INDEX CommitsMergeParentHash ON Commits(MergeParentHash);"
+                                          "CREATE TABLE CommitsObjects("
+                                          "   ObjectHash BLOB,"
+                                          "   CommitHash BLOB NOT NULL,"
+                                          "   Path       TEXT NOT NULL,"
+                                          "   PRIMARY KEY (CommitHash, Path),"
+                                          "   FOREIGN KEY (ObjectHash) REFERENCES Objects(Hash),"
+                                          "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                                          "CREATE INDEX CommitsObjectsObjectHash ON CommitsObjects(ObjectHash);"
+                                          "CREATE TABLE Branches("
+                                          "   Name        TEXT NOT NULL PRIMARY KEY,"
+                                          "   HeadCommit  BLOB,"
+                                          "   FOREIGN KEY (HeadCommit) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                                          "CREATE TABLE BranchesCommits("
+                                          "   BranchName TEXT NOT NULL,"
+                                          "   CommitHash BLOB NOT NULL,"
+                                          "   PRIMARY KEY (BranchName, CommitHash),"
+                                          "   FOREIGN KEY (BranchName) REFERENCES Branches(Name),"
+                                          "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                                          "CREATE INDEX BranchesCommitsCommitHash ON BranchesCommits(CommitHash);"
+                                          "CREATE TABLE CommitsTrees("
+                                          "   CommitHash BLOB NOT NULL PRIMARY KEY,"
+                                          "   TreeHash   BLOB NOT NULL,"
+                                          "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                                          "CREATE TABLE TreesEntries("
+                                          "   TreeHash  BLOB    NOT NULL,"
+                                          "   Name      TEXT    NOT NULL,"
+                                          "   EntryHash BLOB    NOT NULL,"
+                                          "   IsTree    INTEGER NOT NULL,"
+                                          "   PRIMARY KEY (TreeHash, Name)) WITHOUT ROWID;"
+                                          "CREATE TABLE CommitsPathFilters("
+                                          "   CommitHash BLOB NOT NULL PRIMARY KEY,"
+                                          "   Filter     BLOB NOT NULL,"
+                                          "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;";
+
+// Tables des objets de la zone de staging.
+// NOTE: Paths donne les fichiers ajoutés à la zone de staging et Objects le
+//       contenu de ceux qui ne se trouvent pas déjà dans le dépôt. Un contenu
+//       connu n'est donc compressé qu'une seule fois, peu importe le nombre de
+//       fichiers qui le partagent. Un fichier retiré n'a pas de contenu (NULL).
+// NOTE: FileStats associe aux fichiers de l'arbre de travail le hash de leur
+//       contenu tel qu'il était lorsque le fichier avait la taille, la date de
+//       modification (en nanosecondes) et l'inode consignés. Un fichier dont les
+//       attributs n'ont pas changé n'a donc pas à être relu (voir Status). Les
+//       chemins sont représentés comme ceux des objets.
+// NOTE: FileMonitor décrit la session du moniteur de fichiers en cours, s'il y en
+//       a une (voir dvcsusmon), et ChangedPaths les chemins qu'il a vus changer
+//       depuis. Une session n'est synchronisée (IsSynced) qu'une fois qu'un
+//       parcours complet de l'arbre de travail a mis FileStats à jour: les
+//       chemins qui suivent suffisent alors à le garder à jour. Les identifiants
+//       des chemins ne sont jamais réutilisés, ce qui permet de retirer ceux qui
+//       ont été traités sans toucher aux suivants.
+// NOTE: PendingMerge donne le commit d'une fusion interrompue par des conflits:
+//       il sera le second parent du prochain commit (voir Merge). UnmergedPaths
+//       donne les fichiers de cette fusion dont la version fusionnée n'a pas
+//       encore été ajoutée (les conflits, notamment): aucun commit n'est possible
+//       tant qu'il en reste.
+constexpr const char *STAGING_OBJECTS_TABLES_QUERY = "CREATE TABLE Staging.Objects("
+                                                     "   Hash    BLOB    NOT NULL PRIMARY KEY,"
+                                                     "   Path    TEXT    NOT NULL,"
+                                                     "   Size    INTEGER NOT NULL,"
+                                                     "   Content BLOB,"
+                                                     "   Codec   INTEGER NOT NULL DEFAULT 0,"
+                                                     "   Base    BLOB,"
+                                                     "   Depth   INTEGER NOT NULL DEFAULT 0);"
+                                                     "CREATE TABLE Staging.Paths("
+                                                     "   Path TEXT NOT NULL PRIMARY KEY,"
+                                                     "   Hash BLOB) WITHOUT ROWID;"
+                                                     "CREATE TABLE Staging.Chunks("
+                                                     "   Hash    BLOB    NOT NULL PRIMARY KEY,"
+                                                     "   Size    INTEGER NOT NULL,"
+                                                     "   Content BLOB    NOT NULL,"
+                                                     "   Codec   INTEGER NOT NULL);"
+                                                     "CREATE TABLE Staging.ObjectsChunks("
+                                                     "   ObjectHash BLOB    NOT NULL,"
+                                                     "   Position   INTEGER NOT NULL,"
+                                                     "   ChunkHash  BLOB    NOT NULL,"
+                                                     "   PRIMARY KEY (ObjectHash, Position)) WITHOUT ROWID;"
+                                                     "CREATE TABLE Staging.FileStats("
+                                                     "   Path         TEXT    NOT NULL PRIMARY KEY,"
+                                                     "   Size         INTEGER NOT NULL,"
+                                                     "   ModifiedTime INTEGER NOT NULL,"
+                                                     "   Inode        INTEGER NOT NULL,"
+                                                     "   Hash         BLOB    NOT NULL) WITHOUT ROWID;"
+                                                     "CREATE TABLE Staging.FileMonitor("
+                                                     "   Session  TEXT    NOT NULL PRIMARY KEY,"
+                                                     "   IsSynced INTEGER NOT NULL) WITHOUT ROWID;"
+                                                     "CREATE TABLE Staging.ChangedPaths("
+                                                     "   Id   INTEGER PRIMARY KEY AUTOINCREMENT,"
+                                                     "   Path TEXT    NOT NULL);"
+                                                     "CREATE TABLE Staging.PendingMerge("
+                                                     "   CommitHash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                                                     "CREATE TABLE Staging.UnmergedPaths("
+                                                     "   Path TEXT NOT NULL PRIMARY KEY) WITHOUT ROWID;";
+
 ////////////////////////////////////////////////////////////////////////////////////
-// Ouvre une connection <pDB> à la base de données situé à <dbPath>.
+// Valide que la base de données <schemaName> accessible par la connexion <pDB>
+// utilise la version courante du schéma.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool OpenDatabaseConnection(const fs::path &dbPath, TDatabasePtr &pDB) noexcept
+[[nodiscard]] bool ValidateSchemaVersion(dvcs::TDatabasePtr &pDB, std::string_view schemaName = "main") noexcept
 {
-    sqlite3 *pDBHandle;
-    RETURN_IF(sqlite3_open(dbPath.c_str(), &pDBHandle) != SQLITE_OK, false);
-    RETURN_IF(pDBHandle == nullptr, false);
-    pDB = TDatabasePtr{pDBHandle, sqlite3_close};
+    int version{};
+    RETURN_IF(!dvcs::GetSchemaVersion(pDB, schemaName, version), false);
+    if (version != SCHEMA_VERSION)
+    {
+        fmt::print(std::cerr, "Repository uses schema version {0} but version {1} is required. Run 'dvcsus migrate' first.\n", version,
+                   SCHEMA_VERSION);
+        return false;
+    }
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Exécute la requête <query> sur la base de données <pDB>.
-// De la logique additionnelle peut être exécutée à l'aide du callback <pCallback>
-// qui peut recevoir les arguments <pArg>.
-// Pour plus d'informations sur la mécanique de callback, consultez:
-// https://sqlite.org/c3ref/exec.html
+// Écrit le filtre des chemins modifiés par le commit <commit>, dont les fichiers
+// doivent déjà se trouver dans le dépôt. Le filtre contient le chemin de chacun
+// des fichiers du commit, relatif à la racine du dépôt, et ceux des répertoires qui
+// les contiennent: un répertoire est modifié dès qu'un de ses fichiers l'est.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool ExecuteQuery(TDatabasePtr &pDB, const std::string &query, TCallback pCallback = nullptr, void *pArg = nullptr) noexcept
+[[nodiscard]] bool WritePathFilter(dvcs::StatementCache &statements, const dvcs::THash &commit)
 {
-    char *pErrMsg = nullptr;
-    int execResult = sqlite3_exec(pDB.get(), query.c_str(), pCallback, pArg, &pErrMsg);
-    const bool resultIsOK = execResult == SQLITE_OK;
-    if (!resultIsOK)
+    std::unordered_set<std::string> keys;
     {
-        fmt::print(std::cerr, "Internal error {0}: {1}\n", execResult, pErrMsg);
-        return false;
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Path FROM CommitsObjects WHERE CommitHash = @commit;", pStmt), false);
+        RETURN_IF(!dvcs::BindValue(pStmt, 1, commit), false);
+
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+        {
+            // Les chemins stockés sont relatifs au répertoire .dvcs
+            const auto *pPath = reinterpret_cast<const char *>(sqlite3_column_text(pStmt.get(), 0));
+            std::string_view path{(pPath != nullptr) ? pPath : ""};
+            if (!path.starts_with("../"))
+            {
+                continue;
+            }
+            path.remove_prefix(3);
+            for (auto length = path.size(); (length != 0) && (length != std::string_view::npos); length = path.rfind('/', length - 1))
+            {
+                keys.emplace(path.substr(0, length));
+            }
+        }
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+    }
+
+    dvcs::BloomFilter filter{keys.size()};
+    for (const auto &key : keys)
+    {
+        filter.Add(dvcs::BloomKey{key});
     }
-    return resultIsOK;
+
+    const auto bits = filter.GetBits();
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("INSERT OR REPLACE INTO CommitsPathFilters (CommitHash, Filter) VALUES (@commit, @filter);", pStmt), false);
+    RETURN_IF(!dvcs::BindValue(pStmt, 1, commit) ||
+                  (sqlite3_bind_blob(pStmt.get(), 2, bits.data(), static_cast<int>(bits.size()), SQLITE_STATIC) != SQLITE_OK),
+              false);
+    return sqlite3_step(pStmt.get()) == SQLITE_DONE;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Exécute la requête <query> sur la base de données situé à <databasePath>.
-// De la logique additionnelle peut être exécutée à l'aide du callback <pCallback>
-// qui peut recevoir les arguments <pArg>.
-// Pour plus d'informations sur la mécanique de callback, consultez:
-// https://sqlite.org/c3ref/exec.html
+// Permet d'obtenir la source de données distante, telle que configurée (chemin
+// relatif au répertoire .dvcs ou URL), à l'aide des requêtes préparées
+// <statements> de la connexion du dépôt.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool ExecuteQuery(const fs::path &databasePath, const std::string &query, TCallback pCallback = nullptr, void *pArg = nullptr) noexcept
+std::string GetRemoteSetting(dvcs::StatementCache &statements)
 {
-    RETURN_IF((pArg != nullptr) && (pCallback == nullptr), false);
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT Value FROM Staging.Metadata WHERE Name = \"Remote\";", pStmt), {});
+    RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_ROW, {});
+    const auto *pRemote = reinterpret_cast<const char *>(sqlite3_column_text(pStmt.get(), 0));
+    return (pRemote != nullptr) ? std::string{pRemote} : std::string{};
+}
 
-    TDatabasePtr pDB{nullptr, sqlite3_close};
+////////////////////////////////////////////////////////////////////////////////////
+// Permet d'obtenir le chemin d'accès vers le dépôt distant du dépôt situé à
+// <rootPath> à l'aide des requêtes préparées <statements> de sa connexion.
+////////////////////////////////////////////////////////////////////////////////////
+fs::path GetRemote(dvcs::StatementCache &statements, const fs::path &rootPath)
+{
     try
     {
-        RETURN_IF(!OpenDatabaseConnection(fs::current_path() / databasePath, pDB), false);
+        const auto remote = GetRemoteSetting(statements);
+        RETURN_IF(remote.empty(), {});
+        return rootPath / dvcs::DVCS_PATH / fs::path{remote};
     }
     catch (const std::exception &e)
     {
         fmt::print(std::cerr, "{}\n", e.what());
-        return false;
+        return {};
     }
-    RETURN_IF(pDB == nullptr, false);
-
-    return ExecuteQuery(pDB, query, pCallback, pArg);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Fonction utilitaire permettant de valider que la requête <query> sur la base de
-// données <pDB> ne produira aucun résultat.
+// Ajoute au graphe des commits <graph>, stocké à <graphPath>, les commits
+// accessibles depuis la tête de l'une des branches ou depuis l'un des commits
+// <commits> qui n'en font pas encore partie. Le graphe est projeté en mémoire au
+// besoin.
+// NOTE: Le graphe étant ordonné du plus ancien au plus récent, un commit n'est
+//       ajouté qu'après tous ses ancêtres: le coût d'une mise à jour ne dépend donc
+//       que du nombre de nouveaux commits.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool ValidateNoResult(TDatabasePtr &pDB, const std::string &query) noexcept
+[[nodiscard]] bool UpdateCommitGraph(dvcs::StatementCache &statements, dvcs::CommitGraph &graph, const fs::path &graphPath,
+                                     const std::vector<dvcs::THash> &commits = {})
 {
-    int count{};
-    auto countFn = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
-        RETURN_IF(argc != 1, SQLITE_ERROR);
-        try
+    if (!graph.IsOpen())
+    {
+        dvcs::HashAlgorithm algorithm{};
+        RETURN_IF(!dvcs::GetHashAlgorithm(statements.GetDatabase(), "main", algorithm) ||
+                      !graph.Open(graphPath, dvcs::GetHashSize(algorithm)),
+                  false);
+    }
+
+    std::vector<dvcs::THash> heads{commits};
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT HeadCommit FROM Branches WHERE HeadCommit IS NOT NULL;", pStmt), false);
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
         {
-            int *pCount = reinterpret_cast<int *>(pArg);
-            *pCount = std::stoi(pArgv[0]);
-            return SQLITE_OK;
+            bool isPresent{};
+            RETURN_IF(!dvcs::GetColumnHash(pStmt, 0, heads.emplace_back(), isPresent), false);
         }
-        catch (const std::exception &e)
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+    }
+
+    // Les parents de chacune des têtes sont remontés jusqu'aux commits déjà
+    // connus, puis ses nouveaux ancêtres sont ajoutés en ordre postfixe: un commit
+    // suit toujours ses parents
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT Parent.Hash, MergeParent.Hash FROM Commits AS Child "
+                                  "LEFT JOIN Commits AS Parent ON Parent.Hash = Child.ParentHash "
+                                  "LEFT JOIN Commits AS MergeParent ON MergeParent.Hash = Child.MergeParentHash WHERE Child.Hash = @commit;",
+                                  pStmt),
+              false);
+    std::vector<dvcs::GraphCommit> newCommits;
+    std::unordered_set<dvcs::THash, dvcs::HashHasher> visitedCommits;
+    for (const auto &head : heads)
+    {
+        // Commits à ajouter, chacun accompagné d'un indicateur de la visite de ses
+        // parents
+        std::vector<std::pair<dvcs::GraphCommit, bool>> pendingCommits;
+        if ((graph.Find(head) == dvcs::NO_COMMIT) && visitedCommits.insert(head).second)
         {
-            fmt::print(std::cerr, "{}\n", e.what());
-            return SQLITE_ERROR;
+            pendingCommits.emplace_back(dvcs::GraphCommit{head}, false);
         }
-    };
-    RETURN_IF(!ExecuteQuery(pDB, query, countFn, &count), false);
-    return count == 0;
+        while (!pendingCommits.empty())
+        {
+            auto &[commit, isVisited] = pendingCommits.back();
+            if (isVisited)
+            {
+                newCommits.push_back(std::move(commit));
+                pendingCommits.pop_back();
+                continue;
+            }
+            isVisited = true;
+
+            // Le parent d'un commit racine est vide, tout comme le commit fusionné
+            // d'un commit qui n'est pas une fusion
+            bool isPresent{};
+            RETURN_IF(!dvcs::BindValue(pStmt, 1, commit.m_hash) || (sqlite3_step(pStmt.get()) != SQLITE_ROW), false);
+            RETURN_IF(!dvcs::GetColumnHash(pStmt, 0, commit.m_parent, isPresent) || !dvcs::GetColumnHash(pStmt, 1, commit.m_mergeParent, isPresent),
+                      false);
+            sqlite3_reset(pStmt.get());
+            for (const auto &parent : {commit.m_parent, commit.m_mergeParent})
+            {
+                if ((parent.size() != 0) && (graph.Find(parent) == dvcs::NO_COMMIT) && visitedCommits.insert(parent).second)
+                {
+                    pendingCommits.emplace_back(dvcs::GraphCommit{parent}, false);
+                }
+            }
+        }
+    }
+    return newCommits.empty() || graph.Append(newCommits);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Permet d'obtenir le chemin d'accès vers le dépôt distant.
+// Permet d'obtenir le chemin d'accès vers le graphe des commits de la base de
+// données <dbPath>: celui du dépôt pour sa base de données, un fichier voisin de la
+// base de données sinon (un dépôt distant désigné par son fichier).
 ////////////////////////////////////////////////////////////////////////////////////
-fs::path GetRemote()
+fs::path GetCommitGraphPath(const fs::path &dbPath)
 {
-    fs::path remote{};
-    auto callback = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
-        RETURN_IF(argc != 1, SQLITE_ERROR);
-        auto *pPath = reinterpret_cast<fs::path *>(pArg);
-        *pPath = fs::path{pArgv[0]};
-        return SQLITE_OK;
-    };
-    RETURN_IF(!ExecuteQuery(dvcs::STAGING_DB_PATH, "SELECT Value from Metadata WHERE Name = \"Remote\"", callback, &remote), {});
-    RETURN_IF(remote.empty(), remote);
-    try
+    if (dbPath.filename() == dvcs::REPO_DB_PATH.filename())
     {
-        const fs::path dvcsPath = fs::current_path() / dvcs::DVCS_PATH;
-        return dvcsPath / remote;
+        return dbPath.parent_path() / dvcs::COMMIT_GRAPH_PATH.filename();
     }
-    catch (const std::exception &e)
+    return fs::path{dbPath}.concat(".commit-graph");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Donne à la branche <name> du dépôt, dont les requêtes sont préparées à l'aide de
+// <statements>, la tête <head> reçue d'un autre dépôt. Seule une avance rapide est
+// faite: la tête locale doit être un ancêtre de <head> (voir
+// CommitGraph::IsAncestor), qui est ignorée si elle est plutôt un ancêtre de la
+// tête locale. Une branche dont l'historique a divergé est traitée selon <policy>.
+// Les commits de <head> doivent déjà faire partie du dépôt.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool UpdateBranchHead(dvcs::StatementCache &statements, BranchHeadsUpdate &update, const std::string &name, const dvcs::THash &head)
+{
+    dvcs::THash currentHead;
+    bool isPresent{};
     {
-        fmt::print(std::cerr, "{}\n", e.what());
-        return {};
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT HeadCommit FROM Branches WHERE Name = @branch;", pStmt), false);
+        RETURN_IF(!dvcs::BindValue(pStmt, 1, std::string_view{name}), false);
+        const int stepResult = sqlite3_step(pStmt.get());
+        RETURN_IF((stepResult != SQLITE_ROW) && (stepResult != SQLITE_DONE), false);
+        RETURN_IF((stepResult == SQLITE_ROW) && !dvcs::GetColumnHash(pStmt, 0, currentHead, isPresent), false);
+    }
+
+    // Une branche sans commit reçoit simplement la tête, et une branche reçue
+    // sans commit ne change rien
+    RETURN_IF(head.size() == 0, statements.Execute("INSERT OR IGNORE INTO Branches (Name) VALUES (@branch);", {{"@branch", name}}));
+    const auto trackingName = std::string{REMOTE_BRANCH_PREFIX} + name;
+    bool isFastForward = !isPresent || (currentHead == head);
+    if (!isFastForward)
+    {
+        RETURN_IF(!UpdateCommitGraph(statements, update.m_graph, update.m_graphPath, {currentHead, head}), false);
+        const auto currentId = update.m_graph.Find(currentHead);
+        const auto headId = update.m_graph.Find(head);
+        RETURN_IF((currentId == dvcs::NO_COMMIT) || (headId == dvcs::NO_COMMIT), false);
+        RETURN_IF(update.m_graph.IsAncestor(headId, currentId), true);
+        isFastForward = update.m_graph.IsAncestor(currentId, headId);
+    }
+
+    // La branche qui conservait la tête distante n'a plus de raison d'être une fois
+    // la branche locale avancée jusqu'à celle-ci
+    if (isFastForward)
+    {
+        return statements.Execute("INSERT OR REPLACE INTO Branches (Name, HeadCommit) VALUES (@branch, @head);"
+                                  "DELETE FROM Branches WHERE Name = @tracking;",
+                                  {{"@branch", name}, {"@head", head}, {"@tracking", trackingName}});
+    }
+
+    if (update.m_policy == DivergedBranchPolicy::Reject)
+    {
+        fmt::print(std::cerr, "Can't update branch {}: its history has diverged, pull and merge it first\n", name);
+        update.m_rejectedBranch = name;
+        return false;
     }
+    fmt::print(std::cout, "Branch {0} has diverged: its remote head is in branch {1}, merge it first\n", name, trackingName);
+    return statements.Execute("INSERT OR REPLACE INTO Branches (Name, HeadCommit) VALUES (@branch, @head);",
+                              {{"@branch", trackingName}, {"@head", head}});
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
 // Transfère vers un dépôt toutes les données d'une source qui ne s'y trouve pas.
+// Le dépôt local est situé à <rootPath> et ses requêtes sont préparées à l'aide de
+// <statements>.
+// NOTE: Le transfert utilise sa propre connexion puisque la base de données source
+//       y est attachée le temps du transfert.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Transfer(TransferDirection direction) noexcept
+[[nodiscard]] bool Transfer(dvcs::StatementCache &statements, const fs::path &rootPath, TransferDirection direction) noexcept
 {
     try
     {
@@ -170,12 +637,12 @@ fs::path GetRemote()
         switch (direction)
         {
         case TransferDirection::ToLocal:
-            source = GetRemote();
-            destination = fs::current_path() / dvcs::REPO_DB_PATH;
+            source = GetRemote(statements, rootPath);
+            destination = rootPath / dvcs::REPO_DB_PATH;
             break;
         case TransferDirection::ToRemote:
-            destination = GetRemote();
-            source = fs::current_path() / dvcs::REPO_DB_PATH;
+            destination = GetRemote(statements, rootPath);
+            source = rootPath / dvcs::REPO_DB_PATH;
             break;
         default:
             fmt::print(std::cerr, "Unsupported transfer option\n");
@@ -184,21 +651,155 @@ fs::path GetRemote()
         RETURN_IF(source.empty(), false);
         RETURN_IF(destination.empty(), false);
 
-        const auto query{
-            fmt::format("ATTACH DATABASE \"{}\" as Source;"
-                        "BEGIN TRANSACTION;"
-                        "INSERT OR IGNORE INTO Objects (Hash, Path, Size, Content) SELECT Hash, Path, Size, Content FROM Source.Objects;"
-                        "INSERT OR IGNORE INTO Commits (Hash, ParentHash, Author, Email, Message) SELECT Hash, ParentHash, Author, Email, "
-                        "Message FROM Source.Commits;"
-                        "INSERT OR IGNORE INTO CommitsObjects (ObjectHash, CommitHash) SELECT ObjectHash, CommitHash FROM "
-                        "Source.CommitsObjects;"
-                        "INSERT OR REPLACE INTO Branches (Name, HeadCommit) SELECT Name, HeadCommit FROM Source.Branches;"
-                        "INSERT OR IGNORE INTO BranchesCommits (BranchName, CommitHash) SELECT BranchName, CommitHash FROM "
-                        "Source.BranchesCommits;"
-                        "END TRANSACTION;"
-                        "DETACH DATABASE Source;",
-                        source.string())};
-        return ExecuteQuery(destination, query);
+        dvcs::TDatabasePtr pDB{nullptr, sqlite3_close};
+        RETURN_IF(!dvcs::OpenDatabaseConnection(destination, pDB), false);
+        RETURN_IF(!dvcs::ExecuteQuery(pDB, fmt::format("ATTACH DATABASE \"{}\" as Source;", source.string())), false);
+
+        // Les deux dépôts doivent utiliser le même format de stockage
+        RETURN_IF(!ValidateSchemaVersion(pDB, "main") || !ValidateSchemaVersion(pDB, "Source"), false);
+
+        // ... mais chacun conserve son propre profil de stockage
+        dvcs::StorageProfile destinationProfile{};
+        dvcs::StorageProfile sourceProfile{};
+        RETURN_IF(!dvcs::GetStorageProfile(pDB, "main", destinationProfile) || !dvcs::GetStorageProfile(pDB, "Source", sourceProfile), false);
+        RETURN_IF(!dvcs::ApplyStorageSettings(pDB, "main", dvcs::GetStorageSettings(destinationProfile)) ||
+                      !dvcs::ApplyStorageSettings(pDB, "Source", dvcs::GetStorageSettings(sourceProfile)),
+                  false);
+
+        // ... et identifier leurs objets de la même façon
+        dvcs::HashAlgorithm destinationAlgorithm{};
+        dvcs::HashAlgorithm sourceAlgorithm{};
+        RETURN_IF(!dvcs::GetHashAlgorithm(pDB, "main", destinationAlgorithm) || !dvcs::GetHashAlgorithm(pDB, "Source", sourceAlgorithm), false);
+        if (destinationAlgorithm != sourceAlgorithm)
+        {
+            fmt::print(std::cerr, "Can't transfer between a {0} repository and a {1} repository\n", dvcs::GetHashAlgorithmName(sourceAlgorithm),
+                       dvcs::GetHashAlgorithmName(destinationAlgorithm));
+            return false;
+        }
+
+        // Négociation: les commits manquants sont trouvés en descendant l'historique
+        // à partir des têtes des branches de la source jusqu'aux commits que la
+        // destination connaît déjà. Un commit présent dans la destination l'est
+        // avec tous ses ancêtres et tous leurs objets puisqu'un transfert se fait
+        // d'un seul coup. Seuls les objets de ces commits (et les bases de leurs
+        // deltas), puis les morceaux de ces objets, sont ensuite lus et copiés. Le
+        // coût d'un transfert dépend donc de l'écart entre les deux dépôts plutôt
+        // que de la taille de leur historique.
+        // NOTE: Les objets sont copiés dans l'ordre de la source puisque le rowid
+        //       d'un objet désigne sa version la plus récente (voir Add).
+        const auto query{"BEGIN TRANSACTION;"
+                          "CREATE TEMP TABLE MissingCommits(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                          "INSERT INTO MissingCommits (Hash) "
+                          "WITH RECURSIVE Missing(Hash, ParentHash, MergeParentHash) AS ("
+                          "   SELECT SourceCommit.Hash, SourceCommit.ParentHash, SourceCommit.MergeParentHash FROM Source.Branches AS SourceBranch "
+                          "   JOIN Source.Commits AS SourceCommit ON SourceCommit.Hash = SourceBranch.HeadCommit "
+                          "   WHERE NOT EXISTS (SELECT 1 FROM main.Commits WHERE main.Commits.Hash = SourceCommit.Hash) "
+                          "   UNION "
+                          "   SELECT SourceCommit.Hash, SourceCommit.ParentHash, SourceCommit.MergeParentHash FROM Missing "
+                          "   JOIN Source.Commits AS SourceCommit ON SourceCommit.Hash IN (Missing.ParentHash, Missing.MergeParentHash) "
+                          "   WHERE NOT EXISTS (SELECT 1 FROM main.Commits WHERE main.Commits.Hash = SourceCommit.Hash)) "
+                          "SELECT Hash FROM Missing;"
+                          "CREATE TEMP TABLE MissingObjects(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                          "INSERT INTO MissingObjects (Hash) "
+                          "WITH RECURSIVE Missing(Hash) AS ("
+                          "   SELECT SourceLink.ObjectHash FROM MissingCommits "
+                          "   JOIN Source.CommitsObjects AS SourceLink ON SourceLink.CommitHash = MissingCommits.Hash "
+                          "   WHERE SourceLink.ObjectHash IS NOT NULL AND "
+                          "         NOT EXISTS (SELECT 1 FROM main.Objects WHERE main.Objects.Hash = SourceLink.ObjectHash) "
+                          "   UNION "
+                          "   SELECT SourceObject.Base FROM Missing "
+                          "   JOIN Source.Objects AS SourceObject ON SourceObject.Hash = Missing.Hash "
+                          "   WHERE SourceObject.Base IS NOT NULL AND "
+                          "         NOT EXISTS (SELECT 1 FROM main.Objects WHERE main.Objects.Hash = SourceObject.Base)) "
+                          "SELECT Hash FROM Missing;"
+                          "CREATE TEMP TABLE MissingChunks(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                          "INSERT OR IGNORE INTO MissingChunks (Hash) SELECT SourceLink.ChunkHash FROM MissingObjects "
+                          "JOIN Source.ObjectsChunks AS SourceLink ON SourceLink.ObjectHash = MissingObjects.Hash "
+                          "WHERE NOT EXISTS (SELECT 1 FROM main.Chunks WHERE main.Chunks.Hash = SourceLink.ChunkHash);"
+                          "INSERT OR IGNORE INTO main.Dictionaries (Id, Content) SELECT Id, Content FROM Source.Dictionaries;"
+                          "INSERT INTO main.Chunks (Hash, Size, Content, Codec) SELECT SourceChunk.Hash, SourceChunk.Size, SourceChunk.Content, "
+                          "SourceChunk.Codec FROM MissingChunks JOIN Source.Chunks AS SourceChunk ON SourceChunk.Hash = MissingChunks.Hash;"
+                          "INSERT INTO main.Objects (Hash, Path, Size, Content, Codec, Base, Depth) SELECT SourceObject.Hash, SourceObject.Path, "
+                          "SourceObject.Size, SourceObject.Content, SourceObject.Codec, SourceObject.Base, SourceObject.Depth FROM MissingObjects "
+                          "JOIN Source.Objects AS SourceObject ON SourceObject.Hash = MissingObjects.Hash ORDER BY SourceObject.rowid;"
+                          "INSERT OR IGNORE INTO main.ObjectsChunks (ObjectHash, Position, ChunkHash) SELECT SourceLink.ObjectHash, "
+                          "SourceLink.Position, SourceLink.ChunkHash FROM MissingObjects "
+                          "JOIN Source.ObjectsChunks AS SourceLink ON SourceLink.ObjectHash = MissingObjects.Hash;"
+                          "INSERT INTO main.Commits (Hash, ParentHash, Author, Email, Message, MergeParentHash) SELECT SourceCommit.Hash, "
+                          "SourceCommit.ParentHash, SourceCommit.Author, SourceCommit.Email, SourceCommit.Message, SourceCommit.MergeParentHash "
+                          "FROM MissingCommits "
+                          "JOIN Source.Commits AS SourceCommit ON SourceCommit.Hash = MissingCommits.Hash;"
+                          "INSERT OR IGNORE INTO main.CommitsObjects (ObjectHash, CommitHash, Path) SELECT SourceLink.ObjectHash, "
+                          "SourceLink.CommitHash, SourceLink.Path FROM MissingCommits "
+                          "JOIN Source.CommitsObjects AS SourceLink ON SourceLink.CommitHash = MissingCommits.Hash;"};
+        RETURN_IF(!dvcs::ExecuteQuery(pDB, query), false);
+
+        // Les têtes des branches ne font qu'avancer (voir UpdateBranchHead). Les
+        // branches qui conservent les têtes distantes sont propres à chaque dépôt.
+        dvcs::StatementCache transferStatements{pDB};
+        dvcs::CommitGraph graph;
+        BranchHeadsUpdate update{graph, GetCommitGraphPath(destination),
+                                       (direction == TransferDirection::ToRemote) ? DivergedBranchPolicy::Reject : DivergedBranchPolicy::Track};
+        {
+            TBranchHeads heads;
+            dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+            RETURN_IF(!transferStatements.Prepare("SELECT Name, HeadCommit FROM Source.Branches WHERE Name NOT LIKE 'remote/%';", pStmt), false);
+            int stepResult{};
+            while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+            {
+                bool isPresent{};
+                auto &[name, head] = heads.emplace_back(dvcs::GetColumnText(pStmt, 0), dvcs::THash{});
+                RETURN_IF(!dvcs::GetColumnHash(pStmt, 1, head, isPresent), false);
+            }
+            RETURN_IF(stepResult != SQLITE_DONE, false);
+            pStmt.reset();
+
+            for (const auto &[name, head] : heads)
+            {
+                RETURN_IF(!UpdateBranchHead(transferStatements, update, name, head), false);
+            }
+        }
+        RETURN_IF(!dvcs::ExecuteQuery(pDB, "INSERT OR IGNORE INTO main.BranchesCommits (BranchName, CommitHash) "
+                                           "SELECT SourceLink.BranchName, SourceLink.CommitHash FROM MissingCommits "
+                                           "JOIN Source.BranchesCommits AS SourceLink ON SourceLink.CommitHash = MissingCommits.Hash "
+                                           "WHERE SourceLink.BranchName NOT LIKE 'remote/%';"),
+                  false);
+
+        // Les filtres des chemins modifiés des nouveaux commits sont construits à
+        // partir de leurs objets, maintenant copiés
+        {
+            dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+            RETURN_IF(!transferStatements.Prepare("SELECT Hash FROM MissingCommits;", pStmt), false);
+            int stepResult{};
+            while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+            {
+                const auto *pHash = static_cast<const std::uint8_t *>(sqlite3_column_blob(pStmt.get(), 0));
+                dvcs::THash commit{static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), 0))};
+                std::copy_n(pHash, commit.size(), commit.data());
+                RETURN_IF(!WritePathFilter(transferStatements, commit), false);
+            }
+            RETURN_IF(stepResult != SQLITE_DONE, false);
+        }
+        RETURN_IF(!dvcs::ExecuteQuery(pDB, "END TRANSACTION;"), false);
+
+        int nbCommits{};
+        int nbObjects{};
+        int nbChunks{};
+        auto countCallback = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
+            RETURN_IF(argc != 1, SQLITE_ERROR);
+            *reinterpret_cast<int *>(pArg) = std::atoi(pArgv[0]);
+            return SQLITE_OK;
+        };
+        RETURN_IF(!dvcs::ExecuteQuery(pDB, "SELECT COUNT(*) FROM MissingCommits;", countCallback, &nbCommits) ||
+                      !dvcs::ExecuteQuery(pDB, "SELECT COUNT(*) FROM MissingObjects;", countCallback, &nbObjects) ||
+                      !dvcs::ExecuteQuery(pDB, "SELECT COUNT(*) FROM MissingChunks;", countCallback, &nbChunks),
+                  false);
+        fmt::print(std::cout, "transferred {0} commits, {1} objects and {2} chunks\n", nbCommits, nbObjects, nbChunks);
+
+        return dvcs::ExecuteQuery(pDB, "DROP TABLE MissingCommits;"
+                                 "DROP TABLE MissingObjects;"
+                                 "DROP TABLE MissingChunks;"
+                                 "DETACH DATABASE Source;");
     }
     catch (const std::exception &e)
     {
@@ -208,348 +809,3601 @@ fs::path GetRemote()
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Calcul le SHA1 d'un ensemble de données brut <data>.
+// Calcul l'empreinte <algorithm> d'un ensemble de données brut <data>.
 ////////////////////////////////////////////////////////////////////////////////////
-std::string ComputeSHA1(const std::vector<char> &data)
+dvcs::THash ComputeHash(dvcs::HashAlgorithm algorithm, const std::vector<char> &data)
 {
-    boost::uuids::detail::sha1 sha1;
-    sha1.process_bytes(data.data(), data.size());
-
-    constexpr const int digestSize = 5;
-    unsigned int digest[digestSize] = {0}; // NOLINT
-    sha1.get_digest(digest);
-
-    fmt::memory_buffer buf;
-    for (int iHash = 0; iHash < digestSize; ++iHash) // NOLINT
-    {
-        fmt::format_to(buf, "{:08x}", digest[iHash]);
-    }
-    return fmt::to_string(buf);
+    return dvcs::ComputeHash(algorithm, data.data(), data.size());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Transforme les données brutes d'un objet (accessible par le flux d'entrée
-// <inputStream>) en données pouvant être stockées dans DVCSUS.
+// Indique si <path> est contenu dans le répertoire <dirPath> ou dans un de ses
+// sous-répertoires.
+// NOTE: On prend le path par copie à cause des modifications qu'on pourrait lui
+//       apporter dans le cadre de la fonction.
 ////////////////////////////////////////////////////////////////////////////////////
-template <typename TStream>
-requires std::derived_from<TStream, std::istream> HashedCompressedData PrepareObjectContent(TStream &inputStream)
+bool IsContainedInDirectory(fs::path path, const fs::path &dirPath)
 {
-    RETURN_IF(!inputStream.good(), {});
+    if (path.has_filename())
+    {
+        path.remove_filename();
+    }
 
-    namespace bios = boost::iostreams;
-    using OutputDevice = bios::back_insert_device<std::vector<char>>;
-    using OutputStream = bios::stream<OutputDevice>;
+    const auto dirPathLength = std::distance(dirPath.begin(), dirPath.end());
+    const auto pathLength = std::distance(path.begin(), path.end());
 
-    std::vector<char> contents;
-    OutputDevice device{contents};
-    OutputStream objectStream{device};
+    // Si le path reçu est plus court que le path du répertoire, aucune chance
+    // qu'il soit contenu dans celui-ci.
+    RETURN_IF(pathLength < dirPathLength, false);
 
-    // Pour minimiser l'espace disque d'un objet, celui-ci sera
-    // compressé à l'aide de zlib
-    bios::filtering_streambuf<bios::input> objectCompressingStream;
-    objectCompressingStream.push(bios::zlib_compressor());
-    objectCompressingStream.push(inputStream);
+    return std::equal(dirPath.begin(), dirPath.end(), path.begin());
+}
 
-    try
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si <text> correspond au motif <pattern>.
+// Les jokers supportés sont:
+// * '?'  : n'importe quel caractère sauf un séparateur de répertoires
+// * '*'  : n'importe quelle suite de caractères ne contenant pas de séparateur
+// * '**' : n'importe quelle suite de caractères, séparateurs compris
+////////////////////////////////////////////////////////////////////////////////////
+bool MatchesGlob(std::string_view pattern, std::string_view text) noexcept
+{
+    if (pattern.empty())
     {
-        objectStream.exceptions(std::ios::badbit | std::ios::failbit);
-        bios::copy(objectCompressingStream, objectStream);
+        return text.empty();
     }
-    catch (const std::exception &e)
+
+    if (pattern.starts_with("**"))
     {
-        fmt::print(std::cerr, "{}\n", e.what());
-        return {};
+        pattern.remove_prefix(2);
+        // "**/" peut aussi correspondre à aucun répertoire
+        if (pattern.starts_with('/') && MatchesGlob(pattern.substr(1), text))
+        {
+            return true;
+        }
+        for (std::size_t iChar = 0; iChar <= text.size(); ++iChar)
+        {
+            RETURN_IF(MatchesGlob(pattern, text.substr(iChar)), true);
+        }
+        return false;
     }
 
-    // Un objet DVCS est identifé par un hash cryptographique de son contenu
-    // (SHA1 pour être plus précis)
-    const std::string hexdigest = ComputeSHA1(contents);
+    if (pattern.front() == '*')
+    {
+        pattern.remove_prefix(1);
+        for (std::size_t iChar = 0;; ++iChar)
+        {
+            RETURN_IF(MatchesGlob(pattern, text.substr(iChar)), true);
+            RETURN_IF((iChar == text.size()) || (text[iChar] == '/'), false);
+        }
+    }
 
-    return {hexdigest, std::move(contents)};
+    RETURN_IF(text.empty(), false);
+    const bool charMatches = (pattern.front() == '?') ? (text.front() != '/') : (pattern.front() == text.front());
+    return charMatches && MatchesGlob(pattern.substr(1), text.substr(1));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Indique si <path> est contenu dans le répertoire courant ou dans un des
-// sous-répertoires du répertoire courant.
-// NOTE: On prend le path par copie à cause des modifications qu'on pourrait lui
-//       apporter dans le cadre de la fonction.
+// Ajoute à <files> tous les fichiers se trouvant sous le répertoire <dirPath> dont
+// le chemin relatif à <dirPath> correspond au motif <pattern> (s'il y en a un).
+// Le répertoire interne de DVCSUS est ignoré.
 ////////////////////////////////////////////////////////////////////////////////////
-bool IsContainedInCurrentDirectory(fs::path path)
+void CollectFiles(const fs::path &dirPath, std::string_view pattern, std::vector<FileToAdd> &files)
 {
-    if (path.has_filename())
+    for (auto entryIt = fs::recursive_directory_iterator{dirPath}; entryIt != fs::recursive_directory_iterator{}; ++entryIt)
     {
-        path.remove_filename();
+        if (entryIt->is_directory() && (entryIt->path().filename() == dvcs::DVCS_PATH))
+        {
+            entryIt.disable_recursion_pending();
+            continue;
+        }
+        if (!entryIt->is_regular_file())
+        {
+            continue;
+        }
+        if (!pattern.empty() && !MatchesGlob(pattern, fs::relative(entryIt->path(), dirPath).generic_string()))
+        {
+            continue;
+        }
+        files.push_back({entryIt->path(), entryIt->file_size()});
     }
+}
 
-    const fs::path currentPath = fs::current_path();
-    const auto currentPathLength = std::distance(currentPath.begin(), currentPath.end());
-    const auto pathLength = std::distance(path.begin(), path.end());
-
-    // Si le path reçu est plus court que le path courant, aucune chance
-    // qu'il soit contenu dans le répertoire courant.
-    RETURN_IF(pathLength < currentPathLength, false);
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à <removedPaths> les fichiers suivis <trackedPaths> (chemins représentés
+// comme ceux des objets) désignés par le fichier ou le répertoire <absPath> du
+// dépôt dont la racine est <rootPath> qui ne se trouvent plus dans l'arbre de
+// travail.
+////////////////////////////////////////////////////////////////////////////////////
+void CollectRemovedFiles(const fs::path &absPath, const fs::path &rootPath, const std::set<std::string> &trackedPaths,
+                         std::vector<std::string> &removedPaths)
+{
+    const auto relativePath = absPath.lexically_relative(rootPath).generic_string();
+    const auto path = (relativePath == ".") ? std::string{"../"} : "../" + relativePath;
 
-    return std::equal(currentPath.begin(), currentPath.end(), path.begin());
+    // Les fichiers d'un répertoire suivent son chemin dans l'ordre des chemins
+    for (auto pathIt = trackedPaths.lower_bound(path); (pathIt != trackedPaths.end()) && pathIt->starts_with(path); ++pathIt)
+    {
+        const bool isDesignated = (pathIt->size() == path.size()) || path.ends_with('/') || ((*pathIt)[path.size()] == '/');
+        if (isDesignated && !fs::is_regular_file(rootPath / pathIt->substr(3)))
+        {
+            removedPaths.push_back(*pathIt);
+        }
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Initialise le dossier dans lequel les données du dépôt seront entreposés.
+// Ajoute à <files> les fichiers désignés par <pathSpec>, qui peut être un fichier,
+// un répertoire (parcouru récursivement) ou un motif contenant des jokers. Les
+// fichiers doivent se trouver dans le dépôt dont la racine est <rootPath>, par
+// rapport à laquelle les chemins relatifs sont interprétés.
+// Les fichiers suivis <trackedPaths> désignés par un fichier ou un répertoire qui
+// ne se trouvent plus dans l'arbre de travail sont plutôt ajoutés à
+// <removedPaths> (voir CollectRemovedFiles).
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool CreateDVCSFolder() noexcept
+[[nodiscard]] bool ExpandPathSpec(const fs::path &pathSpec, const fs::path &rootPath, const std::set<std::string> &trackedPaths,
+                                  std::vector<FileToAdd> &files, std::vector<std::string> &removedPaths)
 {
-    try
+    const auto nbFilesBefore = files.size();
+    const auto nbRemovedBefore = removedPaths.size();
+
+    if (pathSpec.string().find_first_of("*?") != std::string::npos)
     {
-        const fs::path dvcsPath = fs::current_path() / dvcs::DVCS_PATH;
-        if (fs::exists(dvcsPath))
+        // Le motif débute au premier élément du chemin contenant un joker
+        fs::path basePath;
+        fs::path pattern;
+        for (const auto &element : pathSpec)
         {
-            fmt::print(std::cerr, "Repository already initialized in '{}'", fs::current_path().string());
+            if (pattern.empty() && (element.string().find_first_of("*?") == std::string::npos))
+            {
+                basePath /= element;
+            }
+            else
+            {
+                pattern /= element;
+            }
+        }
+
+        const auto absBasePath{(rootPath / basePath).lexically_normal() / ""};
+        if (!IsContainedInDirectory(absBasePath, rootPath))
+        {
+            fmt::print(std::cerr, "fatal: '{}' is outside repository\n", pathSpec.string());
             return false;
         }
-        return fs::create_directory(dvcsPath);
+        if (fs::is_directory(absBasePath))
+        {
+            CollectFiles(absBasePath, pattern.generic_string(), files);
+        }
     }
-    catch (const std::exception &e)
+    else
     {
-        fmt::print(std::cerr, "{}\n", e.what());
+        const auto absPath{(rootPath / pathSpec).lexically_normal()};
+        if (fs::is_directory(absPath))
+        {
+            if (!IsContainedInDirectory(absPath / "", rootPath))
+            {
+                fmt::print(std::cerr, "fatal: '{}' is outside repository\n", absPath.c_str());
+                return false;
+            }
+            CollectFiles(absPath, {}, files);
+            CollectRemovedFiles(absPath, rootPath, trackedPaths, removedPaths);
+            return true;
+        }
+        if (fs::is_regular_file(absPath))
+        {
+            if (!IsContainedInDirectory(absPath, rootPath))
+            {
+                // Où est-ce que tu va chercher ce fichier-là?
+                fmt::print(std::cerr, "fatal: '{}' is outside repository\n", absPath.c_str());
+                return false;
+            }
+            files.push_back({absPath, fs::file_size(absPath)});
+        }
+        else
+        {
+            CollectRemovedFiles(absPath, rootPath, trackedPaths, removedPaths);
+        }
+    }
+
+    if ((files.size() == nbFilesBefore) && (removedPaths.size() == nbRemovedBefore))
+    {
+        fmt::print(std::cerr, "fatal: pathspec '{}' did not match any files\n", pathSpec.string());
         return false;
     }
+    return true;
 }
 
-} // namespace
-
-namespace dvcs
+////////////////////////////////////////////////////////////////////////////////////
+// Compresse le fichier <file> par morceaux vers un fichier temporaire situé dans
+// <dvcsPath>. La mémoire utilisée est constante peu importe la taille du fichier.
+// Un fichier dont le début semble déjà compressé, ou que la compression ne réduit
+// pas, est plutôt stocké tel quel.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SpoolObjectContent(const FileToAdd &file, const fs::path &dvcsPath, const dvcs::CompressionSettings &settings,
+                                      StagedObject &object)
 {
+    auto storeFile = [&file, &object]() {
+        object.m_spoolFile = dvcs::TemporaryFile{};
+        object.m_codec = dvcs::Codec::Store;
+        object.m_contentPath = file.m_path;
+        object.m_contentSize = file.m_size;
+        return true;
+    };
+
+    std::ifstream inputStream{file.m_path, std::ios::in | std::ios::binary};
+    RETURN_IF(!inputStream.good(), false);
+
+    std::vector<char> sample(dvcs::STREAMING_CHUNK_SIZE);
+    RETURN_IF(!inputStream.read(sample.data(), static_cast<std::streamsize>(sample.size())), false);
+    RETURN_IF((settings.m_codec == dvcs::Codec::Store) || dvcs::IsLikelyIncompressible(sample.data(), sample.size()), storeFile());
+    inputStream.seekg(0);
+
+    static std::atomic<unsigned int> spoolCounter{0};
+    object.m_spoolFile = dvcs::TemporaryFile{
+        dvcsPath / fmt::format("add-{0}-{1}.tmp", std::chrono::steady_clock::now().time_since_epoch().count(), spoolCounter++)};
+    std::ofstream spoolStream{object.m_spoolFile.GetPath(), std::ios::out | std::ios::binary};
+    RETURN_IF(!dvcs::CompressStream(settings, inputStream, spoolStream, object.m_contentSize), false);
+    spoolStream.close();
+    RETURN_IF(spoolStream.fail(), false);
+    RETURN_IF(object.m_contentSize >= file.m_size, storeFile());
+
+    object.m_codec = settings.m_codec;
+    object.m_contentPath = object.m_spoolFile.GetPath();
+    return true;
+}
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Ajoute aux fichiers monitorés par le système de gestion de sources le fichier
-// dont le path relatif à la racine du dépôt est <filePath>
+// Lit le fichier <file> et calcule le hash de son contenu brut.
+// Le contenu des petits fichiers est conservé en mémoire pour éviter d'avoir à le
+// relire lors de la compression. Celui des gros fichiers est traité par morceaux.
+// Lorsque <useChunking> est vrai, les gros fichiers sont au passage découpés selon
+// leur contenu. Un fichier plus gros que la taille maximale d'un blob SQLite
+// <maxBlobSize> l'est toujours, puisqu'il ne pourrait être stocké d'un seul tenant.
+// Peut être appelée de façon concurrente. En cas d'erreur, l'objet retourné est
+// marqué comme invalide.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Add(const fs::path &filePath) noexcept
+StagedObject HashStagedObject(const FileToAdd &file, const fs::path &dvcsPath, dvcs::HashAlgorithm algorithm, bool useChunking,
+                              std::uintmax_t maxBlobSize) noexcept
 {
     try
     {
-        const auto absPath{fs::absolute(filePath)};
-        if (!fs::is_regular_file(absPath))
+        // Le chemin d'accès stocké dans la BD doit être relatif au chemin d'accès du dépôt
+        StagedObject object{fs::relative(file.m_path, dvcsPath), file.m_size};
+
+        std::ifstream fileStream{file.m_path, std::ios::in | std::ios::binary};
+        if ((useChunking && (file.m_size >= CHUNKING_THRESHOLD)) || (file.m_size > maxBlobSize))
         {
-            // Ceci n'est pas un fichier
-            fmt::print(std::cerr, "fatal: pathspec '{}' did not match any files\n", absPath.c_str());
-            return false;
+            object.m_isChunked = true;
+            object.m_isValid = dvcs::ChunkStream(fileStream, algorithm, object.m_chunks, object.m_hash);
+            return object;
         }
-        if (!IsContainedInCurrentDirectory(absPath))
+        if (file.m_size >= STREAMING_THRESHOLD)
         {
-            // Où est-ce que tu va chercher ce fichier-là?
-            fmt::print(std::cerr, "fatal: '{}' is outside repository\n", absPath.c_str());
-            return false;
+            object.m_isValid = dvcs::ComputeStreamHash(fileStream, algorithm, object.m_hash);
+            return object;
         }
 
-        std::ifstream fileStream{filePath.string(), std::ios::in | std::ios::binary};
-        const auto objContent{PrepareObjectContent(fileStream)};
-        RETURN_IF(objContent.m_hash.empty(), false);
-
-        // HashObject a consommé le stream. On peut donc déterminer la taille des données ici
-        const auto dataSize = fileStream.tellg();
-
-        TDatabasePtr pDB{nullptr, sqlite3_close};
-        RETURN_IF(!OpenDatabaseConnection(fs::current_path() / STAGING_DB_PATH, pDB), false);
-        RETURN_IF(pDB == nullptr, false);
-
-        // Le chemin d'accès stocké dans la BD doit être relatif au chemin d'accès du dépôt
-        const fs::path dvcsPath = fs::current_path() / dvcs::DVCS_PATH;
-
-        sqlite3_stmt *pSQLStmt;
-        RETURN_IF(sqlite3_prepare_v2(pDB.get(), "INSERT INTO Objects VALUES(@hash, @path, @size, @content)", -1, &pSQLStmt, nullptr) != SQLITE_OK,
-                  false);
-        TStatementPtr pStmt{pSQLStmt, sqlite3_finalize};
-        RETURN_IF(sqlite3_bind_text(pStmt.get(), 1, objContent.m_hash.c_str(), -1, SQLITE_STATIC) != SQLITE_OK, false);
-        RETURN_IF(sqlite3_bind_text(pStmt.get(), 2, fs::relative(filePath, dvcsPath).c_str(), -1, SQLITE_STATIC) != SQLITE_OK, false);
-        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 3, static_cast<sqlite3_int64>(dataSize)) != SQLITE_OK, false);
-        RETURN_IF(sqlite3_bind_blob64(pStmt.get(), 4, objContent.m_compressedData.data(),
-                                      static_cast<sqlite3_uint64>(objContent.m_compressedData.size()), SQLITE_STATIC) != SQLITE_OK,
-                  false);
+        object.m_rawData.resize(file.m_size);
+        RETURN_IF(!fileStream.read(object.m_rawData.data(), static_cast<std::streamsize>(object.m_rawData.size())), {});
 
-        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        // Un objet DVCS est identifé par un hash cryptographique de son contenu
+        // (SHA1 ou SHA256 selon le dépôt)
+        object.m_hash = ComputeHash(algorithm, object.m_rawData);
+        object.m_isValid = true;
+        return object;
     }
     catch (const std::exception &e)
     {
         fmt::print(std::cerr, "{}\n", e.what());
-        return false;
+        return {};
     }
-
-    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Crée un commit avec le message <message> ayant comme auteur <author> qu'on peut
-// rejoindre à l'addresse courriel <email>.
+// Compresse le contenu de l'objet <object> provenant du fichier <file> selon les
+// paramètres <settings>. Les petits objets sont compressés à l'aide du dictionnaire
+// <pDictionary> s'il y en a un. Un objet ayant une base est plutôt stocké sous
+// forme de delta si celui-ci est plus petit que l'objet compressé au complet. Les
+// contenus pour lesquels la compression ne fait rien gagner sont stockés tels
+// quels.
+// Peut être appelée de façon concurrente.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Commit(const std::string_view author, const std::string_view email, const std::string_view message) noexcept
+[[nodiscard]] bool CompressStagedObject(const FileToAdd &file, const fs::path &dvcsPath, const dvcs::CompressionSettings &settings,
+                                        const dvcs::CompressionDictionary *pDictionary, StagedObject &object) noexcept
 {
-    for (const auto &arg : {author, email, message})
+    // Les morceaux sont compressés au moment de leur insertion
+    RETURN_IF(object.m_isChunked, true);
+
+    try
     {
-        if (arg.empty())
+        if (!object.m_baseHash.has_value() && (file.m_size >= STREAMING_THRESHOLD))
         {
-            fmt::print(std::cerr, "Can't commit. Missing information\n");
-            return false;
+            return SpoolObjectContent(file, dvcsPath, settings, object);
         }
-    }
 
-    auto callback = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
-        RETURN_IF(argc != 1, SQLITE_ERROR);
-        auto *pHash = reinterpret_cast<std::string *>(pArg);
-        *pHash = pArgv[0];
-        return SQLITE_OK;
-    };
-    std::string hash;
-    RETURN_IF(!ExecuteQuery(STAGING_DB_PATH, "SELECT Value FROM Metadata WHERE Name = \"CurrentCommit\";", callback, &hash), false);
+        std::vector<char> delta;
+        if (object.m_baseHash.has_value())
+        {
+            // Le contenu des gros objets n'a pas été conservé lors du calcul de leur hash
+            if (object.m_rawData.size() != file.m_size)
+            {
+                std::ifstream fileStream{file.m_path, std::ios::in | std::ios::binary};
+                object.m_rawData.resize(file.m_size);
+                RETURN_IF(!fileStream.read(object.m_rawData.data(), static_cast<std::streamsize>(object.m_rawData.size())), false);
+            }
 
-    std::vector<char> commitData;
-    commitData.insert(commitData.end(), author.cbegin(), author.cend());
-    commitData.insert(commitData.end(), email.cbegin(), email.cend());
-    commitData.insert(commitData.end(), message.cbegin(), message.cend());
-    commitData.insert(commitData.end(), hash.cbegin(), hash.cend());
-    const auto commitHash = ComputeSHA1(commitData);
+            RETURN_IF(!dvcs::CompressDelta(settings.m_level, object.m_baseData.data(), object.m_baseData.size(), object.m_rawData.data(),
+                                           object.m_rawData.size(), delta),
+                      false);
+            object.m_baseData = {};
+            if (delta.size() * SMALL_DELTA_RATIO <= object.m_rawData.size())
+            {
+                object.m_codec = dvcs::Codec::Zstd;
+                object.m_content = std::move(delta);
+                object.m_rawData = {};
+                return true;
+            }
+        }
 
-    try
-    {
-        const auto stagingFullPath = fs::current_path() / STAGING_DB_PATH;
-        const auto commitQuery = fmt::format(
-            "ATTACH DATABASE \"{0}\" as Staging;"
-            "BEGIN TRANSACTION;"
-            "INSERT INTO Objects (Hash, Path, Size, Content) SELECT Hash, Path, Size, Content FROM Staging.Objects;"
-            "INSERT INTO Commits (Hash, ParentHash, Author, Email, Message) SELECT \"{1}\", Value, \"{2}\", \"{3}\", \"{4}\" FROM Staging.Metadata "
-            "WHERE Name = \"CurrentCommit\";"
-            "INSERT INTO CommitsObjects (ObjectHash, CommitHash) SELECT Hash, \"{1}\" FROM Staging.Objects;"
-            "INSERT INTO BranchesCommits (BranchName, CommitHash) SELECT Value, \"{1}\" FROM Staging.Metadata WHERE Name = \"CurrentBranch\";"
-            "INSERT OR REPLACE INTO Branches (Name, HeadCommit) SELECT Value, \"{1}\" FROM Staging.Metadata WHERE Name = \"CurrentBranch\";"
-            "DELETE FROM Staging.Objects;"
-            "INSERT OR REPLACE INTO Staging.Metadata (Name,  Value) VALUES (\"CurrentCommit\", \"{1}\");"
-            "END TRANSACTION;"
-            "DETACH DATABASE Staging;",
-            stagingFullPath.string(), commitHash, author, email, message);
+        object.m_codec = dvcs::Codec::Store;
+        if ((settings.m_codec != dvcs::Codec::Store) && !dvcs::IsLikelyIncompressible(object.m_rawData.data(), object.m_rawData.size()))
+        {
+            RETURN_IF(!dvcs::Compress(settings, object.m_rawData.data(), object.m_rawData.size(), object.m_content,
+                                      (file.m_size <= MAX_DICTIONARY_OBJECT_SIZE) ? pDictionary : nullptr),
+                      false);
+            if (object.m_content.size() < object.m_rawData.size())
+            {
+                object.m_codec = settings.m_codec;
+            }
+        }
+        if (object.m_codec == dvcs::Codec::Store)
+        {
+            object.m_content = std::move(object.m_rawData);
+        }
+        object.m_rawData = {};
 
-        RETURN_IF(!ExecuteQuery(REPO_DB_PATH, commitQuery), false);
+        if (!delta.empty() && (delta.size() < object.m_content.size()))
+        {
+            object.m_codec = dvcs::Codec::Zstd;
+            object.m_content = std::move(delta);
+        }
+        else
+        {
+            object.m_baseHash.reset();
+            object.m_depth = 0;
+        }
+        return true;
     }
     catch (const std::exception &e)
     {
         fmt::print(std::cerr, "{}\n", e.what());
         return false;
     }
+}
 
+////////////////////////////////////////////////////////////////////////////////////
+// Indique, à l'aide de la requête préparée <pStmt>, si l'objet <object> se trouve
+// déjà dans le dépôt ou dans la zone de staging.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ProbeStagedObject(dvcs::TStatementPtr &pStmt, StagedObject &object) noexcept
+{
+    RETURN_IF(sqlite3_reset(pStmt.get()) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_blob(pStmt.get(), 1, object.m_hash.data(), static_cast<int>(object.m_hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_ROW, false);
+    object.m_isKnown = sqlite3_column_int(pStmt.get(), 0) != 0;
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Initialise un dépôt DVCS dans le répertoire courant
-//
-// Concrètement, un dépôt DVCS ressemble à ceci:
-// repoPath
-// | -- .dvcs
-//     | -- repo.db
-//     | -- staging.db
+// Cherche, à l'aide de la requête préparée <pStmt>, la version précédente du
+// fichier de l'objet <object> dans le dépôt. Si l'objet peut être stocké sous
+// forme de delta par rapport à celle-ci, ses données brutes sont récupérées à
+// l'aide de <reader>.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Init() noexcept
+[[nodiscard]] bool FindDeltaBase(dvcs::TStatementPtr &pStmt, dvcs::ObjectReader &reader, StagedObject &object) noexcept
 {
-    RETURN_IF(!CreateDVCSFolder(), false);
-    try
-    {
-        // Création des bases de données contenant le repo en tant que tel
-        // ainsi que la zone de staging.
-        const auto initQuery{
-            fmt::format("ATTACH DATABASE \"{}\" as Staging;"
-                        "PRAGMA foreign_keys = ON;"
-                        "BEGIN TRANSACTION;"
-                        "CREATE TABLE Staging.Objects("
-                        "   Hash    TEXT    NOT NULL PRIMARY KEY,"
-                        "   Path    TEXT    NOT NULL,"
-                        "   Size    INTEGER NOT NULL,"
-                        "   Content BLOB);"
-                        "CREATE TABLE Staging.Metadata("
-                        "   Name   TEXT NOT NULL PRIMARY KEY CHECK(Name = \"CurrentBranch\" or Name = \"CurrentCommit\" or Name = \"Remote\"),"
-                        "   Value  TEXT NOT NULL);"
-                        "CREATE TABLE Objects("
-                        "   Hash    TEXT    NOT NULL PRIMARY KEY,"
-                        "   Path    TEXT    NOT NULL,"
-                        "   Size    INTEGER NOT NULL,"
-                        "   Content BLOB);"
-                        "CREATE TABLE Commits("
-                        "   Hash        TEXT NOT NULL PRIMARY KEY,"
-                        "   ParentHash  TEXT,"
-                        "   Author      TEXT NOT NULL,"
-                        "   Email       TEXT NOT NULL,"
-                        "   Message     TEXT NOT NULL);"
-                        "CREATE TABLE CommitsObjects("
-                        "   ObjectHash TEXT NOT NULL,"
-                        "   CommitHash TEXT NOT NULL,"
-                        "   FOREIGN KEY (ObjectHash) REFERENCES Objects(Hash),"
-                        "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash));"
-                        "CREATE TABLE Branches("
-                        "   Name        TEXT NOT NULL PRIMARY KEY,"
-                        "   HeadCommit  TEXT,"
-                        "   FOREIGN KEY (HeadCommit) REFERENCES Commits(Hash));"
-                        "CREATE TABLE BranchesCommits("
-                        "   BranchName TEXT NOT NULL,"
-                        "   CommitHash TEXT NOT NULL,"
-                        "   FOREIGN KEY (BranchName) REFERENCES Branches(Name),"
-                        "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash));"
-                        "INSERT INTO Branches (Name) VALUES (\"default\");"
-                        "INSERT INTO Staging.Metadata (Name, Value) VALUES (\"CurrentBranch\", \"default\");"
-                        "INSERT INTO Staging.Metadata (Name, Value) VALUES (\"CurrentCommit\", \"0000000000000000000000000000000000000000\");"
-                        "END TRANSACTION;"
-                        "DETACH DATABASE Staging;",
-                        (fs::current_path() / STAGING_DB_PATH).c_str())};
+    RETURN_IF((object.m_size == 0) || (object.m_size > MAX_DELTA_OBJECT_SIZE), true);
 
-        RETURN_IF(!ExecuteQuery(REPO_DB_PATH, initQuery), false);
-    }
+    const auto pathStr = object.m_path.string();
+    RETURN_IF(sqlite3_reset(pStmt.get()) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_text(pStmt.get(), 1, pathStr.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK, false);
+    const int stepResult = sqlite3_step(pStmt.get());
+    RETURN_IF(stepResult == SQLITE_DONE, true);
+    RETURN_IF(stepResult != SQLITE_ROW, false);
+
+    // Une chaîne trop longue est interrompue par un objet complet
+    const int depth = sqlite3_column_int(pStmt.get(), 1);
+    const auto baseSize = static_cast<std::uintmax_t>(sqlite3_column_int64(pStmt.get(), 2));
+    RETURN_IF((depth >= dvcs::MAX_DELTA_DEPTH) || (baseSize == 0) || (baseSize > MAX_DELTA_OBJECT_SIZE), true);
+
+    const auto hashSize = static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), 0));
+    RETURN_IF((hashSize != dvcs::SHA1_SIZE) && (hashSize != dvcs::SHA256_SIZE), false);
+    dvcs::THash baseHash{hashSize};
+    std::memcpy(baseHash.data(), sqlite3_column_blob(pStmt.get(), 0), hashSize);
+
+    RETURN_IF(!reader.Read(baseHash, object.m_baseData), false);
+    object.m_baseHash = baseHash;
+    object.m_depth = depth + 1;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Copie par morceaux le contenu du fichier de <object> dans la colonne Content de
+// la rangée <rowId> de la table Objects à l'aide des entrées/sorties incrémentales
+// de SQLite. Voir: https://sqlite.org/c3ref/blob_open.html
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteSpooledContent(sqlite3 *pDB, sqlite3_int64 rowId, const StagedObject &object) noexcept
+{
+    sqlite3_blob *pBlobHandle;
+    RETURN_IF(sqlite3_blob_open(pDB, "main", "Objects", "Content", rowId, 1, &pBlobHandle) != SQLITE_OK, false);
+    std::unique_ptr<sqlite3_blob, decltype(&sqlite3_blob_close)> pBlob{pBlobHandle, sqlite3_blob_close};
+
+    std::ifstream contentStream{object.m_contentPath, std::ios::in | std::ios::binary};
+    RETURN_IF(!contentStream.good(), false);
+
+    std::array<char, dvcs::STREAMING_CHUNK_SIZE> buffer{};
+    std::uintmax_t offset{};
+    while (offset < object.m_contentSize)
+    {
+        const auto chunkSize = std::min<std::uintmax_t>(buffer.size(), object.m_contentSize - offset);
+        RETURN_IF(!contentStream.read(buffer.data(), static_cast<std::streamsize>(chunkSize)), false);
+        RETURN_IF(sqlite3_blob_write(pBlob.get(), buffer.data(), static_cast<int>(chunkSize), static_cast<int>(offset)) != SQLITE_OK, false);
+        offset += chunkSize;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Insère l'objet <object> dans la zone de staging à l'aide de la requête préparée
+// <pStmt>. La requête est réinitialisée pour pouvoir être réutilisée.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool InsertStagedObject(dvcs::TStatementPtr &pStmt, const StagedObject &object) noexcept
+{
+    const auto pathStr = object.m_path.string();
+    RETURN_IF(sqlite3_reset(pStmt.get()) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_blob(pStmt.get(), 1, object.m_hash.data(), static_cast<int>(object.m_hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_text(pStmt.get(), 2, pathStr.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_int64(pStmt.get(), 3, static_cast<sqlite3_int64>(object.m_size)) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_int(pStmt.get(), 5, static_cast<int>(object.m_codec)) != SQLITE_OK, false);
+    if (object.m_baseHash.has_value())
+    {
+        RETURN_IF(sqlite3_bind_blob(pStmt.get(), 6, object.m_baseHash->data(), static_cast<int>(object.m_baseHash->size()), SQLITE_STATIC) !=
+                      SQLITE_OK,
+                  false);
+    }
+    else
+    {
+        RETURN_IF(sqlite3_bind_null(pStmt.get(), 6) != SQLITE_OK, false);
+    }
+    RETURN_IF(sqlite3_bind_int(pStmt.get(), 7, object.m_depth) != SQLITE_OK, false);
+    if (object.m_isChunked)
+    {
+        RETURN_IF(sqlite3_bind_null(pStmt.get(), 4) != SQLITE_OK, false);
+    }
+    else if (object.m_contentPath.empty())
+    {
+        // NOTE: Un pointeur nul produirait NULL plutôt qu'un blob vide
+        RETURN_IF(sqlite3_bind_blob64(pStmt.get(), 4, object.m_content.empty() ? "" : object.m_content.data(),
+                                      static_cast<sqlite3_uint64>(object.m_content.size()), SQLITE_STATIC) != SQLITE_OK,
+                  false);
+    }
+    else
+    {
+        // On réserve l'espace nécessaire. Le contenu sera écrit par morceaux par la suite.
+        // NOTE: Un objet plus gros qu'un blob est découpé (voir HashStagedObject): le
+        //       contenu stocké, jamais plus gros que le fichier, tient donc dans un blob.
+        RETURN_IF(sqlite3_bind_zeroblob64(pStmt.get(), 4, static_cast<sqlite3_uint64>(object.m_contentSize)) != SQLITE_OK, false);
+    }
+
+    sqlite3 *pDB = sqlite3_db_handle(pStmt.get());
+    if (sqlite3_step(pStmt.get()) != SQLITE_DONE)
+    {
+        fmt::print(std::cerr, "Can't add '{0}': {1}\n", pathStr, sqlite3_errmsg(pDB));
+        return false;
+    }
+
+    return object.m_contentPath.empty() || WriteSpooledContent(pDB, sqlite3_last_insert_rowid(pDB), object);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compresse les données brutes <pData> de taille <size> d'un morceau selon les
+// paramètres <settings>. Un morceau que la compression ne réduit pas est stocké
+// tel quel.
+// Peut être appelée de façon concurrente.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CompressChunk(const dvcs::CompressionSettings &settings, const char *pData, std::size_t size, std::vector<char> &content,
+                                 dvcs::Codec &codec) noexcept
+{
+    try
+    {
+        codec = dvcs::Codec::Store;
+        if ((settings.m_codec != dvcs::Codec::Store) && !dvcs::IsLikelyIncompressible(pData, size))
+        {
+            RETURN_IF(!dvcs::Compress(settings, pData, size, content), false);
+            if (content.size() < size)
+            {
+                codec = settings.m_codec;
+                return true;
+            }
+        }
+        content.assign(pData, pData + size);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Insère dans la zone de staging les morceaux de l'objet découpé <object> provenant
+// du fichier <file> ainsi que la liste ordonnée de ceux-ci.
+// Les morceaux sont traités par fenêtres de CHUNK_WINDOW_COUNT: ceux déjà connus,
+// selon la requête préparée <pProbeStmt>, ne sont ni relus ni compressés alors que
+// les nouveaux sont compressés en parallèle avant d'être insérés à l'aide de la
+// requête préparée <pInsertStmt>. Les liens entre l'objet et ses morceaux sont
+// insérés à l'aide de la requête préparée <pLinkStmt>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool InsertStagedChunks(const FileToAdd &file, const dvcs::CompressionSettings &settings, dvcs::TStatementPtr &pProbeStmt,
+                                      dvcs::TStatementPtr &pInsertStmt, dvcs::TStatementPtr &pLinkStmt, const StagedObject &object) noexcept
+{
+    try
+    {
+        std::ifstream fileStream{file.m_path, std::ios::in | std::ios::binary};
+        RETURN_IF(!fileStream.good(), false);
+
+        std::vector<char> rawData;
+        std::vector<std::size_t> newChunkIndices;
+        std::vector<std::vector<char>> contents;
+        std::vector<dvcs::Codec> codecs;
+        std::unordered_set<dvcs::THash, dvcs::HashHasher> windowHashes;
+        for (std::size_t windowBegin = 0; windowBegin < object.m_chunks.size(); windowBegin += CHUNK_WINDOW_COUNT)
+        {
+            const std::size_t windowEnd = std::min(windowBegin + CHUNK_WINDOW_COUNT, object.m_chunks.size());
+
+            // Les morceaux déjà connus (ou présents plus d'une fois dans la fenêtre) n'ont pas à être insérés
+            newChunkIndices.clear();
+            windowHashes.clear();
+            for (std::size_t iChunk = windowBegin; iChunk < windowEnd; ++iChunk)
+            {
+                const auto &chunk = object.m_chunks[iChunk];
+                RETURN_IF(sqlite3_reset(pProbeStmt.get()) != SQLITE_OK, false);
+                RETURN_IF(sqlite3_bind_blob(pProbeStmt.get(), 1, chunk.m_hash.data(), static_cast<int>(chunk.m_hash.size()), SQLITE_STATIC) !=
+                              SQLITE_OK,
+                          false);
+                RETURN_IF(sqlite3_step(pProbeStmt.get()) != SQLITE_ROW, false);
+                if ((sqlite3_column_int(pProbeStmt.get(), 0) == 0) && windowHashes.insert(chunk.m_hash).second)
+                {
+                    newChunkIndices.push_back(iChunk);
+                }
+            }
+
+            if (!newChunkIndices.empty())
+            {
+                // Seule la portion du fichier couvrant les nouveaux morceaux de la fenêtre est lue
+                const auto &firstChunk = object.m_chunks[newChunkIndices.front()];
+                const auto &lastChunk = object.m_chunks[newChunkIndices.back()];
+                rawData.resize(static_cast<std::size_t>(lastChunk.m_offset + lastChunk.m_size - firstChunk.m_offset));
+                fileStream.seekg(static_cast<std::streamoff>(firstChunk.m_offset));
+                RETURN_IF(!fileStream.read(rawData.data(), static_cast<std::streamsize>(rawData.size())), false);
+
+                contents.assign(newChunkIndices.size(), {});
+                codecs.assign(newChunkIndices.size(), dvcs::Codec::Store);
+                std::atomic<bool> isValid{true};
+                dvcs::ParallelFor(newChunkIndices.size(), [&](std::size_t index) {
+                    const auto &chunk = object.m_chunks[newChunkIndices[index]];
+                    if (!CompressChunk(settings, rawData.data() + (chunk.m_offset - firstChunk.m_offset), chunk.m_size, contents[index],
+                                       codecs[index]))
+                    {
+                        isValid = false;
+                    }
+                });
+                RETURN_IF(!isValid, false);
+
+                for (std::size_t index = 0; index < newChunkIndices.size(); ++index)
+                {
+                    const auto &chunk = object.m_chunks[newChunkIndices[index]];
+                    RETURN_IF(sqlite3_reset(pInsertStmt.get()) != SQLITE_OK, false);
+                    RETURN_IF(sqlite3_bind_blob(pInsertStmt.get(), 1, chunk.m_hash.data(), static_cast<int>(chunk.m_hash.size()), SQLITE_STATIC) !=
+                                  SQLITE_OK,
+                              false);
+                    RETURN_IF(sqlite3_bind_int64(pInsertStmt.get(), 2, static_cast<sqlite3_int64>(chunk.m_size)) != SQLITE_OK, false);
+                    RETURN_IF(sqlite3_bind_blob64(pInsertStmt.get(), 3, contents[index].data(), static_cast<sqlite3_uint64>(contents[index].size()),
+                                                  SQLITE_STATIC) != SQLITE_OK,
+                              false);
+                    RETURN_IF(sqlite3_bind_int(pInsertStmt.get(), 4, static_cast<int>(codecs[index])) != SQLITE_OK, false);
+                    RETURN_IF(sqlite3_step(pInsertStmt.get()) != SQLITE_DONE, false);
+                }
+            }
+
+            for (std::size_t iChunk = windowBegin; iChunk < windowEnd; ++iChunk)
+            {
+                const auto &chunk = object.m_chunks[iChunk];
+                RETURN_IF(sqlite3_reset(pLinkStmt.get()) != SQLITE_OK, false);
+                RETURN_IF(sqlite3_bind_blob(pLinkStmt.get(), 1, object.m_hash.data(), static_cast<int>(object.m_hash.size()), SQLITE_STATIC) !=
+                              SQLITE_OK,
+                          false);
+                RETURN_IF(sqlite3_bind_int64(pLinkStmt.get(), 2, static_cast<sqlite3_int64>(iChunk)) != SQLITE_OK, false);
+                RETURN_IF(sqlite3_bind_blob(pLinkStmt.get(), 3, chunk.m_hash.data(), static_cast<int>(chunk.m_hash.size()), SQLITE_STATIC) !=
+                              SQLITE_OK,
+                          false);
+                RETURN_IF(sqlite3_step(pLinkStmt.get()) != SQLITE_DONE, false);
+            }
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fonction SQL HexToHash(hex) convertissant un hash hexadécimal en hash binaire.
+////////////////////////////////////////////////////////////////////////////////////
+void HexToHashFunction(sqlite3_context *pContext, int /* argc */, sqlite3_value **pArgv) noexcept
+{
+    if (sqlite3_value_type(pArgv[0]) == SQLITE_NULL)
+    {
+        sqlite3_result_null(pContext);
+        return;
+    }
+
+    const auto *pHex = reinterpret_cast<const char *>(sqlite3_value_text(pArgv[0]));
+    dvcs::THash hash{};
+    if ((pHex == nullptr) || !dvcs::FromHex(pHex, hash))
+    {
+        sqlite3_result_error(pContext, "invalid hexadecimal hash", -1);
+        return;
+    }
+    sqlite3_result_blob(pContext, hash.data(), static_cast<int>(hash.size()), SQLITE_TRANSIENT);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fonction SQL ContentHash(content) calculant le hash binaire des données brutes
+// d'un objet à partir de ses données compressées.
+////////////////////////////////////////////////////////////////////////////////////
+void ContentHashFunction(sqlite3_context *pContext, int /* argc */, sqlite3_value **pArgv) noexcept
+{
+    try
+    {
+        std::vector<char> rawData;
+        // Les objets des dépôts de version 1 sont tous compressés avec zlib
+        if (!dvcs::Decompress(dvcs::Codec::Zlib, sqlite3_value_blob(pArgv[0]), static_cast<std::size_t>(sqlite3_value_bytes(pArgv[0])), rawData))
+        {
+            sqlite3_result_error(pContext, "invalid object content", -1);
+            return;
+        }
+        // Les dépôts de version 1 utilisent tous SHA1
+        const auto hash = ComputeHash(dvcs::HashAlgorithm::SHA1, rawData);
+        sqlite3_result_blob(pContext, hash.data(), static_cast<int>(hash.size()), SQLITE_TRANSIENT);
+    }
+    catch (const std::exception &e)
+    {
+        sqlite3_result_error(pContext, e.what(), -1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit, dans la transaction en cours sur <pDB>, les filtres des chemins modifiés
+// des commits du dépôt qui n'en ont pas encore (voir WritePathFilter).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteAllPathFilters(dvcs::TDatabasePtr &pDB)
+{
+    dvcs::StatementCache statements{pDB};
+    std::vector<dvcs::THash> commits;
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Hash FROM Commits WHERE NOT EXISTS "
+                                      "(SELECT 1 FROM CommitsPathFilters WHERE CommitsPathFilters.CommitHash = Commits.Hash);",
+                                      pStmt),
+                  false);
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+        {
+            const auto *pHash = static_cast<const std::uint8_t *>(sqlite3_column_blob(pStmt.get(), 0));
+            auto &commit = commits.emplace_back(static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), 0)));
+            std::copy_n(pHash, commit.size(), commit.data());
+        }
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+    }
+    for (const auto &commit : commits)
+    {
+        RETURN_IF(!WritePathFilter(statements, commit), false);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 1 à la version courante du schéma.
+// Les tables étant recréées selon le schéma courant, les migrations des versions
+// intermédiaires n'ont pas à être appliquées.
+// Les hash sont convertis en binaire. Les objets sont au passage identifiés par
+// le hash de leurs données brutes (les dépôts de version 1 pouvant utiliser le
+// hash des données compressées). Les identifiants des commits ne changent pas.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion1(dvcs::TDatabasePtr &pDB) noexcept
+{
+    RETURN_IF(sqlite3_create_function(pDB.get(), "HexToHash", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, HexToHashFunction, nullptr, nullptr) !=
+                  SQLITE_OK,
+              false);
+    RETURN_IF(sqlite3_create_function(pDB.get(), "ContentHash", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, ContentHashFunction, nullptr,
+                                      nullptr) != SQLITE_OK,
+              false);
+
+    try
+    {
+        const auto migrationQuery{fmt::format(
+            "BEGIN TRANSACTION;"
+            "ALTER TABLE Objects RENAME TO ObjectsV1;"
+            "ALTER TABLE Commits RENAME TO CommitsV1;"
+            "ALTER TABLE CommitsObjects RENAME TO CommitsObjectsV1;"
+            "ALTER TABLE Branches RENAME TO BranchesV1;"
+            "ALTER TABLE BranchesCommits RENAME TO BranchesCommitsV1;"
+            "ALTER TABLE Staging.Objects RENAME TO ObjectsV1;"
+            "{0}"
+            "{1}"
+            "CREATE TEMP TABLE ObjectIds AS SELECT Hash AS OldHash, ContentHash(Content) AS NewHash FROM ObjectsV1;"
+            "INSERT OR IGNORE INTO Objects (Hash, Path, Size, Content) SELECT ObjectIds.NewHash, Path, Size, Content FROM ObjectsV1 "
+            "JOIN ObjectIds ON ObjectIds.OldHash = ObjectsV1.Hash;"
+            "INSERT INTO Commits (Hash, ParentHash, Author, Email, Message) SELECT HexToHash(Hash), HexToHash(ParentHash), Author, Email, Message "
+            "FROM CommitsV1;"
+            "INSERT OR REPLACE INTO CommitsObjects (ObjectHash, CommitHash, Path) SELECT ObjectIds.NewHash, HexToHash(CommitHash), "
+            "ObjectsV1.Path FROM CommitsObjectsV1 JOIN ObjectIds ON ObjectIds.OldHash = CommitsObjectsV1.ObjectHash "
+            "JOIN ObjectsV1 ON ObjectsV1.Hash = CommitsObjectsV1.ObjectHash ORDER BY ObjectsV1.rowid;"
+            "INSERT INTO Branches (Name, HeadCommit) SELECT Name, HexToHash(HeadCommit) FROM BranchesV1;"
+            "INSERT OR IGNORE INTO BranchesCommits (BranchName, CommitHash) SELECT BranchName, HexToHash(CommitHash) FROM BranchesCommitsV1;"
+            "INSERT OR IGNORE INTO Staging.Objects (Hash, Path, Size, Content) SELECT ContentHash(Content), Path, Size, Content FROM "
+            "Staging.ObjectsV1;"
+            "INSERT OR IGNORE INTO Staging.Paths (Path, Hash) SELECT Path, ContentHash(Content) FROM Staging.ObjectsV1 ORDER BY rowid DESC;"
+            "UPDATE Staging.Metadata SET Value = HexToHash(Value) WHERE Name = \"CurrentCommit\";"
+            "DROP TABLE ObjectIds;"
+            "DROP TABLE CommitsObjectsV1;"
+            "DROP TABLE BranchesCommitsV1;"
+            "DROP TABLE BranchesV1;"
+            "DROP TABLE CommitsV1;"
+            "DROP TABLE ObjectsV1;"
+            "DROP TABLE Staging.ObjectsV1;"
+            "INSERT INTO Metadata (Name, Value) VALUES (\"SchemaVersion\", {2});"
+            "INSERT INTO Metadata (Name, Value) VALUES (\"HashAlgorithm\", \"sha1\");",
+            REPO_TABLES_QUERY, STAGING_OBJECTS_TABLES_QUERY, SCHEMA_VERSION)};
+        dvcs::TransactionGuard transactionGuard{pDB};
+        return dvcs::ExecuteQuery(pDB, migrationQuery) && WriteAllPathFilters(pDB) && dvcs::ExecuteQuery(pDB, "END TRANSACTION;");
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 2 à la version 3 du schéma.
+// Les objets existants ont tous été compressés avec zlib, le codec par défaut.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion2(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "ALTER TABLE Objects ADD COLUMN Codec INTEGER NOT NULL DEFAULT 0;"
+                             "ALTER TABLE Staging.Objects ADD COLUMN Codec INTEGER NOT NULL DEFAULT 0;"
+                             "UPDATE Metadata SET Value = 3 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 3 à la version 4 du schéma.
+// Un dépôt migré n'a encore aucun dictionnaire de compression.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion3(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE Dictionaries("
+                             "   Id      INTEGER NOT NULL PRIMARY KEY,"
+                             "   Content BLOB    NOT NULL);"
+                             "UPDATE Metadata SET Value = 4 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 4 à la version 5 du schéma.
+// Les objets existants sont tous stockés au complet.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion4(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "ALTER TABLE Objects ADD COLUMN Base BLOB;"
+                             "ALTER TABLE Objects ADD COLUMN Depth INTEGER NOT NULL DEFAULT 0;"
+                             "CREATE INDEX ObjectsPath ON Objects(Path);"
+                             "ALTER TABLE Staging.Objects ADD COLUMN Base BLOB;"
+                             "ALTER TABLE Staging.Objects ADD COLUMN Depth INTEGER NOT NULL DEFAULT 0;"
+                             "UPDATE Metadata SET Value = 5 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 5 à la version 6 du schéma.
+// Les objets existants ne sont pas découpés en morceaux.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion5(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE Chunks("
+                             "   Hash    BLOB    NOT NULL PRIMARY KEY,"
+                             "   Size    INTEGER NOT NULL,"
+                             "   Content BLOB    NOT NULL,"
+                             "   Codec   INTEGER NOT NULL);"
+                             "CREATE TABLE ObjectsChunks("
+                             "   ObjectHash BLOB    NOT NULL,"
+                             "   Position   INTEGER NOT NULL,"
+                             "   ChunkHash  BLOB    NOT NULL,"
+                             "   PRIMARY KEY (ObjectHash, Position)) WITHOUT ROWID;"
+                             "CREATE TABLE Staging.Chunks("
+                             "   Hash    BLOB    NOT NULL PRIMARY KEY,"
+                             "   Size    INTEGER NOT NULL,"
+                             "   Content BLOB    NOT NULL,"
+                             "   Codec   INTEGER NOT NULL);"
+                             "CREATE TABLE Staging.ObjectsChunks("
+                             "   ObjectHash BLOB    NOT NULL,"
+                             "   Position   INTEGER NOT NULL,"
+                             "   ChunkHash  BLOB    NOT NULL,"
+                             "   PRIMARY KEY (ObjectHash, Position)) WITHOUT ROWID;"
+                             "UPDATE Metadata SET Value = 6 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 6 à la version 7 du schéma.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion6(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE INDEX ObjectsChunksChunkHash ON ObjectsChunks(ChunkHash);"
+                             "CREATE INDEX CommitsParentHash ON Commits(ParentHash);"
+                             "CREATE INDEX CommitsObjectsObjectHash ON CommitsObjects(ObjectHash);"
+                             "CREATE INDEX BranchesCommitsCommitHash ON BranchesCommits(CommitHash);"
+                             "UPDATE Metadata SET Value = 7 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 7 à la version 8 du schéma.
+// Le cache des attributs des fichiers part vide: il se remplit au fil des appels
+// à Status.
+// NOTE: La version du schéma n'est consignée que dans le dépôt. La zone de
+//       staging peut donc déjà avoir le cache.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion7(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE IF NOT EXISTS Staging.FileStats("
+                             "   Path         TEXT    NOT NULL PRIMARY KEY,"
+                             "   Size         INTEGER NOT NULL,"
+                             "   ModifiedTime INTEGER NOT NULL,"
+                             "   Inode        INTEGER NOT NULL,"
+                             "   Hash         BLOB    NOT NULL) WITHOUT ROWID;"
+                             "UPDATE Metadata SET Value = 8 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 8 à la version 9 du schéma.
+// NOTE: Comme pour la version 8, la zone de staging peut déjà avoir le journal.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion8(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE IF NOT EXISTS Staging.FileMonitor("
+                             "   Session  TEXT    NOT NULL PRIMARY KEY,"
+                             "   IsSynced INTEGER NOT NULL) WITHOUT ROWID;"
+                             "CREATE TABLE IF NOT EXISTS Staging.ChangedPaths("
+                             "   Id   INTEGER PRIMARY KEY AUTOINCREMENT,"
+                             "   Path TEXT    NOT NULL);"
+                             "UPDATE Metadata SET Value = 9 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 9 à la version 10 du schéma.
+// NOTE: Les arbres des commits existants sont construits au besoin (voir
+//       GetCommitTree).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion9(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE CommitsTrees("
+                             "   CommitHash BLOB NOT NULL PRIMARY KEY,"
+                             "   TreeHash   BLOB NOT NULL,"
+                             "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                             "CREATE TABLE TreesEntries("
+                             "   TreeHash  BLOB    NOT NULL,"
+                             "   Name      TEXT    NOT NULL,"
+                             "   EntryHash BLOB    NOT NULL,"
+                             "   IsTree    INTEGER NOT NULL,"
+                             "   PRIMARY KEY (TreeHash, Name)) WITHOUT ROWID;"
+                             "UPDATE Metadata SET Value = 10 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 10 à la version 11 du schéma.
+// NOTE: Les filtres des chemins modifiés des commits existants sont construits à
+//       partir des chemins de leurs fichiers, qui ne sont consignés avec ceux-ci
+//       qu'à partir de la version 13 (voir MigrateFromVersion12).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion10(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE CommitsPathFilters("
+                             "   CommitHash BLOB NOT NULL PRIMARY KEY,"
+                             "   Filter     BLOB NOT NULL,"
+                             "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                             "UPDATE Metadata SET Value = 11 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 11 à la version 12 du schéma. Les commits existants
+// n'ont qu'un parent.
+// NOTE: Comme pour la version 8, la zone de staging peut déjà avoir la table.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion11(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "ALTER TABLE Commits ADD COLUMN MergeParentHash BLOB;"
+                             "CREATE INDEX CommitsMergeParentHash ON Commits(MergeParentHash);"
+                             "CREATE TABLE IF NOT EXISTS Staging.PendingMerge("
+                             "   CommitHash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                             "UPDATE Metadata SET Value = 12 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 12 à la version 13 du schéma. Le chemin d'un fichier
+// d'un commit existant est celui de son objet. Lorsqu'un commit a plusieurs objets
+// au même chemin, le plus récent (selon le rowid, voir Add) est conservé, comme le
+// faisait l'arbre du commit. Il en va de même pour les objets de la zone de staging.
+// Les filtres des chemins modifiés manquants sont ensuite construits.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion12(dvcs::TDatabasePtr &pDB) noexcept
+{
+    try
+    {
+        dvcs::TransactionGuard transactionGuard{pDB};
+        return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                                 "DROP INDEX CommitsObjectsObjectHash;"
+                                 "ALTER TABLE CommitsObjects RENAME TO CommitsObjectsV12;"
+                                 "CREATE TABLE CommitsObjects("
+                                 "   ObjectHash BLOB NOT NULL,"
+                                 "   CommitHash BLOB NOT NULL,"
+                                 "   Path       TEXT NOT NULL,"
+                                 "   PRIMARY KEY (CommitHash, Path),"
+                                 "   FOREIGN KEY (ObjectHash) REFERENCES Objects(Hash),"
+                                 "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                                 "CREATE INDEX CommitsObjectsObjectHash ON CommitsObjects(ObjectHash);"
+                                 "INSERT OR REPLACE INTO CommitsObjects (ObjectHash, CommitHash, Path) SELECT Objects.Hash, "
+                                 "CommitsObjectsV12.CommitHash, Objects.Path FROM CommitsObjectsV12 "
+                                 "JOIN Objects ON Objects.Hash = CommitsObjectsV12.ObjectHash ORDER BY Objects.rowid;"
+                                 "DROP TABLE CommitsObjectsV12;"
+                                 "CREATE TABLE IF NOT EXISTS Staging.Paths("
+                                 "   Path TEXT NOT NULL PRIMARY KEY,"
+                                 "   Hash BLOB NOT NULL) WITHOUT ROWID;"
+                                 "INSERT OR IGNORE INTO Staging.Paths (Path, Hash) SELECT Path, Hash FROM Staging.Objects ORDER BY rowid DESC;") &&
+               WriteAllPathFilters(pDB) &&
+               dvcs::ExecuteQuery(pDB, "UPDATE Metadata SET Value = 13 WHERE Name = \"SchemaVersion\";"
+                                 "END TRANSACTION;");
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 13 à la version 14 du schéma. Les tables des
+// fichiers des commits et de la zone de staging sont reconstruites pour qu'un
+// fichier puisse y être retiré; leur contenu ne change pas.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion13(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "DROP INDEX CommitsObjectsObjectHash;"
+                             "ALTER TABLE CommitsObjects RENAME TO CommitsObjectsV13;"
+                             "CREATE TABLE CommitsObjects("
+                             "   ObjectHash BLOB,"
+                             "   CommitHash BLOB NOT NULL,"
+                             "   Path       TEXT NOT NULL,"
+                             "   PRIMARY KEY (CommitHash, Path),"
+                             "   FOREIGN KEY (ObjectHash) REFERENCES Objects(Hash),"
+                             "   FOREIGN KEY (CommitHash) REFERENCES Commits(Hash)) WITHOUT ROWID;"
+                             "CREATE INDEX CommitsObjectsObjectHash ON CommitsObjects(ObjectHash);"
+                             "INSERT INTO CommitsObjects (ObjectHash, CommitHash, Path) SELECT ObjectHash, CommitHash, Path FROM CommitsObjectsV13;"
+                             "DROP TABLE CommitsObjectsV13;"
+                             "ALTER TABLE Staging.Paths RENAME TO PathsV13;"
+                             "CREATE TABLE Staging.Paths("
+                             "   Path TEXT NOT NULL PRIMARY KEY,"
+                             "   Hash BLOB) WITHOUT ROWID;"
+                             "INSERT INTO Staging.Paths (Path, Hash) SELECT Path, Hash FROM Staging.PathsV13;"
+                             "DROP TABLE Staging.PathsV13;"
+                             "UPDATE Metadata SET Value = 14 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migre un dépôt de la version 14 à la version 15 du schéma. Les conflits d'une
+// fusion déjà en cours ne sont pas connus: aucun de ses fichiers n'est consigné.
+// NOTE: Comme pour la version 8, la zone de staging peut déjà avoir la table.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MigrateFromVersion14(dvcs::TDatabasePtr &pDB) noexcept
+{
+    return dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"
+                             "CREATE TABLE IF NOT EXISTS Staging.UnmergedPaths("
+                             "   Path TEXT NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                             "UPDATE Metadata SET Value = 15 WHERE Name = \"SchemaVersion\";"
+                             "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Migration d'un dépôt d'une version du schéma vers une version subséquente.
+// Une migration met elle-même à jour la version consignée dans le dépôt, ce qui
+// permet à une migration de sauter des versions (voir MigrateFromVersion1).
+////////////////////////////////////////////////////////////////////////////////////
+struct Migration
+{
+    int m_fromVersion;
+    bool (*m_pMigrate)(dvcs::TDatabasePtr &pDB) noexcept;
+};
+
+constexpr const std::array<Migration, 14> MIGRATIONS{{
+    {1, MigrateFromVersion1},
+    {2, MigrateFromVersion2},
+    {3, MigrateFromVersion3},
+    {4, MigrateFromVersion4},
+    {5, MigrateFromVersion5},
+    {6, MigrateFromVersion6},
+    {7, MigrateFromVersion7},
+    {8, MigrateFromVersion8},
+    {9, MigrateFromVersion9},
+    {10, MigrateFromVersion10},
+    {11, MigrateFromVersion11},
+    {12, MigrateFromVersion12},
+    {13, MigrateFromVersion13},
+    {14, MigrateFromVersion14},
+}};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Initialise le dossier dans lequel les données du dépôt seront entreposés.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CreateDVCSFolder() noexcept
+{
+    try
+    {
+        const fs::path dvcsPath = fs::current_path() / dvcs::DVCS_PATH;
+        if (fs::exists(dvcsPath))
+        {
+            fmt::print(std::cerr, "Repository already initialized in '{}'", fs::current_path().string());
+            return false;
+        }
+        return fs::create_directory(dvcsPath);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère les données brutes <samples> d'au plus <maxSamples> petits objets du
+// dépôt <pDB>, choisis au hasard parmi ceux qui ne sont pas des deltas.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SampleObjects(dvcs::TDatabasePtr &pDB, dvcs::DictionaryCache &dictionaries, std::size_t maxSamples,
+                                 std::vector<std::vector<char>> &samples) noexcept
+{
+    try
+    {
+        sqlite3_stmt *pSQLStmt;
+        RETURN_IF(sqlite3_prepare_v2(pDB.get(), "SELECT Content, Codec FROM Objects WHERE Size BETWEEN 1 AND @maxSize AND Base IS NULL ORDER BY random() LIMIT @limit;",
+                                     -1, &pSQLStmt, nullptr) != SQLITE_OK,
+                  false);
+        dvcs::TStatementPtr pStmt{pSQLStmt, sqlite3_finalize};
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 1, static_cast<sqlite3_int64>(MAX_DICTIONARY_OBJECT_SIZE)) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 2, static_cast<sqlite3_int64>(maxSamples)) != SQLITE_OK, false);
+
+        samples.clear();
+        int stepResult = sqlite3_step(pStmt.get());
+        for (; stepResult == SQLITE_ROW; stepResult = sqlite3_step(pStmt.get()))
+        {
+            const int codec = sqlite3_column_int(pStmt.get(), 1);
+            RETURN_IF(!dvcs::IsValidCodec(codec), false);
+            std::vector<char> &rawData = samples.emplace_back();
+            RETURN_IF(!dictionaries.Decompress(static_cast<dvcs::Codec>(codec), sqlite3_column_blob(pStmt.get(), 0),
+                                               static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), 0)), rawData),
+                      false);
+        }
+        return stepResult == SQLITE_DONE;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Résultat de la compression d'un ensemble d'échantillons
+////////////////////////////////////////////////////////////////////////////////////
+struct CompressionMeasure
+{
+    std::uintmax_t m_rawSize{};
+    std::uintmax_t m_compressedSize{};
+    double m_compressionSeconds{};
+    double m_decompressionSeconds{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compresse puis décompresse les échantillons <samples> selon les paramètres
+// <settings>, avec ou sans le dictionnaire <pDictionary>, pour en mesurer le gain
+// et le débit.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MeasureCompression(const std::vector<std::vector<char>> &samples, const dvcs::CompressionSettings &settings,
+                                      const dvcs::CompressionDictionary *pDictionary, CompressionMeasure &measure) noexcept
+{
+    try
+    {
+        measure = CompressionMeasure{};
+        std::vector<std::vector<char>> contents(samples.size());
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (std::size_t iSample = 0; iSample < samples.size(); ++iSample)
+        {
+            RETURN_IF(!dvcs::Compress(settings, samples[iSample].data(), samples[iSample].size(), contents[iSample], pDictionary), false);
+            measure.m_rawSize += samples[iSample].size();
+            measure.m_compressedSize += contents[iSample].size();
+        }
+        measure.m_compressionSeconds = std::chrono::duration<double>{std::chrono::steady_clock::now() - startTime}.count();
+
+        std::vector<char> rawData;
+        startTime = std::chrono::steady_clock::now();
+        for (const auto &content : contents)
+        {
+            RETURN_IF(!dvcs::Decompress(settings.m_codec, content.data(), content.size(), rawData, pDictionary), false);
+        }
+        measure.m_decompressionSeconds = std::chrono::duration<double>{std::chrono::steady_clock::now() - startTime}.count();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Affiche le résultat <measure> de la compression d'échantillons
+////////////////////////////////////////////////////////////////////////////////////
+void PrintCompressionMeasure(std::string_view label, const CompressionMeasure &measure)
+{
+    const double megabytes = static_cast<double>(measure.m_rawSize) / (1024.0 * 1024.0);
+    const double epsilon = std::numeric_limits<double>::epsilon();
+    fmt::print(std::cout, "  {0:<20}{1} bytes (ratio {2:.2f}), compression {3:.2f} MB/s, decompression {4:.2f} MB/s\n", label,
+               measure.m_compressedSize, static_cast<double>(measure.m_rawSize) / std::max<double>(static_cast<double>(measure.m_compressedSize), 1.0),
+               megabytes / std::max(measure.m_compressionSeconds, epsilon), megabytes / std::max(measure.m_decompressionSeconds, epsilon));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Recompresse les petits objets du dépôt <pDB> à l'aide du dictionnaire
+// <dictionary>. Seuls les objets dont le contenu rapetisse sont modifiés. Les
+// deltas sont laissés tels quels.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool RepackObjects(dvcs::TDatabasePtr &pDB, dvcs::DictionaryCache &dictionaries, const dvcs::CompressionSettings &settings,
+                                 const dvcs::CompressionDictionary &dictionary, std::size_t &nbRepacked, std::uintmax_t &nbSavedBytes) noexcept
+{
+    try
+    {
+        nbRepacked = 0;
+        nbSavedBytes = 0;
+
+        // NOTE: Les objets sont modifiés un à un plutôt qu'au fil du parcours de la
+        //       table, SQLite ne garantissant pas ce que voit une requête en cours
+        //       lorsque la table qu'elle parcourt est modifiée.
+        std::vector<sqlite3_int64> rowIds;
+        auto callback = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
+            RETURN_IF(argc != 1, SQLITE_ERROR);
+            reinterpret_cast<std::vector<sqlite3_int64> *>(pArg)->push_back(std::atoll(pArgv[0]));
+            return SQLITE_OK;
+        };
+        const auto query = fmt::format("SELECT rowid FROM Objects WHERE Size BETWEEN 1 AND {} AND Base IS NULL;", MAX_DICTIONARY_OBJECT_SIZE);
+        RETURN_IF(!dvcs::ExecuteQuery(pDB, query, callback, &rowIds), false);
+
+        sqlite3_stmt *pSQLStmt;
+        RETURN_IF(sqlite3_prepare_v2(pDB.get(), "SELECT Content, Codec FROM Objects WHERE rowid = @rowid;", -1, &pSQLStmt, nullptr) != SQLITE_OK,
+                  false);
+        dvcs::TStatementPtr pSelectStmt{pSQLStmt, sqlite3_finalize};
+        RETURN_IF(sqlite3_prepare_v2(pDB.get(), "UPDATE Objects SET Content = @content, Codec = @codec WHERE rowid = @rowid;", -1, &pSQLStmt,
+                                     nullptr) != SQLITE_OK,
+                  false);
+        dvcs::TStatementPtr pUpdateStmt{pSQLStmt, sqlite3_finalize};
+
+        std::vector<char> rawData;
+        std::vector<char> content;
+        for (const auto rowId : rowIds)
+        {
+            RETURN_IF(sqlite3_reset(pSelectStmt.get()) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_bind_int64(pSelectStmt.get(), 1, rowId) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_step(pSelectStmt.get()) != SQLITE_ROW, false);
+
+            const int codec = sqlite3_column_int(pSelectStmt.get(), 1);
+            RETURN_IF(!dvcs::IsValidCodec(codec), false);
+            const auto *pContent = sqlite3_column_blob(pSelectStmt.get(), 0);
+            const auto contentSize = static_cast<std::size_t>(sqlite3_column_bytes(pSelectStmt.get(), 0));
+            RETURN_IF(!dictionaries.Decompress(static_cast<dvcs::Codec>(codec), pContent, contentSize, rawData), false);
+            RETURN_IF(!dvcs::Compress(settings, rawData.data(), rawData.size(), content, &dictionary), false);
+            if (content.size() >= contentSize)
+            {
+                continue;
+            }
+
+            RETURN_IF(sqlite3_reset(pUpdateStmt.get()) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_bind_blob64(pUpdateStmt.get(), 1, content.data(), static_cast<sqlite3_uint64>(content.size()), SQLITE_STATIC) !=
+                          SQLITE_OK,
+                      false);
+            RETURN_IF(sqlite3_bind_int(pUpdateStmt.get(), 2, static_cast<int>(settings.m_codec)) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_bind_int64(pUpdateStmt.get(), 3, rowId) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_step(pUpdateStmt.get()) != SQLITE_DONE, false);
+
+            ++nbRepacked;
+            nbSavedBytes += contentSize - content.size();
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+// Tables de sélection du contenu d'un bundle. L'appelant choisit les branches à
+// envoyer (BundleTips) et indique les commits que le destinataire a déjà
+// (BundleBases), puis BUNDLE_SELECTION_QUERY trouve le reste.
+constexpr const char *BUNDLE_TABLES_QUERY = "DROP TABLE IF EXISTS temp.BundleTips;"
+                                            "DROP TABLE IF EXISTS temp.BundleBases;"
+                                            "DROP TABLE IF EXISTS temp.BundleExcluded;"
+                                            "DROP TABLE IF EXISTS temp.BundleCommits;"
+                                            "DROP TABLE IF EXISTS temp.BundleObjects;"
+                                            "DROP TABLE IF EXISTS temp.BundleChunks;"
+                                            "CREATE TEMP TABLE BundleTips(Name TEXT NOT NULL PRIMARY KEY, HeadCommit BLOB NOT NULL) WITHOUT ROWID;"
+                                            "CREATE TEMP TABLE BundleBases(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                                            "CREATE TEMP TABLE BundleExcluded(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                                            "CREATE TEMP TABLE BundleCommits(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                                            "CREATE TEMP TABLE BundleObjects(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;"
+                                            "CREATE TEMP TABLE BundleChunks(Hash BLOB NOT NULL PRIMARY KEY) WITHOUT ROWID;";
+
+// Sélection du contenu d'un bundle: les commits accessibles à partir des têtes de
+// BundleTips qui ne sont pas des ancêtres des commits de BundleBases, leurs objets
+// (et les bases de leurs deltas) que le destinataire n'a pas déjà, ainsi que les
+// morceaux de ces objets. Les parents des premiers commits sélectionnés sont les
+// préalables du bundle. Les commits de BundleBases inconnus du dépôt sont ignorés.
+constexpr const char *BUNDLE_SELECTION_QUERY =
+    "INSERT INTO BundleExcluded (Hash) "
+    "WITH RECURSIVE Ancestors(Hash) AS ("
+    "   SELECT Hash FROM main.Commits WHERE Hash IN (SELECT Hash FROM BundleBases) "
+    "   UNION "
+    "   SELECT Parent.Hash FROM Ancestors JOIN main.Commits AS Child ON Child.Hash = Ancestors.Hash "
+    "   JOIN main.Commits AS Parent ON Parent.Hash IN (Child.ParentHash, Child.MergeParentHash)) "
+    "SELECT Hash FROM Ancestors;"
+    "INSERT INTO BundleCommits (Hash) "
+    "WITH RECURSIVE Included(Hash, ParentHash, MergeParentHash) AS ("
+    "   SELECT BundledCommit.Hash, BundledCommit.ParentHash, BundledCommit.MergeParentHash FROM BundleTips "
+    "   JOIN main.Commits AS BundledCommit ON BundledCommit.Hash = BundleTips.HeadCommit "
+    "   WHERE NOT EXISTS (SELECT 1 FROM BundleExcluded WHERE BundleExcluded.Hash = BundledCommit.Hash) "
+    "   UNION "
+    "   SELECT BundledCommit.Hash, BundledCommit.ParentHash, BundledCommit.MergeParentHash FROM Included "
+    "   JOIN main.Commits AS BundledCommit ON BundledCommit.Hash IN (Included.ParentHash, Included.MergeParentHash) "
+    "   WHERE NOT EXISTS (SELECT 1 FROM BundleExcluded WHERE BundleExcluded.Hash = BundledCommit.Hash)) "
+    "SELECT Hash FROM Included;"
+    "INSERT INTO BundleObjects (Hash) "
+    "WITH RECURSIVE Needed(Hash) AS ("
+    "   SELECT Link.ObjectHash FROM BundleCommits JOIN main.CommitsObjects AS Link ON Link.CommitHash = BundleCommits.Hash "
+    "   WHERE Link.ObjectHash IS NOT NULL "
+    "   UNION "
+    "   SELECT Object.Base FROM Needed JOIN main.Objects AS Object ON Object.Hash = Needed.Hash WHERE Object.Base IS NOT NULL) "
+    "SELECT Hash FROM Needed WHERE NOT EXISTS (SELECT 1 FROM main.CommitsObjects AS Link "
+    "JOIN BundleExcluded ON BundleExcluded.Hash = Link.CommitHash WHERE Link.ObjectHash = Needed.Hash);"
+    "INSERT OR IGNORE INTO BundleChunks (Hash) SELECT Link.ChunkHash FROM BundleObjects "
+    "JOIN main.ObjectsChunks AS Link ON Link.ObjectHash = BundleObjects.Hash;";
+
+constexpr const char *BUNDLE_CLEANUP_QUERY = "DROP TABLE temp.BundleTips;"
+                                             "DROP TABLE temp.BundleBases;"
+                                             "DROP TABLE temp.BundleExcluded;"
+                                             "DROP TABLE temp.BundleCommits;"
+                                             "DROP TABLE temp.BundleObjects;"
+                                             "DROP TABLE temp.BundleChunks;";
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute au bundle <writer>, par morceaux, les <size> octets de la colonne <column>
+// de la rangée <rowId> de la table <table>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteBlobToBundle(dvcs::TDatabasePtr &pDB, const char *table, const char *column, sqlite3_int64 rowId, std::uint64_t size,
+                                     dvcs::BundleWriter &writer) noexcept
+{
+    RETURN_IF(size == 0, true);
+
+    sqlite3_blob *pBlobHandle;
+    RETURN_IF(sqlite3_blob_open(pDB.get(), "main", table, column, rowId, 0, &pBlobHandle) != SQLITE_OK, false);
+    std::unique_ptr<sqlite3_blob, decltype(&sqlite3_blob_close)> pBlob{pBlobHandle, sqlite3_blob_close};
+
+    std::array<char, dvcs::STREAMING_CHUNK_SIZE> buffer{};
+    for (std::uint64_t offset = 0; offset < size;)
+    {
+        const auto pieceSize = static_cast<int>(std::min<std::uint64_t>(buffer.size(), size - offset));
+        RETURN_IF(sqlite3_blob_read(pBlob.get(), buffer.data(), pieceSize, static_cast<int>(offset)) != SQLITE_OK, false);
+        RETURN_IF(!writer.WriteData(buffer.data(), static_cast<std::size_t>(pieceSize)), false);
+        offset += static_cast<std::uint64_t>(pieceSize);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Copie, par morceaux, les données de l'enregistrement courant de <reader> dans la
+// colonne <column> (de la bonne taille) de la rangée <rowId> de la table <table>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ReadBlobFromBundle(dvcs::BundleReader &reader, std::uint64_t size, dvcs::TDatabasePtr &pDB, const char *table, const char *column,
+                                      sqlite3_int64 rowId) noexcept
+{
+    RETURN_IF(size == 0, true);
+
+    sqlite3_blob *pBlobHandle;
+    RETURN_IF(sqlite3_blob_open(pDB.get(), "main", table, column, rowId, 1, &pBlobHandle) != SQLITE_OK, false);
+    std::unique_ptr<sqlite3_blob, decltype(&sqlite3_blob_close)> pBlob{pBlobHandle, sqlite3_blob_close};
+
+    std::array<char, dvcs::STREAMING_CHUNK_SIZE> buffer{};
+    for (std::uint64_t offset = 0; offset < size;)
+    {
+        const auto pieceSize = static_cast<int>(std::min<std::uint64_t>(buffer.size(), size - offset));
+        RETURN_IF(!reader.ReadData(buffer.data(), static_cast<std::size_t>(pieceSize)), false);
+        RETURN_IF(sqlite3_blob_write(pBlob.get(), buffer.data(), pieceSize, static_cast<int>(offset)) != SQLITE_OK, false);
+        offset += static_cast<std::uint64_t>(pieceSize);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve le commit <commit> désigné par <revision>: le nom d'une branche ou la
+// représentation hexadécimale d'un hash.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ResolveRevision(dvcs::StatementCache &statements, std::string_view revision, dvcs::THash &commit) noexcept
+{
+    try
+    {
+        const std::string name{revision};
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT HeadCommit FROM Branches WHERE Name = @name AND HeadCommit IS NOT NULL;", pStmt), false);
+        RETURN_IF(sqlite3_bind_text(pStmt.get(), 1, name.c_str(), -1, SQLITE_STATIC) != SQLITE_OK, false);
+        bool isPresent{};
+        if (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+        {
+            return dvcs::GetColumnHash(pStmt, 0, commit, isPresent);
+        }
+
+        RETURN_IF(!dvcs::FromHex(revision, commit), false);
+        return !dvcs::ValidateNoResult(statements, "SELECT COUNT(*) FROM Commits WHERE Hash = @hash;", {{"@hash", commit}});
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit dans <writer> les enregistrements du contenu sélectionné à l'aide de
+// BUNDLE_SELECTION_QUERY.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteBundleRecords(dvcs::StatementCache &statements, dvcs::HashAlgorithm algorithm, dvcs::BundleWriter &writer)
+{
+    auto &pDB = statements.GetDatabase();
+    std::vector<char> fields;
+    bool isPresent{};
+
+    dvcs::BundleFieldsWriter{fields}.AddString(dvcs::GetHashAlgorithmName(algorithm));
+    RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Header, fields, 0) || !writer.EndRecord(), false);
+
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT DISTINCT Parent.Hash FROM BundleCommits "
+                                  "JOIN Commits AS BundledCommit ON BundledCommit.Hash = BundleCommits.Hash "
+                                  "JOIN Commits AS Parent ON Parent.Hash IN (BundledCommit.ParentHash, BundledCommit.MergeParentHash) "
+                                  "WHERE NOT EXISTS (SELECT 1 FROM BundleCommits AS Included WHERE Included.Hash = Parent.Hash);",
+                                  pStmt),
+              false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        dvcs::THash commit;
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 0, commit, isPresent), false);
+        dvcs::BundleFieldsWriter{fields}.AddHash(commit);
+        RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Prerequisite, fields, 0) || !writer.EndRecord(), false);
+    }
+
+    // Les dictionnaires sont peu nombreux et petits: on les envoie tous
+    RETURN_IF(!statements.Prepare("SELECT rowid, Id, length(Content) FROM Dictionaries;", pStmt), false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        const auto size = static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 2));
+        dvcs::BundleFieldsWriter{fields}.AddU32(static_cast<std::uint32_t>(sqlite3_column_int64(pStmt.get(), 1)));
+        RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Dictionary, fields, size), false);
+        RETURN_IF(!WriteBlobToBundle(pDB, "Dictionaries", "Content", sqlite3_column_int64(pStmt.get(), 0), size, writer) || !writer.EndRecord(),
+                  false);
+    }
+
+    RETURN_IF(!statements.Prepare("SELECT Chunks.rowid, Chunks.Hash, Chunks.Size, Chunks.Codec, length(Chunks.Content) FROM BundleChunks "
+                                  "JOIN Chunks ON Chunks.Hash = BundleChunks.Hash;",
+                                  pStmt),
+              false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        dvcs::THash hash;
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 1, hash, isPresent), false);
+        const auto size = static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 4));
+        dvcs::BundleFieldsWriter fieldsWriter{fields};
+        fieldsWriter.AddHash(hash);
+        fieldsWriter.AddU64(static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 2)));
+        fieldsWriter.AddU8(static_cast<std::uint8_t>(sqlite3_column_int(pStmt.get(), 3)));
+        RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Chunk, fields, size), false);
+        RETURN_IF(!WriteBlobToBundle(pDB, "Chunks", "Content", sqlite3_column_int64(pStmt.get(), 0), size, writer) || !writer.EndRecord(), false);
+    }
+
+    // Les objets sont écrits dans l'ordre de leur ajout: les bases précèdent leurs
+    // deltas et le rowid désigne toujours la version la plus récente d'un fichier
+    RETURN_IF(!statements.Prepare("SELECT Objects.rowid, Objects.Hash, Path, Size, Codec, Base, Depth, length(Content), Content IS NOT NULL "
+                                  "FROM BundleObjects JOIN Objects ON Objects.Hash = BundleObjects.Hash ORDER BY Objects.rowid;",
+                                  pStmt),
+              false);
+    dvcs::TStatementPtr pChunksStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT ChunkHash FROM ObjectsChunks WHERE ObjectHash = @hash ORDER BY Position;", pChunksStmt), false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        dvcs::THash hash;
+        dvcs::THash base;
+        bool hasBase{};
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 1, hash, isPresent) || !dvcs::GetColumnHash(pStmt, 5, base, hasBase), false);
+        const bool hasContent = sqlite3_column_int(pStmt.get(), 8) != 0;
+        const auto size = static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 7));
+
+        dvcs::BundleFieldsWriter fieldsWriter{fields};
+        fieldsWriter.AddHash(hash);
+        fieldsWriter.AddString(dvcs::GetColumnText(pStmt, 2));
+        fieldsWriter.AddU64(static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 3)));
+        fieldsWriter.AddU8(static_cast<std::uint8_t>(sqlite3_column_int(pStmt.get(), 4)));
+        hasBase ? fieldsWriter.AddHash(base) : fieldsWriter.AddNoHash();
+        fieldsWriter.AddU32(static_cast<std::uint32_t>(sqlite3_column_int(pStmt.get(), 6)));
+        fieldsWriter.AddU8(hasContent ? 1 : 0);
+
+        std::vector<dvcs::THash> chunkHashes;
+        if (!hasContent)
+        {
+            RETURN_IF(sqlite3_bind_blob(pChunksStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+            while (sqlite3_step(pChunksStmt.get()) == SQLITE_ROW)
+            {
+                RETURN_IF(!dvcs::GetColumnHash(pChunksStmt, 0, chunkHashes.emplace_back(), isPresent), false);
+            }
+            sqlite3_reset(pChunksStmt.get());
+        }
+        fieldsWriter.AddU32(static_cast<std::uint32_t>(chunkHashes.size()));
+        for (const auto &chunkHash : chunkHashes)
+        {
+            fieldsWriter.AddHash(chunkHash);
+        }
+
+        RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Object, fields, size), false);
+        RETURN_IF(!WriteBlobToBundle(pDB, "Objects", "Content", sqlite3_column_int64(pStmt.get(), 0), size, writer) || !writer.EndRecord(), false);
+    }
+
+    RETURN_IF(!statements.Prepare("SELECT Commits.Hash, ParentHash, Author, Email, Message, "
+                                  "(SELECT COUNT(*) FROM CommitsObjects WHERE CommitHash = Commits.Hash), MergeParentHash, "
+                                  "(SELECT IFNULL(SUM(length(CAST(Path AS BLOB))), 0) FROM CommitsObjects WHERE CommitHash = Commits.Hash), "
+                                  "(SELECT COUNT(ObjectHash) FROM CommitsObjects WHERE CommitHash = Commits.Hash) "
+                                  "FROM BundleCommits JOIN Commits ON Commits.Hash = BundleCommits.Hash;",
+                                  pStmt),
+              false);
+    dvcs::TStatementPtr pBranchesStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT BranchName FROM BranchesCommits WHERE CommitHash = @hash;", pBranchesStmt), false);
+    dvcs::TStatementPtr pObjectsStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT ObjectHash, Path FROM CommitsObjects WHERE CommitHash = @hash;", pObjectsStmt), false);
+    std::vector<char> entry;
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        dvcs::THash hash;
+        dvcs::THash parent;
+        dvcs::THash mergeParent;
+        bool hasParent{};
+        bool hasMergeParent{};
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 0, hash, isPresent) || !dvcs::GetColumnHash(pStmt, 1, parent, hasParent) ||
+                      !dvcs::GetColumnHash(pStmt, 6, mergeParent, hasMergeParent),
+                  false);
+
+        dvcs::BundleFieldsWriter fieldsWriter{fields};
+        fieldsWriter.AddHash(hash);
+        hasParent ? fieldsWriter.AddHash(parent) : fieldsWriter.AddNoHash();
+        hasMergeParent ? fieldsWriter.AddHash(mergeParent) : fieldsWriter.AddNoHash();
+        fieldsWriter.AddString(dvcs::GetColumnText(pStmt, 2));
+        fieldsWriter.AddString(dvcs::GetColumnText(pStmt, 3));
+        fieldsWriter.AddString(dvcs::GetColumnText(pStmt, 4));
+
+        std::vector<std::string> branches;
+        RETURN_IF(sqlite3_bind_blob(pBranchesStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+        while (sqlite3_step(pBranchesStmt.get()) == SQLITE_ROW)
+        {
+            branches.emplace_back(dvcs::GetColumnText(pBranchesStmt, 0));
+        }
+        sqlite3_reset(pBranchesStmt.get());
+        fieldsWriter.AddU32(static_cast<std::uint32_t>(branches.size()));
+        for (const auto &branch : branches)
+        {
+            fieldsWriter.AddString(branch);
+        }
+
+        // Les fichiers du commit, potentiellement nombreux, sont écrits au fil de
+        // leur lecture: la longueur de leur chemin, leur chemin puis leur objet
+        // (absent d'un fichier retiré), précédé de sa taille
+        const auto nbFiles = static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 5));
+        const auto pathsSize = static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 7));
+        const auto nbObjects = static_cast<std::uint64_t>(sqlite3_column_int64(pStmt.get(), 8));
+        const auto dataSize = nbFiles * (sizeof(std::uint32_t) + sizeof(std::uint8_t)) + pathsSize + nbObjects * hash.size();
+        RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Commit, fields, dataSize), false);
+        RETURN_IF(sqlite3_bind_blob(pObjectsStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+        while (sqlite3_step(pObjectsStmt.get()) == SQLITE_ROW)
+        {
+            dvcs::THash objectHash;
+            RETURN_IF(!dvcs::GetColumnHash(pObjectsStmt, 0, objectHash, isPresent) || (isPresent && (objectHash.size() != hash.size())), false);
+            dvcs::BundleFieldsWriter entryWriter{entry};
+            entryWriter.AddString(dvcs::GetColumnText(pObjectsStmt, 1));
+            isPresent ? entryWriter.AddHash(objectHash) : entryWriter.AddNoHash();
+            RETURN_IF(!writer.WriteData(entry.data(), entry.size()), false);
+        }
+        sqlite3_reset(pObjectsStmt.get());
+        RETURN_IF(!writer.EndRecord(), false);
+    }
+
+    RETURN_IF(!statements.Prepare("SELECT Name, HeadCommit FROM BundleTips;", pStmt), false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        dvcs::THash head;
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 1, head, isPresent), false);
+        dvcs::BundleFieldsWriter fieldsWriter{fields};
+        fieldsWriter.AddString(dvcs::GetColumnText(pStmt, 0));
+        fieldsWriter.AddHash(head);
+        RETURN_IF(!writer.BeginRecord(dvcs::BundleRecordType::Branch, fields, 0) || !writer.EndRecord(), false);
+    }
+
+    return writer.Finish();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Nombre d'éléments réellement ajoutés au dépôt par un unbundle
+////////////////////////////////////////////////////////////////////////////////////
+struct UnbundleCounts
+{
+    std::size_t m_nbCommits{};
+    std::size_t m_nbObjects{};
+    std::size_t m_nbChunks{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Importe l'enregistrement <record> lu de <reader> dans le dépôt dont les
+// requêtes sont préparées à l'aide de <statements>. Les éléments déjà présents
+// dans le dépôt sont sautés. Les têtes des branches sont ajoutées à <heads> pour
+// être mises à jour une fois le bundle importé. Les préalables sont validés par
+// l'appelant.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ImportBundleRecord(dvcs::StatementCache &statements, std::size_t hashSize, const dvcs::BundleRecord &record,
+                                      dvcs::BundleReader &reader, TBranchHeads &heads, UnbundleCounts &counts)
+{
+    auto &pDB = statements.GetDatabase();
+    dvcs::BundleFieldsReader fieldsReader{record.m_fields};
+    bool isPresent{};
+
+    switch (record.m_type)
+    {
+    case dvcs::BundleRecordType::Dictionary:
+    {
+        std::uint32_t id{};
+        RETURN_IF(!fieldsReader.ReadU32(id), false);
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT OR IGNORE INTO Dictionaries (Id, Content) VALUES (@id, zeroblob(@size));", pStmt), false);
+        RETURN_IF((sqlite3_bind_int64(pStmt.get(), 1, id) != SQLITE_OK) ||
+                      (sqlite3_bind_int64(pStmt.get(), 2, static_cast<sqlite3_int64>(record.m_dataSize)) != SQLITE_OK),
+                  false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        RETURN_IF(sqlite3_changes(pDB.get()) == 0, reader.SkipData());
+        return ReadBlobFromBundle(reader, record.m_dataSize, pDB, "Dictionaries", "Content", sqlite3_last_insert_rowid(pDB.get()));
+    }
+    case dvcs::BundleRecordType::Chunk:
+    {
+        dvcs::THash hash;
+        std::uint64_t size{};
+        std::uint8_t codec{};
+        RETURN_IF(!fieldsReader.ReadHash(hash, isPresent) || !fieldsReader.ReadU64(size) || !fieldsReader.ReadU8(codec), false);
+        RETURN_IF(!dvcs::IsValidCodec(codec), false);
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT OR IGNORE INTO Chunks (Hash, Size, Content, Codec) VALUES (@hash, @size, zeroblob(@length), @codec);",
+                                      pStmt),
+                  false);
+        RETURN_IF((sqlite3_bind_blob(pStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK) ||
+                      (sqlite3_bind_int64(pStmt.get(), 2, static_cast<sqlite3_int64>(size)) != SQLITE_OK) ||
+                      (sqlite3_bind_int64(pStmt.get(), 3, static_cast<sqlite3_int64>(record.m_dataSize)) != SQLITE_OK) ||
+                      (sqlite3_bind_int(pStmt.get(), 4, codec) != SQLITE_OK),
+                  false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        RETURN_IF(sqlite3_changes(pDB.get()) == 0, reader.SkipData());
+        ++counts.m_nbChunks;
+        return ReadBlobFromBundle(reader, record.m_dataSize, pDB, "Chunks", "Content", sqlite3_last_insert_rowid(pDB.get()));
+    }
+    case dvcs::BundleRecordType::Object:
+    {
+        dvcs::THash hash;
+        dvcs::THash base;
+        std::string path;
+        std::uint64_t size{};
+        std::uint8_t codec{};
+        bool hasBase{};
+        std::uint32_t depth{};
+        std::uint8_t hasContent{};
+        std::uint32_t nbChunks{};
+        RETURN_IF(!fieldsReader.ReadHash(hash, isPresent) || !fieldsReader.ReadString(path) || !fieldsReader.ReadU64(size) ||
+                      !fieldsReader.ReadU8(codec) || !fieldsReader.ReadHash(base, hasBase) || !fieldsReader.ReadU32(depth) ||
+                      !fieldsReader.ReadU8(hasContent) || !fieldsReader.ReadU32(nbChunks),
+                  false);
+        RETURN_IF(!dvcs::IsValidCodec(codec), false);
+
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT OR IGNORE INTO Objects (Hash, Path, Size, Content, Codec, Base, Depth) "
+                                      "VALUES (@hash, @path, @size, CASE WHEN @hasContent THEN zeroblob(@length) END, @codec, @base, @depth);",
+                                      pStmt),
+                  false);
+        RETURN_IF((sqlite3_bind_blob(pStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK) ||
+                      (sqlite3_bind_text(pStmt.get(), 2, path.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) ||
+                      (sqlite3_bind_int64(pStmt.get(), 3, static_cast<sqlite3_int64>(size)) != SQLITE_OK) ||
+                      (sqlite3_bind_int(pStmt.get(), 4, hasContent) != SQLITE_OK) ||
+                      (sqlite3_bind_int64(pStmt.get(), 5, static_cast<sqlite3_int64>(record.m_dataSize)) != SQLITE_OK) ||
+                      (sqlite3_bind_int(pStmt.get(), 6, codec) != SQLITE_OK) ||
+                      (hasBase ? sqlite3_bind_blob(pStmt.get(), 7, base.data(), static_cast<int>(base.size()), SQLITE_STATIC)
+                               : sqlite3_bind_null(pStmt.get(), 7)) != SQLITE_OK ||
+                      (sqlite3_bind_int(pStmt.get(), 8, static_cast<int>(depth)) != SQLITE_OK),
+                  false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        RETURN_IF(sqlite3_changes(pDB.get()) == 0, reader.SkipData());
+        ++counts.m_nbObjects;
+        const auto rowId = sqlite3_last_insert_rowid(pDB.get());
+
+        for (std::uint32_t iChunk = 0; iChunk < nbChunks; ++iChunk)
+        {
+            dvcs::THash chunkHash;
+            RETURN_IF(!fieldsReader.ReadHash(chunkHash, isPresent), false);
+            const auto position = std::to_string(iChunk);
+            RETURN_IF(!statements.Execute("INSERT OR IGNORE INTO ObjectsChunks (ObjectHash, Position, ChunkHash) VALUES (@object, "
+                                          "CAST(@position AS INTEGER), @chunk);",
+                                          {{"@object", hash}, {"@position", position}, {"@chunk", chunkHash}}),
+                      false);
+        }
+        return (hasContent == 0) || ReadBlobFromBundle(reader, record.m_dataSize, pDB, "Objects", "Content", rowId);
+    }
+    case dvcs::BundleRecordType::Commit:
+    {
+        dvcs::THash hash;
+        dvcs::THash parent;
+        dvcs::THash mergeParent;
+        bool hasParent{};
+        bool hasMergeParent{};
+        std::string author;
+        std::string email;
+        std::string message;
+        std::uint32_t nbBranches{};
+        RETURN_IF(!fieldsReader.ReadHash(hash, isPresent) || !fieldsReader.ReadHash(parent, hasParent) ||
+                      !fieldsReader.ReadHash(mergeParent, hasMergeParent) || !fieldsReader.ReadString(author) || !fieldsReader.ReadString(email) ||
+                      !fieldsReader.ReadString(message) || !fieldsReader.ReadU32(nbBranches),
+                  false);
+        RETURN_IF(hash.size() != hashSize, false);
+
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT OR IGNORE INTO Commits (Hash, ParentHash, Author, Email, Message, MergeParentHash) "
+                                      "VALUES (@hash, @parent, @author, @email, @message, @mergeParent);",
+                                      pStmt),
+                  false);
+        RETURN_IF((sqlite3_bind_blob(pStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK) ||
+                      (hasParent ? sqlite3_bind_blob(pStmt.get(), 2, parent.data(), static_cast<int>(parent.size()), SQLITE_STATIC)
+                                 : sqlite3_bind_null(pStmt.get(), 2)) != SQLITE_OK ||
+                      (sqlite3_bind_text(pStmt.get(), 3, author.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) ||
+                      (sqlite3_bind_text(pStmt.get(), 4, email.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) ||
+                      (sqlite3_bind_text(pStmt.get(), 5, message.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) ||
+                      (hasMergeParent ? sqlite3_bind_blob(pStmt.get(), 6, mergeParent.data(), static_cast<int>(mergeParent.size()), SQLITE_STATIC)
+                                      : sqlite3_bind_null(pStmt.get(), 6)) != SQLITE_OK,
+                  false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        RETURN_IF(sqlite3_changes(pDB.get()) == 0, reader.SkipData());
+        ++counts.m_nbCommits;
+
+        for (std::uint32_t iBranch = 0; iBranch < nbBranches; ++iBranch)
+        {
+            std::string branch;
+            RETURN_IF(!fieldsReader.ReadString(branch), false);
+            RETURN_IF(!statements.Execute("INSERT OR IGNORE INTO BranchesCommits (BranchName, CommitHash) VALUES (@branch, @commit);",
+                                          {{"@branch", branch}, {"@commit", hash}}),
+                      false);
+        }
+
+        dvcs::TStatementPtr pObjectStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT OR IGNORE INTO CommitsObjects (ObjectHash, CommitHash, Path) VALUES (@object, @commit, @path);",
+                                      pObjectStmt),
+                  false);
+        std::vector<char> pathLength(sizeof(std::uint32_t));
+        for (std::uint64_t nbRemaining = record.m_dataSize; nbRemaining > 0;)
+        {
+            std::uint32_t length{};
+            RETURN_IF((nbRemaining < pathLength.size()) || !reader.ReadData(pathLength.data(), pathLength.size()) ||
+                          !dvcs::BundleFieldsReader{pathLength}.ReadU32(length),
+                      false);
+            nbRemaining -= pathLength.size();
+            RETURN_IF(nbRemaining < (static_cast<std::uint64_t>(length) + sizeof(std::uint8_t)), false);
+            std::string path(length, '\0');
+            std::uint8_t objectHashSize{};
+            RETURN_IF(!reader.ReadData(path.data(), path.size()) || !reader.ReadData(&objectHashSize, sizeof(objectHashSize)), false);
+            nbRemaining -= static_cast<std::uint64_t>(length) + sizeof(std::uint8_t);
+
+            // Un fichier retiré par le commit n'a pas d'objet
+            RETURN_IF(((objectHashSize != 0) && (objectHashSize != hashSize)) || (nbRemaining < objectHashSize), false);
+            dvcs::THash objectHash{objectHashSize};
+            RETURN_IF(!reader.ReadData(objectHash.data(), objectHash.size()), false);
+            nbRemaining -= objectHashSize;
+            RETURN_IF(((objectHashSize != 0) ? !dvcs::BindValue(pObjectStmt, 1, objectHash)
+                                             : (sqlite3_bind_null(pObjectStmt.get(), 1) != SQLITE_OK)) ||
+                          !dvcs::BindValue(pObjectStmt, 2, hash) || !dvcs::BindValue(pObjectStmt, 3, std::string_view{path}) ||
+                          (sqlite3_step(pObjectStmt.get()) != SQLITE_DONE),
+                      false);
+            sqlite3_reset(pObjectStmt.get());
+        }
+
+        // Les objets d'un bundle précèdent ses commits
+        return WritePathFilter(statements, hash);
+    }
+    case dvcs::BundleRecordType::Branch:
+    {
+        std::string name;
+        dvcs::THash head;
+        RETURN_IF(!fieldsReader.ReadString(name) || !fieldsReader.ReadHash(head, isPresent), false);
+        if (!name.starts_with(REMOTE_BRANCH_PREFIX))
+        {
+            heads.emplace_back(std::move(name), std::move(head));
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit dans <writer> un bundle des branches de BundleTips, créée à l'aide de
+// BUNDLE_TABLES_QUERY, pour un destinataire ayant déjà les commits de BundleBases.
+// Le dépôt est lu dans une seule transaction: le contenu du bundle est cohérent
+// même si le dépôt est modifié pendant son écriture.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteBundle(dvcs::StatementCache &statements, dvcs::BundleWriter &writer)
+{
+    auto &pDB = statements.GetDatabase();
+
+    dvcs::HashAlgorithm algorithm{};
+    RETURN_IF(!dvcs::GetHashAlgorithm(pDB, "main", algorithm), false);
+
+    dvcs::TransactionGuard transactionGuard{pDB};
+    RETURN_IF(!dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;") || !dvcs::ExecuteQuery(pDB, BUNDLE_SELECTION_QUERY), false);
+    RETURN_IF(!writer.WriteSignature() || !WriteBundleRecords(statements, algorithm, writer), false);
+    return dvcs::ExecuteQuery(pDB, BUNDLE_CLEANUP_QUERY) && dvcs::ExecuteQuery(pDB, "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Importe au fil de sa lecture le bundle <reader>, nommé <bundleName> dans les
+// messages d'erreur, dans une seule transaction: un bundle tronqué ou corrompu, ou
+// dont une branche ne peut être mise à jour selon <update>, laisse le dépôt intact.
+// Le nombre d'éléments ajoutés est donné par <counts>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ImportBundle(dvcs::StatementCache &statements, dvcs::BundleReader &reader, std::string_view bundleName,
+                                BranchHeadsUpdate &update, UnbundleCounts &counts)
+{
+    auto &pDB = statements.GetDatabase();
+
+    dvcs::HashAlgorithm algorithm{};
+    RETURN_IF(!dvcs::GetHashAlgorithm(pDB, "main", algorithm), false);
+
+    dvcs::BundleRecord record;
+    if (!reader.ReadSignature() || !reader.ReadRecord(record) || (record.m_type != dvcs::BundleRecordType::Header))
+    {
+        fmt::print(std::cerr, "{} is not a dvcsus bundle\n", bundleName);
+        return false;
+    }
+
+    std::string algorithmName;
+    dvcs::HashAlgorithm bundleAlgorithm{};
+    dvcs::BundleFieldsReader headerReader{record.m_fields};
+    RETURN_IF(!headerReader.ReadString(algorithmName) || !dvcs::ParseHashAlgorithm(algorithmName, bundleAlgorithm) || !reader.EndRecord(), false);
+    if (bundleAlgorithm != algorithm)
+    {
+        fmt::print(std::cerr, "Can't unbundle a {0} bundle into a {1} repository\n", dvcs::GetHashAlgorithmName(bundleAlgorithm),
+                   dvcs::GetHashAlgorithmName(algorithm));
+        return false;
+    }
+
+    dvcs::TransactionGuard transactionGuard{pDB};
+    RETURN_IF(!dvcs::ExecuteQuery(pDB, "BEGIN TRANSACTION;"), false);
+
+    counts = UnbundleCounts{};
+    TBranchHeads heads;
+    const auto hashSize = dvcs::GetHashSize(algorithm);
+    while (!reader.IsComplete())
+    {
+        bool isValid = reader.ReadRecord(record);
+        if (isValid && !reader.IsComplete() && (record.m_type == dvcs::BundleRecordType::Prerequisite))
+        {
+            dvcs::THash commit;
+            bool isPresent{};
+            isValid = dvcs::BundleFieldsReader{record.m_fields}.ReadHash(commit, isPresent) && reader.EndRecord();
+            if (isValid && dvcs::ValidateNoResult(statements, "SELECT COUNT(*) FROM Commits WHERE Hash = @hash;", {{"@hash", commit}}))
+            {
+                fmt::print(std::cerr, "Bundle requires commit {} which is not in the repository\n", dvcs::ToHex(commit));
+                return false;
+            }
+        }
+        else if (isValid && !reader.IsComplete())
+        {
+            isValid = ImportBundleRecord(statements, hashSize, record, reader, heads, counts) && reader.EndRecord();
+        }
+
+        if (!isValid)
+        {
+            fmt::print(std::cerr, "Can't unbundle {}: the bundle is truncated or corrupted\n", bundleName);
+            return false;
+        }
+    }
+
+    // Les têtes des branches ne font qu'avancer (voir UpdateBranchHead)
+    for (const auto &[name, head] : heads)
+    {
+        RETURN_IF(!UpdateBranchHead(statements, update, name, head), false);
+    }
+
+    return dvcs::ExecuteQuery(pDB, "END TRANSACTION;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Branche annoncée par dvcsusd au début d'une session
+////////////////////////////////////////////////////////////////////////////////////
+struct AdvertisedRef
+{
+    std::string m_name;
+    dvcs::THash m_head;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Envoie le message d'erreur <message> au client de la connexion <connection> et
+// le consigne dans le journal du service. Retourne toujours faux.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SendError(std::iostream &connection, std::string_view message)
+{
+    fmt::print(std::cerr, "{}\n", message);
+    std::vector<char> fields;
+    dvcs::BundleFieldsWriter{fields}.AddString(message);
+    static_cast<void>(dvcs::WriteMessage(connection, dvcs::MessageType::Error, fields) && connection.flush());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Reçoit de <connection> un message de type <expectedType> et ses champs <fields>.
+// Une erreur envoyée par le pair est affichée.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ReceiveMessage(std::iostream &connection, dvcs::MessageType expectedType, std::vector<char> &fields)
+{
+    dvcs::MessageType type{};
+    if (!dvcs::ReadMessage(connection, type, fields))
+    {
+        fmt::print(std::cerr, "Connection to remote lost\n");
+        return false;
+    }
+    if (type == dvcs::MessageType::Error)
+    {
+        std::string message;
+        static_cast<void>(dvcs::BundleFieldsReader{fields}.ReadString(message));
+        fmt::print(std::cerr, "remote: {}\n", message);
+        return false;
+    }
+    if (type != expectedType)
+    {
+        fmt::print(std::cerr, "Unexpected message from remote\n");
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve le fichier <repoDBPath> du dépôt <repositoryName> servi à partir de la
+// racine <rootPath>: le dépôt d'un répertoire ou directement un fichier de base de
+// données. Le dépôt ne peut pas se trouver hors de la racine.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ResolveServedRepository(const fs::path &rootPath, std::string_view repositoryName, fs::path &repoDBPath)
+{
+    const auto relativePath = fs::path{repositoryName}.lexically_normal();
+    RETURN_IF(relativePath.is_absolute() || (!relativePath.empty() && (*relativePath.begin() == "..")), false);
+
+    repoDBPath = rootPath / relativePath;
+    if (fs::is_directory(repoDBPath))
+    {
+        repoDBPath /= dvcs::REPO_DB_PATH;
+    }
+    return fs::is_regular_file(repoDBPath);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Annonce au client de la connexion <connection> l'algorithme de hachage et les
+// branches du dépôt servi.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SendRefs(dvcs::StatementCache &statements, std::iostream &connection)
+{
+    dvcs::HashAlgorithm algorithm{};
+    RETURN_IF(!dvcs::GetHashAlgorithm(statements.GetDatabase(), "main", algorithm), false);
+
+    std::vector<AdvertisedRef> refs;
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT Name, HeadCommit FROM Branches WHERE HeadCommit IS NOT NULL;", pStmt), false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        auto &ref = refs.emplace_back();
+        bool isPresent{};
+        ref.m_name = dvcs::GetColumnText(pStmt, 0);
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 1, ref.m_head, isPresent), false);
+    }
+
+    std::vector<char> fields;
+    dvcs::BundleFieldsWriter fieldsWriter{fields};
+    fieldsWriter.AddString(dvcs::GetHashAlgorithmName(algorithm));
+    fieldsWriter.AddU32(static_cast<std::uint32_t>(refs.size()));
+    for (const auto &ref : refs)
+    {
+        fieldsWriter.AddString(ref.m_name);
+        fieldsWriter.AddHash(ref.m_head);
+    }
+    return dvcs::WriteMessage(connection, dvcs::MessageType::Refs, fields) && connection.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Reçoit de <connection> les branches <refs> annoncées par dvcsusd et valide que le
+// dépôt distant identifie ses objets comme le dépôt local.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ReceiveRefs(dvcs::StatementCache &statements, std::iostream &connection, std::vector<AdvertisedRef> &refs)
+{
+    std::vector<char> fields;
+    RETURN_IF(!ReceiveMessage(connection, dvcs::MessageType::Refs, fields), false);
+
+    dvcs::BundleFieldsReader fieldsReader{fields};
+    std::string algorithmName;
+    dvcs::HashAlgorithm remoteAlgorithm{};
+    dvcs::HashAlgorithm localAlgorithm{};
+    std::uint32_t nbRefs{};
+    RETURN_IF(!fieldsReader.ReadString(algorithmName) || !dvcs::ParseHashAlgorithm(algorithmName, remoteAlgorithm) || !fieldsReader.ReadU32(nbRefs),
+              false);
+    RETURN_IF(!dvcs::GetHashAlgorithm(statements.GetDatabase(), "main", localAlgorithm), false);
+    if (remoteAlgorithm != localAlgorithm)
+    {
+        fmt::print(std::cerr, "Can't transfer between a {0} repository and a {1} repository\n", dvcs::GetHashAlgorithmName(remoteAlgorithm),
+                   dvcs::GetHashAlgorithmName(localAlgorithm));
+        return false;
+    }
+
+    refs.clear();
+    for (std::uint32_t iRef = 0; iRef < nbRefs; ++iRef)
+    {
+        auto &ref = refs.emplace_back();
+        bool isPresent{};
+        RETURN_IF(!fieldsReader.ReadString(ref.m_name) || !fieldsReader.ReadHash(ref.m_head, isPresent), false);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Côté service d'un pull: reçoit les Want et les Have du client, puis lui envoie le
+// bundle des branches qu'il veut, privé de ce qu'il a déjà. Les branches dont le
+// client a déjà la tête sont aussi envoyées, ce qui ne coûte que leur nom.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ServePull(dvcs::StatementCache &statements, std::iostream &connection)
+{
+    RETURN_IF(!dvcs::ExecuteQuery(statements.GetDatabase(), BUNDLE_TABLES_QUERY), false);
+
+    std::vector<char> fields;
+    dvcs::MessageType type{};
+    do
+    {
+        RETURN_IF(!dvcs::ReadMessage(connection, type, fields), false);
+
+        dvcs::THash commit;
+        bool isPresent{};
+        switch (type)
+        {
+        case dvcs::MessageType::Want:
+            RETURN_IF(!dvcs::BundleFieldsReader{fields}.ReadHash(commit, isPresent), false);
+            if (dvcs::ValidateNoResult(statements, "SELECT COUNT(*) FROM Branches WHERE HeadCommit = @hash;", {{"@hash", commit}}))
+            {
+                return SendError(connection, fmt::format("Commit {} is not the head of a branch", dvcs::ToHex(commit)));
+            }
+            break;
+        case dvcs::MessageType::Have:
+            RETURN_IF(!dvcs::BundleFieldsReader{fields}.ReadHash(commit, isPresent), false);
+            RETURN_IF(!statements.Execute("INSERT OR IGNORE INTO BundleBases (Hash) VALUES (@hash);", {{"@hash", commit}}), false);
+            break;
+        case dvcs::MessageType::Done:
+            continue;
+        default:
+            return SendError(connection, "Unexpected message during negotiation");
+        }
+
+        RETURN_IF(!statements.Execute("INSERT OR IGNORE INTO BundleTips (Name, HeadCommit) "
+                                      "SELECT Name, HeadCommit FROM main.Branches WHERE HeadCommit = @hash;",
+                                      {{"@hash", commit}}),
+                  false);
+    } while (type != dvcs::MessageType::Done);
+
+    dvcs::BundleWriter writer{connection};
+    return WriteBundle(statements, writer) && connection.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Côté service d'un push: répond au client par le nombre d'éléments <counts> que
+// son bundle a ajoutés au dépôt.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SendStatus(std::iostream &connection, const UnbundleCounts &counts)
+{
+    std::vector<char> fields;
+    dvcs::BundleFieldsWriter fieldsWriter{fields};
+    fieldsWriter.AddU64(counts.m_nbCommits);
+    fieldsWriter.AddU64(counts.m_nbObjects);
+    fieldsWriter.AddU64(counts.m_nbChunks);
+    return dvcs::WriteMessage(connection, dvcs::MessageType::Status, fields) && connection.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Côté client d'un pull: demande les têtes annoncées <refs> que le dépôt n'a pas et
+// indique au service les commits qu'il a déjà, le tout d'un seul envoi, puis
+// importe le bundle reçu en mettant à jour les branches selon <update>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool PullFromRemote(dvcs::StatementCache &statements, std::iostream &connection, const std::vector<AdvertisedRef> &refs,
+                                  std::string_view remote, BranchHeadsUpdate &update, UnbundleCounts &counts)
+{
+    std::unordered_set<dvcs::THash, dvcs::HashHasher> wants;
+    std::unordered_set<dvcs::THash, dvcs::HashHasher> haves;
+    for (const auto &ref : refs)
+    {
+        const bool isKnown = !dvcs::ValidateNoResult(statements, "SELECT COUNT(*) FROM Commits WHERE Hash = @hash;", {{"@hash", ref.m_head}});
+        (isKnown ? haves : wants).insert(ref.m_head);
+    }
+
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT HeadCommit FROM Branches WHERE HeadCommit IS NOT NULL;", pStmt), false);
+    while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+    {
+        dvcs::THash head;
+        bool isPresent{};
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 0, head, isPresent), false);
+        haves.insert(head);
+    }
+    pStmt.reset();
+
+    std::vector<char> fields;
+    for (const auto &want : wants)
+    {
+        dvcs::BundleFieldsWriter{fields}.AddHash(want);
+        RETURN_IF(!dvcs::WriteMessage(connection, dvcs::MessageType::Want, fields), false);
+    }
+    for (const auto &have : haves)
+    {
+        dvcs::BundleFieldsWriter{fields}.AddHash(have);
+        RETURN_IF(!dvcs::WriteMessage(connection, dvcs::MessageType::Have, fields), false);
+    }
+    fields.clear();
+    RETURN_IF(!dvcs::WriteMessage(connection, dvcs::MessageType::Done, fields) || !connection.flush(), false);
+
+    // Le service répond soit par un bundle, soit par un message d'erreur
+    if (connection.peek() == static_cast<int>(dvcs::MessageType::Error))
+    {
+        static_cast<void>(ReceiveMessage(connection, dvcs::MessageType::Error, fields));
+        return false;
+    }
+    dvcs::BundleReader reader{connection};
+    return ImportBundle(statements, reader, remote, update, counts);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Côté client d'un push: envoie le bundle des branches du dépôt, privé de ce que le
+// service a déjà d'après les têtes annoncées <refs>, puis reçoit le nombre
+// d'éléments que le service a ajoutés.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool PushToRemote(dvcs::StatementCache &statements, std::iostream &connection, const std::vector<AdvertisedRef> &refs,
+                                UnbundleCounts &counts)
+{
+    RETURN_IF(!dvcs::ExecuteQuery(statements.GetDatabase(), BUNDLE_TABLES_QUERY), false);
+    RETURN_IF(!statements.Execute("INSERT INTO BundleTips (Name, HeadCommit) SELECT Name, HeadCommit FROM main.Branches "
+                                  "WHERE HeadCommit IS NOT NULL AND Name NOT LIKE 'remote/%';",
+                                  {}),
+              false);
+    for (const auto &ref : refs)
+    {
+        RETURN_IF(!statements.Execute("INSERT OR IGNORE INTO BundleBases (Hash) VALUES (@hash);", {{"@hash", ref.m_head}}), false);
+    }
+
+    // Le service peut refuser le bundle avant de l'avoir reçu au complet: sa
+    // réponse est lue même si l'envoi a échoué
+    dvcs::BundleWriter writer{connection};
+    static_cast<void>(WriteBundle(statements, writer) && connection.flush());
+
+    std::vector<char> fields;
+    RETURN_IF(!ReceiveMessage(connection, dvcs::MessageType::Status, fields), false);
+    dvcs::BundleFieldsReader fieldsReader{fields};
+    std::uint64_t nbCommits{};
+    std::uint64_t nbObjects{};
+    std::uint64_t nbChunks{};
+    RETURN_IF(!fieldsReader.ReadU64(nbCommits) || !fieldsReader.ReadU64(nbObjects) || !fieldsReader.ReadU64(nbChunks), false);
+    counts = UnbundleCounts{nbCommits, nbObjects, nbChunks};
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Transfère les commits manquants entre le dépôt situé à <rootPath>, dont les
+// requêtes sont préparées à l'aide de <statements>, et le dépôt servi par dvcsusd
+// à l'URL <remote>.
+// Contrairement à un transfert entre fichiers, aucun verrou n'est pris sur la base
+// de données distante par le client: c'est le service qui importe les données.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool RemoteTransfer(dvcs::StatementCache &statements, const fs::path &rootPath, std::string_view remote,
+                                  TransferDirection direction) noexcept
+{
+    try
+    {
+        dvcs::RemoteUrl url;
+        if (!dvcs::ParseRemoteUrl(remote, url))
+        {
+            fmt::print(std::cerr, "Invalid remote URL {}\n", remote);
+            return false;
+        }
+
+        dvcs::SocketStream connection;
+        if (!connection.Connect(url.m_address))
+        {
+            fmt::print(std::cerr, "Can't connect to {}\n", remote);
+            return false;
+        }
+
+        const auto service = (direction == TransferDirection::ToLocal) ? dvcs::RemoteService::Pull : dvcs::RemoteService::Push;
+        std::vector<char> fields;
+        dvcs::BundleFieldsWriter helloWriter{fields};
+        helloWriter.AddU32(dvcs::PROTOCOL_VERSION);
+        helloWriter.AddU8(static_cast<std::uint8_t>(service));
+        helloWriter.AddString(url.m_repository);
+        RETURN_IF(!dvcs::WriteMessage(connection, dvcs::MessageType::Hello, fields) || !connection.flush(), false);
+
+        std::vector<AdvertisedRef> refs;
+        RETURN_IF(!ReceiveRefs(statements, connection, refs), false);
+
+        UnbundleCounts counts;
+        dvcs::CommitGraph graph;
+        BranchHeadsUpdate update{graph, rootPath / dvcs::COMMIT_GRAPH_PATH, DivergedBranchPolicy::Track};
+        RETURN_IF((service == dvcs::RemoteService::Pull) ? !PullFromRemote(statements, connection, refs, remote, update, counts)
+                                                         : !PushToRemote(statements, connection, refs, counts),
+                  false);
+        fmt::print(std::cout, "transferred {0} commits, {1} objects and {2} chunks\n", counts.m_nbCommits, counts.m_nbObjects, counts.m_nbChunks);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve dans le graphe des commits <graph> du dépôt dont la racine est <rootPath>
+// les commits <ids> désignés par les révisions <revisions> (voir
+// ResolveRevision). Le graphe est d'abord mis à jour au besoin.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FindGraphCommits(dvcs::StatementCache &statements, dvcs::CommitGraph &graph, const fs::path &rootPath,
+                                    const std::array<std::string_view, 2> &revisions, std::array<dvcs::TCommitId, 2> &ids)
+{
+    std::vector<dvcs::THash> commits;
+    for (const auto revision : revisions)
+    {
+        if (!ResolveRevision(statements, revision, commits.emplace_back()))
+        {
+            fmt::print(std::cerr, "Unknown revision {}\n", revision);
+            return false;
+        }
+    }
+    RETURN_IF(!UpdateCommitGraph(statements, graph, rootPath / dvcs::COMMIT_GRAPH_PATH, commits), false);
+
+    for (std::size_t index = 0; index < ids.size(); ++index)
+    {
+        ids[index] = graph.Find(commits[index]);
+        RETURN_IF(ids[index] == dvcs::NO_COMMIT, false);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit dans <output> la chaîne JSON représentant le texte <text>
+////////////////////////////////////////////////////////////////////////////////////
+void WriteJsonString(std::ostream &output, std::string_view text)
+{
+    output.put('"');
+    for (const char character : text)
+    {
+        switch (character)
+        {
+        case '"':
+            output << "\\\"";
+            break;
+        case '\\':
+            output << "\\\\";
+            break;
+        case '\n':
+            output << "\\n";
+            break;
+        case '\t':
+            output << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(character) < 0x20)
+            {
+                fmt::print(output, "\\u{:04x}", static_cast<unsigned>(character));
+            }
+            else
+            {
+                output.put(character);
+            }
+            break;
+        }
+    }
+    output.put('"');
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si le commit <commit> a modifié le fichier ou le répertoire dont le
+// chemin stocké (relatif au répertoire .dvcs) est <path> et dont la clé est <key>.
+// Le filtre des chemins modifiés du commit écarte la plupart des commits sans
+// consulter leurs fichiers, qui ne servent qu'à confirmer les autres (le filtre
+// peut se tromper dans ce sens).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool IsPathModified(dvcs::StatementCache &statements, const dvcs::THash &commit, const dvcs::BloomKey &key, std::string_view path,
+                                  bool &isModified)
+{
+    // Un commit sans filtre n'en écarte aucun chemin
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Filter FROM CommitsPathFilters WHERE CommitHash = @commit;", pStmt), false);
+        RETURN_IF(!dvcs::BindValue(pStmt, 1, commit), false);
+
+        const int stepResult = sqlite3_step(pStmt.get());
+        RETURN_IF((stepResult != SQLITE_ROW) && (stepResult != SQLITE_DONE), false);
+        if (stepResult == SQLITE_ROW)
+        {
+            const auto *pBits = static_cast<const std::uint8_t *>(sqlite3_column_blob(pStmt.get(), 0));
+            const std::span<const std::uint8_t> bits{pBits, static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), 0))};
+            isModified = dvcs::BloomFilter::MayContain(bits, key);
+            RETURN_IF(!isModified, true);
+        }
+    }
+
+    // Les fichiers d'un commit sont triés selon leur chemin (voir CommitsObjects):
+    // le fichier et ceux du répertoire sont trouvés directement
+    isModified = !dvcs::ValidateNoResult(statements,
+                                   "SELECT COUNT(*) FROM CommitsObjects WHERE CommitHash = @commit AND "
+                                   "(Path = @path OR (Path > @path || '/' AND Path < @path || '0'));",
+                                   {{"@commit", commit}, {"@path", path}});
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve la source <sourcePath> du fichier <path> (chemins représentés comme ceux
+// des objets) lorsque le commit <commit> l'a ajouté à l'arbre de son parent
+// <parentCommit>: le fichier de cet arbre dont il est la copie la plus semblable
+// selon <options> (voir FindSimilarFiles). La source d'un fichier déplacé, que le
+// commit retire, fait partie de cet arbre au même titre que celle d'une copie.
+// <sourcePath> est vide si le fichier n'a pas été ajouté ou si aucun fichier
+// n'est assez semblable.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FindCopySource(dvcs::StatementCache &statements, const fs::path &rootPath, const dvcs::THash &parentCommit,
+                                  const dvcs::THash &commit, const std::string &path, const dvcs::RenameOptions &options, std::string &sourcePath)
+{
+    sourcePath.clear();
+    dvcs::THash parentTree{};
+    dvcs::THash tree{};
+    std::vector<dvcs::TreeChange> changes;
+    RETURN_IF(!dvcs::GetCommitTree(statements, parentCommit, parentTree) || !dvcs::GetCommitTree(statements, commit, tree) ||
+                  !dvcs::DiffTrees(statements, parentTree, tree, "../", changes),
+              false);
+    const auto changeIt = std::find_if(changes.cbegin(), changes.cend(), [&path](const dvcs::TreeChange &change) { return change.m_path == path; });
+    RETURN_IF((changeIt == changes.cend()) || changeIt->m_oldItem || !changeIt->m_newItem, true);
+
+    std::vector<dvcs::TreeEntry> parentFiles;
+    RETURN_IF(!dvcs::LoadCommitTree(statements, parentCommit, parentFiles), false);
+    std::vector<dvcs::SimilarFile> sources;
+    for (const auto &entry : parentFiles)
+    {
+        sources.push_back(dvcs::SimilarFile{entry.m_path, entry.m_hash, entry.m_size, false});
+    }
+    std::vector<dvcs::SimilarPair> pairs;
+    const std::vector<dvcs::SimilarFile> destinations{dvcs::SimilarFile{path, changeIt->m_newItem->m_hash, changeIt->m_newItem->m_size, false}};
+    RETURN_IF(!dvcs::FindSimilarFiles(rootPath, sources, destinations, options, pairs), false);
+    if (!pairs.empty())
+    {
+        sourcePath = parentFiles[pairs.front().m_source].m_path;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ouvre le dépôt <repository> du répertoire courant.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool OpenCurrentRepository(dvcs::Repository &repository) noexcept
+{
+    try
+    {
+        return repository.Open(fs::current_path());
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Connexions et requêtes préparées d'un dépôt ouvert.
+// Chacune des deux bases de données a sa propre connexion, l'autre base de données
+// y étant attachée. Les requêtes d'une commande sont ainsi écrites du point de vue
+// de la base de données qu'elle modifie principalement.
+// NOTE: Les requêtes préparées doivent être finalisées avant la fermeture des
+//       connexions, d'où l'ordre de déclaration des membres.
+////////////////////////////////////////////////////////////////////////////////////
+struct Repository::Impl
+{
+    TDatabasePtr m_pRepoDB{nullptr, sqlite3_close};    // repo.db, la zone de staging y est attachée sous le nom Staging
+    TDatabasePtr m_pStagingDB{nullptr, sqlite3_close}; // staging.db, le dépôt y est attaché sous le nom Repo
+    StatementCache m_repoStatements{m_pRepoDB};
+    StatementCache m_stagingStatements{m_pStagingDB};
+    CommitGraph m_commitGraph;                         // Projeté au premier besoin (voir UpdateCommitGraph)
+};
+
+Repository::Repository() noexcept = default;
+Repository::Repository(Repository &&) noexcept = default;
+Repository &Repository::operator=(Repository &&) noexcept = default;
+Repository::~Repository() = default;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ouvre le dépôt dont la racine est <rootPath>. Les bases de données du dépôt
+// doivent déjà exister (voir Init).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Repository::Open(const fs::path &rootPath) noexcept
+{
+    try
+    {
+        const auto absRootPath = fs::absolute(rootPath).lexically_normal();
+        const auto repoDBPath = absRootPath / REPO_DB_PATH;
+        const auto stagingDBPath = absRootPath / STAGING_DB_PATH;
+
+        auto pImpl = std::make_unique<Impl>();
+        if (!OpenDatabaseConnection(repoDBPath, pImpl->m_pRepoDB, SQLITE_OPEN_READWRITE) ||
+            !OpenDatabaseConnection(stagingDBPath, pImpl->m_pStagingDB, SQLITE_OPEN_READWRITE))
+        {
+            fmt::print(std::cerr, "Not a dvcsus repository: '{}'\n", absRootPath.string());
+            return false;
+        }
+        // Le profil de stockage du dépôt vaut aussi pour sa zone de staging.
+        // NOTE: Un changement de journalisation (sortir du WAL entre autres) exige
+        //       un accès exclusif à la base de données: il doit être fait avant que
+        //       l'autre connexion ne l'attache.
+        StorageProfile profile{};
+        RETURN_IF(!GetStorageProfile(pImpl->m_pRepoDB, "main", profile), false);
+        const auto &settings = GetStorageSettings(profile);
+        RETURN_IF(!ApplyStorageSettings(pImpl->m_pRepoDB, "main", settings) || !ApplyStorageSettings(pImpl->m_pStagingDB, "main", settings), false);
+
+        RETURN_IF(!ExecuteQuery(pImpl->m_pRepoDB, "ATTACH DATABASE @path AS Staging;", {{"@path", stagingDBPath.native()}}), false);
+        RETURN_IF(!ExecuteQuery(pImpl->m_pStagingDB, "ATTACH DATABASE @path AS Repo;", {{"@path", repoDBPath.native()}}), false);
+        RETURN_IF(!ApplyStorageSettings(pImpl->m_pRepoDB, "Staging", settings) || !ApplyStorageSettings(pImpl->m_pStagingDB, "Repo", settings),
+                  false);
+
+        m_rootPath = absRootPath;
+        m_pImpl = std::move(pImpl);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute aux fichiers monitorés par le système de gestion de sources le fichier
+// dont le path relatif à la racine du dépôt est <filePath>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Add(const fs::path &filePath) noexcept { return Add(std::vector<fs::path>{filePath}); }
+
+[[nodiscard]] bool Add(const std::vector<fs::path> &pathSpecs) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Add(repository, pathSpecs);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute aux fichiers monitorés par le système de gestion de sources tous les
+// fichiers désignés par <pathSpecs> (fichiers, répertoires ou motifs).
+//
+// La lecture, le hachage et la compression des fichiers sont répartis sur un
+// bassin de fils d'exécution alors que les insertions se font toutes dans une
+// seule transaction à l'aide d'une seule requête préparée. Le chemin de chacun
+// des fichiers modifiés est consigné dans la zone de staging, mais seul un contenu
+// encore inconnu y est compressé et inséré. Un fichier revenu à sa version du
+// commit courant est retiré de la zone de staging. Un fichier suivi qui ne se
+// trouve plus dans l'arbre de travail y est consigné comme retiré (voir
+// ExpandPathSpec).
+// Les chemins relatifs de <pathSpecs> le sont par rapport à la racine du dépôt
+// <repository>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Add(Repository &repository, const std::vector<fs::path> &pathSpecs) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+
+        // Le dépôt, attaché à la connexion de la zone de staging, est nécessaire
+        // pour savoir quels objets sont déjà connus
+        auto &pDB = repository.GetImpl().m_pStagingDB;
+        auto &statements = repository.GetImpl().m_stagingStatements;
+        RETURN_IF(!ValidateSchemaVersion(pDB, "Repo"), false);
+
+        // Version courante de chacun des fichiers suivis: celle de la zone de
+        // staging (aucune pour un fichier retiré) ou, à défaut, celle du commit
+        // courant
+        auto &repoStatements = repository.GetImpl().m_repoStatements;
+        dvcs::THash currentCommit{};
+        std::vector<TreeEntry> tree;
+        RETURN_IF(!QueryHash(repoStatements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", currentCommit) ||
+                      !LoadCommitTree(repoStatements, currentCommit, tree),
+                  false);
+        std::unordered_map<std::string, dvcs::THash> committedFiles;
+        std::set<std::string> trackedPaths;
+        for (auto &entry : tree)
+        {
+            trackedPaths.insert(entry.m_path);
+            committedFiles.emplace(std::move(entry.m_path), std::move(entry.m_hash));
+        }
+        std::unordered_map<std::string, std::optional<dvcs::THash>> stagedFiles;
+        {
+            TStatementPtr pStagedStmt{nullptr, sqlite3_reset};
+            RETURN_IF(!statements.Prepare("SELECT Path, Hash FROM Paths;", pStagedStmt), false);
+            int stepResult{};
+            while ((stepResult = sqlite3_step(pStagedStmt.get())) == SQLITE_ROW)
+            {
+                dvcs::THash hash{};
+                bool isPresent{};
+                RETURN_IF(!GetColumnHash(pStagedStmt, 1, hash, isPresent), false);
+                const auto path = GetColumnText(pStagedStmt, 0);
+                stagedFiles[std::string{path}] = isPresent ? std::optional<dvcs::THash>{hash} : std::nullopt;
+                trackedPaths.emplace(path);
+            }
+            RETURN_IF(stepResult != SQLITE_DONE, false);
+        }
+
+        // L'ajout d'un fichier d'une fusion en cours indique que sa version
+        // fusionnée est prête, même si elle est identique à celle déjà consignée.
+        // Un tel fichier est suivi même s'il ne fait pas partie du commit courant:
+        // son retrait de l'arbre de travail peut donc aussi être ajouté.
+        bool hasUnmergedPaths{};
+        {
+            TStatementPtr pUnmergedStmt{nullptr, sqlite3_reset};
+            RETURN_IF(!statements.Prepare("SELECT Path FROM UnmergedPaths;", pUnmergedStmt), false);
+            int stepResult{};
+            while ((stepResult = sqlite3_step(pUnmergedStmt.get())) == SQLITE_ROW)
+            {
+                hasUnmergedPaths = true;
+                trackedPaths.emplace(GetColumnText(pUnmergedStmt, 0));
+            }
+            RETURN_IF(stepResult != SQLITE_DONE, false);
+        }
+
+        std::vector<FileToAdd> files;
+        std::vector<std::string> removedPaths;
+        for (const auto &pathSpec : pathSpecs)
+        {
+            RETURN_IF(!ExpandPathSpec(pathSpec, repository.GetRootPath(), trackedPaths, files, removedPaths), false);
+        }
+        std::sort(files.begin(), files.end());
+        files.erase(std::unique(files.begin(), files.end()), files.end());
+        std::sort(removedPaths.begin(), removedPaths.end());
+        removedPaths.erase(std::unique(removedPaths.begin(), removedPaths.end()), removedPaths.end());
+
+        dvcs::HashAlgorithm algorithm{};
+        RETURN_IF(!GetHashAlgorithm(pDB, "Repo", algorithm), false);
+
+        dvcs::CompressionSettings compressionSettings{};
+        RETURN_IF(!GetCompressionSettings(pDB, "Repo", compressionSettings), false);
+
+        std::unique_ptr<dvcs::CompressionDictionary> pDictionary;
+        RETURN_IF(!GetCurrentDictionary(pDB, "Repo", compressionSettings, pDictionary), false);
+
+        bool useChunking{};
+        RETURN_IF(!GetChunking(pDB, "Repo", useChunking), false);
+
+        // SQLite limite la taille d'un blob (1 Go par défaut)
+        const auto maxBlobSize = static_cast<std::uintmax_t>(sqlite3_limit(pDB.get(), SQLITE_LIMIT_LENGTH, -1));
+
+        // NOTE: Si on quitte avant la fin de la transaction, le gardien s'occupera
+        //       d'annuler les insertions déjà effectuées.
+        const TransactionGuard transactionGuard{pDB};
+        RETURN_IF(!statements.Execute("BEGIN TRANSACTION;", {}), false);
+
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT INTO Objects (Hash, Path, Size, Content, Codec, Base, Depth) VALUES(@hash, @path, @size, @content, "
+                                      "@codec, @base, @depth)",
+                                      pStmt),
+                  false);
+
+        TStatementPtr pProbeStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT EXISTS(SELECT 1 FROM main.Objects WHERE Hash = @hash) OR "
+                                      "EXISTS(SELECT 1 FROM Repo.Objects WHERE Hash = @hash)",
+                                      pProbeStmt),
+                  false);
+
+        // Les deltas sont produits par zstd et ne sont donc utilisés qu'avec celui-ci
+        const bool useDeltas = compressionSettings.m_codec == dvcs::Codec::Zstd;
+        TStatementPtr pBaseStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Hash, Depth, Size FROM Repo.Objects WHERE Path = @path ORDER BY rowid DESC LIMIT 1", pBaseStmt),
+                  false);
+        ObjectReader reader{pDB, "Repo"};
+
+        TStatementPtr pChunkProbeStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT EXISTS(SELECT 1 FROM main.Chunks WHERE Hash = @hash) OR "
+                                      "EXISTS(SELECT 1 FROM Repo.Chunks WHERE Hash = @hash)",
+                                      pChunkProbeStmt),
+                  false);
+        TStatementPtr pChunkStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT INTO Chunks (Hash, Size, Content, Codec) VALUES(@hash, @size, @content, @codec)", pChunkStmt),
+                  false);
+        TStatementPtr pChunkLinkStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("INSERT INTO ObjectsChunks (ObjectHash, Position, ChunkHash) VALUES(@object, @position, @chunk)",
+                                      pChunkLinkStmt),
+                  false);
+
+        const fs::path dvcsPath = repository.GetRootPath() / dvcs::DVCS_PATH;
+        std::uintmax_t totalSize{};
+        std::size_t nbAddedFiles{};
+        for (std::size_t batchBegin = 0, batchEnd = 0; batchBegin < files.size(); batchBegin = batchEnd)
+        {
+            // Constitution d'un lot de fichiers à traiter en parallèle
+            std::uintmax_t batchSize{};
+            for (batchEnd = batchBegin; (batchEnd < files.size()) && (batchEnd - batchBegin < MAX_BATCH_COUNT) && (batchSize < MAX_BATCH_SIZE);
+                 ++batchEnd)
+            {
+                batchSize += files[batchEnd].m_size;
+            }
+
+            // Première passe: on calcule le hash du contenu brut de chacun des fichiers
+            std::vector<StagedObject> objects(batchEnd - batchBegin);
+            ParallelFor(objects.size(),
+                        [&objects, &files, &dvcsPath, batchBegin, algorithm, useChunking, maxBlobSize](std::size_t index) {
+                            objects[index] = HashStagedObject(files[batchBegin + index], dvcsPath, algorithm, useChunking, maxBlobSize);
+                        });
+
+            // Le chemin de chacun des fichiers modifiés est consigné, mais les objets déjà connus (ou
+            // présents plus d'une fois dans le lot) n'ont pas à être compressés. Pour les autres, on
+            // récupère la version précédente du même fichier afin de calculer un delta (sauf pour les
+            // objets découpés, qui partagent plutôt leurs morceaux).
+            std::vector<std::size_t> newObjectIndices;
+            std::unordered_set<dvcs::THash, dvcs::HashHasher> batchHashes;
+            for (std::size_t iObject = 0; iObject < objects.size(); ++iObject)
+            {
+                auto &object = objects[iObject];
+                RETURN_IF(!object.m_isValid, false);
+                const auto path = object.m_path.string();
+                RETURN_IF(hasUnmergedPaths && !statements.Execute("DELETE FROM UnmergedPaths WHERE Path = @path;", {{"@path", path}}), false);
+                const auto stagedIt = stagedFiles.find(path);
+                const auto committedIt = committedFiles.find(path);
+                const bool isCommitted = (committedIt != committedFiles.end()) && (committedIt->second == object.m_hash);
+                if ((stagedIt != stagedFiles.end()) ? (stagedIt->second == object.m_hash) : isCommitted)
+                {
+                    continue;
+                }
+                ++nbAddedFiles;
+                if (isCommitted)
+                {
+                    RETURN_IF(!statements.Execute("DELETE FROM Paths WHERE Path = @path;", {{"@path", path}}), false);
+                    continue;
+                }
+                RETURN_IF(!statements.Execute("INSERT OR REPLACE INTO Paths (Path, Hash) VALUES (@path, @hash);",
+                                              {{"@path", path}, {"@hash", object.m_hash}}),
+                          false);
+
+                RETURN_IF(!ProbeStagedObject(pProbeStmt, object), false);
+                if (!object.m_isKnown && batchHashes.insert(object.m_hash).second)
+                {
+                    RETURN_IF(useDeltas && !object.m_isChunked && !FindDeltaBase(pBaseStmt, reader, object), false);
+                    newObjectIndices.push_back(iObject);
+                }
+            }
+
+            // Deuxième passe: on compresse les nouveaux objets
+            ParallelFor(newObjectIndices.size(),
+                        [&objects, &files, &newObjectIndices, &dvcsPath, &compressionSettings, &pDictionary, batchBegin](std::size_t index) {
+                            const auto iObject = newObjectIndices[index];
+                            if (!CompressStagedObject(files[batchBegin + iObject], dvcsPath, compressionSettings, pDictionary.get(),
+                                                      objects[iObject]))
+                            {
+                                objects[iObject].m_isValid = false;
+                            }
+                        });
+
+            for (const auto iObject : newObjectIndices)
+            {
+                const auto &object = objects[iObject];
+                RETURN_IF(!object.m_isValid, false);
+                RETURN_IF(object.m_isChunked && !InsertStagedChunks(files[batchBegin + iObject], compressionSettings, pChunkProbeStmt, pChunkStmt,
+                                                                    pChunkLinkStmt, object),
+                          false);
+                RETURN_IF(!InsertStagedObject(pStmt, object), false);
+            }
+            totalSize += batchSize;
+        }
+
+        // Le retrait d'un fichier commité est consigné alors qu'un fichier qui ne
+        // l'a jamais été est simplement retiré de la zone de staging
+        for (const auto &path : removedPaths)
+        {
+            RETURN_IF(hasUnmergedPaths && !statements.Execute("DELETE FROM UnmergedPaths WHERE Path = @path;", {{"@path", path}}), false);
+            const auto stagedIt = stagedFiles.find(path);
+            if ((stagedIt != stagedFiles.end()) && !stagedIt->second)
+            {
+                continue;
+            }
+            ++nbAddedFiles;
+            RETURN_IF(!statements.Execute(committedFiles.contains(path) ? "INSERT OR REPLACE INTO Paths (Path, Hash) VALUES (@path, NULL);"
+                                                                        : "DELETE FROM Paths WHERE Path = @path;",
+                                          {{"@path", path}}),
+                      false);
+        }
+
+        pStmt.reset();
+        pProbeStmt.reset();
+        pBaseStmt.reset();
+        pChunkProbeStmt.reset();
+        pChunkStmt.reset();
+        pChunkLinkStmt.reset();
+        RETURN_IF(!statements.Execute("END TRANSACTION;", {}), false);
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        const double seconds = std::max(elapsed.count(), std::numeric_limits<double>::epsilon());
+        const double megabytes = static_cast<double>(totalSize) / (1024.0 * 1024.0);
+        const auto nbFiles = files.size() + removedPaths.size();
+        fmt::print(std::cout, "added {0} files, {1} unchanged ({2:.2f} MB) in {3:.3f}s: {4:.0f} files/s, {5:.2f} MB/s\n", nbAddedFiles,
+                   nbFiles - nbAddedFiles, megabytes, seconds, static_cast<double>(nbFiles) / seconds, megabytes / seconds);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à la zone de staging les fichiers suivis qui ont été modifiés ainsi que,
+// si <includeUntracked>, les fichiers qui ne sont pas suivis (add --all et
+// commit -a). Les fichiers sont trouvés comme le fait Status: un moniteur de
+// fichiers évite donc de parcourir l'arbre de travail au complet. Le retrait des
+// fichiers suivis qui ont disparu est consigné.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool AddChanges(bool includeUntracked) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && AddChanges(repository, includeUntracked);
+}
+
+[[nodiscard]] bool AddChanges(Repository &repository, bool includeUntracked) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        std::vector<TFileChange> changes;
+        WorkingTreeScan scan;
+        RETURN_IF(!GetWorkingTreeChanges(impl.m_pRepoDB, impl.m_repoStatements, repository.GetRootPath(), changes, scan), false);
+
+        std::vector<fs::path> pathSpecs;
+        for (const auto &[path, state] : changes)
+        {
+            if ((state[1] == 'M') || (state[1] == 'D') || (includeUntracked && (state == "??")))
+            {
+                pathSpecs.emplace_back(path);
+            }
+        }
+        return Add(repository, pathSpecs);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Crée un commit avec le message <message> ayant comme auteur <author> qu'on peut
+// rejoindre à l'addresse courriel <email>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Commit(const std::string_view author, const std::string_view email, const std::string_view message) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Commit(repository, author, email, message);
+}
+
+[[nodiscard]] bool Commit(Repository &repository, const std::string_view author, const std::string_view email, const std::string_view message) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    for (const auto &arg : {author, email, message})
+    {
+        if (arg.empty())
+        {
+            fmt::print(std::cerr, "Can't commit. Missing information\n");
+            return false;
+        }
+    }
+
+    try
+    {
+        auto &pDB = repository.GetImpl().m_pRepoDB;
+        auto &statements = repository.GetImpl().m_repoStatements;
+        RETURN_IF(!ValidateSchemaVersion(pDB), false);
+
+        dvcs::HashAlgorithm algorithm{};
+        RETURN_IF(!GetHashAlgorithm(pDB, "main", algorithm), false);
+
+        dvcs::THash parentHash{};
+        RETURN_IF(!QueryHash(statements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", parentHash), false);
+
+        // Le commit d'une fusion interrompue par des conflits devient le second
+        // parent du commit (voir Merge), une fois tous ses fichiers ajoutés
+        std::optional<dvcs::THash> mergeParentHash;
+        if (!ValidateNoResult(statements, "SELECT COUNT(*) FROM Staging.PendingMerge;"))
+        {
+            TStatementPtr pStmt{nullptr, sqlite3_reset};
+            RETURN_IF(!statements.Prepare("SELECT Path FROM Staging.UnmergedPaths ORDER BY Path;", pStmt), false);
+            if (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+            {
+                fmt::print(std::cerr, "Can't commit. Unmerged files must be fixed and added first:\n");
+                do
+                {
+                    fmt::print(std::cerr, "  {}\n", GetDisplayPath(GetColumnText(pStmt, 0)));
+                } while (sqlite3_step(pStmt.get()) == SQLITE_ROW);
+                return false;
+            }
+            RETURN_IF(!QueryHash(statements, "SELECT CommitHash FROM Staging.PendingMerge;", mergeParentHash.emplace()), false);
+        }
+
+        // NOTE: Le hash des parents est intégré sous sa forme hexadécimale pour que
+        //       l'identifiant d'un commit ne dépende pas du format de stockage.
+        const auto parentHex = ToHex(parentHash);
+        std::vector<char> commitData;
+        commitData.insert(commitData.end(), author.cbegin(), author.cend());
+        commitData.insert(commitData.end(), email.cbegin(), email.cend());
+        commitData.insert(commitData.end(), message.cbegin(), message.cend());
+        commitData.insert(commitData.end(), parentHex.cbegin(), parentHex.cend());
+        if (mergeParentHash)
+        {
+            const auto mergeParentHex = ToHex(*mergeParentHash);
+            commitData.insert(commitData.end(), mergeParentHex.cbegin(), mergeParentHex.cend());
+        }
+        const auto commitHash = ComputeHash(algorithm, commitData.data(), commitData.size());
+
+        // NOTE: Seul le contenu des fichiers qui sont toujours dans la zone de
+        //       staging est conservé: celui d'un fichier modifié depuis son ajout,
+        //       ou revenu à sa version du commit courant, ne sert plus.
+        const auto commitQuery =
+            "BEGIN TRANSACTION;"
+            "INSERT INTO Objects (Hash, Path, Size, Content, Codec, Base, Depth) SELECT Hash, Path, Size, Content, Codec, Base, Depth FROM "
+            "Staging.Objects WHERE Hash IN (SELECT Hash FROM Staging.Paths) ORDER BY rowid;"
+            "INSERT INTO Commits (Hash, ParentHash, Author, Email, Message, MergeParentHash) SELECT @commit, Value, @author, @email, @message, "
+            "(SELECT CommitHash FROM Staging.PendingMerge) FROM Staging.Metadata WHERE Name = \"CurrentCommit\";"
+            "INSERT OR IGNORE INTO Chunks (Hash, Size, Content, Codec) SELECT Hash, Size, Content, Codec FROM Staging.Chunks WHERE Hash IN "
+            "(SELECT ChunkHash FROM Staging.ObjectsChunks WHERE ObjectHash IN (SELECT Hash FROM Staging.Paths));"
+            "INSERT INTO ObjectsChunks (ObjectHash, Position, ChunkHash) SELECT ObjectHash, Position, ChunkHash FROM Staging.ObjectsChunks "
+            "WHERE ObjectHash IN (SELECT Hash FROM Staging.Paths);"
+            "INSERT INTO CommitsObjects (ObjectHash, CommitHash, Path) SELECT Hash, @commit, Path FROM Staging.Paths;";
+        const auto branchQuery =
+            "INSERT INTO BranchesCommits (BranchName, CommitHash) SELECT Value, @commit FROM Staging.Metadata WHERE Name = \"CurrentBranch\";"
+            "INSERT OR REPLACE INTO Branches (Name, HeadCommit) SELECT Value, @commit FROM Staging.Metadata WHERE Name = \"CurrentBranch\";"
+            "DELETE FROM Staging.Objects;"
+            "DELETE FROM Staging.Paths;"
+            "DELETE FROM Staging.Chunks;"
+            "DELETE FROM Staging.ObjectsChunks;"
+            "DELETE FROM Staging.PendingMerge;"
+            "DELETE FROM Staging.UnmergedPaths;"
+            "INSERT OR REPLACE INTO Staging.Metadata (Name,  Value) VALUES (\"CurrentCommit\", @commit);"
+            "END TRANSACTION;";
+
+        // L'arbre du commit est construit dans la même transaction, à partir de
+        // celui de son parent, tout comme son filtre des chemins modifiés
+        const TransactionGuard transactionGuard{pDB};
+        dvcs::THash parentTree{};
+        dvcs::THash commitTree{};
+        RETURN_IF(!statements.Execute(commitQuery, {{"@commit", commitHash}, {"@author", author}, {"@email", email}, {"@message", message}}),
+                  false);
+        RETURN_IF(!GetCommitTree(statements, parentHash, parentTree) ||
+                      !BuildCommitTree(statements, algorithm, commitHash, parentTree, commitTree) ||
+                      !WritePathFilter(statements, commitHash) || !statements.Execute(branchQuery, {{"@commit", commitHash}}),
+                  false);
+        const auto graphPath = repository.GetRootPath() / dvcs::COMMIT_GRAPH_PATH;
+        RETURN_IF(!UpdateCommitGraph(statements, repository.GetImpl().m_commitGraph, graphPath, {commitHash}), false);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Initialise un dépôt DVCS dans le répertoire courant
+//
+// Concrètement, un dépôt DVCS ressemble à ceci:
+// repoPath
+// | -- .dvcs
+//     | -- repo.db
+//     | -- staging.db
+//
+// Les objets et les commits du dépôt sont identifiés à l'aide de l'algorithme de
+// hachage <algorithm>, qui est consigné dans les métadonnées du dépôt, tout comme
+// le profil de stockage <profile> appliqué à chacune de ses ouvertures.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Init(const dvcs::HashAlgorithm algorithm, const dvcs::StorageProfile profile) noexcept
+{
+    RETURN_IF(!CreateDVCSFolder(), false);
+    try
+    {
+        // Création des bases de données contenant le repo en tant que tel
+        // ainsi que la zone de staging.
+        // NOTE: La taille des pages doit être choisie avant la création des tables
+        const auto initQuery{fmt::format("ATTACH DATABASE \"{0}\" as Staging;"
+                                         "PRAGMA foreign_keys = ON;"
+                                         "PRAGMA main.page_size = {7};"
+                                         "PRAGMA Staging.page_size = {7};"
+                                         "BEGIN TRANSACTION;"
+                                         "{1}"
+                                         "CREATE TABLE Staging.Metadata("
+                                         "   Name   TEXT NOT NULL PRIMARY KEY CHECK(Name = \"CurrentBranch\" or Name = \"CurrentCommit\" or Name = "
+                                         "\"Remote\"),"
+                                         "   Value  TEXT NOT NULL);"
+                                         "{2}"
+                                         "INSERT INTO Metadata (Name, Value) VALUES (\"SchemaVersion\", {3});"
+                                         "INSERT INTO Metadata (Name, Value) VALUES (\"HashAlgorithm\", \"{5}\");"
+                                         "INSERT INTO Metadata (Name, Value) VALUES (\"Compression\", \"{6}\");"
+                                         "INSERT INTO Metadata (Name, Value) VALUES (\"StorageProfile\", \"{8}\");"
+                                         "INSERT INTO Branches (Name) VALUES (\"default\");"
+                                         "INSERT INTO Staging.Metadata (Name, Value) VALUES (\"CurrentBranch\", \"default\");"
+                                         "INSERT INTO Staging.Metadata (Name, Value) VALUES (\"CurrentCommit\", zeroblob({4}));"
+                                         "END TRANSACTION;"
+                                         "DETACH DATABASE Staging;",
+                                         (fs::current_path() / STAGING_DB_PATH).c_str(), STAGING_OBJECTS_TABLES_QUERY, REPO_TABLES_QUERY,
+                                         SCHEMA_VERSION, dvcs::GetHashSize(algorithm), dvcs::GetHashAlgorithmName(algorithm),
+                                         ToString(CompressionSettings{}), dvcs::GetStorageSettings(profile).m_pageSize,
+                                         dvcs::GetStorageProfileName(profile))};
+
+        RETURN_IF(!ExecuteQuery(REPO_DB_PATH, initQuery), false);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    // On annonce que la job est finie
+    fmt::print(std::cout, "initialized empty repository: {}\n", fs::current_path().c_str());
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Met à jour le format de stockage du dépôt du répertoire courant.
+// Les données sont converties sur place, dans une seule transaction par version.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Migrate() noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Migrate(repository);
+}
+
+[[nodiscard]] bool Migrate(Repository &repository) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &pDB = repository.GetImpl().m_pRepoDB;
+
+        int version{};
+        RETURN_IF(!GetSchemaVersion(pDB, "main", version), false);
+        if (version > SCHEMA_VERSION)
+        {
+            fmt::print(std::cerr, "Repository uses schema version {0} which is newer than this version of dvcsus ({1})\n", version, SCHEMA_VERSION);
+            return false;
+        }
+
+        // Chaque migration est faite dans sa propre transaction: une migration
+        // interrompue laisse le dépôt dans la dernière version atteinte, d'où
+        // une nouvelle exécution peut reprendre.
+        const int initialVersion = version;
+        while (version < SCHEMA_VERSION)
+        {
+            const auto migrationIt = std::find_if(MIGRATIONS.cbegin(), MIGRATIONS.cend(),
+                                                  [version](const Migration &migration) { return migration.m_fromVersion == version; });
+            if (migrationIt == MIGRATIONS.cend())
+            {
+                fmt::print(std::cerr, "No migration from schema version {}\n", version);
+                return false;
+            }
+
+            const int previousVersion = version;
+            RETURN_IF(!migrationIt->m_pMigrate(pDB), false);
+            RETURN_IF(!GetSchemaVersion(pDB, "main", version), false);
+            RETURN_IF(version <= previousVersion, false);
+        }
+
+        if (version == initialVersion)
+        {
+            fmt::print(std::cout, "repository already uses schema version {}\n", version);
+        }
+        else
+        {
+            fmt::print(std::cout, "migrated repository from schema version {0} to {1}\n", initialVersion, version);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Défait tout changement non-committé.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Revert() noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Revert(repository);
+}
+
+[[nodiscard]] bool Revert(Repository &repository) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    return repository.GetImpl().m_stagingStatements.Execute("BEGIN TRANSACTION;"
+                                                            "DELETE FROM Objects;"
+                                                            "DELETE FROM Paths;"
+                                                            "DELETE FROM Chunks;"
+                                                            "DELETE FROM ObjectsChunks;"
+                                                            "DELETE FROM PendingMerge;"
+                                                            "DELETE FROM UnmergedPaths;"
+                                                            "END TRANSACTION;",
+                                                            {});
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Affiche l'état des fichiers du dépôt, un fichier par ligne, à la manière de git:
+// la première colonne compare la zone de staging au commit courant (A: ajouté,
+// M: modifié), la seconde compare l'arbre de travail à la zone de staging (M:
+// modifié, D: supprimé). Les fichiers qui ne sont pas suivis sont marqués "??".
+//
+// Un fichier n'est relu que si sa taille, sa date de modification ou son inode
+// diffèrent de ceux consignés dans le cache de la zone de staging: un status sur
+// un arbre de travail qui n'a pas changé se contente donc de stat. Le parcours des
+// répertoires et le hachage des fichiers sont répartis sur un bassin de fils
+// d'exécution. Lorsqu'un moniteur de fichiers (dvcsusmon) s'exécute, seuls les
+// chemins qu'il a vus changer sont examinés.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Status() noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Status(repository);
+}
+
+[[nodiscard]] bool Status(Repository &repository) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        std::string branch;
+        RETURN_IF(!GetMetadataValue(impl.m_pRepoDB, "Staging", "CurrentBranch", branch), false);
+
+        std::vector<TFileChange> changes;
+        WorkingTreeScan scan;
+        RETURN_IF(!GetWorkingTreeChanges(impl.m_pRepoDB, impl.m_repoStatements, repository.GetRootPath(), changes, scan), false);
+
+        fmt::print(std::cout, "on branch {}\n", branch);
+        for (const auto &[path, state] : changes)
+        {
+            fmt::print(std::cout, "{0} {1}\n", state, path);
+        }
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (scan.m_isMonitored)
+        {
+            fmt::print(std::cout, "scanned {0} of {1} files (file monitor), {2} hashed, in {3:.3f}s\n", scan.m_nbScanned, scan.m_nbFiles,
+                       scan.m_nbHashed, elapsed.count());
+        }
+        else
+        {
+            fmt::print(std::cout, "scanned {0} files, {1} hashed, in {2:.3f}s\n", scan.m_nbScanned, scan.m_nbHashed, elapsed.count());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère tous les nouveaux commits se trouvant dans la source de données distante.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Pull() noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Pull(repository);
+}
+
+[[nodiscard]] bool Pull(Repository &repository) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    auto &statements = repository.GetImpl().m_repoStatements;
+    const auto remote = GetRemoteSetting(statements);
+    const bool isPulled = dvcs::IsRemoteUrl(remote) ? RemoteTransfer(statements, repository.GetRootPath(), remote, TransferDirection::ToLocal)
+                                                    : Transfer(statements, repository.GetRootPath(), TransferDirection::ToLocal);
+    return isPulled && UpdateCommitGraph(statements, repository.GetImpl().m_commitGraph, repository.GetRootPath() / dvcs::COMMIT_GRAPH_PATH);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Envoie tous les nouveaux commits locaux à la source de données distante.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Push() noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Push(repository);
+}
+
+[[nodiscard]] bool Push(Repository &repository) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    auto &statements = repository.GetImpl().m_repoStatements;
+    const auto remote = GetRemoteSetting(statements);
+    return dvcs::IsRemoteUrl(remote) ? RemoteTransfer(statements, repository.GetRootPath(), remote, TransferDirection::ToRemote)
+                                     : Transfer(statements, repository.GetRootPath(), TransferDirection::ToRemote);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Sert au client de la connexion <connection> un des dépôts se trouvant sous la
+// racine <rootPath> (voir dvcsusd). Le client choisit le dépôt et le service (pull
+// ou push) dans son premier message, puis le service lui annonce ses branches.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ServeRemote(std::iostream &connection, const fs::path &rootPath) noexcept
+{
+    try
+    {
+        std::vector<char> fields;
+        dvcs::MessageType type{};
+        RETURN_IF(!dvcs::ReadMessage(connection, type, fields), false);
+        RETURN_IF(type != dvcs::MessageType::Hello, SendError(connection, "Expected a hello message"));
+
+        std::uint32_t version{};
+        std::uint8_t rawService{};
+        std::string repositoryName;
+        dvcs::BundleFieldsReader fieldsReader{fields};
+        RETURN_IF(!fieldsReader.ReadU32(version) || !fieldsReader.ReadU8(rawService) || !fieldsReader.ReadString(repositoryName), false);
+        RETURN_IF(version != dvcs::PROTOCOL_VERSION, SendError(connection, fmt::format("Unsupported protocol version {}", version)));
+        const auto service = static_cast<dvcs::RemoteService>(rawService);
+        RETURN_IF((service != dvcs::RemoteService::Pull) && (service != dvcs::RemoteService::Push), SendError(connection, "Unsupported service"));
+
+        // NOTE: Une autre connexion peut tenir brièvement un verrou exclusif (à sa
+        //       fermeture notamment): il faut l'attendre avant même de lire le schéma
+        fs::path repoDBPath;
+        TDatabasePtr pDB{nullptr, sqlite3_close};
+        if (!ResolveServedRepository(rootPath, repositoryName, repoDBPath) || !OpenDatabaseConnection(repoDBPath, pDB, SQLITE_OPEN_READWRITE))
+        {
+            return SendError(connection, fmt::format("No repository '{}'", repositoryName));
+        }
+        sqlite3_busy_timeout(pDB.get(), BUSY_TIMEOUT_MS);
+        RETURN_IF(!ValidateSchemaVersion(pDB, "main"), SendError(connection, fmt::format("Can't serve repository '{}'", repositoryName)));
+
+        dvcs::StorageProfile profile{};
+        RETURN_IF(!GetStorageProfile(pDB, "main", profile) || !ApplyStorageSettings(pDB, "main", dvcs::GetStorageSettings(profile)), false);
+
+        UnbundleCounts counts;
+        {
+            StatementCache statements{pDB};
+            RETURN_IF(!SendRefs(statements, connection), false);
+            RETURN_IF(service == dvcs::RemoteService::Pull, ServePull(statements, connection));
+
+            // Une branche dont l'historique a divergé doit d'abord être fusionnée
+            // par le client
+            dvcs::CommitGraph graph;
+            BranchHeadsUpdate update{graph, GetCommitGraphPath(repoDBPath), DivergedBranchPolicy::Reject};
+            dvcs::BundleReader reader{connection};
+            if (!ImportBundle(statements, reader, "pushed bundle", update, counts))
+            {
+                return SendError(connection, update.m_rejectedBranch.empty()
+                                                 ? std::string{"Can't import the pushed commits"}
+                                                 : fmt::format("Branch {} has diverged, pull and merge it first", update.m_rejectedBranch));
+            }
+        }
+
+        // Le dépôt est fermé avant de répondre au client d'un push: une fois la
+        // réponse reçue, le dépôt est libre (sa fermeture peut exiger un verrou)
+        pDB.reset();
+        return SendStatus(connection, counts);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Commence la session <session> du moniteur de fichiers (voir FileMonitor). Les
+// chemins consignés par une session précédente sont oubliés: la nouvelle session
+// doit être synchronisée par un parcours complet de l'arbre de travail.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool BeginFileMonitorSession(Repository &repository, std::string_view session) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    auto &impl = repository.GetImpl();
+    RETURN_IF(!ValidateSchemaVersion(impl.m_pStagingDB, "Repo"), false);
+
+    const TransactionGuard transactionGuard{impl.m_pStagingDB};
+    return impl.m_stagingStatements.Execute("BEGIN TRANSACTION;"
+                                            "DELETE FROM ChangedPaths;"
+                                            "DELETE FROM FileMonitor;"
+                                            "INSERT INTO FileMonitor (Session, IsSynced) VALUES (@session, 0);"
+                                            "END TRANSACTION;",
+                                            {{"@session", session}});
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Consigne dans le journal du moniteur de fichiers les chemins <paths>,
+// représentés comme ceux des objets
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool RecordChangedPaths(Repository &repository, const std::vector<std::string> &paths) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    auto &impl = repository.GetImpl();
+
+    const TransactionGuard transactionGuard{impl.m_pStagingDB};
+    RETURN_IF(!impl.m_stagingStatements.Execute("BEGIN TRANSACTION;", {}), false);
+    for (const auto &path : paths)
+    {
+        RETURN_IF(!impl.m_stagingStatements.Execute("INSERT INTO ChangedPaths (Path) VALUES (@path);", {{"@path", path}}), false);
+    }
+    return impl.m_stagingStatements.Execute("END TRANSACTION;", {});
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Termine la session du moniteur de fichiers: les commandes ne peuvent plus se fier
+// au journal
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool EndFileMonitorSession(Repository &repository) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    auto &impl = repository.GetImpl();
+    const TransactionGuard transactionGuard{impl.m_pStagingDB};
+    return impl.m_stagingStatements.Execute("BEGIN TRANSACTION;"
+                                            "DELETE FROM ChangedPaths;"
+                                            "DELETE FROM FileMonitor;"
+                                            "END TRANSACTION;",
+                                            {});
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit dans le fichier <bundlePath> (la sortie standard si "-") un bundle
+// contenant les commits de l'intervalle <range>, leurs objets et leurs branches.
+// L'intervalle est soit vide (toutes les branches), soit le nom d'une branche, soit
+// de la forme <base>..<branche>, où <base> est une branche ou un hash que le
+// destinataire a déjà. Le contenu est lu et écrit au fil de l'eau: la mémoire
+// utilisée ne dépend pas de la taille du bundle.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CreateBundle(const fs::path &bundlePath, std::string_view range) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && CreateBundle(repository, bundlePath, range);
+}
+
+[[nodiscard]] bool CreateBundle(Repository &repository, const fs::path &bundlePath, std::string_view range) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &statements = repository.GetImpl().m_repoStatements;
+        auto &pDB = statements.GetDatabase();
+        RETURN_IF(!ExecuteQuery(pDB, BUNDLE_TABLES_QUERY), false);
+
+        const auto separatorPos = range.find("..");
+        const std::string branch{(separatorPos == std::string_view::npos) ? range : range.substr(separatorPos + 2)};
+        if (!branch.empty() && ValidateNoResult(statements, "SELECT COUNT(*) FROM Branches WHERE Name = @branch AND HeadCommit IS NOT NULL;",
+                                                {{"@branch", branch}}))
+        {
+            fmt::print(std::cerr, "Branch {} has no commit\n", branch);
+            return false;
+        }
+        RETURN_IF(!statements.Execute("INSERT INTO BundleTips (Name, HeadCommit) SELECT Name, HeadCommit FROM main.Branches "
+                                      "WHERE HeadCommit IS NOT NULL AND (@branch = '' OR Name = @branch);",
+                                      {{"@branch", std::string_view{branch.c_str(), branch.size()}}}),
+                  false);
+
+        if (separatorPos != std::string_view::npos)
+        {
+            const auto baseRevision = range.substr(0, separatorPos);
+            dvcs::THash base;
+            if (!ResolveRevision(statements, baseRevision, base))
+            {
+                fmt::print(std::cerr, "Unknown revision {}\n", baseRevision);
+                return false;
+            }
+            RETURN_IF(!statements.Execute("INSERT INTO BundleBases (Hash) VALUES (@hash);", {{"@hash", base}}), false);
+        }
+
+        const bool isStandardOutput = bundlePath == "-";
+        std::ofstream bundleFile;
+        if (!isStandardOutput)
+        {
+            bundleFile.open(bundlePath, std::ios::binary | std::ios::trunc);
+            if (!bundleFile)
+            {
+                fmt::print(std::cerr, "Can't write bundle {}\n", bundlePath.string());
+                return false;
+            }
+        }
+
+        dvcs::BundleWriter writer{isStandardOutput ? std::cout : bundleFile};
+        if (!WriteBundle(statements, writer))
+        {
+            fmt::print(std::cerr, "Can't write bundle {}\n", bundlePath.string());
+            if (!isStandardOutput)
+            {
+                bundleFile.close();
+                std::error_code error;
+                fs::remove(bundlePath, error);
+            }
+            return false;
+        }
+
+        if (!isStandardOutput)
+        {
+            fmt::print(std::cout, "bundled {0} commits, {1} objects and {2} chunks\n", writer.GetNbRecords(dvcs::BundleRecordType::Commit),
+                       writer.GetNbRecords(dvcs::BundleRecordType::Object), writer.GetNbRecords(dvcs::BundleRecordType::Chunk));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Importe dans le dépôt le bundle du fichier <bundlePath> (l'entrée standard si
+// "-"). Le bundle est importé au fil de sa lecture dans une seule transaction: un
+// bundle tronqué ou corrompu laisse le dépôt intact.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Unbundle(const fs::path &bundlePath) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Unbundle(repository, bundlePath);
+}
+
+[[nodiscard]] bool Unbundle(Repository &repository, const fs::path &bundlePath) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        const bool isStandardInput = bundlePath == "-";
+        std::ifstream bundleFile;
+        if (!isStandardInput)
+        {
+            bundleFile.open(bundlePath, std::ios::binary);
+            if (!bundleFile)
+            {
+                fmt::print(std::cerr, "Can't read bundle {}\n", bundlePath.string());
+                return false;
+            }
+        }
+
+        dvcs::BundleReader reader{isStandardInput ? std::cin : bundleFile};
+        UnbundleCounts counts;
+        auto &impl = repository.GetImpl();
+        const auto graphPath = repository.GetRootPath() / dvcs::COMMIT_GRAPH_PATH;
+        BranchHeadsUpdate update{impl.m_commitGraph, graphPath, DivergedBranchPolicy::Track};
+        RETURN_IF(!ImportBundle(impl.m_repoStatements, reader, bundlePath.string(), update, counts) ||
+                      !UpdateCommitGraph(impl.m_repoStatements, impl.m_commitGraph, graphPath),
+                  false);
+        fmt::print(std::cout, "unbundled {0} commits, {1} objects and {2} chunks\n", counts.m_nbCommits, counts.m_nbObjects, counts.m_nbChunks);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique au dépôt que sa source de données distantes se trouve à <remoteRepoPath>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SetRemote(const fs::path &remoteRepoPath) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && SetRemote(repository, remoteRepoPath);
+}
+
+[[nodiscard]] bool SetRemote(Repository &repository, const fs::path &remoteRepoPath) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        // Un dépôt servi par dvcsusd n'est joint qu'au moment d'un transfert
+        const auto remoteText = remoteRepoPath.string();
+        if (dvcs::IsRemoteUrl(remoteText))
+        {
+            dvcs::RemoteUrl url;
+            if (!dvcs::ParseRemoteUrl(remoteText, url))
+            {
+                fmt::print(std::cerr, "Invalid remote URL {}\n", remoteText);
+                return false;
+            }
+            return repository.GetImpl().m_repoStatements.Execute(
+                "INSERT OR REPLACE INTO Staging.Metadata (Name, Value) VALUES (\"Remote\", @remote);", {{"@remote", remoteText}});
+        }
+
+        const auto dvcsPath = repository.GetRootPath() / dvcs::DVCS_PATH;
+        const auto remoteRepoRelativePath = fs::relative(repository.GetRootPath() / remoteRepoPath, dvcsPath);
+        TDatabasePtr pDB{nullptr, sqlite3_close};
+        if (!OpenDatabaseConnection((dvcsPath / remoteRepoRelativePath).lexically_normal(), pDB))
+        {
+            fmt::print(std::cerr, "Remote must be a DVCS database\n");
+            return false;
+        }
+        const auto remote = remoteRepoRelativePath.string();
+        return repository.GetImpl().m_repoStatements.Execute("INSERT OR REPLACE INTO Staging.Metadata (Name, Value) VALUES (\"Remote\", @remote);",
+                                                             {{"@remote", remote}});
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Change les paramètres de compression <settings> (de la forme <codec>[:<niveau>])
+// utilisés pour les prochains objets ajoutés au dépôt. Les objets existants
+// conservent leur codec.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SetCompression(const std::string_view settings) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && SetCompression(repository, settings);
+}
+
+[[nodiscard]] bool SetCompression(Repository &repository, const std::string_view settings) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    CompressionSettings compressionSettings{};
+    if (!ParseCompressionSettings(settings, compressionSettings))
+    {
+        fmt::print(std::cerr, "Invalid compression settings '{}'. Expected <zlib|zstd|lz4|store>[:<level>]\n", settings);
+        return false;
+    }
+
+    try
+    {
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+        const auto value = ToString(compressionSettings);
+        return impl.m_repoStatements.Execute("INSERT OR REPLACE INTO Metadata (Name, Value) VALUES (\"Compression\", @settings);",
+                                             {{"@settings", value}});
+    }
     catch (const std::exception &e)
     {
         fmt::print(std::cerr, "{}\n", e.what());
         return false;
     }
-
-    // On annonce que la job est finie
-    fmt::print(std::cout, "initialized empty repository: {}\n", fs::current_path().c_str());
-
-    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Défait tout changement non-committé.
+// Active ou désactive (<isEnabled>) le découpage selon leur contenu des gros
+// fichiers ajoutés au dépôt. Les objets existants conservent leur format.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Revert() noexcept { return ExecuteQuery(STAGING_DB_PATH, "DELETE FROM Objects;"); }
+[[nodiscard]] bool SetChunking(const bool isEnabled) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && SetChunking(repository, isEnabled);
+}
 
-////////////////////////////////////////////////////////////////////////////////////
-// Récupère tous les nouveaux commits se trouvant dans la source de données distante.
-////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Pull() noexcept { return Transfer(TransferDirection::ToLocal); }
+[[nodiscard]] bool SetChunking(Repository &repository, const bool isEnabled) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+        return impl.m_repoStatements.Execute("INSERT OR REPLACE INTO Metadata (Name, Value) VALUES (\"Chunking\", @value);",
+                                             {{"@value", isEnabled ? "on" : "off"}});
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Envoie tous les nouveaux commits locaux à la source de données distante.
+// Change le profil de stockage <profile> du dépôt. Le nouveau profil s'applique à
+// compter de la prochaine ouverture du dépôt, à l'exception de la taille des pages
+// qui demeure celle choisie à l'init.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool Push() noexcept { return Transfer(TransferDirection::ToRemote); }
+[[nodiscard]] bool SetStorageProfile(const StorageProfile profile) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && SetStorageProfile(repository, profile);
+}
+
+[[nodiscard]] bool SetStorageProfile(Repository &repository, const StorageProfile profile) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+        const std::string name{GetStorageProfileName(profile)};
+        return impl.m_repoStatements.Execute("INSERT OR REPLACE INTO Metadata (Name, Value) VALUES (\"StorageProfile\", @profile);",
+                                             {{"@profile", name}});
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Indique au dépôt que sa source de données distantes se trouve à <remoteRepoPath>.
+// Entraîne un dictionnaire de compression sur un échantillon d'au plus
+// <maxSamples> petits objets du dépôt. Le dictionnaire devient le dictionnaire
+// courant du dépôt: les petits objets existants sont recompressés avec celui-ci,
+// tout comme le seront les prochains objets ajoutés.
+// Le gain et le débit de compression/décompression obtenus sur l'échantillon avec
+// et sans dictionnaire sont affichés.
 ////////////////////////////////////////////////////////////////////////////////////
-[[nodiscard]] bool SetRemote(const fs::path &remoteRepoPath) noexcept
+[[nodiscard]] bool TrainCompressionDictionary(const std::size_t maxSamples) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && TrainCompressionDictionary(repository, maxSamples);
+}
+
+[[nodiscard]] bool TrainCompressionDictionary(Repository &repository, const std::size_t maxSamples) noexcept
 {
+    RETURN_IF(!repository.IsOpen(), false);
     try
     {
-        const auto dvcsPath = fs::current_path() / dvcs::DVCS_PATH;
-        const auto remoteRepoRelativePath = fs::relative(remoteRepoPath, dvcsPath);
-        TDatabasePtr pDB{nullptr, sqlite3_close};
-        if (!OpenDatabaseConnection(remoteRepoRelativePath, pDB))
+        auto &pDB = repository.GetImpl().m_pRepoDB;
+        RETURN_IF(!ValidateSchemaVersion(pDB), false);
+
+        CompressionSettings settings{};
+        RETURN_IF(!GetCompressionSettings(pDB, "main", settings), false);
+        if (settings.m_codec != Codec::Zstd)
         {
-            fmt::print(std::cerr, "Remote must be a DVCS database\n");
+            fmt::print(std::cerr, "Compression dictionaries require the zstd codec. Run 'dvcsus set_compression zstd' first.\n");
+            return false;
+        }
+
+        DictionaryCache dictionaries{pDB, "main"};
+        std::vector<std::vector<char>> samples;
+        RETURN_IF(!SampleObjects(pDB, dictionaries, maxSamples, samples), false);
+        if (samples.size() < MIN_DICTIONARY_SAMPLES)
+        {
+            fmt::print(std::cerr, "Not enough small objects to train a dictionary ({0} found, at least {1} required)\n", samples.size(),
+                       MIN_DICTIONARY_SAMPLES);
             return false;
         }
-        const auto setRemoteQuery{
-            fmt::format("INSERT OR REPLACE INTO Metadata (Name, Value) VALUES (\"Remote\", \"{}\");", remoteRepoRelativePath.string())};
-        return ExecuteQuery(STAGING_DB_PATH, setRemoteQuery);
+
+        std::size_t totalSampleSize{};
+        for (const auto &sample : samples)
+        {
+            totalSampleSize += sample.size();
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+        std::vector<char> content;
+        RETURN_IF(!dvcs::TrainDictionary(samples, std::clamp(totalSampleSize / 10, MIN_DICTIONARY_SIZE, MAX_DICTIONARY_SIZE), content), false);
+        const std::chrono::duration<double> trainingTime = std::chrono::steady_clock::now() - startTime;
+
+        CompressionDictionary dictionary{std::move(content), settings.m_level};
+        RETURN_IF(!dictionary.IsValid(), false);
+        fmt::print(std::cout, "trained dictionary {0} ({1} bytes) from {2} objects ({3} bytes) in {4:.3f}s\n", dictionary.GetId(),
+                   dictionary.GetContent().size(), samples.size(), totalSampleSize, trainingTime.count());
+
+        CompressionMeasure withoutDictionary;
+        CompressionMeasure withDictionary;
+        RETURN_IF(!MeasureCompression(samples, settings, nullptr, withoutDictionary), false);
+        RETURN_IF(!MeasureCompression(samples, settings, &dictionary, withDictionary), false);
+        PrintCompressionMeasure("without dictionary:", withoutDictionary);
+        PrintCompressionMeasure("with dictionary:", withDictionary);
+
+        // Le dictionnaire et les objets recompressés sont enregistrés d'un seul coup
+        const TransactionGuard transactionGuard{pDB};
+        RETURN_IF(!ExecuteQuery(pDB, "BEGIN TRANSACTION;"), false);
+
+        sqlite3_stmt *pSQLStmt;
+        RETURN_IF(sqlite3_prepare_v2(pDB.get(), "INSERT OR IGNORE INTO Dictionaries (Id, Content) VALUES (@id, @content);", -1, &pSQLStmt,
+                                     nullptr) != SQLITE_OK,
+                  false);
+        TStatementPtr pStmt{pSQLStmt, sqlite3_finalize};
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 1, dictionary.GetId()) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_bind_blob64(pStmt.get(), 2, dictionary.GetContent().data(), dictionary.GetContent().size(), SQLITE_STATIC) != SQLITE_OK,
+                  false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        pStmt.reset();
+
+        const auto id = std::to_string(dictionary.GetId());
+        RETURN_IF(!ExecuteQuery(pDB, "INSERT OR REPLACE INTO Metadata (Name, Value) VALUES (\"Dictionary\", CAST(@id AS INTEGER));", {{"@id", id}}),
+                  false);
+
+        std::size_t nbRepacked{};
+        std::uintmax_t nbSavedBytes{};
+        RETURN_IF(!RepackObjects(pDB, dictionaries, settings, dictionary, nbRepacked, nbSavedBytes), false);
+        RETURN_IF(!ExecuteQuery(pDB, "END TRANSACTION;"), false);
+
+        fmt::print(std::cout, "repacked {0} objects, {1} bytes saved\n", nbRepacked, nbSavedBytes);
     }
     catch (const std::exception &e)
     {
         fmt::print(std::cerr, "{}\n", e.what());
         return false;
     }
+
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -557,31 +4411,36 @@ namespace dvcs
 ////////////////////////////////////////////////////////////////////////////////////
 [[nodiscard]] bool CreateBranch(const std::string_view branchName) noexcept
 {
+    Repository repository;
+    return OpenCurrentRepository(repository) && CreateBranch(repository, branchName);
+}
+
+[[nodiscard]] bool CreateBranch(Repository &repository, const std::string_view branchName) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
     try
     {
-        TDatabasePtr pDB{nullptr, sqlite3_close};
-        RETURN_IF(!OpenDatabaseConnection(fs::current_path() / REPO_DB_PATH, pDB), false);
+        auto &impl = repository.GetImpl();
+        auto &statements = impl.m_repoStatements;
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
 
-        if (!ValidateNoResult(pDB, fmt::format("SELECT COUNT(*) FROM Branches WHERE Name = \"{}\"", branchName)))
+        const std::string branch{branchName};
+        if (!ValidateNoResult(statements, "SELECT COUNT(*) FROM Branches WHERE Name = @branch;", {{"@branch", branch}}))
         {
             fmt::print(std::cerr, fmt::format("Branch '{}' already exists.\n", branchName));
             return false;
         }
 
-        if (ValidateNoResult(pDB, "SELECT COUNT(*) FROM Commits"))
+        if (ValidateNoResult(statements, "SELECT COUNT(*) FROM Commits;"))
         {
             fmt::print(std::cerr, fmt::format("Can't create branch '{}' in empty repository.\n", branchName));
             return false;
         }
 
-        const auto createQuery =
-            fmt::format("ATTACH DATABASE \"{0}\" as Staging;"
-                        "BEGIN TRANSACTION;"
-                        "INSERT INTO Branches (Name, HeadCommit) SELECT \"{1}\", Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";"
-                        "END TRANSACTION;"
-                        "DETACH DATABASE Staging;",
-                        (fs::current_path() / STAGING_DB_PATH).c_str(), branchName);
-        return ExecuteQuery(pDB, createQuery);
+        return statements.Execute("BEGIN TRANSACTION;"
+                                  "INSERT INTO Branches (Name, HeadCommit) SELECT @branch, Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";"
+                                  "END TRANSACTION;",
+                                  {{"@branch", branch}});
     }
     catch (const std::exception &e)
     {
@@ -591,37 +4450,648 @@ namespace dvcs
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Positionne DVCSUS sur la branche <branchName>
+// Positionne DVCSUS sur la branche <branchName> et met à jour les fichiers du
+// dépôt pour qu'ils correspondent au commit de tête de celle-ci. Seuls les
+// fichiers qui diffèrent entre les arbres du commit courant et de celui-ci sont
+// touchés (voir DiffTrees et UpdateWorkingTree).
 ////////////////////////////////////////////////////////////////////////////////////
 [[nodiscard]] bool CheckoutBranch(const std::string_view branchName) noexcept
 {
+    Repository repository;
+    return OpenCurrentRepository(repository) && CheckoutBranch(repository, branchName);
+}
+
+[[nodiscard]] bool CheckoutBranch(Repository &repository, const std::string_view branchName) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
     try
     {
-        TDatabasePtr pDB{nullptr, sqlite3_close};
-        RETURN_IF(!OpenDatabaseConnection(fs::current_path() / REPO_DB_PATH, pDB), false);
-        if (ValidateNoResult(pDB, fmt::format("SELECT COUNT(*) FROM Branches WHERE Name = \"{}\"", branchName)))
+        auto &impl = repository.GetImpl();
+        auto &statements = impl.m_repoStatements;
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        const std::string branch{branchName};
+        if (ValidateNoResult(statements, "SELECT COUNT(*) FROM Branches WHERE Name = @branch;", {{"@branch", branch}}))
         {
             fmt::print(std::cerr, fmt::format("Can't checkout branch '{}'. It doesn't exists.\n", branchName));
             return false;
         }
 
-        RETURN_IF(!OpenDatabaseConnection(fs::current_path() / STAGING_DB_PATH, pDB), false);
-        if (!ValidateNoResult(pDB, "SELECT COUNT(*) FROM Objects"))
+        if (!ValidateNoResult(statements, "SELECT COUNT(*) FROM Staging.Paths;"))
         {
             fmt::print(std::cerr, fmt::format("Can't checkout '{}' branch. Uncommitted changes detected.\n", branchName));
             return false;
         }
 
-        const auto checkoutQuery =
-            fmt::format("ATTACH DATABASE \"{0}\" as Repo;"
-                        "BEGIN TRANSACTION;"
-                        "INSERT OR REPLACE INTO Metadata (Name, Value) VALUES (\"CurrentBranch\", \"{1}\");"
-                        "INSERT OR REPLACE INTO Metadata (Name, Value) SELECT \"CurrentCommit\", HeadCommit FROM Repo.Branches WHERE Name = \"{1}\";"
-                        "END TRANSACTION;"
-                        "DETACH DATABASE Repo;",
-                        (fs::current_path() / REPO_DB_PATH).c_str(), branchName);
+        const auto startTime = std::chrono::steady_clock::now();
+
+        // Les fichiers sont mis à jour avant la branche active: en cas d'échec, la
+        // zone de staging désigne toujours l'arbre de travail d'origine.
+        dvcs::THash currentCommit{};
+        RETURN_IF(!QueryHash(statements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", currentCommit), false);
+        dvcs::THash targetCommit{};
+        if (ResolveRevision(statements, branch, targetCommit))
+        {
+            dvcs::THash currentTree{};
+            dvcs::THash targetTree{};
+            std::vector<TreeChange> changes;
+            RETURN_IF(!GetCommitTree(statements, currentCommit, currentTree) || !GetCommitTree(statements, targetCommit, targetTree) ||
+                          !DiffTrees(statements, currentTree, targetTree, "../", changes),
+                      false);
+
+            // Les fichiers que le changement de branche réécrirait ou retirerait ne
+            // doivent pas avoir de modifications locales
+            std::vector<std::string_view> paths;
+            for (const auto &change : changes)
+            {
+                paths.push_back(change.m_path);
+            }
+            RETURN_IF(!ValidateNoLocalChanges(impl.m_pRepoDB, statements, repository.GetRootPath(), paths, "checkout"), false);
+
+            CheckoutCounts counts;
+            RETURN_IF(!UpdateWorkingTree(repository.GetRootPath(), changes, counts), false);
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+            const double seconds = std::max(elapsed.count(), std::numeric_limits<double>::epsilon());
+            const double megabytes = static_cast<double>(counts.m_writtenSize) / (1024.0 * 1024.0);
+            fmt::print(std::cout, "checked out '{0}': {1} files written ({2:.2f} MB), {3} removed in {4:.3f}s: {5:.2f} MB/s\n", branchName,
+                       counts.m_nbWritten, megabytes, counts.m_nbRemoved, seconds, megabytes / seconds);
+        }
+
+        return statements.Execute(
+            "BEGIN TRANSACTION;"
+            "INSERT OR REPLACE INTO Staging.Metadata (Name, Value) VALUES (\"CurrentBranch\", @branch);"
+            "INSERT OR REPLACE INTO Staging.Metadata (Name, Value) SELECT \"CurrentCommit\", HeadCommit FROM Branches WHERE Name = @branch;"
+            "END TRANSACTION;",
+            {{"@branch", branch}});
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si le commit désigné par <ancestor> est un ancêtre du commit désigné par
+// <descendant> (ou le même commit). Les révisions sont des noms de branches ou des
+// hash. La réponse est donnée par le graphe des commits (voir CommitGraph).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool IsAncestor(const std::string_view ancestor, const std::string_view descendant, bool &isAncestor) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && IsAncestor(repository, ancestor, descendant, isAncestor);
+}
+
+[[nodiscard]] bool IsAncestor(Repository &repository, const std::string_view ancestor, const std::string_view descendant, bool &isAncestor) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        std::array<TCommitId, 2> ids{};
+        RETURN_IF(!FindGraphCommits(impl.m_repoStatements, impl.m_commitGraph, repository.GetRootPath(), {ancestor, descendant}, ids), false);
+        isAncestor = impl.m_commitGraph.IsAncestor(ids[0], ids[1]);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve le plus proche ancêtre commun <mergeBase> des commits désignés par
+// <first> et <second>. Deux commits d'historiques disjoints n'en ont aucun.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FindMergeBase(const std::string_view first, const std::string_view second, std::optional<THash> &mergeBase) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && FindMergeBase(repository, first, second, mergeBase);
+}
+
+[[nodiscard]] bool FindMergeBase(Repository &repository, const std::string_view first, const std::string_view second,
+                                 std::optional<THash> &mergeBase) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        std::array<TCommitId, 2> ids{};
+        RETURN_IF(!FindGraphCommits(impl.m_repoStatements, impl.m_commitGraph, repository.GetRootPath(), {first, second}, ids), false);
+        const auto mergeBaseId = impl.m_commitGraph.FindMergeBase(ids[0], ids[1]);
+        mergeBase.reset();
+        if (mergeBaseId != NO_COMMIT)
+        {
+            mergeBase = impl.m_commitGraph.GetHash(mergeBaseId);
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Affiche, du plus récent au plus ancien, les commits désignés par
+// <options.m_range>: les ancêtres de <revision> (le commit courant par défaut) qui
+// ne sont pas des ancêtres de <base>. Les <options.m_skip> premiers commits sont
+// sautés puis au plus <options.m_maxCount> commits sont affichés.
+// Les commits sont affichés par génération décroissante (voir CommitGraph), ceux
+// des branches fusionnées compris, au fil d'un parcours des parents qui ne charge
+// pas l'historique et n'en retient que le front. Lorsque ce front se résume à un
+// seul commit, les commits suivants sont ceux de la chaîne de ses premiers
+// parents jusqu'à son plus proche commit de fusion: ceux qui sont sautés le sont
+// d'un seul coup à l'aide des pointeurs de saut du graphe. Une page coûte donc le
+// même temps peu importe le nombre de commits linéaires qui la précèdent.
+// Avec <options.m_path>, seuls les commits ayant modifié ce fichier ou ce
+// répertoire sont affichés (et sautés): le filtre des chemins modifiés de chacun
+// des commits parcourus est alors consulté (voir IsPathModified), ce qui empêche
+// de sauter ceux-ci d'un seul coup. Avec
+// <options.m_follow>, le fichier est suivi au-delà du commit qui l'a ajouté: les
+// commits précédents sont ceux qui ont modifié sa source (voir FindCopySource).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Log(const LogOptions &options) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Log(repository, options);
+}
+
+[[nodiscard]] bool Log(Repository &repository, const LogOptions &options) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        auto &statements = impl.m_repoStatements;
+        auto &graph = impl.m_commitGraph;
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        // Le chemin est relatif à la racine du dépôt
+        std::string path;
+        if (!options.m_path.empty())
+        {
+            path = fs::path{options.m_path}.lexically_normal().generic_string();
+            while (path.ends_with('/'))
+            {
+                path.pop_back();
+            }
+            if (path.empty() || (path == ".") || path.starts_with("/") || (path == "..") || path.starts_with("../"))
+            {
+                fmt::print(std::cerr, "Invalid path {}\n", options.m_path);
+                return false;
+            }
+        }
+        BloomKey pathKey{path};
+        auto storedPath = "../" + path;
+
+        const auto separatorPos = options.m_range.find("..");
+        const auto revision = (separatorPos == std::string_view::npos) ? options.m_range : options.m_range.substr(separatorPos + 2);
+        std::vector<THash> commits(1);
+        if (revision.empty())
+        {
+            // Un dépôt sans commit n'a aucun historique à afficher
+            RETURN_IF(!QueryHash(statements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", commits[0]), false);
+            RETURN_IF(ValidateNoResult(statements, "SELECT COUNT(*) FROM Commits WHERE Hash = @hash;", {{"@hash", commits[0]}}), true);
+        }
+        else if (!ResolveRevision(statements, revision, commits[0]))
+        {
+            fmt::print(std::cerr, "Unknown revision {}\n", revision);
+            return false;
+        }
+        if (separatorPos != std::string_view::npos)
+        {
+            const auto baseRevision = options.m_range.substr(0, separatorPos);
+            if (!ResolveRevision(statements, baseRevision, commits.emplace_back()))
+            {
+                fmt::print(std::cerr, "Unknown revision {}\n", baseRevision);
+                return false;
+            }
+        }
+        RETURN_IF(!UpdateCommitGraph(statements, graph, repository.GetRootPath() / dvcs::COMMIT_GRAPH_PATH, commits), false);
+
+        // L'historique est parcouru par génération décroissante, en suivant les deux
+        // parents des commits de fusion: un commit est donc toujours affiché avant
+        // ses parents. Les ancêtres d'un ancêtre de la base l'étant aussi, le
+        // parcours ne se poursuit pas au-delà de ceux-ci.
+        const auto tipId = graph.Find(commits[0]);
+        RETURN_IF(tipId == NO_COMMIT, false);
+        auto baseId = NO_COMMIT;
+        if (commits.size() == 2)
+        {
+            baseId = graph.Find(commits[1]);
+            RETURN_IF(baseId == NO_COMMIT, false);
+        }
+
+        // Un commit n'est ajouté au parcours qu'une fois, même s'il est le parent de
+        // plusieurs des commits parcourus. Ceux qui y sont ajoutés ont une génération
+        // inférieure à celle du commit parcouru: un commit d'une génération plus
+        // élevée que celles du parcours ne peut donc plus y être ajouté et est oublié.
+        std::priority_queue<std::pair<std::uint32_t, TCommitId>> pendingCommits;
+        std::set<std::pair<std::uint32_t, TCommitId>> visitedCommits;
+        const auto push = [&](TCommitId id) {
+            if (id != NO_COMMIT)
+            {
+                const auto generation = graph.GetGeneration(id);
+                if (visitedCommits.emplace(generation, id).second)
+                {
+                    pendingCommits.emplace(generation, id);
+                }
+            }
+        };
+        push(tipId);
+
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        std::size_t nbSkipped{};
+        std::size_t nbCommits{};
+        while (!pendingCommits.empty() && (nbCommits < options.m_maxCount))
+        {
+            const auto id = pendingCommits.top().second;
+            pendingCommits.pop();
+            const auto maxGeneration = pendingCommits.empty() ? 0 : pendingCommits.top().first;
+            visitedCommits.erase(visitedCommits.upper_bound({maxGeneration, NO_COMMIT}), visitedCommits.end());
+
+            // Seuls les ancêtres du dernier commit du front restent à parcourir: sans
+            // chemin, ceux de la portion linéaire de la chaîne de ses premiers parents
+            // qui doivent être sautés le sont d'un seul coup. Un ancêtre de la base
+            // sauté de la sorte l'est aussi du commit qui suit et y met fin.
+            if (path.empty() && (nbSkipped < options.m_skip) && pendingCommits.empty())
+            {
+                const auto depth = graph.GetDepth(id);
+                const auto lastMerge = graph.GetLastMerge(id);
+                const auto linearDepth = depth - ((lastMerge == NO_COMMIT) ? 0 : graph.GetDepth(lastMerge));
+                const auto nbJumped = static_cast<std::uint32_t>(std::min<std::size_t>(options.m_skip - nbSkipped, linearDepth));
+                if (nbJumped > 0)
+                {
+                    nbSkipped += nbJumped;
+                    push(graph.GetAncestor(id, depth - nbJumped));
+                    continue;
+                }
+            }
+
+            if ((baseId != NO_COMMIT) && graph.IsAncestor(id, baseId))
+            {
+                continue;
+            }
+            push(graph.GetParent(id));
+            push(graph.GetMergeParent(id));
+
+            const auto commit = graph.GetHash(id);
+            if (!path.empty())
+            {
+                bool isModified{};
+                RETURN_IF(!IsPathModified(statements, commit, pathKey, storedPath, isModified), false);
+                if (!isModified)
+                {
+                    continue;
+                }
+
+                // Les commits qui précèdent celui ayant ajouté le fichier suivi sont
+                // ceux qui ont modifié sa source
+                std::string sourcePath;
+                const auto parentCommit = (graph.GetParent(id) == NO_COMMIT) ? THash{0} : graph.GetHash(graph.GetParent(id));
+                RETURN_IF(options.m_follow &&
+                              !FindCopySource(statements, repository.GetRootPath(), parentCommit, commit, storedPath, options.m_renames, sourcePath),
+                          false);
+                if (!sourcePath.empty())
+                {
+                    storedPath = std::move(sourcePath);
+                    pathKey = BloomKey{GetDisplayPath(storedPath)};
+                }
+            }
+            if (nbSkipped++ < options.m_skip)
+            {
+                continue;
+            }
+            ++nbCommits;
+
+            RETURN_IF(!statements.Prepare("SELECT Author, Email, Message FROM Commits WHERE Hash = @commit;", pStmt), false);
+            RETURN_IF(!BindValue(pStmt, 1, commit) || (sqlite3_step(pStmt.get()) != SQLITE_ROW), false);
+            const auto author = GetColumnText(pStmt, 0);
+            const auto email = GetColumnText(pStmt, 1);
+            const auto message = GetColumnText(pStmt, 2);
+            const auto parentId = graph.GetParent(id);
+            const auto mergeParentId = graph.GetMergeParent(id);
+
+            if (options.m_format == LogFormat::JsonLines)
+            {
+                fmt::print(std::cout, "{{\"commit\":\"{}\",\"parent\":", ToHex(commit));
+                if (parentId == NO_COMMIT)
+                {
+                    std::cout << "null";
+                }
+                else
+                {
+                    fmt::print(std::cout, "\"{}\"", ToHex(graph.GetHash(parentId)));
+                }
+                if (mergeParentId != NO_COMMIT)
+                {
+                    fmt::print(std::cout, ",\"merge_parent\":\"{}\"", ToHex(graph.GetHash(mergeParentId)));
+                }
+                fmt::print(std::cout, ",\"generation\":{},\"author\":", graph.GetGeneration(id));
+                WriteJsonString(std::cout, author);
+                std::cout << ",\"email\":";
+                WriteJsonString(std::cout, email);
+                std::cout << ",\"message\":";
+                WriteJsonString(std::cout, message);
+                std::cout << "}\n";
+            }
+            else
+            {
+                fmt::print(std::cout, "commit {}\n", ToHex(commit));
+                if (mergeParentId != NO_COMMIT)
+                {
+                    fmt::print(std::cout, "Merge: {0} {1}\n", ToHex(graph.GetHash(parentId)), ToHex(graph.GetHash(mergeParentId)));
+                }
+                fmt::print(std::cout, "Author: {0} <{1}>\n\n", author, email);
+                for (std::size_t lineStart = 0; lineStart <= message.size();)
+                {
+                    const auto lineEnd = std::min(message.find('\n', lineStart), message.size());
+                    fmt::print(std::cout, "    {}\n", message.substr(lineStart, lineEnd - lineStart));
+                    lineStart = lineEnd + 1;
+                }
+                std::cout << '\n';
+            }
+            sqlite3_reset(pStmt.get());
+        }
+        std::cout.flush();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Affiche, au format unifié, les différences entre deux versions des fichiers du
+// dépôt: celles de deux commits (ou branches), ou celles d'un commit (le commit
+// courant par défaut) et de l'arbre de travail.
+// Les fichiers à comparer sont trouvés sans lire leurs données (voir DiffTrees et
+// HashWorkingFiles), puis comparés en parallèle par un bassin de fils d'exécution
+// ayant chacun sa propre connexion au dépôt. Les différences sont affichées dans
+// l'ordre des chemins d'accès au fur et à mesure qu'elles sont calculées: celles
+// des premiers fichiers apparaissent sans attendre les suivants.
+// Sur demande, un fichier ajouté semblable à un fichier retiré ou modifié est
+// présenté comme le renommage ou la copie de celui-ci (voir DetectRenames).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Diff(const DiffOptions &options) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Diff(repository, options);
+}
+
+[[nodiscard]] bool Diff(Repository &repository, const DiffOptions &options) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    try
+    {
+        auto &impl = repository.GetImpl();
+        auto &statements = impl.m_repoStatements;
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        THash oldCommit{};
+        if (options.m_oldRevision.empty())
+        {
+            RETURN_IF(!QueryHash(statements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", oldCommit), false);
+        }
+        else if (!ResolveRevision(statements, options.m_oldRevision, oldCommit))
+        {
+            fmt::print(std::cerr, "Unknown revision {}\n", options.m_oldRevision);
+            return false;
+        }
+
+        std::vector<FileDiff> fileDiffs;
+        if (options.m_newRevision.empty())
+        {
+            RETURN_IF(!GetWorkingTreeDiffs(statements, repository.GetRootPath(), oldCommit, fileDiffs), false);
+        }
+        else
+        {
+            THash newCommit{};
+            if (!ResolveRevision(statements, options.m_newRevision, newCommit))
+            {
+                fmt::print(std::cerr, "Unknown revision {}\n", options.m_newRevision);
+                return false;
+            }
+
+            RETURN_IF(!GetCommitDiffs(statements, oldCommit, newCommit, fileDiffs), false);
+        }
+        if (options.m_renames.m_detectRenames || options.m_renames.m_detectCopies || options.m_renames.m_findCopiesHarder)
+        {
+            RETURN_IF(!DetectRenames(statements, repository.GetRootPath(), oldCommit, options.m_renames, fileDiffs), false);
+        }
+
+        return WriteFileDiffs(repository.GetRootPath(), fileDiffs, options, std::cout);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fusionne dans la branche courante le commit désigné par <options.m_revision>.
+// Lorsque le commit courant est un ancêtre de celui-ci, la branche est simplement
+// avancée jusqu'à lui. Sinon, les fichiers modifiés depuis la base commune des
+// deux commits (voir CommitGraph::FindMergeBase) le sont d'un seul côté, et sont
+// alors repris de ce côté, ou des deux côtés, et sont alors fusionnés ligne par
+// ligne (voir dvcs::MergeTexts) par un bassin de fils d'exécution ayant chacun sa
+// propre connexion au dépôt.
+// Le commit fusionné et les fichiers touchés par la fusion sont consignés dans la
+// zone de staging avant que l'arbre de travail ne soit modifié: le prochain commit
+// sera le commit de fusion, qui a pour parents le commit courant et le commit
+// fusionné, et il n'est possible qu'une fois tous ces fichiers ajoutés (voir
+// Commit). Les fichiers fusionnés sans conflit sont ajoutés aussitôt et, sans
+// conflit, le commit est créé; sinon, il le sera une fois les conflits résolus et
+// les fichiers ajoutés. Un fichier binaire modifié des deux côtés est un conflit:
+// la version du commit courant est conservée jusqu'à ce qu'une version soit
+// ajoutée.
+// Un fichier ajouté d'un côté qui est la copie d'un fichier modifié de l'autre
+// côté (un fichier déplacé, par exemple) reçoit aussi ces modifications (voir
+// FindMergeCopies). Un fichier retiré d'un côté et modifié de l'autre est un
+// conflit, à moins que ces modifications n'aient été reçues par sa copie.
+// Un fichier ayant des modifications locales n'est jamais écrasé.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Merge(const MergeOptions &options) noexcept
+{
+    Repository repository;
+    return OpenCurrentRepository(repository) && Merge(repository, options);
+}
+
+[[nodiscard]] bool Merge(Repository &repository, const MergeOptions &options) noexcept
+{
+    RETURN_IF(!repository.IsOpen(), false);
+    for (const auto &arg : {options.m_revision, options.m_author, options.m_email})
+    {
+        if (arg.empty())
+        {
+            fmt::print(std::cerr, "Can't merge. Missing information\n");
+            return false;
+        }
+    }
+
+    try
+    {
+        auto &impl = repository.GetImpl();
+        auto &statements = impl.m_repoStatements;
+        auto &graph = impl.m_commitGraph;
+        const auto &rootPath = repository.GetRootPath();
+        RETURN_IF(!ValidateSchemaVersion(impl.m_pRepoDB), false);
+
+        if (!ValidateNoResult(statements, "SELECT COUNT(*) FROM Staging.Paths;") ||
+            !ValidateNoResult(statements, "SELECT COUNT(*) FROM Staging.PendingMerge;"))
+        {
+            fmt::print(std::cerr, "Can't merge. Uncommitted changes detected.\n");
+            return false;
+        }
+
+        std::string branch;
+        RETURN_IF(!GetMetadataValue(impl.m_pRepoDB, "Staging", "CurrentBranch", branch), false);
+        THash theirsCommit{};
+        if (!ResolveRevision(statements, options.m_revision, theirsCommit))
+        {
+            fmt::print(std::cerr, "Unknown revision {}\n", options.m_revision);
+            return false;
+        }
+
+        // Le commit courant d'une branche sans commit n'existe pas
+        THash oursCommit{};
+        RETURN_IF(!QueryHash(statements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", oursCommit), false);
+        const bool hasOursCommit = !ValidateNoResult(statements, "SELECT COUNT(*) FROM Commits WHERE Hash = @hash;", {{"@hash", oursCommit}});
+        std::vector<THash> commits{theirsCommit};
+        if (hasOursCommit)
+        {
+            commits.push_back(oursCommit);
+        }
+        RETURN_IF(!UpdateCommitGraph(statements, graph, rootPath / dvcs::COMMIT_GRAPH_PATH, commits), false);
+        const auto theirsId = graph.Find(theirsCommit);
+        const auto oursId = hasOursCommit ? graph.Find(oursCommit) : NO_COMMIT;
+        RETURN_IF((theirsId == NO_COMMIT) || (hasOursCommit && (oursId == NO_COMMIT)), false);
+
+        if ((oursId != NO_COMMIT) && graph.IsAncestor(theirsId, oursId))
+        {
+            fmt::print(std::cout, "already up to date\n");
+            return true;
+        }
+
+        THash oursTree{};
+        THash theirsTree{};
+        RETURN_IF(!GetCommitTree(statements, oursCommit, oursTree) || !GetCommitTree(statements, theirsCommit, theirsTree), false);
+
+        if ((oursId == NO_COMMIT) || graph.IsAncestor(oursId, theirsId))
+        {
+            // Avance rapide: l'arbre de travail est mis à jour comme par
+            // CheckoutBranch, puis la branche désigne le commit fusionné
+            std::vector<TreeChange> changes;
+            RETURN_IF(!DiffTrees(statements, oursTree, theirsTree, "../", changes), false);
+            std::vector<std::string_view> paths;
+            for (const auto &change : changes)
+            {
+                paths.push_back(change.m_path);
+            }
+            RETURN_IF(!ValidateNoLocalChanges(impl.m_pRepoDB, statements, rootPath, paths, "merge"), false);
+
+            CheckoutCounts counts;
+            RETURN_IF(!UpdateWorkingTree(rootPath, changes, counts), false);
+            RETURN_IF(!statements.Execute("BEGIN TRANSACTION;"
+                                          "INSERT OR REPLACE INTO Branches (Name, HeadCommit) VALUES (@branch, @commit);"
+                                          "INSERT OR REPLACE INTO Staging.Metadata (Name, Value) VALUES (\"CurrentCommit\", @commit);"
+                                          "END TRANSACTION;",
+                                          {{"@branch", branch}, {"@commit", theirsCommit}}),
+                      false);
+            fmt::print(std::cout, "fast-forwarded '{0}' to {1}: {2} files written\n", branch, ToHex(theirsCommit), counts.m_nbWritten);
+            return true;
+        }
+
+        THash baseTree{0};
+        const auto baseId = graph.FindMergeBase(oursId, theirsId);
+        RETURN_IF((baseId != NO_COMMIT) && !GetCommitTree(statements, graph.GetHash(baseId), baseTree), false);
+
+        std::vector<TreeChange> oursChanges;
+        std::vector<TreeChange> theirsChanges;
+        RETURN_IF(!DiffTrees(statements, baseTree, oursTree, "../", oursChanges) ||
+                      !DiffTrees(statements, baseTree, theirsTree, "../", theirsChanges),
+                  false);
+        MergePlan plan;
+        RETURN_IF(!PlanMerge(rootPath, oursChanges, theirsChanges, options.m_renames, plan), false);
+        RETURN_IF(!ValidateNoLocalChanges(impl.m_pRepoDB, statements, rootPath, plan.m_paths, "merge"), false);
+
+        // La fusion est consignée avant que l'arbre de travail ne soit touché: une
+        // fusion interrompue, même par une erreur, laisse ses fichiers à ajouter
+        {
+            const TransactionGuard transactionGuard{impl.m_pRepoDB};
+            RETURN_IF(!statements.Execute("BEGIN TRANSACTION;"
+                                          "INSERT INTO Staging.PendingMerge (CommitHash) VALUES (@commit);",
+                                          {{"@commit", theirsCommit}}),
+                      false);
+            for (const auto path : plan.m_paths)
+            {
+                RETURN_IF(!statements.Execute("INSERT OR IGNORE INTO Staging.UnmergedPaths (Path) VALUES (@path);", {{"@path", path}}), false);
+            }
+            RETURN_IF(!statements.Execute("END TRANSACTION;", {}), false);
+        }
+
+        CheckoutCounts counts;
+        std::vector<TreeChange> writtenConflicts;
+        std::copy_if(plan.m_deleteConflicts.cbegin(), plan.m_deleteConflicts.cend(), std::back_inserter(writtenConflicts),
+                     [](const TreeChange &change) { return change.m_newItem.has_value(); });
+        RETURN_IF(!UpdateWorkingTree(rootPath, plan.m_takenChanges, counts) || !UpdateWorkingTree(rootPath, writtenConflicts, counts), false);
+
+        std::vector<std::optional<FileMergeResult>> results;
+        MergeFiles(rootPath, plan.m_fileMerges, options.m_algorithm, branch, options.m_revision, results);
+
+        std::vector<fs::path> cleanPaths;
+        for (const auto &change : plan.m_takenChanges)
+        {
+            cleanPaths.emplace_back(GetDisplayPath(change.m_path));
+        }
+        std::size_t nbConflicts{};
+        for (std::size_t index = 0; index < plan.m_fileMerges.size(); ++index)
+        {
+            const auto displayPath = GetDisplayPath(plan.m_fileMerges[index].m_path);
+            if (!results[index])
+            {
+                fmt::print(std::cerr, "Can't merge '{}'\n", displayPath);
+                return false;
+            }
+            if (*results[index] == FileMergeResult::Clean)
+            {
+                cleanPaths.emplace_back(displayPath);
+                continue;
+            }
+            const auto &sourcePath = plan.m_fileMerges[index].m_sourcePath;
+            fmt::print(std::cout, "CONFLICT ({0}): Merge conflict in {1}{2}\n", (*results[index] == FileMergeResult::Conflict) ? "content" : "binary",
+                       displayPath, sourcePath.empty() ? std::string{} : fmt::format(" (copy of {})", GetDisplayPath(sourcePath)));
+            ++nbConflicts;
+        }
+        for (const auto &conflict : plan.m_deleteConflicts)
+        {
+            const std::string_view deletedIn = conflict.m_newItem ? std::string_view{branch} : options.m_revision;
+            const std::string_view modifiedIn = conflict.m_newItem ? options.m_revision : std::string_view{branch};
+            fmt::print(std::cout, "CONFLICT (modify/delete): {0} deleted in {1} and modified in {2}\n", GetDisplayPath(conflict.m_path), deletedIn,
+                       modifiedIn);
+            ++nbConflicts;
+        }
 
-        return ExecuteQuery(pDB, checkoutQuery);
+        RETURN_IF(!cleanPaths.empty() && !Add(repository, cleanPaths), false);
+        fmt::print(std::cout, "merged '{0}' into '{1}': {2} files taken, {3} merged, {4} conflicts\n", options.m_revision, branch,
+                   plan.m_takenChanges.size(), plan.m_fileMerges.size() + plan.m_deleteConflicts.size() - nbConflicts, nbConflicts);
+        if (nbConflicts > 0)
+        {
+            fmt::print(std::cerr, "Automatic merge failed; fix conflicts, add the files and commit the result.\n");
+            return false;
+        }
+        return Commit(repository, options.m_author, options.m_email, fmt::format("Merge '{0}' into '{1}'", options.m_revision, branch));
     }
     catch (const std::exception &e)
     {
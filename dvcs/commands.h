@@ -1,28 +1,178 @@
 #pragma once
 
+#include "diff.h"
+#include "hash.h"
+#include "similarity.h"
+#include "storage.h"
+
+#include <cstddef>
 #include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace dvcs
 {
 
+////////////////////////////////////////////////////////////////////////////////////
+// Dépôt DVCS ouvert.
+// Un dépôt garde ouvertes ses connexions aux bases de données du dépôt et de la
+// zone de staging ainsi que les requêtes qu'il a déjà préparées. Un processus
+// exécutant plusieurs commandes sur le même dépôt (un service, par exemple) évite
+// ainsi d'ouvrir des connexions et d'analyser les mêmes requêtes à chaque fois.
+// Un dépôt ne doit être utilisé que par un seul fil d'exécution à la fois.
+////////////////////////////////////////////////////////////////////////////////////
+class Repository
+{
+  public:
+    Repository() noexcept;
+    Repository(const Repository &) = delete;
+    Repository &operator=(const Repository &) = delete;
+    Repository(Repository &&) noexcept;
+    Repository &operator=(Repository &&) noexcept;
+    ~Repository();
+
+    [[nodiscard]] bool Open(const fs::path &rootPath) noexcept;
+    [[nodiscard]] bool IsOpen() const noexcept { return m_pImpl != nullptr; }
+    [[nodiscard]] const fs::path &GetRootPath() const noexcept { return m_rootPath; }
+
+    // Détails d'implémentation, définis avec les commandes
+    struct Impl;
+    [[nodiscard]] Impl &GetImpl() noexcept { return *m_pImpl; }
+
+  private:
+    fs::path m_rootPath;
+    std::unique_ptr<Impl> m_pImpl;
+};
+
+// Format des commits affichés par Log
+enum class LogFormat
+{
+    Medium,    // Hash, auteur et message de chaque commit, pour un humain
+    JsonLines, // Un objet JSON par commit et par ligne, pour un outil
+};
+
+// Détection des fichiers renommés ou copiés (voir dvcs::FindSimilarPairs). Un
+// fichier identique à sa source est toujours trouvé, les autres ne le sont que si
+// le nombre de sources ne dépasse pas <m_renameLimit>.
+struct RenameOptions
+{
+    bool m_detectRenames{false};
+    bool m_detectCopies{false};                                  // Implique m_detectRenames
+    bool m_findCopiesHarder{false};                              // Implique m_detectCopies: les fichiers inchangés sont aussi des sources
+    std::size_t m_threshold{DEFAULT_SIMILARITY_THRESHOLD};       // Similarité minimale, en pourcentage
+    std::size_t m_candidateLimit{DEFAULT_SIMILARITY_CANDIDATES}; // Sources comparées à chacun des fichiers
+    std::size_t m_renameLimit{DEFAULT_RENAME_LIMIT};
+};
+
+// Sélection et pagination des commits affichés par Log
+struct LogOptions
+{
+    std::string_view m_range{};                                      // [<base>..]<revision>
+    std::size_t m_skip{};                                            // Nombre de commits sautés
+    std::size_t m_maxCount{std::numeric_limits<std::size_t>::max()}; // Nombre maximal de commits affichés
+    LogFormat m_format{LogFormat::Medium};
+    std::string_view m_path{}; // Fichier ou répertoire modifié par les commits, relatif à la racine du dépôt
+    bool m_follow{false};      // Suit le fichier <m_path> jusqu'à la source dont il est une copie
+    RenameOptions m_renames{};
+};
+
+// Versions comparées par Diff et présentation des différences
+struct DiffOptions
+{
+    std::string_view m_oldRevision{}; // Commit courant si vide
+    std::string_view m_newRevision{}; // Arbre de travail si vide
+    DiffAlgorithm m_algorithm{DiffAlgorithm::Myers};
+    std::size_t m_nbContextLines{DEFAULT_DIFF_CONTEXT};
+    RenameOptions m_renames{};
+};
+
+// Commit fusionné par Merge et auteur du commit de fusion
+struct MergeOptions
+{
+    std::string_view m_revision{}; // Branche ou hash du commit fusionné
+    std::string_view m_author{};
+    std::string_view m_email{};
+    DiffAlgorithm m_algorithm{DiffAlgorithm::Myers};  // Fusion des fichiers modifiés des deux côtés
+    RenameOptions m_renames{.m_detectRenames = true}; // Fusion des fichiers renommés ou copiés d'un côté
+};
+
+// NOTE: Les commandes ne recevant pas de dépôt ouvrent celui du répertoire courant
+//       le temps de leur exécution.
+
 // Gestion locale
 [[nodiscard]] bool Add(const fs::path &filePath) noexcept;
+[[nodiscard]] bool Add(const std::vector<fs::path> &pathSpecs) noexcept;
+[[nodiscard]] bool Add(Repository &repository, const std::vector<fs::path> &pathSpecs) noexcept;
+[[nodiscard]] bool AddChanges(bool includeUntracked = true) noexcept;
+[[nodiscard]] bool AddChanges(Repository &repository, bool includeUntracked = true) noexcept;
 [[nodiscard]] bool Commit(std::string_view author, std::string_view email, std::string_view message) noexcept;
-[[nodiscard]] bool Init() noexcept;
+[[nodiscard]] bool Commit(Repository &repository, std::string_view author, std::string_view email, std::string_view message) noexcept;
+[[nodiscard]] bool Init(HashAlgorithm algorithm = HashAlgorithm::SHA1, StorageProfile profile = StorageProfile::Durable) noexcept;
+[[nodiscard]] bool Migrate() noexcept;
+[[nodiscard]] bool Migrate(Repository &repository) noexcept;
 [[nodiscard]] bool Revert() noexcept;
+[[nodiscard]] bool Revert(Repository &repository) noexcept;
+[[nodiscard]] bool Status() noexcept;
+[[nodiscard]] bool Status(Repository &repository) noexcept;
 
 // Gestion distante
-// (Limité à un path pour ce prototype)
+// (Un fichier de dépôt ou un dépôt servi par dvcsusd)
 [[nodiscard]] bool Pull() noexcept;
+[[nodiscard]] bool Pull(Repository &repository) noexcept;
 [[nodiscard]] bool Push() noexcept;
+[[nodiscard]] bool Push(Repository &repository) noexcept;
 [[nodiscard]] bool SetRemote(const fs::path &remoteRepoPath) noexcept;
+[[nodiscard]] bool SetRemote(Repository &repository, const fs::path &remoteRepoPath) noexcept;
+
+// Transfert hors ligne
+[[nodiscard]] bool CreateBundle(const fs::path &bundlePath, std::string_view range = {}) noexcept;
+[[nodiscard]] bool CreateBundle(Repository &repository, const fs::path &bundlePath, std::string_view range = {}) noexcept;
+[[nodiscard]] bool Unbundle(const fs::path &bundlePath) noexcept;
+[[nodiscard]] bool Unbundle(Repository &repository, const fs::path &bundlePath) noexcept;
+
+// Service réseau (voir dvcsusd)
+[[nodiscard]] bool ServeRemote(std::iostream &connection, const fs::path &rootPath) noexcept;
+
+// Moniteur de fichiers (voir dvcsusmon)
+[[nodiscard]] bool BeginFileMonitorSession(Repository &repository, std::string_view session) noexcept;
+[[nodiscard]] bool RecordChangedPaths(Repository &repository, const std::vector<std::string> &paths) noexcept;
+[[nodiscard]] bool EndFileMonitorSession(Repository &repository) noexcept;
+
+// Gestion du stockage
+[[nodiscard]] bool SetCompression(std::string_view settings) noexcept;
+[[nodiscard]] bool SetCompression(Repository &repository, std::string_view settings) noexcept;
+[[nodiscard]] bool SetChunking(bool isEnabled) noexcept;
+[[nodiscard]] bool SetChunking(Repository &repository, bool isEnabled) noexcept;
+[[nodiscard]] bool SetStorageProfile(StorageProfile profile) noexcept;
+[[nodiscard]] bool SetStorageProfile(Repository &repository, StorageProfile profile) noexcept;
+[[nodiscard]] bool TrainCompressionDictionary(std::size_t maxSamples = 1000) noexcept;
+[[nodiscard]] bool TrainCompressionDictionary(Repository &repository, std::size_t maxSamples = 1000) noexcept;
+
+// Historique (voir CommitGraph)
+[[nodiscard]] bool IsAncestor(std::string_view ancestor, std::string_view descendant, bool &isAncestor) noexcept;
+[[nodiscard]] bool IsAncestor(Repository &repository, std::string_view ancestor, std::string_view descendant, bool &isAncestor) noexcept;
+[[nodiscard]] bool FindMergeBase(std::string_view first, std::string_view second, std::optional<THash> &mergeBase) noexcept;
+[[nodiscard]] bool FindMergeBase(Repository &repository, std::string_view first, std::string_view second, std::optional<THash> &mergeBase) noexcept;
+[[nodiscard]] bool Log(const LogOptions &options = {}) noexcept;
+[[nodiscard]] bool Log(Repository &repository, const LogOptions &options = {}) noexcept;
+
+// Comparaison des versions des fichiers (voir DiffText)
+[[nodiscard]] bool Diff(const DiffOptions &options = {}) noexcept;
+[[nodiscard]] bool Diff(Repository &repository, const DiffOptions &options = {}) noexcept;
 
 // Gestion des branches
 [[nodiscard]] bool CreateBranch(std::string_view branchName) noexcept;
+[[nodiscard]] bool CreateBranch(Repository &repository, std::string_view branchName) noexcept;
 [[nodiscard]] bool CheckoutBranch(std::string_view branchName) noexcept;
+[[nodiscard]] bool CheckoutBranch(Repository &repository, std::string_view branchName) noexcept;
+[[nodiscard]] bool Merge(const MergeOptions &options) noexcept;
+[[nodiscard]] bool Merge(Repository &repository, const MergeOptions &options) noexcept;
 
 } // namespace dvcs
@@ -0,0 +1,621 @@
+#include "commitgraph.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// En-tête du fichier (32 octets): signature, taille des hash, nombre d'entrées de
+// la table de hachage, nombre de commits et 8 octets réservés.
+// NOTE: Les entiers sont petit-boutistes. La signature comprend la version du
+//       format: un fichier d'une autre version est simplement reconstruit.
+constexpr const std::string_view GRAPH_SIGNATURE = "DVCSCG02";
+constexpr const std::size_t HASH_SIZE_OFFSET = 8;
+constexpr const std::size_t CAPACITY_OFFSET = 12;
+constexpr const std::size_t NB_COMMITS_OFFSET = 16;
+constexpr const std::size_t HEADER_SIZE = 32;
+
+// Champs d'un commit, à la suite de son hash: parent, commit fusionné, profondeur,
+// génération, saut et plus proche fusion
+constexpr const std::size_t RECORD_FIELDS_SIZE = 24;
+constexpr const std::size_t PARENT_OFFSET = 0;
+constexpr const std::size_t MERGE_PARENT_OFFSET = 4;
+constexpr const std::size_t DEPTH_OFFSET = 8;
+constexpr const std::size_t GENERATION_OFFSET = 12;
+constexpr const std::size_t JUMP_OFFSET = 16;
+constexpr const std::size_t LAST_MERGE_OFFSET = 20;
+
+// Entrée libre de la table de hachage
+constexpr const dvcs::TCommitId EMPTY_SLOT = dvcs::NO_COMMIT;
+
+// Nombre minimal d'entrées de la table de hachage. La table compte toujours au
+// moins deux fois plus d'entrées que de commits.
+constexpr const std::uint32_t MIN_CAPACITY = 1024;
+
+[[nodiscard]] std::uint32_t LoadU32(const std::uint8_t *pBytes) noexcept
+{
+    return static_cast<std::uint32_t>(pBytes[0]) | (static_cast<std::uint32_t>(pBytes[1]) << 8U) |
+           (static_cast<std::uint32_t>(pBytes[2]) << 16U) | (static_cast<std::uint32_t>(pBytes[3]) << 24U);
+}
+
+[[nodiscard]] std::uint64_t LoadU64(const std::uint8_t *pBytes) noexcept
+{
+    return static_cast<std::uint64_t>(LoadU32(pBytes)) | (static_cast<std::uint64_t>(LoadU32(pBytes + 4)) << 32U);
+}
+
+void StoreU32(std::uint8_t *pBytes, std::uint32_t value) noexcept
+{
+    for (std::size_t index = 0; index < 4; ++index)
+    {
+        pBytes[index] = static_cast<std::uint8_t>(value >> (8U * index));
+    }
+}
+
+void StoreU64(std::uint8_t *pBytes, std::uint64_t value) noexcept
+{
+    StoreU32(pBytes, static_cast<std::uint32_t>(value));
+    StoreU32(pBytes + 4, static_cast<std::uint32_t>(value >> 32U));
+}
+
+// Première entrée de la table de hachage à examiner pour le hash <pHash>. Les
+// hash étant uniformément distribués, leurs premiers octets suffisent.
+[[nodiscard]] std::uint32_t GetFirstSlot(const std::uint8_t *pHash, std::uint32_t capacity) noexcept
+{
+    return LoadU32(pHash) & (capacity - 1);
+}
+
+[[nodiscard]] bool WriteAt(int descriptor, const void *pData, std::size_t size, std::size_t offset) noexcept
+{
+    const auto *pBytes = static_cast<const std::uint8_t *>(pData);
+    while (size > 0)
+    {
+        const auto nbWritten = ::pwrite(descriptor, pBytes, size, static_cast<off_t>(offset));
+        if (nbWritten < 0)
+        {
+            RETURN_IF(errno != EINTR, false);
+            continue;
+        }
+        pBytes += nbWritten;
+        size -= static_cast<std::size_t>(nbWritten);
+        offset += static_cast<std::size_t>(nbWritten);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ferme un descripteur de fichier à la sortie de sa portée (et libère du même
+// coup le verrou posé sur celui-ci)
+////////////////////////////////////////////////////////////////////////////////////
+class DescriptorGuard
+{
+  public:
+    explicit DescriptorGuard(int descriptor) noexcept : m_descriptor{descriptor} {}
+    DescriptorGuard(const DescriptorGuard &) = delete;
+    DescriptorGuard &operator=(const DescriptorGuard &) = delete;
+    ~DescriptorGuard() { ::close(m_descriptor); }
+
+  private:
+    int m_descriptor;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Commit en cours d'ajout au graphe
+////////////////////////////////////////////////////////////////////////////////////
+struct NewCommit
+{
+    dvcs::THash m_hash{};
+    dvcs::TCommitId m_parent{dvcs::NO_COMMIT};
+    dvcs::TCommitId m_mergeParent{dvcs::NO_COMMIT};
+    std::uint32_t m_depth{};
+    std::uint32_t m_generation{};
+    dvcs::TCommitId m_jump{};
+    dvcs::TCommitId m_lastMerge{dvcs::NO_COMMIT};
+};
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] bool CommitGraph::Open(const fs::path &graphPath, std::size_t hashSize) noexcept
+{
+    Close();
+    try
+    {
+        m_graphPath = graphPath;
+        m_hashSize = hashSize;
+
+        const int descriptor = ::open(graphPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+        {
+            RETURN_IF(errno == ENOENT, true);
+            fmt::print(std::cerr, "Can't open commit graph '{}'\n", graphPath.string());
+            return false;
+        }
+        const DescriptorGuard descriptorGuard{descriptor};
+        return Map(descriptor);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+void CommitGraph::Close() noexcept
+{
+    Unmap();
+    m_graphPath.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Projette en mémoire le fichier ouvert <descriptor>. Un fichier vide ou invalide
+// donne un graphe vide.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CommitGraph::Map(int descriptor) noexcept
+{
+    Unmap();
+
+    struct stat fileStat
+    {
+    };
+    RETURN_IF(::fstat(descriptor, &fileStat) != 0, false);
+    const auto fileSize = static_cast<std::size_t>(fileStat.st_size);
+    RETURN_IF(fileSize < HEADER_SIZE, true);
+
+    void *pMapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (pMapping == MAP_FAILED)
+    {
+        fmt::print(std::cerr, "Can't map commit graph '{}'\n", m_graphPath.string());
+        return false;
+    }
+    m_pData = static_cast<const std::uint8_t *>(pMapping);
+    m_mappedSize = fileSize;
+
+    const auto capacity = LoadU32(m_pData + CAPACITY_OFFSET);
+    const auto nbCommits = LoadU64(m_pData + NB_COMMITS_OFFSET);
+    const bool isValid = (std::memcmp(m_pData, GRAPH_SIGNATURE.data(), GRAPH_SIGNATURE.size()) == 0) &&
+                         (LoadU32(m_pData + HASH_SIZE_OFFSET) == m_hashSize) && std::has_single_bit(capacity) &&
+                         (nbCommits * 2 <= capacity) &&
+                         (HEADER_SIZE + (capacity * sizeof(TCommitId)) + (nbCommits * (m_hashSize + RECORD_FIELDS_SIZE)) <= fileSize);
+    if (!isValid)
+    {
+        Unmap();
+        return true;
+    }
+    m_capacity = capacity;
+    m_nbCommits = static_cast<std::size_t>(nbCommits);
+    return true;
+}
+
+void CommitGraph::Unmap() noexcept
+{
+    if (m_pData != nullptr)
+    {
+        ::munmap(const_cast<std::uint8_t *>(m_pData), m_mappedSize);
+    }
+    m_pData = nullptr;
+    m_mappedSize = 0;
+    m_capacity = 0;
+    m_nbCommits = 0;
+}
+
+[[nodiscard]] const std::uint8_t *CommitGraph::GetRecord(TCommitId id) const noexcept
+{
+    return m_pData + HEADER_SIZE + (static_cast<std::size_t>(m_capacity) * sizeof(TCommitId)) +
+           (static_cast<std::size_t>(id) * (m_hashSize + RECORD_FIELDS_SIZE));
+}
+
+[[nodiscard]] TCommitId CommitGraph::Find(const THash &commit) const noexcept
+{
+    RETURN_IF((m_nbCommits == 0) || (commit.size() != m_hashSize), NO_COMMIT);
+
+    // NOTE: Les entrées désignant un commit au-delà de ceux de l'en-tête (écrites
+    //       par un ajout en cours ou interrompu) sont ignorées
+    const auto *pTable = m_pData + HEADER_SIZE;
+    auto slot = GetFirstSlot(commit.data(), m_capacity);
+    for (std::uint32_t iProbe = 0; iProbe < m_capacity; ++iProbe, slot = (slot + 1) & (m_capacity - 1))
+    {
+        const auto id = LoadU32(pTable + (static_cast<std::size_t>(slot) * sizeof(TCommitId)));
+        RETURN_IF(id == EMPTY_SLOT, NO_COMMIT);
+        if ((id < m_nbCommits) && (std::memcmp(GetRecord(id), commit.data(), m_hashSize) == 0))
+        {
+            return id;
+        }
+    }
+    return NO_COMMIT;
+}
+
+[[nodiscard]] THash CommitGraph::GetHash(TCommitId id) const noexcept
+{
+    THash hash{m_hashSize};
+    std::memcpy(hash.data(), GetRecord(id), m_hashSize);
+    return hash;
+}
+
+[[nodiscard]] TCommitId CommitGraph::GetParent(TCommitId id) const noexcept { return LoadU32(GetRecord(id) + m_hashSize + PARENT_OFFSET); }
+
+[[nodiscard]] TCommitId CommitGraph::GetMergeParent(TCommitId id) const noexcept
+{
+    return LoadU32(GetRecord(id) + m_hashSize + MERGE_PARENT_OFFSET);
+}
+
+[[nodiscard]] std::uint32_t CommitGraph::GetDepth(TCommitId id) const noexcept { return LoadU32(GetRecord(id) + m_hashSize + DEPTH_OFFSET); }
+
+[[nodiscard]] std::uint32_t CommitGraph::GetGeneration(TCommitId id) const noexcept
+{
+    return LoadU32(GetRecord(id) + m_hashSize + GENERATION_OFFSET);
+}
+
+[[nodiscard]] TCommitId CommitGraph::GetJump(TCommitId id) const noexcept { return LoadU32(GetRecord(id) + m_hashSize + JUMP_OFFSET); }
+
+[[nodiscard]] TCommitId CommitGraph::GetLastMerge(TCommitId id) const noexcept
+{
+    return LoadU32(GetRecord(id) + m_hashSize + LAST_MERGE_OFFSET);
+}
+
+[[nodiscard]] TCommitId CommitGraph::GetAncestor(TCommitId id, std::uint32_t depth) const noexcept
+{
+    RETURN_IF((depth == 0) || (depth > GetDepth(id)), NO_COMMIT);
+    while (GetDepth(id) > depth)
+    {
+        const auto jump = GetJump(id);
+        id = (GetDepth(jump) >= depth) ? jump : GetParent(id);
+    }
+    return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les commits situés entre un commit et le plus proche commit de fusion de la
+// chaîne de ses premiers parents n'ont qu'un parent: chacune de ces portions de
+// chaîne est donc vérifiée d'un seul coup à l'aide des pointeurs de saut, et le
+// parcours ne reprend qu'aux parents des commits de fusion. Un commit d'une
+// génération inférieure ou égale à celle de l'ancêtre cherché ne peut mener à
+// celui-ci.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CommitGraph::IsAncestor(TCommitId ancestor, TCommitId descendant) const noexcept
+{
+    RETURN_IF(ancestor == descendant, true);
+    const auto generation = GetGeneration(ancestor);
+    const auto depth = GetDepth(ancestor);
+
+    std::vector<TCommitId> pendingCommits{descendant};
+    std::unordered_set<TCommitId> visitedCommits{descendant};
+    while (!pendingCommits.empty())
+    {
+        const auto id = pendingCommits.back();
+        pendingCommits.pop_back();
+        RETURN_IF(id == ancestor, true);
+        if (GetGeneration(id) <= generation)
+        {
+            continue;
+        }
+        RETURN_IF((GetDepth(id) >= depth) && (GetAncestor(id, depth) == ancestor), true);
+
+        const auto lastMerge = GetLastMerge(id);
+        if ((lastMerge != NO_COMMIT) && (GetGeneration(lastMerge) > generation))
+        {
+            for (const auto parent : {GetParent(lastMerge), GetMergeParent(lastMerge)})
+            {
+                if ((parent != NO_COMMIT) && visitedCommits.insert(parent).second)
+                {
+                    pendingCommits.push_back(parent);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Plus proche ancêtre commun des deux commits sur les chaînes de leurs premiers
+// parents, NO_COMMIT s'ils n'en ont aucun
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] TCommitId CommitGraph::FindFirstParentMergeBase(TCommitId first, TCommitId second) const noexcept
+{
+    auto depth = std::min(GetDepth(first), GetDepth(second));
+    first = GetAncestor(first, depth);
+    second = GetAncestor(second, depth);
+
+    // Deux commits d'une même profondeur ont des pointeurs de saut menant à une
+    // même profondeur: les deux commits remontent donc de concert, en sautant
+    // tant que cela ne mène pas à un ancêtre commun
+    while (first != second)
+    {
+        const auto firstJump = GetJump(first);
+        const auto secondJump = GetJump(second);
+        if ((firstJump != secondJump) && (GetDepth(firstJump) < depth))
+        {
+            first = firstJump;
+            second = secondJump;
+        }
+        else
+        {
+            first = GetParent(first);
+            second = GetParent(second);
+            RETURN_IF((first == NO_COMMIT) || (second == NO_COMMIT), NO_COMMIT);
+        }
+        depth = GetDepth(first);
+    }
+    return first;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lorsque les chaînes des premiers parents des deux commits ne comptent aucune
+// fusion au-dessus de leur plus proche ancêtre commun, les autres ancêtres des
+// commits sont ceux de celui-ci: il est donc leur base commune.
+// Sinon, les ancêtres des deux commits sont marqués par génération décroissante
+// (comme le fait git). Un commit n'est examiné qu'une fois que tous ses
+// descendants parcourus l'ont été: le premier à être marqué par les deux commits
+// est donc l'ancêtre commun de plus haute génération.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] TCommitId CommitGraph::FindMergeBase(TCommitId first, TCommitId second) const noexcept
+{
+    RETURN_IF(first == second, first);
+    const auto firstParentBase = FindFirstParentMergeBase(first, second);
+    const auto baseDepth = (firstParentBase == NO_COMMIT) ? 0 : GetDepth(firstParentBase);
+    const auto isLinear = [&](TCommitId id) {
+        const auto lastMerge = GetLastMerge(id);
+        return (lastMerge == NO_COMMIT) || (GetDepth(lastMerge) <= baseDepth);
+    };
+    RETURN_IF(isLinear(first) && isLinear(second), firstParentBase);
+
+    constexpr const std::uint8_t FROM_FIRST = 1;
+    constexpr const std::uint8_t FROM_SECOND = 2;
+    constexpr const std::uint8_t FROM_BOTH = FROM_FIRST | FROM_SECOND;
+    std::unordered_map<TCommitId, std::uint8_t> marks;
+    std::priority_queue<std::pair<std::uint32_t, TCommitId>> pendingCommits;
+    const auto mark = [&](TCommitId id, std::uint8_t from) {
+        if (id == NO_COMMIT)
+        {
+            return;
+        }
+        auto &commitMarks = marks[id];
+        if (commitMarks == 0)
+        {
+            pendingCommits.emplace(GetGeneration(id), id);
+        }
+        commitMarks |= from;
+    };
+
+    mark(first, FROM_FIRST);
+    mark(second, FROM_SECOND);
+    while (!pendingCommits.empty())
+    {
+        const auto id = pendingCommits.top().second;
+        pendingCommits.pop();
+        const auto from = marks[id];
+        RETURN_IF(from == FROM_BOTH, id);
+        mark(GetParent(id), from);
+        mark(GetMergeParent(id), from);
+    }
+    return NO_COMMIT;
+}
+
+[[nodiscard]] bool CommitGraph::Append(const std::vector<GraphCommit> &commits) noexcept
+{
+    RETURN_IF(!IsOpen(), false);
+    try
+    {
+        // Les ajouts sont sérialisés à l'aide d'un verrou sur le fichier. Comme
+        // celui-ci a pu être remplacé pendant l'attente du verrou, le fichier
+        // verrouillé doit toujours être celui qui se trouve à son emplacement.
+        int descriptor = -1;
+        for (;;)
+        {
+            descriptor = ::open(m_graphPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (descriptor < 0)
+            {
+                fmt::print(std::cerr, "Can't open commit graph '{}'\n", m_graphPath.string());
+                return false;
+            }
+
+            struct stat descriptorStat
+            {
+            };
+            struct stat pathStat
+            {
+            };
+            int lockResult{};
+            while (((lockResult = ::flock(descriptor, LOCK_EX)) != 0) && (errno == EINTR))
+            {
+            }
+            if ((lockResult == 0) && (::fstat(descriptor, &descriptorStat) == 0) && (::stat(m_graphPath.c_str(), &pathStat) == 0) &&
+                (descriptorStat.st_dev == pathStat.st_dev) && (descriptorStat.st_ino == pathStat.st_ino))
+            {
+                break;
+            }
+            ::close(descriptor);
+            RETURN_IF(lockResult != 0, false);
+        }
+        const DescriptorGuard descriptorGuard{descriptor};
+        RETURN_IF(!Map(descriptor), false);
+
+        std::vector<NewCommit> newCommits;
+        std::unordered_map<THash, TCommitId, HashHasher> newIds;
+        const auto getCommit = [&](TCommitId id) {
+            return (id < m_nbCommits)
+                       ? NewCommit{{}, GetParent(id), GetMergeParent(id), GetDepth(id), GetGeneration(id), GetJump(id), GetLastMerge(id)}
+                       : newCommits[id - m_nbCommits];
+        };
+        const auto findParent = [&](const THash &commitHash, const THash &parentHash, TCommitId &parent) {
+            parent = Find(parentHash);
+            if (parent == NO_COMMIT)
+            {
+                const auto parentIt = newIds.find(parentHash);
+                if (parentIt == newIds.end())
+                {
+                    fmt::print(std::cerr, "Parent of commit {} is missing from the commit graph\n", ToHex(commitHash));
+                    return false;
+                }
+                parent = parentIt->second;
+            }
+            return true;
+        };
+        for (const auto &[hash, parentHash, mergeParentHash] : commits)
+        {
+            RETURN_IF(hash.size() != m_hashSize, false);
+            if ((Find(hash) != NO_COMMIT) || newIds.contains(hash))
+            {
+                continue;
+            }
+
+            const auto id = static_cast<TCommitId>(m_nbCommits + newCommits.size());
+            RETURN_IF(id == NO_COMMIT, false);
+            NewCommit commit{hash, NO_COMMIT, NO_COMMIT, 1, 1, id, NO_COMMIT};
+            if (parentHash.size() != 0)
+            {
+                RETURN_IF(!findParent(hash, parentHash, commit.m_parent), false);
+
+                // Le saut d'un commit mène à celui de son parent lorsque les deux
+                // sauts précédents sont de même longueur (ils sont alors fusionnés),
+                // sinon à son parent
+                const auto parent = getCommit(commit.m_parent);
+                const auto jump = getCommit(parent.m_jump);
+                const auto jumpTarget = getCommit(jump.m_jump);
+                commit.m_depth = parent.m_depth + 1;
+                commit.m_generation = parent.m_generation + 1;
+                commit.m_jump = ((parent.m_depth - jump.m_depth) == (jump.m_depth - jumpTarget.m_depth)) ? jump.m_jump : commit.m_parent;
+                commit.m_lastMerge = parent.m_lastMerge;
+            }
+            if (mergeParentHash.size() != 0)
+            {
+                RETURN_IF(!findParent(hash, mergeParentHash, commit.m_mergeParent), false);
+                commit.m_generation = std::max(commit.m_generation, getCommit(commit.m_mergeParent).m_generation + 1);
+                commit.m_lastMerge = id;
+            }
+            newIds.emplace(hash, id);
+            newCommits.push_back(commit);
+        }
+        RETURN_IF(newCommits.empty(), true);
+
+        const auto recordSize = m_hashSize + RECORD_FIELDS_SIZE;
+        std::vector<std::uint8_t> records(newCommits.size() * recordSize);
+        for (std::size_t index = 0; index < newCommits.size(); ++index)
+        {
+            auto *pRecord = records.data() + (index * recordSize);
+            std::memcpy(pRecord, newCommits[index].m_hash.data(), m_hashSize);
+            StoreU32(pRecord + m_hashSize + PARENT_OFFSET, newCommits[index].m_parent);
+            StoreU32(pRecord + m_hashSize + MERGE_PARENT_OFFSET, newCommits[index].m_mergeParent);
+            StoreU32(pRecord + m_hashSize + DEPTH_OFFSET, newCommits[index].m_depth);
+            StoreU32(pRecord + m_hashSize + GENERATION_OFFSET, newCommits[index].m_generation);
+            StoreU32(pRecord + m_hashSize + JUMP_OFFSET, newCommits[index].m_jump);
+            StoreU32(pRecord + m_hashSize + LAST_MERGE_OFFSET, newCommits[index].m_lastMerge);
+        }
+
+        const auto nbCommits = m_nbCommits + newCommits.size();
+        if ((m_pData == nullptr) || (nbCommits * 2 > m_capacity))
+        {
+            // La table de hachage doit grandir: le fichier est réécrit au complet,
+            // puis remplace l'ancien d'un coup
+            const auto capacity = std::max(MIN_CAPACITY, std::bit_ceil(static_cast<std::uint32_t>(nbCommits * 4)));
+            const auto tableSize = static_cast<std::size_t>(capacity) * sizeof(TCommitId);
+            std::vector<std::uint8_t> graphData(HEADER_SIZE + tableSize + (nbCommits * recordSize), 0);
+            std::memcpy(graphData.data(), GRAPH_SIGNATURE.data(), GRAPH_SIGNATURE.size());
+            StoreU32(graphData.data() + HASH_SIZE_OFFSET, static_cast<std::uint32_t>(m_hashSize));
+            StoreU32(graphData.data() + CAPACITY_OFFSET, capacity);
+            StoreU64(graphData.data() + NB_COMMITS_OFFSET, nbCommits);
+
+            auto *pTable = graphData.data() + HEADER_SIZE;
+            auto *pRecords = pTable + tableSize;
+            std::fill(pTable, pRecords, std::uint8_t{0xFF});
+            if (m_nbCommits > 0)
+            {
+                std::memcpy(pRecords, GetRecord(0), m_nbCommits * recordSize);
+            }
+            std::memcpy(pRecords + (m_nbCommits * recordSize), records.data(), records.size());
+            for (TCommitId id = 0; id < nbCommits; ++id)
+            {
+                auto slot = GetFirstSlot(pRecords + (static_cast<std::size_t>(id) * recordSize), capacity);
+                while (LoadU32(pTable + (static_cast<std::size_t>(slot) * sizeof(TCommitId))) != EMPTY_SLOT)
+                {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                StoreU32(pTable + (static_cast<std::size_t>(slot) * sizeof(TCommitId)), id);
+            }
+
+            const auto tempPath = fs::path{m_graphPath}.concat(".tmp");
+            {
+                std::ofstream graphFile{tempPath, std::ios::out | std::ios::binary | std::ios::trunc};
+                if (!graphFile.write(reinterpret_cast<const char *>(graphData.data()), static_cast<std::streamsize>(graphData.size())) ||
+                    !graphFile.flush())
+                {
+                    fmt::print(std::cerr, "Can't write commit graph '{}'\n", tempPath.string());
+                    return false;
+                }
+            }
+            fs::rename(tempPath, m_graphPath);
+        }
+        else
+        {
+            // Les commits et leurs entrées sont écrits avant l'en-tête: une entrée
+            // laissée par un ajout interrompu désigne un commit au-delà de ceux de
+            // l'en-tête et peut donc être réutilisée
+            const auto *pTable = m_pData + HEADER_SIZE;
+            const auto recordsOffset = HEADER_SIZE + (static_cast<std::size_t>(m_capacity) * sizeof(TCommitId));
+            RETURN_IF(!WriteAt(descriptor, records.data(), records.size(), recordsOffset + (m_nbCommits * recordSize)), false);
+
+            std::unordered_map<std::uint32_t, TCommitId> usedSlots;
+            for (std::size_t index = 0; index < newCommits.size(); ++index)
+            {
+                auto slot = GetFirstSlot(newCommits[index].m_hash.data(), m_capacity);
+                for (;; slot = (slot + 1) & (m_capacity - 1))
+                {
+                    const auto id = LoadU32(pTable + (static_cast<std::size_t>(slot) * sizeof(TCommitId)));
+                    if (((id == EMPTY_SLOT) || (id >= m_nbCommits)) && !usedSlots.contains(slot))
+                    {
+                        break;
+                    }
+                }
+
+                const auto id = static_cast<TCommitId>(m_nbCommits + index);
+                std::array<std::uint8_t, sizeof(TCommitId)> slotData{};
+                StoreU32(slotData.data(), id);
+                RETURN_IF(!WriteAt(descriptor, slotData.data(), slotData.size(), HEADER_SIZE + (static_cast<std::size_t>(slot) * sizeof(TCommitId))),
+                          false);
+                usedSlots.emplace(slot, id);
+            }
+
+            std::array<std::uint8_t, sizeof(std::uint64_t)> nbCommitsData{};
+            StoreU64(nbCommitsData.data(), nbCommits);
+            RETURN_IF(!WriteAt(descriptor, nbCommitsData.data(), nbCommitsData.size(), NB_COMMITS_OFFSET), false);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+
+    // Le graphe est projeté à nouveau pour inclure les commits ajoutés
+    const auto graphPath = m_graphPath;
+    return Open(graphPath, m_hashSize);
+}
+
+} // namespace dvcs
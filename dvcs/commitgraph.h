@@ -0,0 +1,111 @@
+#pragma once
+
+#include "hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+// Identifiant d'un commit au sein du graphe des commits: sa position dans celui-ci
+using TCommitId = std::uint32_t;
+
+// Identifiant d'un commit absent du graphe (ou du parent d'un commit racine)
+constexpr const TCommitId NO_COMMIT = std::numeric_limits<TCommitId>::max();
+
+////////////////////////////////////////////////////////////////////////////////////
+// Commit ajouté au graphe, avec son parent et, pour un commit de fusion, le commit
+// fusionné (des hash vides sinon)
+////////////////////////////////////////////////////////////////////////////////////
+struct GraphCommit
+{
+    THash m_hash{};
+    THash m_parent{0};
+    THash m_mergeParent{0};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Graphe des commits d'un dépôt, stocké dans un fichier projeté en mémoire.
+// Un commit y est identifié par un entier dense (TCommitId), attribué dans l'ordre
+// d'ajout: ses parents le précèdent donc toujours. Chacun des commits a son hash,
+// son premier parent, le commit qu'il a fusionné (s'il y a lieu), sa profondeur
+// (le nombre de commits de la chaîne de ses premiers parents, lui compris), sa
+// génération (1 pour un commit racine, un de plus que le plus élevé de ses parents
+// sinon), un pointeur de saut vers l'un de ses premiers ancêtres et le plus proche
+// commit de fusion de la chaîne de ses premiers parents.
+// Les pointeurs de saut forment une liste à accès aléatoire en binaire oblique
+// (Myers, 1983): l'ancêtre d'un commit à une profondeur donnée se trouve en
+// O(log n) sauts. Tant que les chaînes de premiers parents de deux commits ne
+// comptent aucune fusion, les requêtes d'ascendance et de base commune se font
+// donc aussi en O(log n) sauts. Sinon, elles parcourent les ancêtres par
+// génération décroissante, sans descendre sous la génération de la réponse.
+// Le fichier contient, après son en-tête, une table de hachage (à adressage
+// ouvert) des identifiants selon le hash des commits, puis les commits dans
+// l'ordre de leurs identifiants. Un ajout écrit les nouveaux commits à la fin du
+// fichier et leurs entrées dans la table, puis le nombre de commits de l'en-tête:
+// un lecteur ne voit donc que des commits complets. Le fichier n'est réécrit au
+// complet que lorsque la table doit grandir.
+// NOTE: Le graphe est un cache: un fichier absent, invalide ou d'une autre version
+//       est vide, et il est reconstruit au prochain ajout.
+////////////////////////////////////////////////////////////////////////////////////
+class CommitGraph
+{
+  public:
+    CommitGraph() noexcept = default;
+    CommitGraph(const CommitGraph &) = delete;
+    CommitGraph &operator=(const CommitGraph &) = delete;
+    ~CommitGraph() { Close(); }
+
+    // Projette en mémoire le graphe stocké à <graphPath>, dont les commits sont
+    // identifiés par des hash de <hashSize> octets
+    [[nodiscard]] bool Open(const fs::path &graphPath, std::size_t hashSize) noexcept;
+    void Close() noexcept;
+    [[nodiscard]] bool IsOpen() const noexcept { return !m_graphPath.empty(); }
+
+    [[nodiscard]] std::size_t GetNbCommits() const noexcept { return m_nbCommits; }
+    [[nodiscard]] TCommitId Find(const THash &commit) const noexcept;
+    [[nodiscard]] THash GetHash(TCommitId id) const noexcept;
+    [[nodiscard]] TCommitId GetParent(TCommitId id) const noexcept;
+    [[nodiscard]] TCommitId GetMergeParent(TCommitId id) const noexcept;
+    [[nodiscard]] std::uint32_t GetDepth(TCommitId id) const noexcept;
+    [[nodiscard]] std::uint32_t GetGeneration(TCommitId id) const noexcept;
+    // Plus proche commit de fusion de la chaîne des premiers parents du commit
+    // <id> (le commit lui-même compris), NO_COMMIT s'il n'y en a aucun
+    [[nodiscard]] TCommitId GetLastMerge(TCommitId id) const noexcept;
+
+    // Ancêtre du commit <id> (le commit lui-même compris) à la profondeur <depth>
+    // sur la chaîne de ses premiers parents. La profondeur ne peut dépasser celle
+    // du commit.
+    [[nodiscard]] TCommitId GetAncestor(TCommitId id, std::uint32_t depth) const noexcept;
+    [[nodiscard]] bool IsAncestor(TCommitId ancestor, TCommitId descendant) const noexcept;
+    // Ancêtre commun des deux commits qui n'est l'ancêtre d'aucun autre (celui de
+    // plus haute génération s'il y en a plusieurs), NO_COMMIT s'ils n'en ont aucun
+    [[nodiscard]] TCommitId FindMergeBase(TCommitId first, TCommitId second) const noexcept;
+
+    // Ajoute au graphe les commits <commits>. Les parents d'un commit doivent déjà
+    // faire partie du graphe ou le précéder dans <commits>. Les commits déjà
+    // présents, ajoutés par exemple par un autre processus, sont ignorés.
+    [[nodiscard]] bool Append(const std::vector<GraphCommit> &commits) noexcept;
+
+  private:
+    [[nodiscard]] bool Map(int descriptor) noexcept;
+    void Unmap() noexcept;
+    [[nodiscard]] const std::uint8_t *GetRecord(TCommitId id) const noexcept;
+    [[nodiscard]] TCommitId GetJump(TCommitId id) const noexcept;
+    [[nodiscard]] TCommitId FindFirstParentMergeBase(TCommitId first, TCommitId second) const noexcept;
+
+    fs::path m_graphPath;
+    std::size_t m_hashSize{};
+    const std::uint8_t *m_pData{nullptr};
+    std::size_t m_mappedSize{};
+    std::uint32_t m_capacity{}; // Nombre d'entrées de la table de hachage
+    std::size_t m_nbCommits{};
+};
+
+} // namespace dvcs
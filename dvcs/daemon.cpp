@@ -0,0 +1,90 @@
+#include "daemon.h"
+#include "commands.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <cerrno>
+#include <iostream>
+#include <utility>
+
+namespace dvcs
+{
+
+Daemon::Daemon(fs::path rootPath) noexcept : m_rootPath{std::move(rootPath)} {}
+
+Daemon::~Daemon()
+{
+    Stop();
+    if (!m_address.m_socketPath.empty() && m_listener.IsValid())
+    {
+        ::unlink(m_address.m_socketPath.c_str());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ouvre le socket à l'écoute de <address> sur lequel les clients se connecteront
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool Daemon::Listen(const NetworkAddress &address) noexcept
+{
+    if (!ListenOn(address, m_listener, m_port))
+    {
+        fmt::print(std::cerr, "Can't listen on {}\n", address.m_socketPath.empty() ? fmt::format("{}:{}", address.m_host, address.m_port)
+                                                                                      : address.m_socketPath);
+        return false;
+    }
+    m_address = address;
+    return true;
+}
+
+void Daemon::Run() noexcept
+{
+    while (!m_isStopping)
+    {
+        const int descriptor = ::accept4(m_listener.Get(), nullptr, nullptr, SOCK_CLOEXEC);
+        if (descriptor < 0)
+        {
+            // Stop ferme le socket d'écoute pour interrompre l'attente
+            if ((errno == EINTR) || (errno == ECONNABORTED))
+            {
+                continue;
+            }
+            break;
+        }
+
+        // Les connexions terminées sont oubliées au fil de l'eau
+        m_connections.remove_if([](const std::unique_ptr<Connection> &pConnection) { return pConnection->m_isDone.load(); });
+
+        try
+        {
+            auto &pConnection = m_connections.emplace_back(std::make_unique<Connection>());
+            pConnection->m_thread = std::jthread{[this, pState = pConnection.get(), descriptor]() {
+                SocketStream connection{SocketHandle{descriptor}};
+                static_cast<void>(ServeRemote(connection, m_rootPath));
+                pState->m_isDone = true;
+            }};
+        }
+        catch (const std::exception &e)
+        {
+            ::close(descriptor);
+            fmt::print(std::cerr, "{}\n", e.what());
+        }
+    }
+
+    // Les jthread attendent la fin de leur connexion
+    m_connections.clear();
+}
+
+void Daemon::Stop() noexcept
+{
+    m_isStopping = true;
+    if (m_listener.IsValid())
+    {
+        ::shutdown(m_listener.Get(), SHUT_RDWR);
+    }
+}
+
+} // namespace dvcs
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "network.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Service réseau servant les dépôts se trouvant sous un répertoire racine.
+// Chaque connexion est servie par son propre fil d'exécution, avec ses propres
+// connexions aux bases de données: SQLite se charge de sérialiser les écritures.
+////////////////////////////////////////////////////////////////////////////////////
+class Daemon
+{
+  public:
+    explicit Daemon(fs::path rootPath) noexcept;
+    Daemon(const Daemon &) = delete;
+    Daemon &operator=(const Daemon &) = delete;
+    ~Daemon();
+
+    [[nodiscard]] bool Listen(const NetworkAddress &address) noexcept;
+    [[nodiscard]] std::uint16_t GetPort() const noexcept { return m_port; }
+
+    // Accepte les connexions jusqu'à l'appel de Stop, puis attend la fin de
+    // celles en cours
+    void Run() noexcept;
+
+    // Peut être appelé de n'importe quel fil d'exécution
+    void Stop() noexcept;
+
+  private:
+    struct Connection
+    {
+        std::atomic<bool> m_isDone{false};
+        std::jthread m_thread;
+    };
+
+    fs::path m_rootPath;
+    NetworkAddress m_address;
+    SocketHandle m_listener;
+    std::uint16_t m_port{};
+    std::atomic<bool> m_isStopping{false};
+    std::list<std::unique_ptr<Connection>> m_connections;
+};
+
+} // namespace dvcs
@@ -0,0 +1,664 @@
+#include "database.h"
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <optional>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+using TBlobPtr = std::unique_ptr<sqlite3_blob, decltype(&sqlite3_blob_close)>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Source Boost.IOStreams lisant par morceaux le contenu d'une colonne BLOB à
+// l'aide des entrées/sorties incrémentales de SQLite.
+// Voir: https://sqlite.org/c3ref/blob_open.html
+////////////////////////////////////////////////////////////////////////////////////
+class BlobSource
+{
+  public:
+    using char_type = char;
+    using category = boost::iostreams::source_tag;
+
+    explicit BlobSource(sqlite3_blob *pBlob) : m_pBlob{pBlob}, m_size{sqlite3_blob_bytes(pBlob)} {}
+
+    std::streamsize read(char *pData, std::streamsize size)
+    {
+        RETURN_IF(m_offset >= m_size, -1);
+        const int nbRead = static_cast<int>(std::min<std::streamsize>(size, m_size - m_offset));
+        if (sqlite3_blob_read(m_pBlob, pData, nbRead, m_offset) != SQLITE_OK)
+        {
+            throw std::ios_base::failure{"Can't read object content"};
+        }
+        m_offset += nbRead;
+        return nbRead;
+    }
+
+  private:
+    sqlite3_blob *m_pBlob;
+    int m_size;
+    int m_offset{};
+};
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] bool OpenDatabaseConnection(const fs::path &dbPath, TDatabasePtr &pDB, int flags) noexcept
+{
+    sqlite3 *pDBHandle = nullptr;
+    const int openResult = sqlite3_open_v2(dbPath.c_str(), &pDBHandle, flags, nullptr);
+    // NOTE: Même en cas d'erreur, la connexion doit être fermée
+    TDatabasePtr pNewDB{pDBHandle, sqlite3_close};
+    RETURN_IF((openResult != SQLITE_OK) || (pNewDB == nullptr), false);
+    pDB = std::move(pNewDB);
+    return true;
+}
+
+void RollbackPendingTransaction(TDatabasePtr &pDB) noexcept
+{
+    if ((pDB != nullptr) && (sqlite3_get_autocommit(pDB.get()) == 0))
+    {
+        sqlite3_exec(pDB.get(), "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+}
+
+
+
+[[nodiscard]] bool ExecuteQuery(TDatabasePtr &pDB, const std::string &query, TCallback pCallback, void *pArg) noexcept
+{
+    char *pErrMsg = nullptr;
+    int execResult = sqlite3_exec(pDB.get(), query.c_str(), pCallback, pArg, &pErrMsg);
+    const bool resultIsOK = execResult == SQLITE_OK;
+    if (!resultIsOK)
+    {
+        fmt::print(std::cerr, "Internal error {0}: {1}\n", execResult, (pErrMsg != nullptr) ? pErrMsg : sqlite3_errstr(execResult));
+        sqlite3_free(pErrMsg);
+        RollbackPendingTransaction(pDB);
+        return false;
+    }
+    return resultIsOK;
+}
+
+[[nodiscard]] bool BindValue(TStatementPtr &pStmt, int index, const TQueryValue &value) noexcept
+{
+    if (const auto *pText = std::get_if<std::string_view>(&value))
+    {
+        return sqlite3_bind_text(pStmt.get(), index, pText->data(), static_cast<int>(pText->size()), SQLITE_STATIC) == SQLITE_OK;
+    }
+    const auto &hash = std::get<THash>(value);
+    return sqlite3_bind_blob(pStmt.get(), index, hash.data(), static_cast<int>(hash.size()), SQLITE_TRANSIENT) == SQLITE_OK;
+}
+
+[[nodiscard]] bool ExecuteStatement(TStatementPtr &pStmt, const TQueryParameters &parameters) noexcept
+{
+    for (const auto &[pName, value] : parameters)
+    {
+        const int index = sqlite3_bind_parameter_index(pStmt.get(), pName);
+        RETURN_IF((index != 0) && !BindValue(pStmt, index, value), false);
+    }
+
+    int stepResult = sqlite3_step(pStmt.get());
+    while (stepResult == SQLITE_ROW)
+    {
+        stepResult = sqlite3_step(pStmt.get());
+    }
+    sqlite3_reset(pStmt.get());
+    sqlite3_clear_bindings(pStmt.get());
+    if (stepResult != SQLITE_DONE)
+    {
+        sqlite3 *pDB = sqlite3_db_handle(pStmt.get());
+        fmt::print(std::cerr, "Internal error {0}: {1}\n", stepResult, sqlite3_errmsg(pDB));
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] bool ExecuteQuery(TDatabasePtr &pDB, std::string_view query, const TQueryParameters &parameters) noexcept
+{
+    const char *pQuery = query.data();
+    const char *pQueryEnd = query.data() + query.size();
+    while (pQuery < pQueryEnd)
+    {
+        sqlite3_stmt *pSQLStmt = nullptr;
+        const char *pTail = nullptr;
+        if (sqlite3_prepare_v2(pDB.get(), pQuery, static_cast<int>(pQueryEnd - pQuery), &pSQLStmt, &pTail) != SQLITE_OK)
+        {
+            fmt::print(std::cerr, "Internal error {0}: {1}\n", sqlite3_errcode(pDB.get()), sqlite3_errmsg(pDB.get()));
+            RollbackPendingTransaction(pDB);
+            return false;
+        }
+        pQuery = pTail;
+        if (pSQLStmt == nullptr)
+        {
+            // Il ne restait que des espaces ou des commentaires
+            continue;
+        }
+
+        TStatementPtr pStmt{pSQLStmt, sqlite3_finalize};
+        if (!ExecuteStatement(pStmt, parameters))
+        {
+            RollbackPendingTransaction(pDB);
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool StatementCache::Prepare(std::string_view query, TStatementPtr &pStmt) noexcept
+{
+    try
+    {
+        auto &statements = m_statements[std::string{query}];
+        if (statements.empty())
+        {
+            sqlite3_stmt *pSQLStmt = nullptr;
+            if ((sqlite3_prepare_v2(m_pDB.get(), query.data(), static_cast<int>(query.size()), &pSQLStmt, nullptr) != SQLITE_OK) ||
+                (pSQLStmt == nullptr))
+            {
+                fmt::print(std::cerr, "Internal error {0}: {1}\n", sqlite3_errcode(m_pDB.get()), sqlite3_errmsg(m_pDB.get()));
+                m_statements.erase(std::string{query});
+                return false;
+            }
+            statements.emplace_back(pSQLStmt, sqlite3_finalize);
+        }
+
+        sqlite3_clear_bindings(statements.front().get());
+        pStmt = TStatementPtr{statements.front().get(), sqlite3_reset};
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool StatementCache::Execute(std::string_view query, const TQueryParameters &parameters) noexcept
+{
+    try
+    {
+        const std::string key{query};
+        auto statementsIt = m_statements.find(key);
+        if (statementsIt != m_statements.end())
+        {
+            for (auto &pCachedStmt : statementsIt->second)
+            {
+                TStatementPtr pStmt{pCachedStmt.get(), sqlite3_reset};
+                if (!ExecuteStatement(pStmt, parameters))
+                {
+                    RollbackPendingTransaction(m_pDB);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<TStatementPtr> statements;
+        const char *pQuery = query.data();
+        const char *pQueryEnd = query.data() + query.size();
+        while (pQuery < pQueryEnd)
+        {
+            sqlite3_stmt *pSQLStmt = nullptr;
+            const char *pTail = nullptr;
+            if (sqlite3_prepare_v2(m_pDB.get(), pQuery, static_cast<int>(pQueryEnd - pQuery), &pSQLStmt, &pTail) != SQLITE_OK)
+            {
+                fmt::print(std::cerr, "Internal error {0}: {1}\n", sqlite3_errcode(m_pDB.get()), sqlite3_errmsg(m_pDB.get()));
+                RollbackPendingTransaction(m_pDB);
+                return false;
+            }
+            pQuery = pTail;
+            if (pSQLStmt == nullptr)
+            {
+                continue;
+            }
+
+            statements.emplace_back(pSQLStmt, sqlite3_finalize);
+            if (!ExecuteStatement(statements.back(), parameters))
+            {
+                RollbackPendingTransaction(m_pDB);
+                return false;
+            }
+        }
+        m_statements.emplace(key, std::move(statements));
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        RollbackPendingTransaction(m_pDB);
+        return false;
+    }
+}
+
+[[nodiscard]] bool QueryHash(StatementCache &statements, std::string_view query, THash &hash) noexcept
+{
+    TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare(query, pStmt), false);
+    RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_ROW, false);
+    const auto size = static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), 0));
+    RETURN_IF((size != SHA1_SIZE) && (size != SHA256_SIZE), false);
+    hash = THash{size};
+    std::memcpy(hash.data(), sqlite3_column_blob(pStmt.get(), 0), size);
+    return true;
+}
+
+[[nodiscard]] bool GetSchemaVersion(TDatabasePtr &pDB, std::string_view schemaName, int &version) noexcept
+{
+    auto callback = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
+        RETURN_IF(argc != 1, SQLITE_ERROR);
+        *reinterpret_cast<int *>(pArg) = std::atoi(pArgv[0]);
+        return SQLITE_OK;
+    };
+
+    try
+    {
+        int nbTables{};
+        RETURN_IF(!ExecuteQuery(pDB,
+                                fmt::format("SELECT COUNT(*) FROM {}.sqlite_master WHERE type = \"table\" AND name = \"Metadata\";", schemaName),
+                                callback, &nbTables),
+                  false);
+        version = 1;
+        RETURN_IF(nbTables == 0, true);
+        return ExecuteQuery(pDB, fmt::format("SELECT Value FROM {}.Metadata WHERE Name = \"SchemaVersion\";", schemaName), callback, &version);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool GetMetadataValue(TDatabasePtr &pDB, std::string_view schemaName, std::string_view name, std::string &value) noexcept
+{
+    auto callback = [](void *pArg, int argc, char **pArgv, char ** /* pErrMsg */) {
+        RETURN_IF((argc != 1) || (pArgv[0] == nullptr), SQLITE_ERROR);
+        *reinterpret_cast<std::string *>(pArg) = pArgv[0];
+        return SQLITE_OK;
+    };
+
+    try
+    {
+        value.clear();
+        return ExecuteQuery(pDB, fmt::format("SELECT Value FROM {0}.Metadata WHERE Name = \"{1}\";", schemaName, name), callback, &value);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool GetHashAlgorithm(TDatabasePtr &pDB, std::string_view schemaName, HashAlgorithm &algorithm) noexcept
+{
+    std::string value;
+    RETURN_IF(!GetMetadataValue(pDB, schemaName, "HashAlgorithm", value), false);
+    algorithm = HashAlgorithm::SHA1;
+    return value.empty() || ParseHashAlgorithm(value, algorithm);
+}
+
+[[nodiscard]] bool GetCompressionSettings(TDatabasePtr &pDB, std::string_view schemaName, CompressionSettings &settings) noexcept
+{
+    std::string value;
+    RETURN_IF(!GetMetadataValue(pDB, schemaName, "Compression", value), false);
+    settings = CompressionSettings{};
+    return value.empty() || ParseCompressionSettings(value, settings);
+}
+
+[[nodiscard]] bool GetChunking(TDatabasePtr &pDB, std::string_view schemaName, bool &isEnabled) noexcept
+{
+    std::string value;
+    RETURN_IF(!GetMetadataValue(pDB, schemaName, "Chunking", value), false);
+    isEnabled = value == "on";
+    return value.empty() || isEnabled || (value == "off");
+}
+
+[[nodiscard]] bool GetStorageProfile(TDatabasePtr &pDB, std::string_view schemaName, StorageProfile &profile) noexcept
+{
+    profile = StorageProfile::Durable;
+
+    int version{};
+    RETURN_IF(!GetSchemaVersion(pDB, schemaName, version), false);
+    RETURN_IF(version == 1, true);
+
+    std::string value;
+    RETURN_IF(!GetMetadataValue(pDB, schemaName, "StorageProfile", value), false);
+    return value.empty() || ParseStorageProfile(value, profile);
+}
+
+[[nodiscard]] bool ApplyStorageSettings(TDatabasePtr &pDB, std::string_view schemaName, const StorageSettings &settings) noexcept
+{
+    try
+    {
+        // Les lecteurs concurrents permis par le WAL doivent parfois attendre la
+        // fin d'un checkpoint plutôt que d'échouer immédiatement.
+        RETURN_IF(sqlite3_busy_timeout(pDB.get(), BUSY_TIMEOUT_MS) != SQLITE_OK, false);
+        return ExecuteQuery(pDB, fmt::format("PRAGMA {0}.journal_mode = {1};"
+                                             "PRAGMA {0}.synchronous = {2};"
+                                             "PRAGMA {0}.mmap_size = {3};"
+                                             "PRAGMA {0}.cache_size = -{4};",
+                                             schemaName, settings.m_journalMode, settings.m_synchronous, settings.m_mmapSize,
+                                             settings.m_cacheSizeKB));
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool LoadDictionary(TDatabasePtr &pDB, std::string_view schemaName, std::uint32_t id, int level,
+                                  std::unique_ptr<CompressionDictionary> &pDictionary) noexcept
+{
+    try
+    {
+        sqlite3_stmt *pSQLStmt;
+        const auto query = fmt::format("SELECT Content FROM {}.Dictionaries WHERE Id = @id;", schemaName);
+        RETURN_IF(sqlite3_prepare_v2(pDB.get(), query.c_str(), -1, &pSQLStmt, nullptr) != SQLITE_OK, false);
+        TStatementPtr pStmt{pSQLStmt, sqlite3_finalize};
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 1, id) != SQLITE_OK, false);
+        if (sqlite3_step(pStmt.get()) != SQLITE_ROW)
+        {
+            fmt::print(std::cerr, "Missing compression dictionary {}\n", id);
+            return false;
+        }
+
+        const auto *pContent = static_cast<const char *>(sqlite3_column_blob(pStmt.get(), 0));
+        std::vector<char> content(pContent, pContent + sqlite3_column_bytes(pStmt.get(), 0));
+        pDictionary = std::make_unique<CompressionDictionary>(std::move(content), level);
+        if (!pDictionary->IsValid() || (pDictionary->GetId() != id))
+        {
+            fmt::print(std::cerr, "Invalid compression dictionary {}\n", id);
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool GetCurrentDictionary(TDatabasePtr &pDB, std::string_view schemaName, const CompressionSettings &settings,
+                                        std::unique_ptr<CompressionDictionary> &pDictionary) noexcept
+{
+    pDictionary.reset();
+    RETURN_IF(settings.m_codec != Codec::Zstd, true);
+
+    std::string value;
+    RETURN_IF(!GetMetadataValue(pDB, schemaName, "Dictionary", value), false);
+    RETURN_IF(value.empty(), true);
+
+    std::uint32_t id{};
+    const auto [pEnd, errorCode] = std::from_chars(value.data(), value.data() + value.size(), id);
+    RETURN_IF((errorCode != std::errc{}) || (pEnd != value.data() + value.size()), false);
+    return LoadDictionary(pDB, schemaName, id, settings.m_level, pDictionary);
+}
+
+[[nodiscard]] bool DictionaryCache::Decompress(Codec codec, const void *pContent, std::size_t size, std::vector<char> &rawData) noexcept
+{
+    const CompressionDictionary *pDictionary = nullptr;
+    return Find(codec, pContent, size, pDictionary) && dvcs::Decompress(codec, pContent, size, rawData, pDictionary);
+}
+
+[[nodiscard]] bool DictionaryCache::Find(Codec codec, const void *pContent, std::size_t size, const CompressionDictionary *&pDictionary) noexcept
+{
+    pDictionary = nullptr;
+    const auto id = GetDictionaryId(codec, pContent, size);
+    RETURN_IF(id == 0, true);
+
+    try
+    {
+        auto dictionaryIt = m_dictionaries.find(id);
+        if (dictionaryIt == m_dictionaries.end())
+        {
+            std::unique_ptr<CompressionDictionary> pNewDictionary;
+            // NOTE: Le niveau de compression n'a pas d'importance pour la décompression
+            RETURN_IF(!LoadDictionary(m_pDB, m_schemaName, id, CompressionSettings{}.m_level, pNewDictionary), false);
+            dictionaryIt = m_dictionaries.emplace(id, std::move(pNewDictionary)).first;
+        }
+        pDictionary = dictionaryIt->second.get();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+ObjectReader::ObjectReader(TDatabasePtr &pDB, const std::string &schemaName) : m_pDB{pDB}, m_schemaName{schemaName}, m_dictionaries{pDB, schemaName}
+{
+    sqlite3_stmt *pSQLStmt = nullptr;
+    const auto query = fmt::format("SELECT Content, Codec, Base FROM {}.Objects WHERE Hash = @hash;", schemaName);
+    if (sqlite3_prepare_v2(m_pDB.get(), query.c_str(), -1, &pSQLStmt, nullptr) == SQLITE_OK)
+    {
+        m_pStmt.reset(pSQLStmt);
+    }
+
+    // NOTE: Le contenu n'est pas sélectionné puisqu'il est lu par morceaux
+    const auto storageQuery = fmt::format("SELECT rowid, Codec, Base IS NOT NULL, Content IS NULL FROM {}.Objects WHERE Hash = @hash;", schemaName);
+    if (sqlite3_prepare_v2(m_pDB.get(), storageQuery.c_str(), -1, &pSQLStmt, nullptr) == SQLITE_OK)
+    {
+        m_pStorageStmt.reset(pSQLStmt);
+    }
+
+    const auto chunksQuery = fmt::format("SELECT Chunks.Content, Chunks.Codec FROM {0}.ObjectsChunks JOIN {0}.Chunks ON Chunks.Hash = "
+                                         "ObjectsChunks.ChunkHash WHERE ObjectsChunks.ObjectHash = @hash ORDER BY ObjectsChunks.Position;",
+                                         schemaName);
+    if (sqlite3_prepare_v2(m_pDB.get(), chunksQuery.c_str(), -1, &pSQLStmt, nullptr) == SQLITE_OK)
+    {
+        m_pChunksStmt.reset(pSQLStmt);
+    }
+}
+
+[[nodiscard]] bool ObjectReader::Read(const THash &hash, std::vector<char> &rawData) noexcept
+{
+    RETURN_IF((m_pStmt == nullptr) || (m_pChunksStmt == nullptr), false);
+    try
+    {
+        // On remonte la chaîne de deltas jusqu'à l'objet complet...
+        std::vector<std::vector<char>> deltas;
+        std::optional<THash> currentHash{hash};
+        while (currentHash.has_value())
+        {
+            RETURN_IF(deltas.size() > static_cast<std::size_t>(MAX_DELTA_DEPTH), false);
+
+            RETURN_IF(sqlite3_reset(m_pStmt.get()) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_bind_blob(m_pStmt.get(), 1, currentHash->data(), static_cast<int>(currentHash->size()), SQLITE_STATIC) != SQLITE_OK,
+                      false);
+            if (sqlite3_step(m_pStmt.get()) != SQLITE_ROW)
+            {
+                fmt::print(std::cerr, "Missing object {}\n", ToHex(*currentHash));
+                return false;
+            }
+
+            const auto *pContent = static_cast<const char *>(sqlite3_column_blob(m_pStmt.get(), 0));
+            const auto contentSize = static_cast<std::size_t>(sqlite3_column_bytes(m_pStmt.get(), 0));
+            const auto baseSize = static_cast<std::size_t>(sqlite3_column_bytes(m_pStmt.get(), 2));
+            if ((baseSize == 0) && (sqlite3_column_type(m_pStmt.get(), 0) == SQLITE_NULL))
+            {
+                rawData.clear();
+                boost::iostreams::stream<boost::iostreams::back_insert_device<std::vector<char>>> dataStream{rawData};
+                std::uintmax_t nbRead{};
+                RETURN_IF(!ReadChunks(*currentHash, dataStream, nbRead) || !dataStream.flush(), false);
+                currentHash.reset();
+            }
+            else if (baseSize == 0)
+            {
+                const int codec = sqlite3_column_int(m_pStmt.get(), 1);
+                RETURN_IF(!IsValidCodec(codec), false);
+                RETURN_IF(!m_dictionaries.Decompress(static_cast<Codec>(codec), pContent, contentSize, rawData), false);
+                currentHash.reset();
+            }
+            else
+            {
+                RETURN_IF((baseSize != SHA1_SIZE) && (baseSize != SHA256_SIZE), false);
+                deltas.emplace_back(pContent, pContent + contentSize);
+                currentHash = THash{baseSize};
+                std::memcpy(currentHash->data(), sqlite3_column_blob(m_pStmt.get(), 2), baseSize);
+            }
+        }
+
+        sqlite3_reset(m_pStmt.get());
+
+        // ... puis on applique les deltas à partir de celui-ci
+        std::vector<char> baseData;
+        for (auto deltaIt = deltas.crbegin(); deltaIt != deltas.crend(); ++deltaIt)
+        {
+            std::swap(baseData, rawData);
+            RETURN_IF(!DecompressDelta(baseData.data(), baseData.size(), deltaIt->data(), deltaIt->size(), rawData), false);
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool ObjectReader::ReadTo(const THash &hash, std::ostream &output, std::uintmax_t &nbWritten) noexcept
+{
+    RETURN_IF((m_pStorageStmt == nullptr) || (m_pChunksStmt == nullptr), false);
+    nbWritten = 0;
+    try
+    {
+        RETURN_IF(sqlite3_reset(m_pStorageStmt.get()) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_bind_blob(m_pStorageStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+        if (sqlite3_step(m_pStorageStmt.get()) != SQLITE_ROW)
+        {
+            fmt::print(std::cerr, "Missing object {}\n", ToHex(hash));
+            return false;
+        }
+        const sqlite3_int64 rowId = sqlite3_column_int64(m_pStorageStmt.get(), 0);
+        const int codec = sqlite3_column_int(m_pStorageStmt.get(), 1);
+        const bool isDelta = sqlite3_column_int(m_pStorageStmt.get(), 2) != 0;
+        const bool isChunked = !isDelta && (sqlite3_column_int(m_pStorageStmt.get(), 3) != 0);
+        sqlite3_reset(m_pStorageStmt.get());
+
+        if (isDelta)
+        {
+            std::vector<char> rawData;
+            RETURN_IF(!Read(hash, rawData), false);
+            RETURN_IF(!output.write(rawData.data(), static_cast<std::streamsize>(rawData.size())), false);
+            nbWritten = rawData.size();
+            return true;
+        }
+        RETURN_IF(isChunked, ReadChunks(hash, output, nbWritten));
+        RETURN_IF(!IsValidCodec(codec), false);
+
+        sqlite3_blob *pBlobHandle = nullptr;
+        RETURN_IF(sqlite3_blob_open(m_pDB.get(), m_schemaName.c_str(), "Objects", "Content", rowId, 0, &pBlobHandle) != SQLITE_OK, false);
+        TBlobPtr pBlob{pBlobHandle, sqlite3_blob_close};
+
+        // Le dictionnaire requis, s'il y en a un, est identifié dans l'entête
+        std::array<char, MAX_FRAME_HEADER_SIZE> header{};
+        const int headerSize = std::min(sqlite3_blob_bytes(pBlob.get()), static_cast<int>(header.size()));
+        RETURN_IF(sqlite3_blob_read(pBlob.get(), header.data(), headerSize, 0) != SQLITE_OK, false);
+        const CompressionDictionary *pDictionary = nullptr;
+        RETURN_IF(!m_dictionaries.Find(static_cast<Codec>(codec), header.data(), static_cast<std::size_t>(headerSize), pDictionary), false);
+
+        boost::iostreams::stream<BlobSource> contentStream{pBlob.get()};
+        return DecompressStream(static_cast<Codec>(codec), contentStream, output, nbWritten, pDictionary);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+[[nodiscard]] bool ObjectReader::ReadChunks(const THash &hash, std::ostream &output, std::uintmax_t &nbWritten)
+{
+    RETURN_IF(sqlite3_reset(m_pChunksStmt.get()) != SQLITE_OK, false);
+    RETURN_IF(sqlite3_bind_blob(m_pChunksStmt.get(), 1, hash.data(), static_cast<int>(hash.size()), SQLITE_STATIC) != SQLITE_OK, false);
+
+    nbWritten = 0;
+    std::vector<char> chunkData;
+    int stepResult{};
+    while ((stepResult = sqlite3_step(m_pChunksStmt.get())) == SQLITE_ROW)
+    {
+        const int codec = sqlite3_column_int(m_pChunksStmt.get(), 1);
+        RETURN_IF(!IsValidCodec(codec), false);
+        RETURN_IF(!m_dictionaries.Decompress(static_cast<Codec>(codec), sqlite3_column_blob(m_pChunksStmt.get(), 0),
+                                             static_cast<std::size_t>(sqlite3_column_bytes(m_pChunksStmt.get(), 0)), chunkData),
+                  false);
+        RETURN_IF(!output.write(chunkData.data(), static_cast<std::streamsize>(chunkData.size())), false);
+        nbWritten += chunkData.size();
+    }
+    sqlite3_reset(m_pChunksStmt.get());
+    return stepResult == SQLITE_DONE;
+}
+
+[[nodiscard]] bool ExecuteQuery(const fs::path &databasePath, const std::string &query, TCallback pCallback, void *pArg) noexcept
+{
+    RETURN_IF((pArg != nullptr) && (pCallback == nullptr), false);
+
+    TDatabasePtr pDB{nullptr, sqlite3_close};
+    try
+    {
+        RETURN_IF(!OpenDatabaseConnection(fs::current_path() / databasePath, pDB), false);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+    RETURN_IF(pDB == nullptr, false);
+
+    return ExecuteQuery(pDB, query, pCallback, pArg);
+}
+
+[[nodiscard]] bool ValidateNoResult(StatementCache &statements, std::string_view query, const TQueryParameters &parameters) noexcept
+{
+    TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare(query, pStmt), false);
+    for (const auto &[pName, value] : parameters)
+    {
+        const int index = sqlite3_bind_parameter_index(pStmt.get(), pName);
+        RETURN_IF((index != 0) && !BindValue(pStmt, index, value), false);
+    }
+    RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_ROW, false);
+    return sqlite3_column_int64(pStmt.get(), 0) == 0;
+}
+
+[[nodiscard]] bool GetColumnHash(TStatementPtr &pStmt, int column, THash &hash, bool &isPresent) noexcept
+{
+    isPresent = sqlite3_column_type(pStmt.get(), column) != SQLITE_NULL;
+    const auto size = static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), column));
+    RETURN_IF(isPresent && (size != SHA1_SIZE) && (size != SHA256_SIZE), false);
+    hash = THash{size};
+    if (isPresent)
+    {
+        std::memcpy(hash.data(), sqlite3_column_blob(pStmt.get(), column), size);
+    }
+    return true;
+}
+
+[[nodiscard]] std::string_view GetColumnText(TStatementPtr &pStmt, int column) noexcept
+{
+    const auto *pText = reinterpret_cast<const char *>(sqlite3_column_text(pStmt.get(), column));
+    return (pText != nullptr) ? std::string_view{pText, static_cast<std::size_t>(sqlite3_column_bytes(pStmt.get(), column))} : std::string_view{};
+}
+
+} // namespace dvcs
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "codec.h"
+#include "hash.h"
+#include "storage.h"
+
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+using TDatabasePtr = std::unique_ptr<sqlite3, decltype(&sqlite3_close)>;
+using TStatementPtr = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>;
+using TCallback = int (*)(void *, int, char **, char **);
+
+// Valeur d'un paramètre nommé d'une requête
+using TQueryValue = std::variant<std::string_view, THash>;
+using TQueryParameters = std::vector<std::pair<const char *, TQueryValue>>;
+
+// Taille des morceaux lus/écrits lors du traitement d'un gros fichier
+constexpr const std::size_t STREAMING_CHUNK_SIZE = 64U * 1024U;
+
+// Un nouvel objet est stocké sous forme de delta par rapport à la version
+// précédente du même fichier. La longueur des chaînes de deltas est bornée pour
+// limiter le coût de la reconstruction d'un objet: une fois la longueur maximale
+// atteinte, l'objet est stocké au complet et sert de nouvelle base.
+constexpr const int MAX_DELTA_DEPTH = 10;
+
+// Délai pendant lequel une connexion attend qu'un verrou se libère avant d'échouer
+constexpr const int BUSY_TIMEOUT_MS = 5000;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ouvre une connection <pDB> à la base de données situé à <dbPath> selon les
+// options <flags>. Par défaut, la base de données est créée si elle n'existe pas.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool OpenDatabaseConnection(const fs::path &dbPath, TDatabasePtr &pDB,
+                                          int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Annule la transaction laissée ouverte sur la connexion <pDB>, s'il y en a une.
+// Les connexions d'un dépôt étant conservées d'une commande à l'autre, on ne peut
+// pas compter sur leur fermeture pour annuler le travail d'une commande ayant
+// échoué en cours de route.
+////////////////////////////////////////////////////////////////////////////////////
+void RollbackPendingTransaction(TDatabasePtr &pDB) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Annule, à la sortie de sa portée, la transaction laissée ouverte sur la
+// connexion <pDB> par une commande interrompue.
+////////////////////////////////////////////////////////////////////////////////////
+class TransactionGuard
+{
+  public:
+    explicit TransactionGuard(TDatabasePtr &pDB) noexcept : m_pDB{pDB} {}
+    TransactionGuard(const TransactionGuard &) = delete;
+    TransactionGuard &operator=(const TransactionGuard &) = delete;
+    ~TransactionGuard() { RollbackPendingTransaction(m_pDB); }
+
+  private:
+    TDatabasePtr &m_pDB;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Exécute la requête <query> sur la base de données <pDB>.
+// De la logique additionnelle peut être exécutée à l'aide du callback <pCallback>
+// qui peut recevoir les arguments <pArg>.
+// Pour plus d'informations sur la mécanique de callback, consultez:
+// https://sqlite.org/c3ref/exec.html
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ExecuteQuery(TDatabasePtr &pDB, const std::string &query, TCallback pCallback = nullptr, void *pArg = nullptr) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Associe la valeur <value> au paramètre <index> de la requête préparée <pStmt>.
+// NOTE: Un hash est copié par SQLite puisque <value> est souvent une copie
+//       temporaire de celui de l'appelant, détruite au retour de la fonction.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool BindValue(TStatementPtr &pStmt, int index, const TQueryValue &value) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Exécute jusqu'au bout l'énoncé préparé <pStmt> après avoir remplacé ses
+// paramètres nommés (ex: @hash) par les valeurs correspondantes de <parameters>.
+// L'énoncé est réinitialisé pour pouvoir être réutilisé.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ExecuteStatement(TStatementPtr &pStmt, const TQueryParameters &parameters) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Exécute la requête <query>, pouvant contenir plusieurs énoncés, sur la base de
+// données <pDB>. Les paramètres nommés (ex: @hash) de chacun des énoncés sont
+// remplacés par les valeurs correspondantes de <parameters>, ce qui permet de
+// manipuler des valeurs binaires sans les convertir en texte.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ExecuteQuery(TDatabasePtr &pDB, std::string_view query, const TQueryParameters &parameters) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Requêtes préparées d'une connexion, conservées pour être réutilisées.
+// Une requête est identifiée par son texte: celles qui varient d'un appel à
+// l'autre doivent donc recevoir leurs valeurs sous forme de paramètres. Une
+// requête préparée ne peut être utilisée que par un seul appelant à la fois.
+// NOTE: Une requête fournie par le cache est réinitialisée plutôt que finalisée
+//       lorsqu'on n'en a plus besoin (TStatementPtr avec sqlite3_reset comme
+//       destructeur), ce qui libère les verrous qu'elle pourrait détenir.
+////////////////////////////////////////////////////////////////////////////////////
+class StatementCache
+{
+  public:
+    explicit StatementCache(TDatabasePtr &pDB) noexcept : m_pDB{pDB} {}
+    StatementCache(const StatementCache &) = delete;
+    StatementCache &operator=(const StatementCache &) = delete;
+
+    [[nodiscard]] TDatabasePtr &GetDatabase() noexcept { return m_pDB; }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Récupère dans <pStmt> la requête <query>, composée d'un seul énoncé, en la
+    // préparant si ce n'est pas déjà fait.
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool Prepare(std::string_view query, TStatementPtr &pStmt) noexcept;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Exécute la requête <query>, pouvant contenir plusieurs énoncés, avec les
+    // paramètres <parameters>. Les énoncés sont préparés au fil de la première
+    // exécution de la requête puisqu'un énoncé peut dépendre du précédent.
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool Execute(std::string_view query, const TQueryParameters &parameters) noexcept;
+
+  private:
+    TDatabasePtr &m_pDB;
+    std::unordered_map<std::string, std::vector<TStatementPtr>> m_statements;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère l'empreinte <hash> produite par la requête <query> préparée à l'aide
+// de <statements>. Une requête ne produisant aucun résultat est considérée comme
+// une erreur.
+// NOTE: Les callbacks de sqlite3_exec ne reçoivent que du texte, ce qui ne
+//       convient pas à des valeurs binaires.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool QueryHash(StatementCache &statements, std::string_view query, THash &hash) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère la version <version> du schéma de la base de données <schemaName>
+// (main ou une base de données attachée) accessible par la connexion <pDB>.
+// Les bases de données créées avant l'introduction des versions n'ont pas de
+// table Metadata et sont considérées comme étant à la version 1.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetSchemaVersion(TDatabasePtr &pDB, std::string_view schemaName, int &version) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère la valeur <value> de la métadonnée <name> du dépôt <schemaName> (main
+// ou une base de données attachée) accessible par la connexion <pDB>.
+// <value> est vide si la métadonnée n'est pas définie.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetMetadataValue(TDatabasePtr &pDB, std::string_view schemaName, std::string_view name, std::string &value) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère l'algorithme de hachage <algorithm> utilisé par le dépôt <schemaName>.
+// Un dépôt n'en précisant aucun utilise SHA1.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetHashAlgorithm(TDatabasePtr &pDB, std::string_view schemaName, HashAlgorithm &algorithm) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère les paramètres de compression <settings> des nouveaux objets du dépôt
+// <schemaName>. Un dépôt n'en précisant aucun utilise les paramètres par défaut.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetCompressionSettings(TDatabasePtr &pDB, std::string_view schemaName, CompressionSettings &settings) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si les gros objets du dépôt <schemaName> sont découpés en morceaux selon
+// leur contenu (<isEnabled>). Le découpage est désactivé par défaut.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetChunking(TDatabasePtr &pDB, std::string_view schemaName, bool &isEnabled) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère le profil de stockage <profile> du dépôt <schemaName>. Un dépôt n'en
+// précisant aucun (ou antérieur aux métadonnées) utilise le profil durable.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetStorageProfile(TDatabasePtr &pDB, std::string_view schemaName, StorageProfile &profile) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Applique les réglages <settings> à la base de données <schemaName> accessible par
+// la connexion <pDB>.
+// NOTE: Hormis le WAL, ces réglages ne sont pas conservés dans la base de données:
+//       ils doivent être appliqués à chaque connexion et à chaque base de données
+//       attachée. La taille des pages, elle, ne peut être choisie qu'à la création
+//       (voir Init).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ApplyStorageSettings(TDatabasePtr &pDB, std::string_view schemaName, const StorageSettings &settings) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Charge le dictionnaire de compression <id> du dépôt <schemaName> et le prépare
+// pour la compression au niveau <level>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool LoadDictionary(TDatabasePtr &pDB, std::string_view schemaName, std::uint32_t id, int level,
+                                  std::unique_ptr<CompressionDictionary> &pDictionary) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Charge le dictionnaire <pDictionary> avec lequel les nouveaux petits objets du
+// dépôt <schemaName> doivent être compressés selon les paramètres <settings>.
+// <pDictionary> est nul si le dépôt n'en a pas ou si le codec n'en utilise pas.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetCurrentDictionary(TDatabasePtr &pDB, std::string_view schemaName, const CompressionSettings &settings,
+                                        std::unique_ptr<CompressionDictionary> &pDictionary) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Dictionnaires de compression d'un dépôt, chargés au besoin lors de la
+// décompression d'objets.
+////////////////////////////////////////////////////////////////////////////////////
+class DictionaryCache
+{
+  public:
+    DictionaryCache(TDatabasePtr &pDB, std::string schemaName) : m_pDB{pDB}, m_schemaName{std::move(schemaName)} {}
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Décompresse les données <pContent> de taille <size> produites par <codec>
+    // à l'aide du dictionnaire requis, s'il y en a un.
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool Decompress(Codec codec, const void *pContent, std::size_t size, std::vector<char> &rawData) noexcept;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Trouve le dictionnaire <pDictionary> requis pour décompresser les données
+    // débutant par <pContent>, de taille <size>, produites par <codec>.
+    // <pDictionary> est nul si aucun dictionnaire n'est requis.
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool Find(Codec codec, const void *pContent, std::size_t size, const CompressionDictionary *&pDictionary) noexcept;
+
+  private:
+    TDatabasePtr &m_pDB;
+    std::string m_schemaName;
+    std::unordered_map<std::uint32_t, std::unique_ptr<CompressionDictionary>> m_dictionaries;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lecture des données brutes des objets d'un dépôt.
+// Un objet stocké sous forme de delta est reconstruit à partir de l'objet complet
+// au bout de sa chaîne de deltas. Un objet découpé en morceaux est reconstruit en
+// concaténant ceux-ci.
+////////////////////////////////////////////////////////////////////////////////////
+class ObjectReader
+{
+  public:
+    ObjectReader(TDatabasePtr &pDB, const std::string &schemaName);
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Récupère les données brutes <rawData> de l'objet <hash>
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool Read(const THash &hash, std::vector<char> &rawData) noexcept;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Écrit par morceaux dans <output> les données brutes de l'objet <hash>, dont
+    // <nbWritten> reçoit la taille. Le contenu d'un objet complet est lu par
+    // morceaux à l'aide des entrées/sorties incrémentales de SQLite. Seul un objet
+    // stocké sous forme de delta, dont la taille est bornée, est reconstruit en
+    // mémoire.
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool ReadTo(const THash &hash, std::ostream &output, std::uintmax_t &nbWritten) noexcept;
+
+  private:
+    ////////////////////////////////////////////////////////////////////////////////
+    // Écrit dans <output> les données brutes des morceaux de l'objet <hash>, un
+    // morceau à la fois. <nbWritten> reçoit leur taille totale.
+    ////////////////////////////////////////////////////////////////////////////////
+    [[nodiscard]] bool ReadChunks(const THash &hash, std::ostream &output, std::uintmax_t &nbWritten);
+
+    TDatabasePtr &m_pDB;
+    std::string m_schemaName;
+    DictionaryCache m_dictionaries;
+    TStatementPtr m_pStmt{nullptr, sqlite3_finalize};
+    TStatementPtr m_pStorageStmt{nullptr, sqlite3_finalize};
+    TStatementPtr m_pChunksStmt{nullptr, sqlite3_finalize};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Exécute la requête <query> sur la base de données situé à <databasePath>.
+// De la logique additionnelle peut être exécutée à l'aide du callback <pCallback>
+// qui peut recevoir les arguments <pArg>.
+// Pour plus d'informations sur la mécanique de callback, consultez:
+// https://sqlite.org/c3ref/exec.html
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ExecuteQuery(const fs::path &databasePath, const std::string &query, TCallback pCallback = nullptr, void *pArg = nullptr) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fonction utilitaire permettant de valider que la requête de comptage <query>,
+// préparée à l'aide de <statements> et recevant les paramètres <parameters>, ne
+// compte aucune rangée.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ValidateNoResult(StatementCache &statements, std::string_view query, const TQueryParameters &parameters = {}) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère l'empreinte <hash> de la colonne <column> de la rangée courante de
+// <pStmt>. <isPresent> est faux si la valeur est NULL.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetColumnHash(TStatementPtr &pStmt, int column, THash &hash, bool &isPresent) noexcept;
+
+[[nodiscard]] std::string_view GetColumnText(TStatementPtr &pStmt, int column) noexcept;
+
+} // namespace dvcs
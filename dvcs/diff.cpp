@@ -0,0 +1,1035 @@
+#include "diff.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DVCS_HAS_X86_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DVCS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define DVCS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+
+// Une ligne commune aux deux textes qui revient plus souvent que ceci dans l'ancien
+// texte ne sert pas d'ancre à l'algorithme Histogram (même limite que jgit)
+constexpr const std::size_t MAX_HISTOGRAM_OCCURRENCES = 64U;
+
+// Coût minimal (nombre d'éditions) à partir duquel Myers se contente d'un
+// découpage approximatif plutôt que du plus court script d'édition (voir
+// MyersDiff::FindMiddleSnake)
+constexpr const std::ptrdiff_t MIN_MYERS_MAX_COST = 256;
+
+// Indique qu'une ligne n'a aucune autre occurrence (voir HistogramDiff)
+constexpr const std::size_t NO_LINE = std::numeric_limits<std::size_t>::max();
+
+using TFindLineEndsFunction = void (*)(const char *pData, std::size_t size, std::vector<std::size_t> &lineEnds);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à <lineEnds> la position suivant chacun des '\n' de <pData>, en débutant
+// à la position <offset>
+////////////////////////////////////////////////////////////////////////////////////
+void FindLineEndsFrom(const char *pData, std::size_t offset, std::size_t size, std::vector<std::size_t> &lineEnds)
+{
+    for (; offset < size; ++offset)
+    {
+        if (pData[offset] == '\n')
+        {
+            lineEnds.push_back(offset + 1);
+        }
+    }
+}
+
+void FindLineEndsGeneric(const char *pData, std::size_t size, std::vector<std::size_t> &lineEnds)
+{
+    FindLineEndsFrom(pData, 0, size, lineEnds);
+}
+
+#ifdef DVCS_HAS_X86_SIMD
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si le processeur courant et le système d'exploitation (qui doit
+// sauvegarder les registres YMM) supportent AVX2
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CPUSupportsAVX2() noexcept
+{
+    constexpr const unsigned int osxsaveBit = 1U << 27U; // CPUID.1:ECX
+    constexpr const unsigned int avxBit = 1U << 28U;     // CPUID.1:ECX
+    constexpr const unsigned int avx2Bit = 1U << 5U;     // CPUID.(7,0):EBX
+    constexpr const unsigned int ymmStateMask = 0x6U;    // XCR0: états SSE et AVX
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    std::array<int, 4> registers{};
+    __cpuid(registers.data(), 0);
+    if (registers[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(registers.data(), 1);
+    const auto ecx = static_cast<unsigned int>(registers[2]);
+    if (((ecx & osxsaveBit) == 0) || ((ecx & avxBit) == 0) || ((_xgetbv(0) & ymmStateMask) != ymmStateMask))
+    {
+        return false;
+    }
+    __cpuidex(registers.data(), 7, 0);
+    return (static_cast<unsigned int>(registers[1]) & avx2Bit) != 0;
+#else
+    unsigned int eax{};
+    unsigned int ebx{};
+    unsigned int ecx{};
+    unsigned int edx{};
+    if ((__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) || ((ecx & osxsaveBit) == 0) || ((ecx & avxBit) == 0))
+    {
+        return false;
+    }
+    unsigned int xcr0{};
+    unsigned int xcr0High{};
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+    if ((xcr0 & ymmStateMask) != ymmStateMask)
+    {
+        return false;
+    }
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+    {
+        return false;
+    }
+    return (ebx & avx2Bit) != 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les '\n' d'un bloc de 16 octets sont trouvés en une comparaison. Le masque qui
+// en résulte est ensuite parcouru bit par bit: le coût dépend du nombre de lignes
+// plutôt que du nombre d'octets.
+// NOTE: SSE2 fait partie de x86-64: aucune détection n'est nécessaire.
+////////////////////////////////////////////////////////////////////////////////////
+void FindLineEndsSSE2(const char *pData, std::size_t size, std::vector<std::size_t> &lineEnds)
+{
+    constexpr const std::size_t blockSize = sizeof(__m128i);
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    std::size_t offset = 0;
+    for (; offset + blockSize <= size; offset += blockSize)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pData + offset)); // NOLINT
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines)));
+        for (; mask != 0; mask &= mask - 1U)
+        {
+            lineEnds.push_back(offset + static_cast<std::size_t>(std::countr_zero(mask)) + 1U);
+        }
+    }
+    FindLineEndsFrom(pData, offset, size, lineEnds);
+}
+
+DVCS_TARGET_AVX2 void FindLineEndsAVX2(const char *pData, std::size_t size, std::vector<std::size_t> &lineEnds)
+{
+    constexpr const std::size_t blockSize = sizeof(__m256i);
+    const __m256i newlines = _mm256_set1_epi8('\n');
+
+    std::size_t offset = 0;
+    for (; offset + blockSize <= size; offset += blockSize)
+    {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pData + offset)); // NOLINT
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newlines)));
+        for (; mask != 0; mask &= mask - 1U)
+        {
+            lineEnds.push_back(offset + static_cast<std::size_t>(std::countr_zero(mask)) + 1U);
+        }
+    }
+    FindLineEndsFrom(pData, offset, size, lineEnds);
+}
+
+#endif
+
+[[nodiscard]] dvcs::LineScanBackend GetPreferredLineScanBackend() noexcept
+{
+    static const dvcs::LineScanBackend preferredBackend = dvcs::IsLineScanBackendSupported(dvcs::LineScanBackend::AVX2)   ? dvcs::LineScanBackend::AVX2
+                                                          : dvcs::IsLineScanBackendSupported(dvcs::LineScanBackend::SSE2) ? dvcs::LineScanBackend::SSE2
+                                                                                                                          : dvcs::LineScanBackend::Generic;
+    return preferredBackend;
+}
+
+[[nodiscard]] TFindLineEndsFunction GetFindLineEndsFunction(dvcs::LineScanBackend backend) noexcept
+{
+    switch (backend == dvcs::LineScanBackend::Auto ? GetPreferredLineScanBackend() : backend)
+    {
+#ifdef DVCS_HAS_X86_SIMD
+    case dvcs::LineScanBackend::SSE2:
+        return FindLineEndsSSE2;
+    case dvcs::LineScanBackend::AVX2:
+        return dvcs::IsLineScanBackendSupported(dvcs::LineScanBackend::AVX2) ? FindLineEndsAVX2 : FindLineEndsSSE2;
+#endif
+    default:
+        return FindLineEndsGeneric;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Empreinte d'une ligne, calculée 8 octets à la fois puis mélangée à la manière de
+// SplitMix64. Elle ne sert qu'à regrouper les lignes identiques: deux lignes de
+// même empreinte sont toujours comparées octet par octet (voir LineClassifier).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::uint64_t HashLine(const char *pData, std::size_t size) noexcept
+{
+    constexpr const std::uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+
+    std::uint64_t hash = size * multiplier;
+    std::size_t offset = 0;
+    for (; offset + sizeof(std::uint64_t) <= size; offset += sizeof(std::uint64_t))
+    {
+        std::uint64_t word{};
+        std::memcpy(&word, pData + offset, sizeof(word));
+        hash = std::rotl((hash ^ word) * multiplier, 27);
+    }
+    if (offset < size)
+    {
+        std::uint64_t word{};
+        std::memcpy(&word, pData + offset, size - offset);
+        hash = std::rotl((hash ^ word) * multiplier, 27);
+    }
+    hash = (hash ^ (hash >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27U)) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Attribue à chacune des lignes distinctes des deux textes un identifiant dense
+// (sa classe): les algorithmes ne comparent ensuite que des entiers.
+// Les classes sont trouvées dans une table de hachage à adressage ouvert selon
+// l'empreinte des lignes.
+////////////////////////////////////////////////////////////////////////////////////
+class LineClassifier
+{
+  public:
+    explicit LineClassifier(std::size_t nbLines) : m_slots(std::bit_ceil(std::max<std::size_t>(16U, 2U * nbLines)), 0) {}
+
+    [[nodiscard]] std::uint32_t Classify(std::string_view line, std::uint64_t hash)
+    {
+        const std::size_t mask = m_slots.size() - 1U;
+        for (auto iSlot = static_cast<std::size_t>(hash) & mask;; iSlot = (iSlot + 1U) & mask)
+        {
+            const auto slot = m_slots[iSlot];
+            if (slot == 0)
+            {
+                m_lines.emplace_back(hash, line);
+                m_slots[iSlot] = static_cast<std::uint32_t>(m_lines.size());
+                return static_cast<std::uint32_t>(m_lines.size()) - 1U;
+            }
+
+            const auto &[slotHash, slotLine] = m_lines[slot - 1U];
+            if ((slotHash == hash) && (slotLine == line))
+            {
+                return slot - 1U;
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t GetNbClasses() const noexcept { return m_lines.size(); }
+
+  private:
+    std::vector<std::uint32_t> m_slots; // Classe + 1, 0 pour une case libre
+    std::vector<std::pair<std::uint64_t, std::string_view>> m_lines;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Textes comparés, représentés par les classes de leurs lignes, et lignes retirées
+// de l'ancien texte ou ajoutées au nouveau
+////////////////////////////////////////////////////////////////////////////////////
+struct DiffContext
+{
+    std::vector<std::uint32_t> m_oldLines;
+    std::vector<std::uint32_t> m_newLines;
+    std::vector<char> m_isRemoved;
+    std::vector<char> m_isAdded;
+    std::size_t m_nbClasses{};
+
+    void MarkRemoved(std::size_t begin, std::size_t end) { std::fill(m_isRemoved.begin() + begin, m_isRemoved.begin() + end, 1); }
+    void MarkAdded(std::size_t begin, std::size_t end) { std::fill(m_isAdded.begin() + begin, m_isAdded.begin() + end, 1); }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Algorithme de Myers (1986) dans sa variante en espace linéaire: la comparaison
+// est récursivement scindée au milieu du plus court script d'édition (le "middle
+// snake"), trouvé en cherchant à la fois depuis le début et depuis la fin.
+// Comme xdiff (git), la recherche s'arrête après un certain coût et scinde alors la
+// comparaison là où elle s'est rendue le plus loin: le script n'est plus
+// forcément le plus court, mais le temps de calcul reste borné lorsque les textes
+// n'ont presque rien en commun.
+////////////////////////////////////////////////////////////////////////////////////
+class MyersDiff
+{
+  public:
+    explicit MyersDiff(DiffContext &context)
+        : m_context{context},
+          m_forward(context.m_oldLines.size() + context.m_newLines.size() + 3U),
+          m_backward(m_forward.size()),
+          m_diagonalOffset{static_cast<std::ptrdiff_t>(context.m_newLines.size()) + 1},
+          m_maxCost{std::max(MIN_MYERS_MAX_COST, static_cast<std::ptrdiff_t>(std::sqrt(static_cast<double>(m_forward.size()))))}
+    {
+    }
+
+    void Compare(std::ptrdiff_t oldBegin, std::ptrdiff_t oldEnd, std::ptrdiff_t newBegin, std::ptrdiff_t newEnd, bool isMinimal);
+
+  private:
+    // Point où scinder la comparaison, et si chacune des deux moitiés doit être
+    // résolue sans approximation
+    struct Split
+    {
+        std::ptrdiff_t m_oldPos{};
+        std::ptrdiff_t m_newPos{};
+        bool m_isMinimalBefore{true};
+        bool m_isMinimalAfter{true};
+    };
+
+    [[nodiscard]] Split FindMiddleSnake(std::ptrdiff_t oldBegin, std::ptrdiff_t oldEnd, std::ptrdiff_t newBegin, std::ptrdiff_t newEnd,
+                                        bool isMinimal);
+
+    // Position atteinte sur la diagonale <diagonal> (position dans l'ancien texte
+    // moins position dans le nouveau)
+    [[nodiscard]] std::ptrdiff_t &Forward(std::ptrdiff_t diagonal) noexcept
+    {
+        return m_forward[static_cast<std::size_t>(diagonal + m_diagonalOffset)];
+    }
+    [[nodiscard]] std::ptrdiff_t &Backward(std::ptrdiff_t diagonal) noexcept
+    {
+        return m_backward[static_cast<std::size_t>(diagonal + m_diagonalOffset)];
+    }
+
+    DiffContext &m_context;
+    std::vector<std::ptrdiff_t> m_forward;
+    std::vector<std::ptrdiff_t> m_backward;
+    std::ptrdiff_t m_diagonalOffset{};
+    std::ptrdiff_t m_maxCost{};
+};
+
+void MyersDiff::Compare(std::ptrdiff_t oldBegin, std::ptrdiff_t oldEnd, std::ptrdiff_t newBegin, std::ptrdiff_t newEnd, bool isMinimal)
+{
+    const auto &oldLines = m_context.m_oldLines;
+    const auto &newLines = m_context.m_newLines;
+    for (; (oldBegin < oldEnd) && (newBegin < newEnd) && (oldLines[oldBegin] == newLines[newBegin]); ++oldBegin, ++newBegin)
+    {
+    }
+    for (; (oldBegin < oldEnd) && (newBegin < newEnd) && (oldLines[oldEnd - 1] == newLines[newEnd - 1]); --oldEnd, --newEnd)
+    {
+    }
+
+    if (oldBegin == oldEnd)
+    {
+        m_context.MarkAdded(static_cast<std::size_t>(newBegin), static_cast<std::size_t>(newEnd));
+    }
+    else if (newBegin == newEnd)
+    {
+        m_context.MarkRemoved(static_cast<std::size_t>(oldBegin), static_cast<std::size_t>(oldEnd));
+    }
+    else
+    {
+        // La profondeur de la récursion est logarithmique puisque chacune des
+        // moitiés a au plus la moitié du coût de la comparaison
+        const auto split = FindMiddleSnake(oldBegin, oldEnd, newBegin, newEnd, isMinimal);
+        Compare(oldBegin, split.m_oldPos, newBegin, split.m_newPos, split.m_isMinimalBefore);
+        Compare(split.m_oldPos, oldEnd, split.m_newPos, newEnd, split.m_isMinimalAfter);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les chemins sont étendus d'une édition à la fois depuis le début (Forward) et
+// depuis la fin (Backward) jusqu'à ce qu'ils se chevauchent sur une diagonale.
+// Au-delà de <m_maxCost> éditions, la comparaison est plutôt scindée à l'extrémité
+// du chemin le plus avancé, sauf si <isMinimal>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] MyersDiff::Split MyersDiff::FindMiddleSnake(std::ptrdiff_t oldBegin, std::ptrdiff_t oldEnd, std::ptrdiff_t newBegin,
+                                                          std::ptrdiff_t newEnd, bool isMinimal)
+{
+    const auto &oldLines = m_context.m_oldLines;
+    const auto &newLines = m_context.m_newLines;
+
+    const std::ptrdiff_t minDiagonal = oldBegin - newEnd;
+    const std::ptrdiff_t maxDiagonal = oldEnd - newBegin;
+    const std::ptrdiff_t forwardMid = oldBegin - newBegin;
+    const std::ptrdiff_t backwardMid = oldEnd - newEnd;
+    const bool isOdd = ((forwardMid - backwardMid) & 1) != 0;
+
+    std::ptrdiff_t forwardMin = forwardMid;
+    std::ptrdiff_t forwardMax = forwardMid;
+    std::ptrdiff_t backwardMin = backwardMid;
+    std::ptrdiff_t backwardMax = backwardMid;
+    Forward(forwardMid) = oldBegin;
+    Backward(backwardMid) = oldEnd;
+
+    for (std::ptrdiff_t cost = 1;; ++cost)
+    {
+        // Une édition de plus depuis le début
+        if (forwardMin > minDiagonal)
+        {
+            Forward(--forwardMin - 1) = -1;
+        }
+        else
+        {
+            ++forwardMin;
+        }
+        if (forwardMax < maxDiagonal)
+        {
+            Forward(++forwardMax + 1) = -1;
+        }
+        else
+        {
+            --forwardMax;
+        }
+        for (std::ptrdiff_t diagonal = forwardMax; diagonal >= forwardMin; diagonal -= 2)
+        {
+            std::ptrdiff_t oldPos = (Forward(diagonal - 1) >= Forward(diagonal + 1)) ? Forward(diagonal - 1) + 1 : Forward(diagonal + 1);
+            std::ptrdiff_t newPos = oldPos - diagonal;
+            for (; (oldPos < oldEnd) && (newPos < newEnd) && (oldLines[oldPos] == newLines[newPos]); ++oldPos, ++newPos)
+            {
+            }
+            Forward(diagonal) = oldPos;
+            if (isOdd && (backwardMin <= diagonal) && (diagonal <= backwardMax) && (Backward(diagonal) <= oldPos))
+            {
+                return Split{oldPos, newPos, true, true};
+            }
+        }
+
+        // Une édition de plus depuis la fin
+        if (backwardMin > minDiagonal)
+        {
+            Backward(--backwardMin - 1) = std::numeric_limits<std::ptrdiff_t>::max();
+        }
+        else
+        {
+            ++backwardMin;
+        }
+        if (backwardMax < maxDiagonal)
+        {
+            Backward(++backwardMax + 1) = std::numeric_limits<std::ptrdiff_t>::max();
+        }
+        else
+        {
+            --backwardMax;
+        }
+        for (std::ptrdiff_t diagonal = backwardMax; diagonal >= backwardMin; diagonal -= 2)
+        {
+            std::ptrdiff_t oldPos = (Backward(diagonal - 1) < Backward(diagonal + 1)) ? Backward(diagonal - 1) : Backward(diagonal + 1) - 1;
+            std::ptrdiff_t newPos = oldPos - diagonal;
+            for (; (oldPos > oldBegin) && (newPos > newBegin) && (oldLines[oldPos - 1] == newLines[newPos - 1]); --oldPos, --newPos)
+            {
+            }
+            Backward(diagonal) = oldPos;
+            if (!isOdd && (forwardMin <= diagonal) && (diagonal <= forwardMax) && (oldPos <= Forward(diagonal)))
+            {
+                return Split{oldPos, newPos, true, true};
+            }
+        }
+
+        if (isMinimal || (cost < m_maxCost))
+        {
+            continue;
+        }
+
+        // Trop coûteux: on retient le chemin qui a parcouru le plus de lignes
+        std::ptrdiff_t forwardBest = -1;
+        std::ptrdiff_t forwardBestOldPos = -1;
+        for (std::ptrdiff_t diagonal = forwardMax; diagonal >= forwardMin; diagonal -= 2)
+        {
+            std::ptrdiff_t oldPos = std::min(Forward(diagonal), oldEnd);
+            std::ptrdiff_t newPos = oldPos - diagonal;
+            if (newEnd < newPos)
+            {
+                oldPos = newEnd + diagonal;
+                newPos = newEnd;
+            }
+            if (forwardBest < oldPos + newPos)
+            {
+                forwardBest = oldPos + newPos;
+                forwardBestOldPos = oldPos;
+            }
+        }
+
+        std::ptrdiff_t backwardBest = std::numeric_limits<std::ptrdiff_t>::max();
+        std::ptrdiff_t backwardBestOldPos = std::numeric_limits<std::ptrdiff_t>::max();
+        for (std::ptrdiff_t diagonal = backwardMax; diagonal >= backwardMin; diagonal -= 2)
+        {
+            std::ptrdiff_t oldPos = std::max(oldBegin, Backward(diagonal));
+            std::ptrdiff_t newPos = oldPos - diagonal;
+            if (newPos < newBegin)
+            {
+                oldPos = newBegin + diagonal;
+                newPos = newBegin;
+            }
+            if (oldPos + newPos < backwardBest)
+            {
+                backwardBest = oldPos + newPos;
+                backwardBestOldPos = oldPos;
+            }
+        }
+
+        if ((oldEnd + newEnd) - backwardBest < forwardBest - (oldBegin + newBegin))
+        {
+            return Split{forwardBestOldPos, forwardBest - forwardBestOldPos, true, false};
+        }
+        return Split{backwardBestOldPos, backwardBest - backwardBestOldPos, false, true};
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Algorithme Histogram (jgit): la plus longue suite de lignes communes contenant
+// la ligne la plus rare de l'ancien texte sert d'ancre, puis les régions qui la
+// précèdent et la suivent sont comparées à leur tour. Une région sans ligne commune
+// est entièrement remplacée; une région dont les lignes communes sont toutes trop
+// fréquentes (voir MAX_HISTOGRAM_OCCURRENCES) est confiée à Myers.
+////////////////////////////////////////////////////////////////////////////////////
+class HistogramDiff
+{
+  public:
+    HistogramDiff(DiffContext &context, MyersDiff &myers)
+        : m_context{context}, m_myers{myers}, m_counts(context.m_nbClasses, 0), m_heads(context.m_nbClasses, NO_LINE),
+          m_nexts(context.m_oldLines.size(), NO_LINE)
+    {
+    }
+
+    void Compare(std::size_t oldBegin, std::size_t oldEnd, std::size_t newBegin, std::size_t newEnd);
+
+  private:
+    struct Region
+    {
+        std::size_t m_oldBegin{};
+        std::size_t m_oldEnd{};
+        std::size_t m_newBegin{};
+        std::size_t m_newEnd{};
+    };
+
+    [[nodiscard]] bool FindCommonSequence(const Region &region, Region &sequence, bool &hasCommonLines) const noexcept;
+
+    DiffContext &m_context;
+    MyersDiff &m_myers;
+    std::vector<std::size_t> m_counts; // Occurrences de chacune des classes dans l'ancien texte de la région
+    std::vector<std::size_t> m_heads;  // Première occurrence de chacune des classes
+    std::vector<std::size_t> m_nexts;  // Occurrence suivante de la classe de chacune des lignes
+};
+
+void HistogramDiff::Compare(std::size_t oldBegin, std::size_t oldEnd, std::size_t newBegin, std::size_t newEnd)
+{
+    const auto &oldLines = m_context.m_oldLines;
+    const auto &newLines = m_context.m_newLines;
+
+    // Les régions restantes sont empilées plutôt que traitées récursivement: une
+    // longue suite d'ancres ferait autrement déborder la pile
+    std::vector<Region> regions{{oldBegin, oldEnd, newBegin, newEnd}};
+    while (!regions.empty())
+    {
+        auto region = regions.back();
+        regions.pop_back();
+
+        for (; (region.m_oldBegin < region.m_oldEnd) && (region.m_newBegin < region.m_newEnd) &&
+               (oldLines[region.m_oldBegin] == newLines[region.m_newBegin]);
+             ++region.m_oldBegin, ++region.m_newBegin)
+        {
+        }
+        for (; (region.m_oldBegin < region.m_oldEnd) && (region.m_newBegin < region.m_newEnd) &&
+               (oldLines[region.m_oldEnd - 1] == newLines[region.m_newEnd - 1]);
+             --region.m_oldEnd, --region.m_newEnd)
+        {
+        }
+        if ((region.m_oldBegin == region.m_oldEnd) || (region.m_newBegin == region.m_newEnd))
+        {
+            m_context.MarkRemoved(region.m_oldBegin, region.m_oldEnd);
+            m_context.MarkAdded(region.m_newBegin, region.m_newEnd);
+            continue;
+        }
+
+        // Les occurrences de chacune des classes sont chaînées dans l'ordre
+        for (auto iLine = region.m_oldEnd; iLine-- > region.m_oldBegin;)
+        {
+            const auto lineClass = oldLines[iLine];
+            m_nexts[iLine] = (m_counts[lineClass] == 0) ? NO_LINE : m_heads[lineClass];
+            m_heads[lineClass] = iLine;
+            ++m_counts[lineClass];
+        }
+
+        Region sequence;
+        bool hasCommonLines{false};
+        const bool isFound = FindCommonSequence(region, sequence, hasCommonLines);
+        for (auto iLine = region.m_oldBegin; iLine < region.m_oldEnd; ++iLine)
+        {
+            m_counts[oldLines[iLine]] = 0;
+        }
+
+        if (isFound)
+        {
+            regions.push_back({sequence.m_oldEnd, region.m_oldEnd, sequence.m_newEnd, region.m_newEnd});
+            regions.push_back({region.m_oldBegin, sequence.m_oldBegin, region.m_newBegin, sequence.m_newBegin});
+        }
+        else if (hasCommonLines)
+        {
+            m_myers.Compare(static_cast<std::ptrdiff_t>(region.m_oldBegin), static_cast<std::ptrdiff_t>(region.m_oldEnd),
+                            static_cast<std::ptrdiff_t>(region.m_newBegin), static_cast<std::ptrdiff_t>(region.m_newEnd), false);
+        }
+        else
+        {
+            m_context.MarkRemoved(region.m_oldBegin, region.m_oldEnd);
+            m_context.MarkAdded(region.m_newBegin, region.m_newEnd);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve la suite de lignes communes <sequence> de la région <region> qui sert
+// d'ancre. Une suite est préférée à une autre si elle contient une ligne plus
+// rare, ou si elle est plus longue à rareté égale.
+// NOTE: Le nouveau texte est parcouru en sautant les lignes d'une suite déjà
+//       trouvée: chacune d'elles mènerait à la même suite.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool HistogramDiff::FindCommonSequence(const Region &region, Region &sequence, bool &hasCommonLines) const noexcept
+{
+    const auto &oldLines = m_context.m_oldLines;
+    const auto &newLines = m_context.m_newLines;
+
+    std::size_t bestCount = MAX_HISTOGRAM_OCCURRENCES + 1U;
+    bool isFound{false};
+    for (auto iNewLine = region.m_newBegin; iNewLine < region.m_newEnd;)
+    {
+        auto iNextNewLine = iNewLine + 1U;
+        const auto lineCount = m_counts[newLines[iNewLine]];
+        hasCommonLines = hasCommonLines || (lineCount > 0);
+        if ((lineCount == 0) || (lineCount > bestCount))
+        {
+            iNewLine = iNextNewLine;
+            continue;
+        }
+
+        for (auto iOldLine = m_heads[newLines[iNewLine]]; iOldLine != NO_LINE; iOldLine = m_nexts[iOldLine])
+        {
+            Region candidate{iOldLine, iOldLine + 1U, iNewLine, iNewLine + 1U};
+            auto count = lineCount;
+            for (; (candidate.m_oldBegin > region.m_oldBegin) && (candidate.m_newBegin > region.m_newBegin) &&
+                   (oldLines[candidate.m_oldBegin - 1] == newLines[candidate.m_newBegin - 1]);)
+            {
+                --candidate.m_oldBegin;
+                --candidate.m_newBegin;
+                count = std::min(count, m_counts[oldLines[candidate.m_oldBegin]]);
+            }
+            for (; (candidate.m_oldEnd < region.m_oldEnd) && (candidate.m_newEnd < region.m_newEnd) &&
+                   (oldLines[candidate.m_oldEnd] == newLines[candidate.m_newEnd]);)
+            {
+                count = std::min(count, m_counts[oldLines[candidate.m_oldEnd]]);
+                ++candidate.m_oldEnd;
+                ++candidate.m_newEnd;
+            }
+            iNextNewLine = std::max(iNextNewLine, candidate.m_newEnd);
+
+            if (!isFound || (count < bestCount) || (candidate.m_oldEnd - candidate.m_oldBegin > sequence.m_oldEnd - sequence.m_oldBegin))
+            {
+                sequence = candidate;
+                bestCount = count;
+                isFound = true;
+            }
+        }
+        iNewLine = iNextNewLine;
+    }
+    return isFound && (bestCount <= MAX_HISTOGRAM_OCCURRENCES);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à <output> les lignes [<begin>, <end>[ du texte <text>, précédées de
+// <prefix>. Une dernière ligne sans '\n' est signalée comme le fait diff.
+////////////////////////////////////////////////////////////////////////////////////
+void WriteLines(const dvcs::DiffText &text, std::size_t begin, std::size_t end, char prefix, std::string &output)
+{
+    for (auto iLine = begin; iLine < end; ++iLine)
+    {
+        const auto line = text.GetLine(iLine);
+        output += prefix;
+        output += line;
+        if (!line.ends_with('\n'))
+        {
+            output += "\n\\ No newline at end of file\n";
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Intervalle de lignes d'un en-tête de bloc: le numéro de la première ligne (à
+// partir de 1) et leur nombre, omis s'il vaut 1. Un intervalle vide est désigné par
+// la ligne qui le précède.
+////////////////////////////////////////////////////////////////////////////////////
+void WriteHunkRange(std::size_t begin, std::size_t count, std::string &output)
+{
+    if (count == 1)
+    {
+        fmt::format_to(std::back_inserter(output), "{}", begin + 1U);
+    }
+    else
+    {
+        fmt::format_to(std::back_inserter(output), "{},{}", (count == 0) ? begin : begin + 1U, count);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à <output> les lignes [<begin>, <end>[ du texte <text>, telles quelles
+////////////////////////////////////////////////////////////////////////////////////
+void AppendLines(const dvcs::DiffText &text, std::size_t begin, std::size_t end, std::string &output)
+{
+    for (auto iLine = begin; iLine < end; ++iLine)
+    {
+        output += text.GetLine(iLine);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à <output> un marqueur de conflit, sur sa propre ligne même si la ligne
+// qui le précède n'a pas de '\n'
+////////////////////////////////////////////////////////////////////////////////////
+void AppendConflictMarker(std::string_view marker, std::string_view label, std::string &output)
+{
+    if (!output.empty() && !output.ends_with('\n'))
+    {
+        output += '\n';
+    }
+    output += marker;
+    if (!label.empty())
+    {
+        output += ' ';
+        output += label;
+    }
+    output += '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si les lignes [<firstBegin>, <firstEnd>[ de <first> sont identiques aux
+// lignes [<secondBegin>, <secondEnd>[ de <second>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool AreLinesEqual(const dvcs::DiffText &first, std::size_t firstBegin, std::size_t firstEnd, const dvcs::DiffText &second,
+                                 std::size_t secondBegin, std::size_t secondEnd) noexcept
+{
+    if ((firstEnd - firstBegin) != (secondEnd - secondBegin))
+    {
+        return false;
+    }
+    for (std::size_t iLine = 0; iLine < firstEnd - firstBegin; ++iLine)
+    {
+        if ((first.GetLineHash(firstBegin + iLine) != second.GetLineHash(secondBegin + iLine)) ||
+            (first.GetLine(firstBegin + iLine) != second.GetLine(secondBegin + iLine)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Le texte est d'abord parcouru en entier pour trouver ses fins de ligne, puis
+// chacune des lignes est hachée: les deux boucles restent simples et le
+// découpage profite des instructions vectorielles.
+////////////////////////////////////////////////////////////////////////////////////
+DiffText::DiffText(std::string_view text, LineScanBackend backend) : m_text{text}
+{
+    if (text.empty())
+    {
+        return;
+    }
+
+    m_isBinary = std::memchr(text.data(), '\0', std::min(text.size(), BINARY_DETECTION_SIZE)) != nullptr;
+    if (m_isBinary)
+    {
+        return;
+    }
+
+    GetFindLineEndsFunction(backend)(text.data(), text.size(), m_lineEnds);
+    if (text.back() != '\n')
+    {
+        m_lineEnds.push_back(text.size());
+    }
+
+    m_lineHashes.resize(m_lineEnds.size());
+    std::size_t lineBegin = 0;
+    for (std::size_t iLine = 0; iLine < m_lineEnds.size(); ++iLine)
+    {
+        m_lineHashes[iLine] = HashLine(text.data() + lineBegin, m_lineEnds[iLine] - lineBegin);
+        lineBegin = m_lineEnds[iLine];
+    }
+}
+
+[[nodiscard]] std::string_view DiffText::GetLine(std::size_t iLine) const noexcept
+{
+    const std::size_t lineBegin = (iLine == 0) ? 0 : m_lineEnds[iLine - 1];
+    return m_text.substr(lineBegin, m_lineEnds[iLine] - lineBegin);
+}
+
+[[nodiscard]] std::vector<DiffChange> ComputeDiff(const DiffText &oldText, const DiffText &newText, DiffAlgorithm algorithm)
+{
+    const auto nbOldLines = oldText.GetNbLines();
+    const auto nbNewLines = newText.GetNbLines();
+
+    DiffContext context;
+    {
+        LineClassifier classifier{nbOldLines + nbNewLines};
+        context.m_oldLines.resize(nbOldLines);
+        for (std::size_t iLine = 0; iLine < nbOldLines; ++iLine)
+        {
+            context.m_oldLines[iLine] = classifier.Classify(oldText.GetLine(iLine), oldText.GetLineHash(iLine));
+        }
+        context.m_newLines.resize(nbNewLines);
+        for (std::size_t iLine = 0; iLine < nbNewLines; ++iLine)
+        {
+            context.m_newLines[iLine] = classifier.Classify(newText.GetLine(iLine), newText.GetLineHash(iLine));
+        }
+        context.m_nbClasses = classifier.GetNbClasses();
+    }
+    context.m_isRemoved.resize(nbOldLines, 0);
+    context.m_isAdded.resize(nbNewLines, 0);
+
+    MyersDiff myers{context};
+    if (algorithm == DiffAlgorithm::Histogram)
+    {
+        HistogramDiff histogram{context, myers};
+        histogram.Compare(0, nbOldLines, 0, nbNewLines);
+    }
+    else
+    {
+        myers.Compare(0, static_cast<std::ptrdiff_t>(nbOldLines), 0, static_cast<std::ptrdiff_t>(nbNewLines), false);
+    }
+
+    // Les lignes inchangées des deux textes s'apparient dans l'ordre: les lignes
+    // marquées qui les séparent forment les modifications
+    std::vector<DiffChange> changes;
+    std::size_t iOldLine = 0;
+    std::size_t iNewLine = 0;
+    while ((iOldLine < nbOldLines) || (iNewLine < nbNewLines))
+    {
+        if (((iOldLine < nbOldLines) && (context.m_isRemoved[iOldLine] != 0)) || ((iNewLine < nbNewLines) && (context.m_isAdded[iNewLine] != 0)))
+        {
+            auto &change = changes.emplace_back(DiffChange{iOldLine, 0, iNewLine, 0});
+            for (; (iOldLine < nbOldLines) && (context.m_isRemoved[iOldLine] != 0); ++iOldLine)
+            {
+                ++change.m_oldCount;
+            }
+            for (; (iNewLine < nbNewLines) && (context.m_isAdded[iNewLine] != 0); ++iNewLine)
+            {
+                ++change.m_newCount;
+            }
+            continue;
+        }
+        ++iOldLine;
+        ++iNewLine;
+    }
+    return changes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les modifications séparées par au plus deux fois <nbContextLines> lignes
+// inchangées partagent le même bloc.
+////////////////////////////////////////////////////////////////////////////////////
+void WriteUnifiedDiff(const DiffText &oldText, const DiffText &newText, const std::vector<DiffChange> &changes, std::size_t nbContextLines,
+                      std::string &output)
+{
+    for (std::size_t iFirst = 0; iFirst < changes.size();)
+    {
+        auto iLast = iFirst;
+        for (; (iLast + 1U < changes.size()) &&
+               (changes[iLast + 1U].m_oldStart - (changes[iLast].m_oldStart + changes[iLast].m_oldCount) <= 2U * nbContextLines);
+             ++iLast)
+        {
+        }
+
+        const auto &first = changes[iFirst];
+        const auto &last = changes[iLast];
+        const auto nbLinesBefore = std::min({nbContextLines, first.m_oldStart, first.m_newStart});
+        const auto nbLinesAfter = std::min({nbContextLines, oldText.GetNbLines() - (last.m_oldStart + last.m_oldCount),
+                                            newText.GetNbLines() - (last.m_newStart + last.m_newCount)});
+        const auto oldBegin = first.m_oldStart - nbLinesBefore;
+        const auto newBegin = first.m_newStart - nbLinesBefore;
+        const auto oldEnd = last.m_oldStart + last.m_oldCount + nbLinesAfter;
+        const auto newEnd = last.m_newStart + last.m_newCount + nbLinesAfter;
+
+        output += "@@ -";
+        WriteHunkRange(oldBegin, oldEnd - oldBegin, output);
+        output += " +";
+        WriteHunkRange(newBegin, newEnd - newBegin, output);
+        output += " @@\n";
+
+        auto iOldLine = oldBegin;
+        for (auto iChange = iFirst; iChange <= iLast; ++iChange)
+        {
+            const auto &change = changes[iChange];
+            WriteLines(oldText, iOldLine, change.m_oldStart, ' ', output);
+            WriteLines(oldText, change.m_oldStart, change.m_oldStart + change.m_oldCount, '-', output);
+            WriteLines(newText, change.m_newStart, change.m_newStart + change.m_newCount, '+', output);
+            iOldLine = change.m_oldStart + change.m_oldCount;
+        }
+        WriteLines(oldText, iOldLine, oldEnd, ' ', output);
+
+        iFirst = iLast + 1U;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les modifications des deux côtés sont parcourues dans l'ordre des lignes de la
+// base et regroupées en régions: une région s'étend tant qu'une modification de
+// l'un ou l'autre des côtés chevauche ou touche ses lignes. Les lignes de la base
+// qui précèdent une région sont intactes des deux côtés, ce qui donne, pour chacun
+// des côtés, le décalage entre ses lignes et celles de la base.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::size_t MergeTexts(const DiffText &base, const DiffText &ours, const DiffText &theirs, DiffAlgorithm algorithm,
+                                     std::string_view oursLabel, std::string_view theirsLabel, std::string &output)
+{
+    const auto oursChanges = ComputeDiff(base, ours, algorithm);
+    const auto theirsChanges = ComputeDiff(base, theirs, algorithm);
+
+    std::size_t nbConflicts{};
+    std::size_t iBaseLine{};
+    std::size_t iOurs{};
+    std::size_t iTheirs{};
+    std::ptrdiff_t oursOffset{};
+    std::ptrdiff_t theirsOffset{};
+    while ((iOurs < oursChanges.size()) || (iTheirs < theirsChanges.size()))
+    {
+        const bool startsWithOurs = (iTheirs == theirsChanges.size()) ||
+                                    ((iOurs < oursChanges.size()) && (oursChanges[iOurs].m_oldStart <= theirsChanges[iTheirs].m_oldStart));
+        const auto &firstChange = startsWithOurs ? oursChanges[iOurs] : theirsChanges[iTheirs];
+        const auto regionBegin = firstChange.m_oldStart;
+        auto regionEnd = firstChange.m_oldStart + firstChange.m_oldCount;
+
+        // Les modifications de chacun des côtés qui font partie de la région sont
+        // [iOurs, iOursEnd[ et [iTheirs, iTheirsEnd[
+        auto iOursEnd = iOurs;
+        auto iTheirsEnd = iTheirs;
+        for (bool isExtended = true; isExtended;)
+        {
+            isExtended = false;
+            for (auto [pChanges, pIndex] : {std::pair{&oursChanges, &iOursEnd}, std::pair{&theirsChanges, &iTheirsEnd}})
+            {
+                for (; (*pIndex < pChanges->size()) && ((*pChanges)[*pIndex].m_oldStart <= regionEnd); ++*pIndex)
+                {
+                    regionEnd = std::max(regionEnd, (*pChanges)[*pIndex].m_oldStart + (*pChanges)[*pIndex].m_oldCount);
+                    isExtended = true;
+                }
+            }
+        }
+
+        const auto oursBegin = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(regionBegin) + oursOffset);
+        const auto theirsBegin = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(regionBegin) + theirsOffset);
+        for (; iOurs < iOursEnd; ++iOurs)
+        {
+            oursOffset += static_cast<std::ptrdiff_t>(oursChanges[iOurs].m_newCount) - static_cast<std::ptrdiff_t>(oursChanges[iOurs].m_oldCount);
+        }
+        for (; iTheirs < iTheirsEnd; ++iTheirs)
+        {
+            theirsOffset +=
+                static_cast<std::ptrdiff_t>(theirsChanges[iTheirs].m_newCount) - static_cast<std::ptrdiff_t>(theirsChanges[iTheirs].m_oldCount);
+        }
+        const auto oursEnd = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(regionEnd) + oursOffset);
+        const auto theirsEnd = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(regionEnd) + theirsOffset);
+
+        AppendLines(base, iBaseLine, regionBegin, output);
+        const bool isOursChanged = !AreLinesEqual(base, regionBegin, regionEnd, ours, oursBegin, oursEnd);
+        const bool isTheirsChanged = !AreLinesEqual(base, regionBegin, regionEnd, theirs, theirsBegin, theirsEnd);
+        if (!isTheirsChanged || AreLinesEqual(ours, oursBegin, oursEnd, theirs, theirsBegin, theirsEnd))
+        {
+            AppendLines(ours, oursBegin, oursEnd, output);
+        }
+        else if (!isOursChanged)
+        {
+            AppendLines(theirs, theirsBegin, theirsEnd, output);
+        }
+        else
+        {
+            AppendConflictMarker("<<<<<<<", oursLabel, output);
+            AppendLines(ours, oursBegin, oursEnd, output);
+            AppendConflictMarker("=======", {}, output);
+            AppendLines(theirs, theirsBegin, theirsEnd, output);
+            AppendConflictMarker(">>>>>>>", theirsLabel, output);
+            ++nbConflicts;
+        }
+        iBaseLine = regionEnd;
+    }
+    AppendLines(base, iBaseLine, base.GetNbLines(), output);
+    return nbConflicts;
+}
+
+[[nodiscard]] std::string_view GetDiffAlgorithmName(DiffAlgorithm algorithm) noexcept
+{
+    switch (algorithm)
+    {
+    case DiffAlgorithm::Myers:
+        return "myers";
+    case DiffAlgorithm::Histogram:
+        return "histogram";
+    }
+    return "unknown";
+}
+
+[[nodiscard]] bool ParseDiffAlgorithm(std::string_view name, DiffAlgorithm &algorithm) noexcept
+{
+    for (const auto candidate : {DiffAlgorithm::Myers, DiffAlgorithm::Histogram})
+    {
+        if (name == GetDiffAlgorithmName(candidate))
+        {
+            algorithm = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+[[nodiscard]] bool IsLineScanBackendSupported(LineScanBackend backend) noexcept
+{
+    switch (backend)
+    {
+    case LineScanBackend::Auto:
+    case LineScanBackend::Generic:
+        return true;
+    case LineScanBackend::SSE2:
+#ifdef DVCS_HAS_X86_SIMD
+        return true;
+#else
+        return false;
+#endif
+    case LineScanBackend::AVX2:
+#ifdef DVCS_HAS_X86_SIMD
+    {
+        static const bool isSupported = CPUSupportsAVX2();
+        return isSupported;
+    }
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+[[nodiscard]] std::string_view GetLineScanBackendName(LineScanBackend backend) noexcept
+{
+    switch (backend)
+    {
+    case LineScanBackend::Auto:
+        return "auto";
+    case LineScanBackend::Generic:
+        return "generic";
+    case LineScanBackend::SSE2:
+        return "sse2";
+    case LineScanBackend::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace dvcs
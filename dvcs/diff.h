@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dvcs
+{
+
+// Nombre de lignes de contexte par défaut autour des modifications (diff unifié)
+constexpr const std::size_t DEFAULT_DIFF_CONTEXT = 3U;
+
+// Un fichier dont les premiers octets contiennent un octet nul est binaire: ses
+// différences ne sont pas détaillées (même heuristique que git)
+constexpr const std::size_t BINARY_DETECTION_SIZE = 8000U;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Algorithme de comparaison de deux textes.
+// Myers trouve un plus court script d'édition. Histogram (jgit) s'ancre plutôt
+// sur les lignes rares communes aux deux textes, ce qui donne des différences plus
+// lisibles pour du code source (les lignes vides ou les accolades ne servent pas
+// d'ancres); il revient à Myers lorsqu'il n'en trouve aucune.
+////////////////////////////////////////////////////////////////////////////////////
+enum class DiffAlgorithm
+{
+    Myers,
+    Histogram
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Implémentation du découpage d'un texte en lignes.
+// Auto choisit la plus rapide supportée par le processeur courant.
+////////////////////////////////////////////////////////////////////////////////////
+enum class LineScanBackend
+{
+    Auto,
+    Generic, // Implémentation portable, octet par octet
+    SSE2,    // 16 octets à la fois (x86-64)
+    AVX2     // 32 octets à la fois (x86-64)
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Texte à comparer, découpé en lignes. Chacune des lignes (son '\n' final compris)
+// a une empreinte qui permet de l'apparier rapidement aux lignes de l'autre texte.
+// Le texte n'est pas copié: il doit survivre à l'instance.
+////////////////////////////////////////////////////////////////////////////////////
+class DiffText
+{
+  public:
+    explicit DiffText(std::string_view text, LineScanBackend backend = LineScanBackend::Auto);
+
+    // Un texte binaire n'est pas découpé: il n'a aucune ligne
+    [[nodiscard]] bool IsBinary() const noexcept { return m_isBinary; }
+    [[nodiscard]] std::size_t GetNbLines() const noexcept { return m_lineHashes.size(); }
+    [[nodiscard]] std::string_view GetLine(std::size_t iLine) const noexcept;
+    [[nodiscard]] std::uint64_t GetLineHash(std::size_t iLine) const noexcept { return m_lineHashes[iLine]; }
+
+  private:
+    std::string_view m_text;
+    std::vector<std::size_t> m_lineEnds; // Position suivant chacune des lignes
+    std::vector<std::uint64_t> m_lineHashes;
+    bool m_isBinary{false};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Modification: les <m_oldCount> lignes de l'ancien texte débutant à la ligne
+// <m_oldStart> sont remplacées par les <m_newCount> lignes du nouveau texte
+// débutant à la ligne <m_newStart>. Les lignes sont numérotées à partir de 0.
+////////////////////////////////////////////////////////////////////////////////////
+struct DiffChange
+{
+    std::size_t m_oldStart{};
+    std::size_t m_oldCount{};
+    std::size_t m_newStart{};
+    std::size_t m_newCount{};
+
+    bool operator==(const DiffChange &) const noexcept = default;
+};
+
+// Modifications qui transforment <oldText> en <newText>, dans l'ordre des lignes
+[[nodiscard]] std::vector<DiffChange> ComputeDiff(const DiffText &oldText, const DiffText &newText, DiffAlgorithm algorithm);
+
+// Ajoute à <output> les blocs (hunks) du diff unifié des modifications <changes>,
+// chacun entouré d'au plus <nbContextLines> lignes inchangées
+void WriteUnifiedDiff(const DiffText &oldText, const DiffText &newText, const std::vector<DiffChange> &changes, std::size_t nbContextLines,
+                      std::string &output);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fusion à trois voies: ajoute à <output> le texte <base> auquel sont appliquées
+// les modifications de <ours> et celles de <theirs>. Les modifications d'un seul
+// des côtés sont reprises telles quelles, tout comme celles qui sont identiques des
+// deux côtés. Celles qui se chevauchent (ou se touchent) sans être identiques sont
+// des conflits: les lignes des deux côtés sont alors écrites, séparées par des
+// marqueurs nommés <oursLabel> et <theirsLabel> (comme le fait git).
+// Aucun des textes ne doit être binaire. Retourne le nombre de conflits.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::size_t MergeTexts(const DiffText &base, const DiffText &ours, const DiffText &theirs, DiffAlgorithm algorithm,
+                                     std::string_view oursLabel, std::string_view theirsLabel, std::string &output);
+
+[[nodiscard]] std::string_view GetDiffAlgorithmName(DiffAlgorithm algorithm) noexcept;
+[[nodiscard]] bool ParseDiffAlgorithm(std::string_view name, DiffAlgorithm &algorithm) noexcept;
+
+[[nodiscard]] bool IsLineScanBackendSupported(LineScanBackend backend) noexcept;
+[[nodiscard]] std::string_view GetLineScanBackendName(LineScanBackend backend) noexcept;
+
+} // namespace dvcs
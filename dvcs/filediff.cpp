@@ -0,0 +1,460 @@
+#include "filediff.h"
+#include "diff.h"
+#include "paths.h"
+#include "threadpool.h"
+#include "tree.h"
+#include "worktree.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// Indique si deux fichiers de tailles <lhsSize> et <rhsSize> peuvent atteindre la
+// similarité <threshold> (en pourcentage)
+[[nodiscard]] bool IsSizeSimilar(std::uintmax_t lhsSize, std::uintmax_t rhsSize, std::size_t threshold) noexcept
+{
+    return std::min(lhsSize, rhsSize) * 100U >= std::max(lhsSize, rhsSize) * threshold;
+}
+
+// Nombre de fichiers comparés d'avance par chacun des fils d'exécution de
+// WriteFileDiffs
+// pendant que les différences des précédents sont affichées
+constexpr const std::size_t DIFF_FILES_PER_WORKER = 4U;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère les données <data> de la nouvelle version du fichier <fileDiff> (ou de
+// l'ancienne si <isOld>), lues à l'aide de <reader> ou dans l'arbre de travail du
+// dépôt dont la racine est <rootPath>. Une version absente est vide.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ReadFileVersion(dvcs::ObjectReader &reader, const fs::path &rootPath, const dvcs::FileDiff &fileDiff, bool isOld,
+                                   std::vector<char> &data)
+{
+    data.clear();
+    const auto &hash = isOld ? fileDiff.m_oldHash : fileDiff.m_newHash;
+    RETURN_IF(!hash, true);
+    return (isOld || !fileDiff.m_isInWorkingTree) ? reader.Read(*hash, data) : dvcs::ReadWorkingTreeData(rootPath, fileDiff.m_path, data);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ajoute à <output> les différences entre les deux versions du fichier
+// <fileDiff>, au format unifié (voir dvcs::WriteUnifiedDiff). Seul un en-tête est
+// donné pour un fichier binaire, ou pour un fichier renommé ou copié sans être
+// modifié.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteFileDiff(dvcs::ObjectReader &reader, const fs::path &rootPath, const dvcs::FileDiff &fileDiff,
+                                 const dvcs::DiffOptions &options, std::string &output)
+{
+    const auto displayPath = dvcs::GetDisplayPath(fileDiff.m_path);
+    const auto oldDisplayPath = fileDiff.m_oldPath.empty() ? displayPath : dvcs::GetDisplayPath(fileDiff.m_oldPath);
+    const auto oldLabel = fileDiff.m_oldHash ? "a/" + oldDisplayPath : std::string{"/dev/null"};
+    const auto newLabel = fileDiff.m_newHash ? "b/" + displayPath : std::string{"/dev/null"};
+    fmt::format_to(std::back_inserter(output), "diff a/{0} b/{1}\n", oldDisplayPath, displayPath);
+    if (!fileDiff.m_oldPath.empty())
+    {
+        fmt::format_to(std::back_inserter(output), "similarity index {0}%\n{1} from {2}\n{1} to {3}\n", fileDiff.m_similarity,
+                       fileDiff.m_isCopy ? "copy" : "rename", oldDisplayPath, displayPath);
+        RETURN_IF(fileDiff.m_oldHash == fileDiff.m_newHash, true);
+    }
+
+    std::vector<char> oldData;
+    std::vector<char> newData;
+    RETURN_IF(!ReadFileVersion(reader, rootPath, fileDiff, true, oldData) || !ReadFileVersion(reader, rootPath, fileDiff, false, newData), false);
+
+    const dvcs::DiffText oldText{{oldData.data(), oldData.size()}};
+    const dvcs::DiffText newText{{newData.data(), newData.size()}};
+    if (oldText.IsBinary() || newText.IsBinary())
+    {
+        fmt::format_to(std::back_inserter(output), "Binary files {0} and {1} differ\n", oldLabel, newLabel);
+        return true;
+    }
+
+    fmt::format_to(std::back_inserter(output), "--- {0}\n+++ {1}\n", oldLabel, newLabel);
+    dvcs::WriteUnifiedDiff(oldText, newText, dvcs::ComputeDiff(oldText, newText, options.m_algorithm), options.m_nbContextLines, output);
+    return true;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] bool FindSimilarFiles(const fs::path &rootPath, const std::vector<SimilarFile> &sources, const std::vector<SimilarFile> &destinations,
+                                    const RenameOptions &options, std::vector<SimilarPair> &pairs)
+{
+    pairs.clear();
+    std::unordered_map<THash, std::vector<std::size_t>, HashHasher> sourcesByHash;
+    for (std::size_t iSource = 0; iSource < sources.size(); ++iSource)
+    {
+        if (sources[iSource].m_size > 0)
+        {
+            sourcesByHash[sources[iSource].m_hash].push_back(iSource);
+        }
+    }
+
+    std::vector<std::size_t> inexactDestinations;
+    for (std::size_t iDestination = 0; iDestination < destinations.size(); ++iDestination)
+    {
+        const auto &destination = destinations[iDestination];
+        const auto sourcesIt = sourcesByHash.find(destination.m_hash);
+        if (destination.m_size == 0)
+        {
+            continue;
+        }
+        if (sourcesIt == sourcesByHash.end())
+        {
+            inexactDestinations.push_back(iDestination);
+            continue;
+        }
+        const auto &identicalSources = sourcesIt->second;
+        for (std::size_t iSource = 0; iSource < std::min(identicalSources.size(), options.m_candidateLimit); ++iSource)
+        {
+            pairs.push_back(SimilarPair{identicalSources[iSource], iDestination, 100U});
+        }
+    }
+    if (options.m_threshold >= 100U)
+    {
+        inexactDestinations.clear();
+    }
+    else if (!inexactDestinations.empty() && (std::max(sources.size(), inexactDestinations.size()) > options.m_renameLimit))
+    {
+        fmt::print(std::cerr, "warning: inexact rename detection was skipped due to too many files.\n");
+        inexactDestinations.clear();
+    }
+
+    // Un fichier n'est lu que si l'un des fichiers de l'autre côté a une taille
+    // compatible avec la sienne
+    std::vector<std::uintmax_t> sourceSizes;
+    std::vector<std::uintmax_t> destinationSizes;
+    if (!inexactDestinations.empty())
+    {
+        for (const auto &source : sources)
+        {
+            if (source.m_size > 0)
+            {
+                sourceSizes.push_back(source.m_size);
+            }
+        }
+        for (const auto iDestination : inexactDestinations)
+        {
+            destinationSizes.push_back(destinations[iDestination].m_size);
+        }
+        std::sort(sourceSizes.begin(), sourceSizes.end());
+        std::sort(destinationSizes.begin(), destinationSizes.end());
+    }
+    auto hasSimilarSize = [&options](std::uintmax_t size, const std::vector<std::uintmax_t> &sortedSizes) {
+        const auto sizeIt = std::lower_bound(sortedSizes.cbegin(), sortedSizes.cend(), size * options.m_threshold / 100U);
+        return (sizeIt != sortedSizes.cend()) && IsSizeSimilar(size, *sizeIt, options.m_threshold);
+    };
+
+    std::vector<SimilaritySketch> sourceSketches(sources.size());
+    std::vector<SimilaritySketch> destinationSketches(destinations.size());
+    std::vector<std::pair<const SimilarFile *, SimilaritySketch *>> sketchedFiles;
+    for (std::size_t iSource = 0; iSource < sources.size(); ++iSource)
+    {
+        if ((sources[iSource].m_size > 0) && hasSimilarSize(sources[iSource].m_size, destinationSizes))
+        {
+            sketchedFiles.emplace_back(&sources[iSource], &sourceSketches[iSource]);
+        }
+    }
+    for (const auto iDestination : inexactDestinations)
+    {
+        if (hasSimilarSize(destinations[iDestination].m_size, sourceSizes))
+        {
+            sketchedFiles.emplace_back(&destinations[iDestination], &destinationSketches[iDestination]);
+        }
+    }
+
+    // NOTE: Une connexion SQLite ne doit servir qu'à un seul fil d'exécution à la
+    //       fois: chacun des fils ouvre donc la sienne et pige ses fichiers à lire
+    //       à même une liste commune.
+    const auto repoDBPath = rootPath / REPO_DB_PATH;
+    std::atomic<std::size_t> nextIndex{0};
+    std::atomic<bool> isValid{true};
+    ParallelFor(std::min(sketchedFiles.size(), GetWorkerCount()), [&](std::size_t /* iWorker */) {
+        TDatabasePtr pDB{nullptr, sqlite3_close};
+        if (!OpenDatabaseConnection(repoDBPath, pDB, SQLITE_OPEN_READONLY) || (sqlite3_busy_timeout(pDB.get(), BUSY_TIMEOUT_MS) != SQLITE_OK))
+        {
+            isValid = false;
+            return;
+        }
+        ObjectReader reader{pDB, "main"};
+        std::vector<char> data;
+        for (std::size_t index = nextIndex++; index < sketchedFiles.size(); index = nextIndex++)
+        {
+            try
+            {
+                const auto &[pFile, pSketch] = sketchedFiles[index];
+                if (pFile->m_isInWorkingTree ? !ReadWorkingTreeData(rootPath, pFile->m_path, data) : !reader.Read(pFile->m_hash, data))
+                {
+                    isValid = false;
+                    continue;
+                }
+                *pSketch = SimilaritySketch{{data.data(), data.size()}};
+            }
+            catch (const std::exception &)
+            {
+                isValid = false;
+            }
+        }
+    });
+    RETURN_IF(!isValid, false);
+
+    for (auto pair : FindSimilarPairs(sourceSketches, destinationSketches, options.m_threshold, options.m_candidateLimit))
+    {
+        pair.m_similarity = std::min<std::size_t>(pair.m_similarity, 99U);
+        if ((pair.m_similarity >= options.m_threshold) &&
+            IsSizeSimilar(sources[pair.m_source].m_size, destinations[pair.m_destination].m_size, options.m_threshold))
+        {
+            pairs.push_back(pair);
+        }
+    }
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const SimilarPair &lhs, const SimilarPair &rhs) { return lhs.m_similarity > rhs.m_similarity; });
+    return true;
+}
+
+[[nodiscard]] bool GetWorkingTreeDiffs(StatementCache &statements, const fs::path &rootPath, const THash &commit,
+                                       std::vector<FileDiff> &fileDiffs)
+{
+    HashAlgorithm algorithm{};
+    RETURN_IF(!GetHashAlgorithm(statements.GetDatabase(), "main", algorithm), false);
+
+    std::vector<TreeEntry> tree;
+    RETURN_IF(!LoadCommitTree(statements, commit, tree), false);
+    std::map<std::string, std::optional<TreeItem>> trackedFiles;
+    for (auto &entry : tree)
+    {
+        trackedFiles.emplace(std::move(entry.m_path), TreeItem{entry.m_hash, false, entry.m_size});
+    }
+    {
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Path FROM Staging.Paths;", pStmt), false);
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+        {
+            trackedFiles.try_emplace(std::string{GetColumnText(pStmt, 0)});
+        }
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+    }
+
+    // Les chemins d'accès des objets sont relatifs au répertoire interne de DVCSUS
+    std::vector<WorkingFile> files;
+    std::size_t nbHashed{};
+    RETURN_IF(!ScanWorkingTree({{rootPath, "../"}}, files) || !HashWorkingFiles(statements, rootPath, algorithm, files, nbHashed), false);
+
+    // Les fichiers de l'arbre de travail sont triés par HashWorkingFiles
+    for (const auto &[path, oldItem] : trackedFiles)
+    {
+        const auto fileIt = std::lower_bound(files.cbegin(), files.cend(), path,
+                                             [](const WorkingFile &file, const std::string &filePath) { return file.m_path < filePath; });
+        const auto oldSize = oldItem ? oldItem->m_size : 0U;
+        if ((fileIt == files.cend()) || (fileIt->m_path != path))
+        {
+            if (oldItem)
+            {
+                fileDiffs.push_back(FileDiff{path, oldItem->m_hash, std::nullopt, false, oldSize});
+            }
+        }
+        else if (!oldItem || (oldItem->m_hash != fileIt->m_hash))
+        {
+            auto &fileDiff =
+                fileDiffs.emplace_back(FileDiff{path, std::nullopt, fileIt->m_hash, true, oldSize, static_cast<std::uintmax_t>(fileIt->m_size)});
+            if (oldItem)
+            {
+                fileDiff.m_oldHash = oldItem->m_hash;
+            }
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool GetCommitDiffs(StatementCache &statements, const THash &oldCommit, const THash &newCommit, std::vector<FileDiff> &fileDiffs)
+{
+    THash oldTree{};
+    THash newTree{};
+    std::vector<TreeChange> changes;
+    RETURN_IF(!GetCommitTree(statements, oldCommit, oldTree) || !GetCommitTree(statements, newCommit, newTree) ||
+                  !DiffTrees(statements, oldTree, newTree, "../", changes),
+              false);
+    for (const auto &change : changes)
+    {
+        auto &fileDiff = fileDiffs.emplace_back(FileDiff{change.m_path, std::nullopt, std::nullopt, false});
+        if (change.m_oldItem)
+        {
+            fileDiff.m_oldHash = change.m_oldItem->m_hash;
+            fileDiff.m_oldSize = change.m_oldItem->m_size;
+        }
+        if (change.m_newItem)
+        {
+            fileDiff.m_newHash = change.m_newItem->m_hash;
+            fileDiff.m_newSize = change.m_newItem->m_size;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool DetectRenames(StatementCache &statements, const fs::path &rootPath, const THash &oldCommit,
+                                 const RenameOptions &options, std::vector<FileDiff> &fileDiffs)
+{
+    const bool detectCopies = options.m_detectCopies || options.m_findCopiesHarder;
+    std::vector<SimilarFile> sources;
+    std::vector<std::optional<std::size_t>> removedDiffs; // Fichier comparé retiré de chacune des sources
+    std::vector<SimilarFile> destinations;
+    std::vector<std::size_t> addedDiffs;
+    for (std::size_t index = 0; index < fileDiffs.size(); ++index)
+    {
+        const auto &fileDiff = fileDiffs[index];
+        if (fileDiff.m_oldHash && !fileDiff.m_newHash)
+        {
+            sources.push_back(SimilarFile{fileDiff.m_path, *fileDiff.m_oldHash, fileDiff.m_oldSize, false});
+            removedDiffs.emplace_back(index);
+        }
+        else if (!fileDiff.m_oldHash && fileDiff.m_newHash)
+        {
+            destinations.push_back(SimilarFile{fileDiff.m_path, *fileDiff.m_newHash, fileDiff.m_newSize, fileDiff.m_isInWorkingTree});
+            addedDiffs.push_back(index);
+        }
+    }
+    RETURN_IF(destinations.empty(), true);
+
+    std::vector<TreeEntry> oldFiles;
+    if (options.m_findCopiesHarder)
+    {
+        RETURN_IF(!LoadCommitTree(statements, oldCommit, oldFiles), false);
+        std::unordered_set<std::string_view> removedPaths;
+        for (const auto &source : sources)
+        {
+            removedPaths.insert(source.m_path);
+        }
+        for (const auto &entry : oldFiles)
+        {
+            if (!removedPaths.contains(entry.m_path))
+            {
+                sources.push_back(SimilarFile{entry.m_path, entry.m_hash, entry.m_size, false});
+                removedDiffs.emplace_back();
+            }
+        }
+    }
+    else if (detectCopies)
+    {
+        for (const auto &fileDiff : fileDiffs)
+        {
+            if (fileDiff.m_oldHash && fileDiff.m_newHash)
+            {
+                sources.push_back(SimilarFile{fileDiff.m_path, *fileDiff.m_oldHash, fileDiff.m_oldSize, false});
+                removedDiffs.emplace_back();
+            }
+        }
+    }
+
+    std::vector<SimilarPair> pairs;
+    RETURN_IF(!FindSimilarFiles(rootPath, sources, destinations, options, pairs), false);
+
+    std::vector<bool> isDestinationFound(destinations.size(), false);
+    std::vector<bool> isRenamed(fileDiffs.size(), false);
+    for (const auto &pair : pairs)
+    {
+        const auto &removedDiff = removedDiffs[pair.m_source];
+        const bool isRename = removedDiff && !isRenamed[*removedDiff];
+        if (isDestinationFound[pair.m_destination] || (!isRename && !detectCopies))
+        {
+            continue;
+        }
+        isDestinationFound[pair.m_destination] = true;
+        if (isRename)
+        {
+            isRenamed[*removedDiff] = true;
+        }
+
+        const auto &source = sources[pair.m_source];
+        auto &fileDiff = fileDiffs[addedDiffs[pair.m_destination]];
+        fileDiff.m_oldPath = source.m_path;
+        fileDiff.m_oldHash = source.m_hash;
+        fileDiff.m_oldSize = source.m_size;
+        fileDiff.m_similarity = pair.m_similarity;
+        fileDiff.m_isCopy = !isRename;
+    }
+
+    // NOTE: Les chemins d'accès des sources renvoient aux fichiers comparés: ceux
+    //       qui sont renommés ne sont retirés qu'une fois les paires formées.
+    std::vector<FileDiff> remainingDiffs;
+    for (std::size_t index = 0; index < fileDiffs.size(); ++index)
+    {
+        if (!isRenamed[index])
+        {
+            remainingDiffs.push_back(std::move(fileDiffs[index]));
+        }
+    }
+    fileDiffs = std::move(remainingDiffs);
+    return true;
+}
+
+[[nodiscard]] bool WriteFileDiffs(const fs::path &rootPath, const std::vector<FileDiff> &fileDiffs, const DiffOptions &options,
+                                  std::ostream &output)
+{
+    // NOTE: Une connexion SQLite ne doit servir qu'à un seul fil d'exécution à la
+    //       fois: chacun des fils ouvre donc la sienne à sa première comparaison.
+    struct WorkerConnection
+    {
+        TDatabasePtr m_pDB{nullptr, sqlite3_close};
+        std::optional<ObjectReader> m_reader;
+    };
+    std::vector<WorkerConnection> connections(GetWorkerCount());
+    const auto repoDBPath = rootPath / REPO_DB_PATH;
+    auto diffFile = [&](std::size_t iWorker, std::size_t index) -> std::optional<std::string> {
+        try
+        {
+            auto &connection = connections[iWorker];
+            if (!connection.m_reader)
+            {
+                if (!OpenDatabaseConnection(repoDBPath, connection.m_pDB, SQLITE_OPEN_READONLY) ||
+                    (sqlite3_busy_timeout(connection.m_pDB.get(), BUSY_TIMEOUT_MS) != SQLITE_OK))
+                {
+                    return std::nullopt;
+                }
+                connection.m_reader.emplace(connection.m_pDB, "main");
+            }
+
+            std::string diff;
+            RETURN_IF(!WriteFileDiff(*connection.m_reader, rootPath, fileDiffs[index], options, diff), std::nullopt);
+            return diff;
+        }
+        catch (const std::exception &)
+        {
+            return std::nullopt;
+        }
+    };
+
+    bool isValid{true};
+    const auto writeDiff = [&](std::size_t index, std::optional<std::string> &&diff) {
+        if (!diff)
+        {
+            fmt::print(std::cerr, "Can't diff '{}'\n", GetDisplayPath(fileDiffs[index].m_path));
+            isValid = false;
+            return;
+        }
+        output.write(diff->data(), static_cast<std::streamsize>(diff->size()));
+    };
+    ParallelForOrdered(fileDiffs.size(), DIFF_FILES_PER_WORKER * GetWorkerCount(), diffFile, writeDiff);
+    output.flush();
+    return isValid;
+}
+
+} // namespace dvcs
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "commands.h"
+#include "database.h"
+#include "hash.h"
+#include "similarity.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Version d'un fichier considérée par la détection des renommages et des copies
+////////////////////////////////////////////////////////////////////////////////////
+struct SimilarFile
+{
+    std::string_view m_path; // Chemin d'accès représenté comme celui des objets
+    THash m_hash{};
+    std::uintmax_t m_size{};
+    bool m_isInWorkingTree{false}; // Lue dans l'arbre de travail plutôt que dans le dépôt
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve les paires <pairs> des fichiers <sources> et <destinations> du dépôt dont
+// la racine est <rootPath> qui sont semblables selon <options>, de la plus
+// semblable à la moins semblable (voir FindSimilarPairs). Les fichiers vides
+// sont ignorés.
+// Une destination identique à des sources n'est apparentée qu'à celles-ci, sans
+// que les données d'aucun des fichiers soient lues. Seuls les autres fichiers dont
+// la taille permet d'atteindre le seuil de similarité sont lus, par un bassin de
+// fils d'exécution ayant chacun sa propre connexion au dépôt, pour calculer leurs
+// signatures. La similarité de fichiers différents est d'au plus 99%.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FindSimilarFiles(const fs::path &rootPath, const std::vector<SimilarFile> &sources, const std::vector<SimilarFile> &destinations,
+                                    const RenameOptions &options, std::vector<SimilarPair> &pairs);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichier comparé par Diff. Ses deux versions sont des objets du dépôt, sauf la
+// nouvelle lorsqu'elle est lue dans l'arbre de travail. L'ancienne version d'un
+// fichier renommé ou copié est celle de sa source.
+////////////////////////////////////////////////////////////////////////////////////
+struct FileDiff
+{
+    std::string m_path;             // Chemin d'accès représenté comme celui des objets
+    std::optional<THash> m_oldHash; // Absent d'un fichier ajouté
+    std::optional<THash> m_newHash; // Absent d'un fichier retiré
+    bool m_isInWorkingTree{false};
+    std::uintmax_t m_oldSize{};
+    std::uintmax_t m_newSize{};
+    std::string m_oldPath{};    // Source d'un fichier renommé ou copié, vide sinon
+    std::size_t m_similarity{}; // Similarité avec la source, en pourcentage
+    bool m_isCopy{false};       // La source n'est pas retirée
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve les fichiers suivis <fileDiffs> de l'arbre de travail du dépôt dont la
+// racine est <rootPath> qui diffèrent de ceux du commit <commit>, triés selon leur
+// chemin d'accès. Les fichiers suivis sont ceux du commit et de la zone de
+// staging: comme pour git diff, les autres sont ignorés.
+// Seuls les fichiers dont les attributs ont changé sont hachés (voir
+// HashWorkingFiles).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetWorkingTreeDiffs(StatementCache &statements, const fs::path &rootPath, const THash &commit,
+                                       std::vector<FileDiff> &fileDiffs);
+
+// Trouve les fichiers <fileDiffs> qui diffèrent entre les commits <oldCommit> et
+// <newCommit>, triés selon leur chemin d'accès (voir DiffTrees)
+[[nodiscard]] bool GetCommitDiffs(StatementCache &statements, const THash &oldCommit, const THash &newCommit, std::vector<FileDiff> &fileDiffs);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve, parmi les fichiers comparés <fileDiffs>, ceux qui sont ajoutés alors
+// qu'ils sont semblables à un fichier du commit <oldCommit> (voir
+// FindSimilarFiles). Ils deviennent des renommages d'un fichier retiré, qui n'est
+// alors plus comparé, ou des copies d'un fichier modifié (ou de n'importe lequel
+// des fichiers du commit, selon <options>). Les paires les plus semblables sont
+// retenues d'abord et un fichier retiré n'est renommé qu'une fois.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool DetectRenames(StatementCache &statements, const fs::path &rootPath, const THash &oldCommit,
+                                 const RenameOptions &options, std::vector<FileDiff> &fileDiffs);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit dans <output> les différences entre les deux versions de chacun des
+// fichiers <fileDiffs> du dépôt dont la racine est <rootPath>, au format unifié
+// (voir dvcs::WriteUnifiedDiff). Les fichiers sont comparés en parallèle par un
+// bassin de fils d'exécution ayant chacun sa propre connexion au dépôt, et leurs
+// différences sont écrites dans l'ordre au fur et à mesure qu'elles sont
+// calculées: celles des premiers fichiers apparaissent sans attendre les suivants.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteFileDiffs(const fs::path &rootPath, const std::vector<FileDiff> &fileDiffs, const DiffOptions &options,
+                                  std::ostream &output);
+
+} // namespace dvcs
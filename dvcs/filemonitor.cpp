@@ -0,0 +1,364 @@
+#include "filemonitor.h"
+#include "paths.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// Répertoire racine de l'arbre de travail, représenté comme les chemins des objets
+// (relatifs au répertoire interne de DVCSUS)
+const std::string ROOT_DIRECTORY_PATH{"../"};
+
+// Événements surveillés sur chacun des répertoires de l'arbre de travail.
+// NOTE: IN_CLOSE_WRITE couvre les fichiers modifiés à l'aide de mmap, pour
+//       lesquels IN_MODIFY n'est pas émis.
+constexpr const std::uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+                                           IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+// Délai sans nouvel événement après lequel les chemins en attente sont consignés
+constexpr const int FLUSH_DELAY_MS = 50;
+
+// Nombre de chemins en attente à partir duquel ils sont consignés sans délai
+constexpr const std::size_t MAX_PENDING_PATHS = 4096;
+
+// Taille du tampon de lecture des événements: plusieurs centaines d'événements
+// sont ainsi lus d'un coup
+constexpr const std::size_t EVENTS_BUFFER_SIZE = 64U * 1024U;
+
+void CloseDescriptor(int &descriptor) noexcept
+{
+    if (descriptor >= 0)
+    {
+        ::close(descriptor);
+        descriptor = -1;
+    }
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+FileMonitor::FileMonitor(fs::path rootPath) noexcept : m_rootPath{std::move(rootPath)} {}
+
+FileMonitor::~FileMonitor()
+{
+    // NOTE: Le verrou est libéré avec son descripteur
+    CloseDescriptor(m_stopDescriptor);
+    CloseDescriptor(m_inotifyDescriptor);
+    CloseDescriptor(m_lockDescriptor);
+}
+
+[[nodiscard]] bool FileMonitor::Start() noexcept
+{
+    try
+    {
+        RETURN_IF(!m_repository.Open(m_rootPath), false);
+        m_rootPath = m_repository.GetRootPath();
+
+        // Un seul moniteur par dépôt
+        const auto lockPath = m_rootPath / FILE_MONITOR_LOCK_PATH;
+        m_lockDescriptor = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if ((m_lockDescriptor < 0) || (::flock(m_lockDescriptor, LOCK_EX | LOCK_NB) != 0))
+        {
+            fmt::print(std::cerr, "Can't lock '{}': is a file monitor already running?\n", lockPath.native());
+            return false;
+        }
+
+        m_inotifyDescriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        m_stopDescriptor = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        RETURN_IF((m_inotifyDescriptor < 0) || (m_stopDescriptor < 0), false);
+        m_cookieWatch = ::inotify_add_watch(m_inotifyDescriptor, (m_rootPath / DVCS_PATH).c_str(), IN_CREATE | IN_ONLYDIR);
+        RETURN_IF(m_cookieWatch < 0, false);
+
+        // NOTE: La session ne commence qu'une fois tous les répertoires surveillés:
+        //       le parcours complet qui la synchronisera verra tout ce qui précède.
+        return AddWatches(ROOT_DIRECTORY_PATH) && BeginSession();
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+void FileMonitor::Run() noexcept
+{
+    std::array<pollfd, 2> descriptors{{{m_inotifyDescriptor, POLLIN, 0}, {m_stopDescriptor, POLLIN, 0}}};
+    while (true)
+    {
+        // Les chemins en attente sont consignés dès que les événements se calment
+        const int nbReady = ::poll(descriptors.data(), descriptors.size(), m_changedPaths.empty() ? -1 : FLUSH_DELAY_MS);
+        if (nbReady < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if ((descriptors[1].revents != 0) || !((nbReady == 0) ? Flush() : ProcessEvents()))
+        {
+            break;
+        }
+    }
+
+    // Le journal n'est plus tenu à jour: les commandes parcourront l'arbre de
+    // travail au complet
+    static_cast<void>(EndFileMonitorSession(m_repository));
+}
+
+void FileMonitor::Stop() noexcept
+{
+    const std::uint64_t value{1};
+    [[maybe_unused]] const auto nbWritten = ::write(m_stopDescriptor, &value, sizeof(value));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Surveille le répertoire <directoryPath> ainsi que tous ses sous-répertoires, à
+// l'exception des répertoires internes de DVCSUS (comme ScanDirectory)
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FileMonitor::AddWatches(const std::string &directoryPath) noexcept
+{
+    try
+    {
+        std::vector<std::string> directories{directoryPath};
+        while (!directories.empty())
+        {
+            const auto path = std::move(directories.back());
+            directories.pop_back();
+
+            const auto fullPath = m_rootPath / std::string_view{path}.substr(ROOT_DIRECTORY_PATH.size());
+            const int watch = ::inotify_add_watch(m_inotifyDescriptor, fullPath.c_str(), WATCH_MASK);
+            if (watch < 0)
+            {
+                // Un répertoire peut disparaître avant d'être surveillé
+                if ((errno == ENOENT) || (errno == ENOTDIR))
+                {
+                    continue;
+                }
+                // ENOSPC: la limite fs.inotify.max_user_watches est atteinte
+                fmt::print(std::cerr, "Can't watch '{}'\n", fullPath.native());
+                return false;
+            }
+            m_watches[watch] = path;
+
+            std::unique_ptr<DIR, int (*)(DIR *)> pDir{::opendir(fullPath.c_str()), ::closedir};
+            if (pDir == nullptr)
+            {
+                continue;
+            }
+            while (const dirent *pEntry = ::readdir(pDir.get()))
+            {
+                const std::string_view name{pEntry->d_name};
+                if ((name == ".") || (name == "..") || (name == DVCS_PATH.native()))
+                {
+                    continue;
+                }
+                bool isDirectory = (pEntry->d_type == DT_DIR);
+                if (pEntry->d_type == DT_UNKNOWN)
+                {
+                    struct stat fileStat
+                    {
+                    };
+                    isDirectory = (::fstatat(::dirfd(pDir.get()), pEntry->d_name, &fileStat, AT_SYMLINK_NOFOLLOW) == 0) && S_ISDIR(fileStat.st_mode);
+                }
+                if (isDirectory)
+                {
+                    directories.push_back(fmt::format("{0}{1}/", path, name));
+                }
+            }
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Cesse de surveiller le répertoire <directoryPath> ainsi que ses sous-répertoires
+////////////////////////////////////////////////////////////////////////////////////
+void FileMonitor::RemoveWatches(const std::string &directoryPath) noexcept
+{
+    for (auto watchIt = m_watches.begin(); watchIt != m_watches.end();)
+    {
+        if (watchIt->second.starts_with(directoryPath))
+        {
+            ::inotify_rm_watch(m_inotifyDescriptor, watchIt->first);
+            watchIt = m_watches.erase(watchIt);
+        }
+        else
+        {
+            ++watchIt;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lit tous les événements disponibles et met de côté les chemins qu'ils touchent.
+// Un répertoire créé ou déplacé dans l'arbre de travail est surveillé dès qu'il est
+// vu; les fichiers qui y sont apparus avant cela sont couverts par son propre
+// chemin, qui est parcouru au complet par status.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FileMonitor::ProcessEvents() noexcept
+{
+    try
+    {
+        alignas(inotify_event) std::array<char, EVENTS_BUFFER_SIZE> buffer;
+        bool isOverflow{false};
+        while (true)
+        {
+            const auto nbRead = ::read(m_inotifyDescriptor, buffer.data(), buffer.size());
+            if (nbRead < 0)
+            {
+                RETURN_IF(errno == EAGAIN, true);
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+
+            for (std::size_t offset{}; offset < static_cast<std::size_t>(nbRead);)
+            {
+                const auto *pEvent = reinterpret_cast<const inotify_event *>(buffer.data() + offset);
+                offset += sizeof(inotify_event) + pEvent->len;
+
+                if ((pEvent->mask & IN_Q_OVERFLOW) != 0)
+                {
+                    isOverflow = true;
+                    continue;
+                }
+                const std::string_view name{(pEvent->len != 0) ? pEvent->name : ""};
+                if (pEvent->wd == m_cookieWatch)
+                {
+                    if (name.starts_with(FILE_MONITOR_COOKIE_PREFIX))
+                    {
+                        m_cookies.emplace_back(name);
+                    }
+                    continue;
+                }
+
+                const auto watchIt = m_watches.find(pEvent->wd);
+                if (watchIt == m_watches.end())
+                {
+                    continue;
+                }
+                if ((pEvent->mask & IN_IGNORED) != 0)
+                {
+                    m_watches.erase(watchIt);
+                    continue;
+                }
+                if (name.empty() || (name == DVCS_PATH.native()))
+                {
+                    continue;
+                }
+
+                auto path = watchIt->second + std::string{name};
+                if ((pEvent->mask & IN_ISDIR) != 0)
+                {
+                    if ((pEvent->mask & IN_MOVED_FROM) != 0)
+                    {
+                        RemoveWatches(path + '/');
+                    }
+                    else if (((pEvent->mask & (IN_CREATE | IN_MOVED_TO)) != 0) && !AddWatches(path + '/'))
+                    {
+                        return false;
+                    }
+                }
+                m_changedPaths.insert(std::move(path));
+            }
+
+            if (isOverflow)
+            {
+                // Des événements ont été perdus, dont possiblement la création de
+                // répertoires qu'il faut surveiller
+                isOverflow = false;
+                m_changedPaths.clear();
+                RemoveWatches(ROOT_DIRECTORY_PATH);
+                RETURN_IF(!AddWatches(ROOT_DIRECTORY_PATH) || !BeginSession(), false);
+            }
+
+            // Une commande attend son fichier témoin
+            if (!m_cookies.empty() || (m_changedPaths.size() >= MAX_PENDING_PATHS))
+            {
+                RETURN_IF(!Flush(), false);
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Consigne les chemins en attente, suivis des fichiers témoins qui les couvrent
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FileMonitor::Flush() noexcept
+{
+    RETURN_IF(m_changedPaths.empty() && m_cookies.empty(), true);
+    try
+    {
+        std::vector<std::string> paths(m_changedPaths.cbegin(), m_changedPaths.cend());
+        paths.insert(paths.end(), m_cookies.cbegin(), m_cookies.cend());
+        RETURN_IF(!RecordChangedPaths(m_repository, paths), false);
+        m_changedPaths.clear();
+        m_cookies.clear();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Commence une nouvelle session, qui doit être synchronisée par un parcours complet
+// de l'arbre de travail
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FileMonitor::BeginSession() noexcept
+{
+    try
+    {
+        const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return BeginFileMonitorSession(m_repository, fmt::format("{0}-{1}", ::getpid(), now));
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+} // namespace dvcs
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "commands.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+// Préfixe des fichiers témoins qu'une commande crée dans le répertoire interne de
+// DVCSUS pour s'assurer que le moniteur a consigné toutes les modifications
+// survenues avant elle (voir FileMonitor)
+constexpr const std::string_view FILE_MONITOR_COOKIE_PREFIX = "fsmonitor-cookie-";
+
+////////////////////////////////////////////////////////////////////////////////////
+// Moniteur des fichiers de l'arbre de travail d'un dépôt (Linux seulement).
+// Le moniteur surveille tous les répertoires de l'arbre de travail à l'aide
+// d'inotify et consigne dans la zone de staging les chemins qui ont changé: status
+// et les commandes qui en dépendent n'ont alors à examiner que ceux-ci.
+// Le moniteur garde un verrou sur FILE_MONITOR_LOCK_PATH tant qu'il s'exécute: un
+// verrou libre indique aux commandes que le journal n'est plus tenu à jour.
+// Une file d'événements débordée commence une nouvelle session, ce qui force le
+// prochain status à parcourir l'arbre de travail au complet.
+// Chaque fichier témoin (FILE_MONITOR_COOKIE_PREFIX) créé dans le répertoire
+// interne de DVCSUS est consigné, dès sa création, après les chemins en attente:
+// les événements d'inotify étant ordonnés, la commande qui l'a créé sait ainsi que
+// le journal est à jour.
+////////////////////////////////////////////////////////////////////////////////////
+class FileMonitor
+{
+  public:
+    explicit FileMonitor(fs::path rootPath) noexcept;
+    FileMonitor(const FileMonitor &) = delete;
+    FileMonitor &operator=(const FileMonitor &) = delete;
+    ~FileMonitor();
+
+    // Surveille l'arbre de travail et commence une nouvelle session
+    [[nodiscard]] bool Start() noexcept;
+    [[nodiscard]] std::size_t GetNbWatches() const noexcept { return m_watches.size(); }
+
+    // Consigne les modifications jusqu'à l'appel de Stop, puis termine la session
+    void Run() noexcept;
+
+    // Peut être appelé de n'importe quel fil d'exécution ou d'un gestionnaire de
+    // signal
+    void Stop() noexcept;
+
+  private:
+    [[nodiscard]] bool AddWatches(const std::string &directoryPath) noexcept;
+    void RemoveWatches(const std::string &directoryPath) noexcept;
+    [[nodiscard]] bool ProcessEvents() noexcept;
+    [[nodiscard]] bool Flush() noexcept;
+    [[nodiscard]] bool BeginSession() noexcept;
+
+    fs::path m_rootPath;
+    Repository m_repository;
+    int m_lockDescriptor{-1};
+    int m_inotifyDescriptor{-1};
+    int m_stopDescriptor{-1};
+    int m_cookieWatch{-1};
+    // Répertoires surveillés, représentés comme les chemins des objets ('/' final
+    // compris)
+    std::unordered_map<int, std::string> m_watches;
+    std::set<std::string> m_changedPaths;
+    std::vector<std::string> m_cookies;
+};
+
+} // namespace dvcs
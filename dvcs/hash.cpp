@@ -0,0 +1,661 @@
+#include "hash.h"
+
+#include <cstring>
+#include <istream>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DVCS_HAS_SHA_NI
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DVCS_TARGET_SHA_NI
+#define DVCS_ALWAYS_INLINE __forceinline
+#else
+#include <cpuid.h>
+#define DVCS_TARGET_SHA_NI __attribute__((target("sha,sse4.1")))
+#define DVCS_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+#endif
+
+namespace
+{
+
+// Les deux algorithmes traitent les données par blocs de 64 octets
+constexpr const std::size_t BLOCK_SIZE = 64;
+
+// Taille des morceaux lus lors du hachage d'un flux
+constexpr const std::size_t STREAM_CHUNK_SIZE = 64U * 1024U;
+
+// Taille maximale de l'état interne d'un algorithme, en mots de 32 bits
+constexpr const std::size_t MAX_STATE_SIZE = 8;
+
+using TState = std::array<std::uint32_t, MAX_STATE_SIZE>;
+using TCompressFunction = void (*)(std::uint32_t *pState, const std::uint8_t *pBlocks, std::size_t nbBlocks) noexcept;
+
+constexpr const TState SHA1_INITIAL_STATE{0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+constexpr const TState SHA256_INITIAL_STATE{0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+// Constantes des rondes de SHA256
+alignas(16) constexpr const std::array<std::uint32_t, 64> SHA256_ROUND_CONSTANTS{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE,
+    0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA,
+    0x5CB0A9DC, 0x76F988DA, 0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967, 0x27B70A85,
+    0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070, 0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F,
+    0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+[[nodiscard]] constexpr std::uint32_t RotateLeft(std::uint32_t value, unsigned int count) noexcept
+{
+    return (value << count) | (value >> (32U - count));
+}
+
+[[nodiscard]] constexpr std::uint32_t RotateRight(std::uint32_t value, unsigned int count) noexcept
+{
+    return (value >> count) | (value << (32U - count));
+}
+
+[[nodiscard]] inline std::uint32_t LoadBigEndian(const std::uint8_t *pBytes) noexcept
+{
+    return (static_cast<std::uint32_t>(pBytes[0]) << 24U) | (static_cast<std::uint32_t>(pBytes[1]) << 16U) |
+           (static_cast<std::uint32_t>(pBytes[2]) << 8U) | static_cast<std::uint32_t>(pBytes[3]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Implémentation portable de la fonction de compression de SHA1 (FIPS 180-4)
+////////////////////////////////////////////////////////////////////////////////////
+void CompressSHA1Generic(std::uint32_t *pState, const std::uint8_t *pBlocks, std::size_t nbBlocks) noexcept
+{
+    std::array<std::uint32_t, 80> words{};
+    for (std::size_t iBlock = 0; iBlock < nbBlocks; ++iBlock, pBlocks += BLOCK_SIZE)
+    {
+        for (std::size_t iWord = 0; iWord < 16; ++iWord)
+        {
+            words[iWord] = LoadBigEndian(pBlocks + 4 * iWord);
+        }
+        for (std::size_t iWord = 16; iWord < words.size(); ++iWord)
+        {
+            words[iWord] = RotateLeft(words[iWord - 3] ^ words[iWord - 8] ^ words[iWord - 14] ^ words[iWord - 16], 1);
+        }
+
+        std::uint32_t a = pState[0];
+        std::uint32_t b = pState[1];
+        std::uint32_t c = pState[2];
+        std::uint32_t d = pState[3];
+        std::uint32_t e = pState[4];
+        for (std::size_t iRound = 0; iRound < words.size(); ++iRound)
+        {
+            std::uint32_t f{};
+            std::uint32_t k{};
+            if (iRound < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (iRound < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (iRound < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            const std::uint32_t temp = RotateLeft(a, 5) + f + e + k + words[iRound];
+            e = d;
+            d = c;
+            c = RotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        pState[0] += a;
+        pState[1] += b;
+        pState[2] += c;
+        pState[3] += d;
+        pState[4] += e;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Implémentation portable de la fonction de compression de SHA256 (FIPS 180-4)
+////////////////////////////////////////////////////////////////////////////////////
+void CompressSHA256Generic(std::uint32_t *pState, const std::uint8_t *pBlocks, std::size_t nbBlocks) noexcept
+{
+    std::array<std::uint32_t, 64> words{};
+    for (std::size_t iBlock = 0; iBlock < nbBlocks; ++iBlock, pBlocks += BLOCK_SIZE)
+    {
+        for (std::size_t iWord = 0; iWord < 16; ++iWord)
+        {
+            words[iWord] = LoadBigEndian(pBlocks + 4 * iWord);
+        }
+        for (std::size_t iWord = 16; iWord < words.size(); ++iWord)
+        {
+            const std::uint32_t s0 = RotateRight(words[iWord - 15], 7) ^ RotateRight(words[iWord - 15], 18) ^ (words[iWord - 15] >> 3U);
+            const std::uint32_t s1 = RotateRight(words[iWord - 2], 17) ^ RotateRight(words[iWord - 2], 19) ^ (words[iWord - 2] >> 10U);
+            words[iWord] = words[iWord - 16] + s0 + words[iWord - 7] + s1;
+        }
+
+        std::array<std::uint32_t, 8> vars{};
+        std::copy(pState, pState + vars.size(), vars.begin());
+        auto &[a, b, c, d, e, f, g, h] = vars;
+        for (std::size_t iRound = 0; iRound < words.size(); ++iRound)
+        {
+            const std::uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+            const std::uint32_t choice = (e & f) ^ (~e & g);
+            const std::uint32_t temp1 = h + s1 + choice + SHA256_ROUND_CONSTANTS[iRound] + words[iRound];
+            const std::uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+            const std::uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            const std::uint32_t temp2 = s0 + majority;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+
+        for (std::size_t iVar = 0; iVar < vars.size(); ++iVar)
+        {
+            pState[iVar] += vars[iVar];
+        }
+    }
+}
+
+#ifdef DVCS_HAS_SHA_NI
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si le processeur courant supporte les extensions SHA (ainsi que
+// SSE4.1 dont dépendent les implémentations ci-dessous).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CPUSupportsSHANI() noexcept
+{
+    constexpr const unsigned int sse41Bit = 1U << 19U; // CPUID.1:ECX
+    constexpr const unsigned int shaBit = 1U << 29U;   // CPUID.(7,0):EBX
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    std::array<int, 4> registers{};
+    __cpuid(registers.data(), 0);
+    if (registers[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(registers.data(), 1);
+    const bool hasSSE41 = (static_cast<unsigned int>(registers[2]) & sse41Bit) != 0;
+    __cpuidex(registers.data(), 7, 0);
+    return hasSSE41 && ((static_cast<unsigned int>(registers[1]) & shaBit) != 0);
+#else
+    unsigned int eax{};
+    unsigned int ebx{};
+    unsigned int ecx{};
+    unsigned int edx{};
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+    {
+        return false;
+    }
+    const bool hasSSE41 = (ecx & sse41Bit) != 0;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+    {
+        return false;
+    }
+    return hasSSE41 && ((ebx & shaBit) != 0);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Quatre rondes de SHA1 (groupe <Group> parmi 20) à l'aide des extensions SHA.
+// Le calcul des mots des groupes suivants est entrelacé avec les rondes: le mot
+// du groupe k est complété en trois étapes (sha1msg1 au groupe k-3, xor au groupe
+// k-2 et sha1msg2 au groupe k-1).
+////////////////////////////////////////////////////////////////////////////////////
+template <std::size_t Group>
+DVCS_TARGET_SHA_NI DVCS_ALWAYS_INLINE void SHA1Rounds(__m128i &abcd, __m128i (&e)[2], __m128i (&messages)[4],
+                                                      const std::uint8_t *pBlock, const __m128i &byteSwapMask) noexcept
+{
+    auto &current = messages[Group % 4];
+    if constexpr (Group < 4)
+    {
+        current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pBlock + 16 * Group)), byteSwapMask);
+    }
+
+    auto &eCurrent = e[Group % 2];
+    if constexpr (Group == 0)
+    {
+        eCurrent = _mm_add_epi32(eCurrent, current);
+    }
+    else
+    {
+        eCurrent = _mm_sha1nexte_epu32(eCurrent, current);
+    }
+    e[(Group + 1) % 2] = abcd;
+
+    if constexpr ((Group >= 3) && (Group <= 18))
+    {
+        messages[(Group + 1) % 4] = _mm_sha1msg2_epu32(messages[(Group + 1) % 4], current);
+    }
+    abcd = _mm_sha1rnds4_epu32(abcd, eCurrent, Group / 5);
+    if constexpr ((Group >= 1) && (Group <= 16))
+    {
+        messages[(Group + 3) % 4] = _mm_sha1msg1_epu32(messages[(Group + 3) % 4], current);
+    }
+    if constexpr ((Group >= 2) && (Group <= 17))
+    {
+        messages[(Group + 2) % 4] = _mm_xor_si128(messages[(Group + 2) % 4], current);
+    }
+}
+
+template <std::size_t... Groups>
+DVCS_TARGET_SHA_NI DVCS_ALWAYS_INLINE void SHA1Block(__m128i &abcd, __m128i (&e)[2], const std::uint8_t *pBlock,
+                                                     const __m128i &byteSwapMask, std::index_sequence<Groups...> /* groups */) noexcept
+{
+    __m128i messages[4]{}; // NOLINT
+    (SHA1Rounds<Groups>(abcd, e, messages, pBlock, byteSwapMask), ...);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fonction de compression de SHA1 utilisant les extensions SHA
+////////////////////////////////////////////////////////////////////////////////////
+DVCS_TARGET_SHA_NI void CompressSHA1SHANI(std::uint32_t *pState, const std::uint8_t *pBlocks, std::size_t nbBlocks) noexcept
+{
+    // Les instructions SHA1 s'attendent à ce que le premier mot soit dans la partie haute du registre
+    const __m128i byteSwapMask = _mm_set_epi64x(0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pState)), 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(pState[4]), 0, 0, 0);
+    for (std::size_t iBlock = 0; iBlock < nbBlocks; ++iBlock, pBlocks += BLOCK_SIZE)
+    {
+        const __m128i abcdSave = abcd;
+        __m128i e[2]{e0, _mm_setzero_si128()}; // NOLINT
+        SHA1Block(abcd, e, pBlocks, byteSwapMask, std::make_index_sequence<20>{});
+
+        // Le dernier groupe de rondes laisse dans e[0] l'état précédant ses rondes
+        e0 = _mm_sha1nexte_epu32(e[0], e0);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pState), _mm_shuffle_epi32(abcd, 0x1B));
+    pState[4] = static_cast<std::uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Quatre rondes de SHA256 (groupe <Group> parmi 16) à l'aide des extensions SHA.
+// Les mots des groupes 4 et suivants sont calculés à partir des quatre précédents.
+////////////////////////////////////////////////////////////////////////////////////
+template <std::size_t Group>
+DVCS_TARGET_SHA_NI DVCS_ALWAYS_INLINE void SHA256Rounds(__m128i &abef, __m128i &cdgh, __m128i (&messages)[4], const std::uint8_t *pBlock,
+                                                        const __m128i &byteSwapMask) noexcept
+{
+    auto &current = messages[Group % 4];
+    if constexpr (Group < 4)
+    {
+        current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pBlock + 16 * Group)), byteSwapMask);
+    }
+    else
+    {
+        const auto &previous = messages[(Group + 3) % 4];
+        const __m128i shifted = _mm_alignr_epi8(previous, messages[(Group + 2) % 4], 4);
+        current = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(current, messages[(Group + 1) % 4]), shifted), previous);
+    }
+
+    __m128i message =
+        _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i *>(SHA256_ROUND_CONSTANTS.data() + 4 * Group)));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+    message = _mm_shuffle_epi32(message, 0x0E);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, message);
+}
+
+template <std::size_t... Groups>
+DVCS_TARGET_SHA_NI DVCS_ALWAYS_INLINE void SHA256Block(__m128i &abef, __m128i &cdgh, const std::uint8_t *pBlock, const __m128i &byteSwapMask,
+                                                       std::index_sequence<Groups...> /* groups */) noexcept
+{
+    __m128i messages[4]{}; // NOLINT
+    (SHA256Rounds<Groups>(abef, cdgh, messages, pBlock, byteSwapMask), ...);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fonction de compression de SHA256 utilisant les extensions SHA
+////////////////////////////////////////////////////////////////////////////////////
+DVCS_TARGET_SHA_NI void CompressSHA256SHANI(std::uint32_t *pState, const std::uint8_t *pBlocks, std::size_t nbBlocks) noexcept
+{
+    // Inverse l'ordre des octets de chacun des mots de 32 bits
+    const __m128i byteSwapMask = _mm_set_epi64x(0x0C0D0E0F08090A0BLL, 0x0405060700010203LL);
+
+    // Les instructions SHA256 travaillent sur les paires de registres ABEF/CDGH
+    const __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pState)), 0xB1);
+    const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pState + 4)), 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (std::size_t iBlock = 0; iBlock < nbBlocks; ++iBlock, pBlocks += BLOCK_SIZE)
+    {
+        const __m128i abefSave = abef;
+        const __m128i cdghSave = cdgh;
+        SHA256Block(abef, cdgh, pBlocks, byteSwapMask, std::make_index_sequence<16>{});
+        abef = _mm_add_epi32(abef, abefSave);
+        cdgh = _mm_add_epi32(cdgh, cdghSave);
+    }
+
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pState), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pState + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+#endif // DVCS_HAS_SHA_NI
+
+////////////////////////////////////////////////////////////////////////////////////
+// Moteur de hachage commun à SHA1 et SHA256.
+// Les deux algorithmes partagent la même construction (Merkle-Damgård): seuls
+// l'état initial, la fonction de compression et la taille de l'empreinte diffèrent.
+////////////////////////////////////////////////////////////////////////////////////
+class BlockHashEngine final : public dvcs::HashEngine
+{
+  public:
+    BlockHashEngine(dvcs::HashAlgorithm algorithm, dvcs::HashBackend backend, TCompressFunction pCompress) noexcept
+        : m_algorithm{algorithm}, m_backend{backend}, m_pCompress{pCompress}
+    {
+        Reset();
+    }
+
+    void Update(const void *pData, std::size_t size) noexcept override
+    {
+        const auto *pBytes = static_cast<const std::uint8_t *>(pData);
+        m_length += size;
+
+        // On complète d'abord le bloc partiel laissé par l'appel précédent
+        if (m_bufferSize > 0)
+        {
+            const std::size_t nbCopied = std::min(size, BLOCK_SIZE - m_bufferSize);
+            std::memcpy(m_buffer.data() + m_bufferSize, pBytes, nbCopied);
+            m_bufferSize += nbCopied;
+            pBytes += nbCopied;
+            size -= nbCopied;
+            if (m_bufferSize < BLOCK_SIZE)
+            {
+                return;
+            }
+            m_pCompress(m_state.data(), m_buffer.data(), 1);
+            m_bufferSize = 0;
+        }
+
+        // Les blocs complets sont traités directement à partir des données reçues
+        const std::size_t nbBlocks = size / BLOCK_SIZE;
+        if (nbBlocks > 0)
+        {
+            m_pCompress(m_state.data(), pBytes, nbBlocks);
+            pBytes += nbBlocks * BLOCK_SIZE;
+            size -= nbBlocks * BLOCK_SIZE;
+        }
+
+        std::memcpy(m_buffer.data(), pBytes, size);
+        m_bufferSize = size;
+    }
+
+    [[nodiscard]] dvcs::THash Finalize() noexcept override
+    {
+        // Remplissage: un bit à 1, des zéros puis la longueur du message en bits
+        const std::uint64_t lengthInBits = m_length * 8U;
+        m_buffer[m_bufferSize++] = 0x80;
+        if (m_bufferSize > BLOCK_SIZE - sizeof(lengthInBits))
+        {
+            std::fill(m_buffer.begin() + static_cast<std::ptrdiff_t>(m_bufferSize), m_buffer.end(), std::uint8_t{0});
+            m_pCompress(m_state.data(), m_buffer.data(), 1);
+            m_bufferSize = 0;
+        }
+        std::fill(m_buffer.begin() + static_cast<std::ptrdiff_t>(m_bufferSize), m_buffer.end() - sizeof(lengthInBits), std::uint8_t{0});
+        for (std::size_t iByte = 0; iByte < sizeof(lengthInBits); ++iByte)
+        {
+            m_buffer[BLOCK_SIZE - 1 - iByte] = static_cast<std::uint8_t>(lengthInBits >> (8U * iByte));
+        }
+        m_pCompress(m_state.data(), m_buffer.data(), 1);
+
+        // Les mots de l'état sont convertis en octets gros-boutistes
+        dvcs::THash hash{dvcs::GetHashSize(m_algorithm)};
+        for (std::size_t iByte = 0; iByte < hash.size(); ++iByte)
+        {
+            hash[iByte] = static_cast<std::uint8_t>(m_state[iByte / 4] >> (24U - 8U * (iByte % 4)));
+        }
+
+        Reset();
+        return hash;
+    }
+
+    [[nodiscard]] dvcs::HashAlgorithm GetAlgorithm() const noexcept override { return m_algorithm; }
+    [[nodiscard]] dvcs::HashBackend GetBackend() const noexcept override { return m_backend; }
+
+  private:
+    void Reset() noexcept
+    {
+        m_state = (m_algorithm == dvcs::HashAlgorithm::SHA1) ? SHA1_INITIAL_STATE : SHA256_INITIAL_STATE;
+        m_length = 0;
+        m_bufferSize = 0;
+    }
+
+    const dvcs::HashAlgorithm m_algorithm;
+    const dvcs::HashBackend m_backend;
+    const TCompressFunction m_pCompress;
+    TState m_state{};
+    std::array<std::uint8_t, BLOCK_SIZE> m_buffer{};
+    std::size_t m_bufferSize{};
+    std::uint64_t m_length{}; // Nombre total d'octets reçus
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Implémentation la plus rapide supportée par le processeur courant.
+// La détection n'est faite qu'une seule fois.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] dvcs::HashBackend GetPreferredBackend() noexcept
+{
+    static const dvcs::HashBackend preferredBackend =
+        dvcs::IsHashBackendSupported(dvcs::HashBackend::SHANI) ? dvcs::HashBackend::SHANI : dvcs::HashBackend::Generic;
+    return preferredBackend;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Les empreintes étant cryptographiques, leurs premiers octets sont déjà
+// uniformément distribués.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::size_t HashHasher::operator()(const THash &hash) const noexcept
+{
+    std::size_t value{};
+    std::memcpy(&value, hash.data(), sizeof(value));
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Produit la représentation hexadécimale de l'empreinte <hash>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::string ToHex(const THash &hash)
+{
+    constexpr const std::string_view digits{"0123456789abcdef"};
+
+    std::string hex(hash.size() * 2, '0');
+    for (std::size_t iByte = 0; iByte < hash.size(); ++iByte)
+    {
+        hex[2 * iByte] = digits[hash[iByte] >> 4U];
+        hex[2 * iByte + 1] = digits[hash[iByte] & 0x0FU];
+    }
+    return hex;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Convertit la représentation hexadécimale <hex> en empreinte <hash>.
+// La longueur de <hex> détermine l'algorithme (SHA1 ou SHA256) de l'empreinte.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FromHex(std::string_view hex, THash &hash) noexcept
+{
+    if ((hex.size() != SHA1_SIZE * 2) && (hex.size() != SHA256_SIZE * 2))
+    {
+        return false;
+    }
+
+    auto toNibble = [](char digit) -> int {
+        if ((digit >= '0') && (digit <= '9'))
+        {
+            return digit - '0';
+        }
+        if ((digit >= 'a') && (digit <= 'f'))
+        {
+            return digit - 'a' + 10;
+        }
+        if ((digit >= 'A') && (digit <= 'F'))
+        {
+            return digit - 'A' + 10;
+        }
+        return -1;
+    };
+
+    THash result{hex.size() / 2};
+    for (std::size_t iByte = 0; iByte < result.size(); ++iByte)
+    {
+        const int high = toNibble(hex[2 * iByte]);
+        const int low = toNibble(hex[2 * iByte + 1]);
+        if ((high < 0) || (low < 0))
+        {
+            return false;
+        }
+        result[iByte] = static_cast<std::uint8_t>((high << 4) | low);
+    }
+    hash = result;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si l'implémentation <backend> peut être utilisée sur le processeur courant.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool IsHashBackendSupported(HashBackend backend) noexcept
+{
+    switch (backend)
+    {
+    case HashBackend::Auto:
+    case HashBackend::Generic:
+        return true;
+    case HashBackend::SHANI:
+#ifdef DVCS_HAS_SHA_NI
+        return CPUSupportsSHANI();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Crée un moteur de hachage pour l'algorithme <algorithm>.
+// Retourne nullptr si l'implémentation <backend> n'est pas supportée par le
+// processeur courant.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::unique_ptr<HashEngine> CreateHashEngine(HashAlgorithm algorithm, HashBackend backend)
+{
+    if (backend == HashBackend::Auto)
+    {
+        backend = GetPreferredBackend();
+    }
+    if (!IsHashBackendSupported(backend))
+    {
+        return nullptr;
+    }
+
+    const bool isSHA1 = algorithm == HashAlgorithm::SHA1;
+    TCompressFunction pCompress = isSHA1 ? CompressSHA1Generic : CompressSHA256Generic;
+#ifdef DVCS_HAS_SHA_NI
+    if (backend == HashBackend::SHANI)
+    {
+        pCompress = isSHA1 ? CompressSHA1SHANI : CompressSHA256SHANI;
+    }
+#endif
+    return std::make_unique<BlockHashEngine>(algorithm, backend, pCompress);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Calcule l'empreinte <algorithm> d'un ensemble de données contigu.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] THash ComputeHash(HashAlgorithm algorithm, const void *pData, std::size_t size)
+{
+    auto pEngine = CreateHashEngine(algorithm);
+    pEngine->Update(pData, size);
+    return pEngine->Finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Calcule par morceaux l'empreinte <algorithm> des données du flux <inputStream>.
+// La mémoire utilisée est constante peu importe la quantité de données.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ComputeStreamHash(std::istream &inputStream, HashAlgorithm algorithm, THash &hash)
+{
+    if (!inputStream.good())
+    {
+        return false;
+    }
+
+    auto pEngine = CreateHashEngine(algorithm);
+    std::array<char, STREAM_CHUNK_SIZE> buffer{};
+    while (inputStream.read(buffer.data(), buffer.size()) || (inputStream.gcount() > 0))
+    {
+        pEngine->Update(buffer.data(), static_cast<std::size_t>(inputStream.gcount()));
+    }
+    if (inputStream.bad())
+    {
+        return false;
+    }
+
+    hash = pEngine->Finalize();
+    return true;
+}
+
+[[nodiscard]] std::size_t GetHashSize(HashAlgorithm algorithm) noexcept
+{
+    return (algorithm == HashAlgorithm::SHA1) ? SHA1_SIZE : SHA256_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Nom sous lequel l'algorithme est enregistré dans les métadonnées d'un dépôt
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::string_view GetHashAlgorithmName(HashAlgorithm algorithm) noexcept
+{
+    return (algorithm == HashAlgorithm::SHA1) ? "sha1" : "sha256";
+}
+
+[[nodiscard]] std::string_view GetHashBackendName(HashBackend backend) noexcept
+{
+    switch (backend)
+    {
+    case HashBackend::Auto:
+        return "auto";
+    case HashBackend::Generic:
+        return "generic";
+    case HashBackend::SHANI:
+        return "sha-ni";
+    }
+    return "unknown";
+}
+
+[[nodiscard]] bool ParseHashAlgorithm(std::string_view name, HashAlgorithm &algorithm) noexcept
+{
+    for (const auto candidate : {HashAlgorithm::SHA1, HashAlgorithm::SHA256})
+    {
+        if (name == GetHashAlgorithmName(candidate))
+        {
+            algorithm = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace dvcs
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace dvcs
+{
+
+// Taille en octets d'une empreinte SHA1
+constexpr const std::size_t SHA1_SIZE = 20;
+
+// Taille en octets d'une empreinte SHA256
+constexpr const std::size_t SHA256_SIZE = 32;
+
+// Taille maximale en octets d'une empreinte, peu importe l'algorithme
+constexpr const std::size_t MAX_HASH_SIZE = SHA256_SIZE;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Algorithme de hachage identifiant les objets et les commits d'un dépôt.
+// Il est choisi à l'initialisation du dépôt et ne change plus par la suite.
+////////////////////////////////////////////////////////////////////////////////////
+enum class HashAlgorithm
+{
+    SHA1,
+    SHA256
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Implémentation d'un algorithme de hachage.
+// Auto choisit la plus rapide supportée par le processeur courant.
+////////////////////////////////////////////////////////////////////////////////////
+enum class HashBackend
+{
+    Auto,
+    Generic, // Implémentation portable
+    SHANI    // Extensions SHA des processeurs x86-64
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Empreinte binaire identifiant un objet ou un commit.
+// Sa taille dépend de l'algorithme de hachage du dépôt (SHA1 par défaut).
+// La représentation hexadécimale n'est utilisée qu'aux frontières du système
+// (ligne de commande, affichage).
+////////////////////////////////////////////////////////////////////////////////////
+class THash
+{
+  public:
+    constexpr THash() noexcept = default;
+    explicit constexpr THash(std::size_t size) noexcept : m_size{std::min(size, MAX_HASH_SIZE)} {}
+
+    [[nodiscard]] std::uint8_t *data() noexcept { return m_bytes.data(); }
+    [[nodiscard]] const std::uint8_t *data() const noexcept { return m_bytes.data(); }
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+    [[nodiscard]] std::uint8_t &operator[](std::size_t index) noexcept { return m_bytes[index]; }
+    [[nodiscard]] std::uint8_t operator[](std::size_t index) const noexcept { return m_bytes[index]; }
+
+    [[nodiscard]] bool operator==(const THash &other) const noexcept
+    {
+        return std::equal(data(), data() + size(), other.data(), other.data() + other.size());
+    }
+
+  private:
+    std::array<std::uint8_t, MAX_HASH_SIZE> m_bytes{};
+    std::size_t m_size{SHA1_SIZE};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Foncteur permettant d'utiliser une empreinte comme clé d'un conteneur associatif
+////////////////////////////////////////////////////////////////////////////////////
+struct HashHasher
+{
+    [[nodiscard]] std::size_t operator()(const THash &hash) const noexcept;
+};
+
+[[nodiscard]] std::string ToHex(const THash &hash);
+[[nodiscard]] bool FromHex(std::string_view hex, THash &hash) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Calcul incrémental d'une empreinte.
+// Les données peuvent être fournies en autant de morceaux que nécessaire. Une
+// fois l'empreinte récupérée, le moteur est prêt à traiter de nouvelles données.
+////////////////////////////////////////////////////////////////////////////////////
+class HashEngine
+{
+  public:
+    virtual ~HashEngine() = default;
+
+    virtual void Update(const void *pData, std::size_t size) noexcept = 0;
+    [[nodiscard]] virtual THash Finalize() noexcept = 0;
+
+    [[nodiscard]] virtual HashAlgorithm GetAlgorithm() const noexcept = 0;
+    [[nodiscard]] virtual HashBackend GetBackend() const noexcept = 0;
+};
+
+[[nodiscard]] bool IsHashBackendSupported(HashBackend backend) noexcept;
+[[nodiscard]] std::unique_ptr<HashEngine> CreateHashEngine(HashAlgorithm algorithm, HashBackend backend = HashBackend::Auto);
+[[nodiscard]] THash ComputeHash(HashAlgorithm algorithm, const void *pData, std::size_t size);
+[[nodiscard]] bool ComputeStreamHash(std::istream &inputStream, HashAlgorithm algorithm, THash &hash);
+
+[[nodiscard]] std::size_t GetHashSize(HashAlgorithm algorithm) noexcept;
+[[nodiscard]] std::string_view GetHashAlgorithmName(HashAlgorithm algorithm) noexcept;
+[[nodiscard]] std::string_view GetHashBackendName(HashBackend backend) noexcept;
+[[nodiscard]] bool ParseHashAlgorithm(std::string_view name, HashAlgorithm &algorithm) noexcept;
+
+} // namespace dvcs
@@ -0,0 +1,240 @@
+#include "merge.h"
+#include "filediff.h"
+#include "paths.h"
+#include "threadpool.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fusionne les versions du fichier <fileMerge>, lues à l'aide de <reader>, et
+// écrit le résultat dans l'arbre de travail du dépôt dont la racine est
+// <rootPath> (voir dvcs::MergeTexts). Un fichier binaire n'est pas touché.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MergeFile(dvcs::ObjectReader &reader, const fs::path &rootPath, const dvcs::FileMerge &fileMerge, dvcs::DiffAlgorithm algorithm,
+                             std::string_view oursLabel, std::string_view theirsLabel, dvcs::FileMergeResult &result)
+{
+    std::vector<char> baseData;
+    std::vector<char> oursData;
+    std::vector<char> theirsData;
+    RETURN_IF(fileMerge.m_baseHash && !reader.Read(*fileMerge.m_baseHash, baseData), false);
+    RETURN_IF(!reader.Read(fileMerge.m_oursHash, oursData) || !reader.Read(fileMerge.m_theirsHash, theirsData), false);
+
+    const dvcs::DiffText baseText{{baseData.data(), baseData.size()}};
+    const dvcs::DiffText oursText{{oursData.data(), oursData.size()}};
+    const dvcs::DiffText theirsText{{theirsData.data(), theirsData.size()}};
+    if (baseText.IsBinary() || oursText.IsBinary() || theirsText.IsBinary())
+    {
+        result = dvcs::FileMergeResult::BinaryConflict;
+        return true;
+    }
+
+    std::string output;
+    result = (dvcs::MergeTexts(baseText, oursText, theirsText, algorithm, oursLabel, theirsLabel, output) == 0) ? dvcs::FileMergeResult::Clean
+                                                                                                                  : dvcs::FileMergeResult::Conflict;
+    fs::path filePath;
+    return dvcs::ResolveWorkingTreePath(rootPath, fileMerge.m_path, filePath) && dvcs::WriteWorkingTreeData(filePath, output);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve les fichiers <copies> ajoutés par les modifications <changes> d'un côté
+// d'une fusion qui sont des copies (voir FindSimilarFiles) de fichiers de la base
+// que les modifications <otherChanges> de l'autre côté modifient: ces
+// modifications doivent aussi leur être appliquées. Seuls les fichiers ajoutés
+// d'un seul côté sont considérés.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool FindMergeCopies(const fs::path &rootPath, const std::vector<dvcs::TreeChange> &changes,
+                                   const std::vector<dvcs::TreeChange> &otherChanges, const dvcs::RenameOptions &options,
+                                   std::unordered_map<std::string_view, const dvcs::TreeChange *> &copies)
+{
+    std::unordered_set<std::string_view> otherPaths;
+    std::vector<dvcs::SimilarFile> sources;
+    std::vector<const dvcs::TreeChange *> sourceChanges;
+    for (const auto &change : otherChanges)
+    {
+        otherPaths.insert(change.m_path);
+        if (change.m_oldItem && change.m_newItem)
+        {
+            sources.push_back(dvcs::SimilarFile{change.m_path, change.m_oldItem->m_hash, change.m_oldItem->m_size, false});
+            sourceChanges.push_back(&change);
+        }
+    }
+    std::vector<dvcs::SimilarFile> destinations;
+    std::vector<const dvcs::TreeChange *> destinationChanges;
+    for (const auto &change : changes)
+    {
+        if (!change.m_oldItem && change.m_newItem && !otherPaths.contains(change.m_path))
+        {
+            destinations.push_back(dvcs::SimilarFile{change.m_path, change.m_newItem->m_hash, change.m_newItem->m_size, false});
+            destinationChanges.push_back(&change);
+        }
+    }
+    RETURN_IF(sources.empty() || destinations.empty(), true);
+
+    std::vector<dvcs::SimilarPair> pairs;
+    RETURN_IF(!dvcs::FindSimilarFiles(rootPath, sources, destinations, options, pairs), false);
+    for (const auto &pair : pairs)
+    {
+        copies.try_emplace(destinationChanges[pair.m_destination]->m_path, sourceChanges[pair.m_source]);
+    }
+    return true;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] bool PlanMerge(const fs::path &rootPath, const std::vector<TreeChange> &oursChanges, const std::vector<TreeChange> &theirsChanges,
+                             const RenameOptions &options, MergePlan &plan)
+{
+    std::unordered_map<std::string_view, const TreeChange *> oursChangesByPath;
+    for (const auto &change : oursChanges)
+    {
+        oursChangesByPath.emplace(change.m_path, &change);
+    }
+    std::unordered_map<std::string_view, const TreeChange *> theirsCopies;
+    std::unordered_map<std::string_view, const TreeChange *> oursCopies;
+    if (options.m_detectRenames || options.m_detectCopies)
+    {
+        RETURN_IF(!FindMergeCopies(rootPath, theirsChanges, oursChanges, options, theirsCopies) ||
+                      !FindMergeCopies(rootPath, oursChanges, theirsChanges, options, oursCopies),
+                  false);
+    }
+
+    // Les modifications d'un fichier que l'autre côté a renommé (ou copié) sont
+    // appliquées à sa copie: le retrait du fichier renommé n'entre donc pas en
+    // conflit avec celles-ci
+    std::unordered_set<std::string_view> theirsCopySources;
+    for (const auto &[path, pSource] : theirsCopies)
+    {
+        theirsCopySources.insert(pSource->m_path);
+    }
+    std::unordered_set<std::string_view> oursCopySources;
+    for (const auto &[path, pSource] : oursCopies)
+    {
+        oursCopySources.insert(pSource->m_path);
+    }
+
+    // Le fichier modifié d'un conflit de retrait est laissé (ou écrit) dans
+    // l'arbre de travail et le conflit doit être résolu à la main
+    for (const auto &change : theirsChanges)
+    {
+        const auto oursIt = oursChangesByPath.find(change.m_path);
+        const bool isRemovedByOurs = (oursIt != oursChangesByPath.end()) && !oursIt->second->m_newItem;
+        if (!change.m_newItem)
+        {
+            if (oursIt == oursChangesByPath.end() || theirsCopySources.contains(change.m_path))
+            {
+                plan.m_takenChanges.push_back(change);
+            }
+            else if (isRemovedByOurs)
+            {
+                continue;
+            }
+            else
+            {
+                plan.m_deleteConflicts.push_back(TreeChange{change.m_path, std::nullopt, std::nullopt});
+            }
+            plan.m_paths.push_back(change.m_path);
+            continue;
+        }
+
+        const auto copyIt = theirsCopies.find(change.m_path);
+        if (copyIt != theirsCopies.end())
+        {
+            const auto &source = *copyIt->second;
+            plan.m_fileMerges.push_back(
+                FileMerge{change.m_path, source.m_oldItem->m_hash, source.m_newItem->m_hash, change.m_newItem->m_hash, source.m_path});
+        }
+        else if (isRemovedByOurs)
+        {
+            if (oursCopySources.contains(change.m_path))
+            {
+                continue;
+            }
+            plan.m_deleteConflicts.push_back(TreeChange{change.m_path, std::nullopt, change.m_newItem});
+        }
+        else if (oursIt == oursChangesByPath.end())
+        {
+            plan.m_takenChanges.push_back(change);
+        }
+        else if (oursIt->second->m_newItem->m_hash != change.m_newItem->m_hash)
+        {
+            auto &fileMerge =
+                plan.m_fileMerges.emplace_back(FileMerge{change.m_path, std::nullopt, oursIt->second->m_newItem->m_hash, change.m_newItem->m_hash});
+            if (change.m_oldItem)
+            {
+                fileMerge.m_baseHash = change.m_oldItem->m_hash;
+            }
+        }
+        else
+        {
+            continue;
+        }
+        plan.m_paths.push_back(change.m_path);
+    }
+    for (const auto &change : oursChanges)
+    {
+        const auto copyIt = oursCopies.find(change.m_path);
+        if (copyIt != oursCopies.end())
+        {
+            const auto &source = *copyIt->second;
+            plan.m_fileMerges.push_back(
+                FileMerge{change.m_path, source.m_oldItem->m_hash, change.m_newItem->m_hash, source.m_newItem->m_hash, source.m_path});
+            plan.m_paths.push_back(change.m_path);
+        }
+    }
+    return true;
+}
+
+void MergeFiles(const fs::path &rootPath, const std::vector<FileMerge> &fileMerges, DiffAlgorithm algorithm, std::string_view oursLabel,
+                std::string_view theirsLabel, std::vector<std::optional<FileMergeResult>> &results)
+{
+    // NOTE: Une connexion SQLite ne doit servir qu'à un seul fil d'exécution à la
+    //       fois: chacun des fils ouvre donc la sienne et pige ses fichiers à
+    //       fusionner à même une liste commune.
+    results.assign(fileMerges.size(), std::nullopt);
+    const auto repoDBPath = rootPath / REPO_DB_PATH;
+    std::atomic<std::size_t> nextIndex{0};
+    ParallelFor(std::min(fileMerges.size(), GetWorkerCount()), [&](std::size_t /* iWorker */) {
+        TDatabasePtr pDB{nullptr, sqlite3_close};
+        if (!OpenDatabaseConnection(repoDBPath, pDB, SQLITE_OPEN_READONLY) || (sqlite3_busy_timeout(pDB.get(), BUSY_TIMEOUT_MS) != SQLITE_OK))
+        {
+            return;
+        }
+        ObjectReader reader{pDB, "main"};
+        for (std::size_t index = nextIndex++; index < fileMerges.size(); index = nextIndex++)
+        {
+            try
+            {
+                FileMergeResult result{};
+                if (MergeFile(reader, rootPath, fileMerges[index], algorithm, oursLabel, theirsLabel, result))
+                {
+                    results[index] = result;
+                }
+            }
+            catch (const std::exception &)
+            {
+            }
+        }
+    });
+}
+
+} // namespace dvcs
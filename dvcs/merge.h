@@ -0,0 +1,81 @@
+#pragma once
+
+#include "commands.h"
+#include "database.h"
+#include "diff.h"
+#include "hash.h"
+#include "tree.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichier modifié des deux côtés d'une fusion (voir Merge), ou copié d'un côté
+// alors que sa source est modifiée de l'autre
+////////////////////////////////////////////////////////////////////////////////////
+struct FileMerge
+{
+    std::string m_path;              // Chemin d'accès représenté comme celui des objets
+    std::optional<THash> m_baseHash; // Absent d'un fichier ajouté des deux côtés
+    THash m_oursHash{};
+    THash m_theirsHash{};
+    std::string_view m_sourcePath{}; // Fichier copié par l'un des côtés et modifié par l'autre, vide sinon
+};
+
+// Résultat de la fusion d'un fichier
+enum class FileMergeResult
+{
+    Clean,         // Fusionné sans conflit
+    Conflict,      // Fusionné avec des marqueurs de conflit
+    BinaryConflict // Non fusionné: la version du commit courant est conservée jusqu'à son ajout
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Travail d'une fusion, établi à partir des modifications de chacun des côtés
+// depuis leur base commune (voir PlanMerge). Les chemins d'accès renvoient à
+// ces modifications, qui doivent survivre au plan.
+////////////////////////////////////////////////////////////////////////////////////
+struct MergePlan
+{
+    std::vector<TreeChange> m_takenChanges;    // Modifications reprises du commit fusionné
+    std::vector<FileMerge> m_fileMerges;       // Fichiers à fusionner ligne par ligne
+    std::vector<TreeChange> m_deleteConflicts; // Fichiers retirés d'un côté et modifiés de l'autre
+    std::vector<std::string_view> m_paths;     // Fichiers de l'arbre de travail touchés par la fusion
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Établit le plan <plan> de la fusion des modifications <theirsChanges> du commit
+// fusionné dans celles <oursChanges> du commit courant, faites depuis leur base
+// commune dans le dépôt dont la racine est <rootPath>.
+// Les fichiers modifiés d'un seul côté sont repris de celui-ci: seuls ceux du
+// commit fusionné sont donc écrits. Ceux qui sont modifiés des deux côtés sont
+// fusionnés. Un fichier ajouté d'un côté qui est la copie d'un fichier modifié de
+// l'autre côté (un fichier déplacé, par exemple) reçoit aussi ces modifications
+// lorsque <options> le demande. Un fichier retiré d'un côté l'est aussi de
+// l'autre, à moins que celui-ci ne l'ait modifié sans que sa copie n'ait reçu ces
+// modifications: c'est alors un conflit.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool PlanMerge(const fs::path &rootPath, const std::vector<TreeChange> &oursChanges, const std::vector<TreeChange> &theirsChanges,
+                             const RenameOptions &options, MergePlan &plan);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fusionne les fichiers <fileMerges> du dépôt dont la racine est <rootPath> et en
+// écrit le résultat dans l'arbre de travail, les conflits étant entourés de
+// marqueurs nommés <oursLabel> et <theirsLabel> (voir dvcs::MergeTexts). Les
+// fichiers sont fusionnés en parallèle par un bassin de fils d'exécution ayant
+// chacun sa propre connexion au dépôt. Le résultat de chacun des fichiers est
+// donné par <results>; il est absent pour un fichier qui n'a pu être fusionné.
+////////////////////////////////////////////////////////////////////////////////////
+void MergeFiles(const fs::path &rootPath, const std::vector<FileMerge> &fileMerges, DiffAlgorithm algorithm, std::string_view oursLabel,
+                std::string_view theirsLabel, std::vector<std::optional<FileMergeResult>> &results);
+
+} // namespace dvcs
@@ -0,0 +1,330 @@
+#include "network.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+constexpr const std::string_view TCP_URL_SCHEME = "dvcs://";
+constexpr const std::string_view UNIX_URL_SCHEME = "dvcs+unix://";
+constexpr const std::string_view UNIX_ADDRESS_PREFIX = "unix:";
+
+// Délai après lequel une connexion muette est abandonnée, pour qu'un pair disparu
+// ne bloque pas indéfiniment un client ou un fil d'exécution du service
+constexpr const int SOCKET_TIMEOUT_S = 60;
+
+constexpr const int LISTEN_BACKLOG = 64;
+
+using TAddressInfoPtr = std::unique_ptr<addrinfo, decltype(&freeaddrinfo)>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Prépare l'adresse <unixAddress> du socket Unix situé à <socketPath>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool MakeUnixAddress(const std::string &socketPath, sockaddr_un &unixAddress) noexcept
+{
+    unixAddress = sockaddr_un{};
+    unixAddress.sun_family = AF_UNIX;
+    RETURN_IF(socketPath.empty() || (socketPath.size() >= sizeof(unixAddress.sun_path)), false);
+    std::memcpy(unixAddress.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve les adresses TCP correspondant à l'hôte et au port de <address>. Sans
+// hôte, ce sont les adresses locales sur lesquelles on peut écouter.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ResolveTcpAddress(const dvcs::NetworkAddress &address, TAddressInfoPtr &pAddressInfo) noexcept
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = address.m_host.empty() ? AI_PASSIVE : 0;
+
+    const auto port = std::to_string(address.m_port);
+    addrinfo *pResult = nullptr;
+    RETURN_IF(getaddrinfo(address.m_host.empty() ? nullptr : address.m_host.c_str(), port.c_str(), &hints, &pResult) != 0, false);
+    pAddressInfo = TAddressInfoPtr{pResult, freeaddrinfo};
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lit le numéro de port <port> de <text>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ParsePort(std::string_view text, std::uint16_t &port) noexcept
+{
+    const auto [pEnd, errorCode] = std::from_chars(text.data(), text.data() + text.size(), port);
+    return !text.empty() && (errorCode == std::errc{}) && (pEnd == text.data() + text.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Applique les options communes à toutes les connexions établies
+////////////////////////////////////////////////////////////////////////////////////
+void ConfigureConnection(int descriptor) noexcept
+{
+    const timeval timeout{SOCKET_TIMEOUT_S, 0};
+    setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(descriptor, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Les messages sont déjà regroupés par le tampon du flux: inutile que le
+    // système retarde leur envoi (échoue sans conséquence sur un socket Unix)
+    const int isEnabled = 1;
+    setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &isEnabled, sizeof(isEnabled));
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lit l'adresse réseau <address> de sa forme textuelle <text>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ParseNetworkAddress(std::string_view text, NetworkAddress &address)
+{
+    address = NetworkAddress{};
+    if (text.starts_with(UNIX_ADDRESS_PREFIX))
+    {
+        address.m_socketPath = text.substr(UNIX_ADDRESS_PREFIX.size());
+        return !address.m_socketPath.empty();
+    }
+
+    // Une adresse IPv6 contient elle-même des ':'
+    std::string_view host = text;
+    std::string_view port;
+    if (text.starts_with('['))
+    {
+        const auto closingPos = text.find(']');
+        RETURN_IF(closingPos == std::string_view::npos, false);
+        host = text.substr(1, closingPos - 1);
+        const auto rest = text.substr(closingPos + 1);
+        RETURN_IF(!rest.empty() && !rest.starts_with(':'), false);
+        port = rest.empty() ? rest : rest.substr(1);
+    }
+    else if (const auto separatorPos = text.rfind(':'); separatorPos != std::string_view::npos)
+    {
+        host = text.substr(0, separatorPos);
+        port = text.substr(separatorPos + 1);
+    }
+
+    address.m_host = host;
+    return port.empty() || ParsePort(port, address.m_port);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si <text> désigne un dépôt servi par dvcsusd plutôt qu'un fichier
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool IsRemoteUrl(std::string_view text) noexcept { return text.starts_with(TCP_URL_SCHEME) || text.starts_with(UNIX_URL_SCHEME); }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lit le dépôt distant <url> de sa forme textuelle <text>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ParseRemoteUrl(std::string_view text, RemoteUrl &url)
+{
+    url = RemoteUrl{};
+    if (text.starts_with(UNIX_URL_SCHEME))
+    {
+        const auto rest = text.substr(UNIX_URL_SCHEME.size());
+        const auto separatorPos = rest.rfind(':');
+        RETURN_IF(separatorPos == std::string_view::npos, false);
+        url.m_address.m_socketPath = rest.substr(0, separatorPos);
+        url.m_repository = rest.substr(separatorPos + 1);
+        return !url.m_address.m_socketPath.empty();
+    }
+
+    RETURN_IF(!text.starts_with(TCP_URL_SCHEME), false);
+    const auto rest = text.substr(TCP_URL_SCHEME.size());
+    const auto separatorPos = rest.find('/');
+    const auto authority = rest.substr(0, separatorPos);
+    RETURN_IF(authority.empty() || authority.starts_with(UNIX_ADDRESS_PREFIX), false);
+    url.m_repository = (separatorPos == std::string_view::npos) ? std::string_view{} : rest.substr(separatorPos + 1);
+    return ParseNetworkAddress(authority, url.m_address) && !url.m_address.m_host.empty();
+}
+
+SocketHandle::SocketHandle(SocketHandle &&other) noexcept : m_descriptor{std::exchange(other.m_descriptor, -1)} {}
+
+SocketHandle &SocketHandle::operator=(SocketHandle &&other) noexcept
+{
+    Close();
+    m_descriptor = std::exchange(other.m_descriptor, -1);
+    return *this;
+}
+
+void SocketHandle::Close() noexcept
+{
+    if (m_descriptor >= 0)
+    {
+        ::close(m_descriptor);
+        m_descriptor = -1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Ouvre un socket <socket> à l'écoute de <address>. Le port réellement utilisé est
+// donné par <port> (0 pour un socket Unix).
+// NOTE: Un socket Unix laissé par un service précédent est remplacé.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ListenOn(const NetworkAddress &address, SocketHandle &socket, std::uint16_t &port) noexcept
+{
+    port = 0;
+    if (!address.m_socketPath.empty())
+    {
+        sockaddr_un unixAddress{};
+        RETURN_IF(!MakeUnixAddress(address.m_socketPath, unixAddress), false);
+        SocketHandle newSocket{::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+        RETURN_IF(!newSocket.IsValid(), false);
+        ::unlink(address.m_socketPath.c_str());
+        RETURN_IF(::bind(newSocket.Get(), reinterpret_cast<const sockaddr *>(&unixAddress), sizeof(unixAddress)) != 0, false);
+        RETURN_IF(::listen(newSocket.Get(), LISTEN_BACKLOG) != 0, false);
+        socket = std::move(newSocket);
+        return true;
+    }
+
+    TAddressInfoPtr pAddressInfo{nullptr, freeaddrinfo};
+    RETURN_IF(!ResolveTcpAddress(address, pAddressInfo), false);
+    for (const addrinfo *pInfo = pAddressInfo.get(); pInfo != nullptr; pInfo = pInfo->ai_next)
+    {
+        SocketHandle newSocket{::socket(pInfo->ai_family, pInfo->ai_socktype | SOCK_CLOEXEC, pInfo->ai_protocol)};
+        if (!newSocket.IsValid())
+        {
+            continue;
+        }
+
+        const int isEnabled = 1;
+        setsockopt(newSocket.Get(), SOL_SOCKET, SO_REUSEADDR, &isEnabled, sizeof(isEnabled));
+        if ((::bind(newSocket.Get(), pInfo->ai_addr, pInfo->ai_addrlen) != 0) || (::listen(newSocket.Get(), LISTEN_BACKLOG) != 0))
+        {
+            continue;
+        }
+
+        sockaddr_storage boundAddress{};
+        socklen_t boundAddressSize = sizeof(boundAddress);
+        RETURN_IF(::getsockname(newSocket.Get(), reinterpret_cast<sockaddr *>(&boundAddress), &boundAddressSize) != 0, false);
+        port = ntohs((boundAddress.ss_family == AF_INET6) ? reinterpret_cast<const sockaddr_in6 *>(&boundAddress)->sin6_port
+                                                          : reinterpret_cast<const sockaddr_in *>(&boundAddress)->sin_port);
+        socket = std::move(newSocket);
+        return true;
+    }
+    return false;
+}
+
+SocketStreamBuffer::SocketStreamBuffer(int descriptor) noexcept : m_descriptor{descriptor}
+{
+    setg(m_inputBuffer.data(), m_inputBuffer.data(), m_inputBuffer.data());
+    setp(m_outputBuffer.data(), m_outputBuffer.data() + m_outputBuffer.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Remplit le tampon de lecture à partir du socket
+////////////////////////////////////////////////////////////////////////////////////
+SocketStreamBuffer::int_type SocketStreamBuffer::underflow()
+{
+    RETURN_IF(gptr() < egptr(), traits_type::to_int_type(*gptr()));
+
+    ssize_t nbRead = -1;
+    do
+    {
+        nbRead = ::recv(m_descriptor, m_inputBuffer.data(), m_inputBuffer.size(), 0);
+    } while ((nbRead < 0) && (errno == EINTR));
+    RETURN_IF(nbRead <= 0, traits_type::eof());
+
+    setg(m_inputBuffer.data(), m_inputBuffer.data(), m_inputBuffer.data() + nbRead);
+    return traits_type::to_int_type(*gptr());
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Envoie le tampon d'écriture plein avant d'y ajouter <character>
+////////////////////////////////////////////////////////////////////////////////////
+SocketStreamBuffer::int_type SocketStreamBuffer::overflow(int_type character)
+{
+    RETURN_IF(!Flush(), traits_type::eof());
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+    return traits_type::not_eof(character);
+}
+
+int SocketStreamBuffer::sync() { return Flush() ? 0 : -1; }
+
+[[nodiscard]] bool SocketStreamBuffer::Flush() noexcept
+{
+    const char *pData = pbase();
+    while (pData < pptr())
+    {
+        // MSG_NOSIGNAL: un pair disparu est une erreur, pas une raison de mourir
+        const ssize_t nbSent = ::send(m_descriptor, pData, static_cast<std::size_t>(pptr() - pData), MSG_NOSIGNAL);
+        if (nbSent < 0)
+        {
+            RETURN_IF(errno != EINTR, false);
+            continue;
+        }
+        pData += nbSent;
+    }
+    setp(m_outputBuffer.data(), m_outputBuffer.data() + m_outputBuffer.size());
+    return true;
+}
+
+SocketStream::SocketStream(SocketHandle socket) : std::iostream{nullptr}, m_socket{std::move(socket)}
+{
+    ConfigureConnection(m_socket.Get());
+    m_pBuffer = std::make_unique<SocketStreamBuffer>(m_socket.Get());
+    rdbuf(m_pBuffer.get());
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Établit la connexion du flux au service situé à <address>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool SocketStream::Connect(const NetworkAddress &address)
+{
+    SocketHandle socket;
+    if (!address.m_socketPath.empty())
+    {
+        sockaddr_un unixAddress{};
+        RETURN_IF(!MakeUnixAddress(address.m_socketPath, unixAddress), false);
+        socket = SocketHandle{::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+        RETURN_IF(!socket.IsValid(), false);
+        RETURN_IF(::connect(socket.Get(), reinterpret_cast<const sockaddr *>(&unixAddress), sizeof(unixAddress)) != 0, false);
+    }
+    else
+    {
+        TAddressInfoPtr pAddressInfo{nullptr, freeaddrinfo};
+        RETURN_IF(!ResolveTcpAddress(address, pAddressInfo), false);
+        for (const addrinfo *pInfo = pAddressInfo.get(); (pInfo != nullptr) && !socket.IsValid(); pInfo = pInfo->ai_next)
+        {
+            socket = SocketHandle{::socket(pInfo->ai_family, pInfo->ai_socktype | SOCK_CLOEXEC, pInfo->ai_protocol)};
+            if (socket.IsValid() && (::connect(socket.Get(), pInfo->ai_addr, pInfo->ai_addrlen) != 0))
+            {
+                socket.Close();
+            }
+        }
+        RETURN_IF(!socket.IsValid(), false);
+    }
+
+    ConfigureConnection(socket.Get());
+    m_socket = std::move(socket);
+    m_pBuffer = std::make_unique<SocketStreamBuffer>(m_socket.Get());
+    rdbuf(m_pBuffer.get());
+    clear();
+    return true;
+}
+
+} // namespace dvcs
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace dvcs
+{
+
+// Port TCP sur lequel dvcsusd écoute par défaut
+constexpr const std::uint16_t DEFAULT_DAEMON_PORT = 9427;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Adresse réseau d'un service: un hôte et un port TCP, ou le chemin d'un socket
+// Unix.
+// Forme textuelle: <hôte>[:<port>], [<hôte IPv6>][:<port>] ou unix:<chemin>
+////////////////////////////////////////////////////////////////////////////////////
+struct NetworkAddress
+{
+    std::string m_host;       // Vide pour un socket Unix
+    std::uint16_t m_port{DEFAULT_DAEMON_PORT};
+    std::string m_socketPath; // Vide pour TCP
+};
+
+[[nodiscard]] bool ParseNetworkAddress(std::string_view text, NetworkAddress &address);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Dépôt servi par dvcsusd. Le chemin du dépôt est relatif à la racine du service.
+// Forme textuelle: dvcs://<hôte>[:<port>]/<dépôt> ou dvcs+unix://<socket>:<dépôt>
+////////////////////////////////////////////////////////////////////////////////////
+struct RemoteUrl
+{
+    NetworkAddress m_address;
+    std::string m_repository;
+};
+
+[[nodiscard]] bool IsRemoteUrl(std::string_view text) noexcept;
+[[nodiscard]] bool ParseRemoteUrl(std::string_view text, RemoteUrl &url);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Descripteur de socket fermé automatiquement lorsqu'on n'en a plus besoin
+////////////////////////////////////////////////////////////////////////////////////
+class SocketHandle
+{
+  public:
+    SocketHandle() noexcept = default;
+    explicit SocketHandle(int descriptor) noexcept : m_descriptor{descriptor} {}
+    SocketHandle(const SocketHandle &) = delete;
+    SocketHandle &operator=(const SocketHandle &) = delete;
+    SocketHandle(SocketHandle &&other) noexcept;
+    SocketHandle &operator=(SocketHandle &&other) noexcept;
+    ~SocketHandle() { Close(); }
+
+    [[nodiscard]] int Get() const noexcept { return m_descriptor; }
+    [[nodiscard]] bool IsValid() const noexcept { return m_descriptor >= 0; }
+    void Close() noexcept;
+
+  private:
+    int m_descriptor{-1};
+};
+
+// Ouvre un socket à l'écoute de <address>. Le port réellement utilisé (utile pour
+// le port 0, choisi par le système) est donné par <port>.
+[[nodiscard]] bool ListenOn(const NetworkAddress &address, SocketHandle &socket, std::uint16_t &port) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Tampon de flux lisant et écrivant sur un socket connecté.
+// Les écritures sont accumulées jusqu'au vidage du flux: plusieurs messages
+// peuvent ainsi être envoyés d'un coup, sans attendre de réponse entre chacun.
+////////////////////////////////////////////////////////////////////////////////////
+class SocketStreamBuffer : public std::streambuf
+{
+  public:
+    explicit SocketStreamBuffer(int descriptor) noexcept;
+
+  protected:
+    int_type underflow() override;
+    int_type overflow(int_type character) override;
+    int sync() override;
+
+  private:
+    [[nodiscard]] bool Flush() noexcept;
+
+    static constexpr std::size_t BUFFER_SIZE = 64U * 1024U;
+
+    int m_descriptor;
+    std::array<char, BUFFER_SIZE> m_inputBuffer{};
+    std::array<char, BUFFER_SIZE> m_outputBuffer{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Flux sur une connexion réseau. La connexion est fermée avec le flux.
+////////////////////////////////////////////////////////////////////////////////////
+class SocketStream : public std::iostream
+{
+  public:
+    SocketStream() noexcept : std::iostream{nullptr} {}
+    explicit SocketStream(SocketHandle socket);
+    SocketStream(const SocketStream &) = delete;
+    SocketStream &operator=(const SocketStream &) = delete;
+
+    [[nodiscard]] bool Connect(const NetworkAddress &address);
+    [[nodiscard]] bool IsOpen() const noexcept { return m_socket.IsValid(); }
+
+  private:
+    SocketHandle m_socket;
+    std::unique_ptr<SocketStreamBuffer> m_pBuffer;
+};
+
+} // namespace dvcs
@@ -10,5 +10,7 @@ namespace dvcs
 const fs::path DVCS_PATH{".dvcs"};
 const fs::path REPO_DB_PATH = DVCS_PATH / fs::path{"repo.db"};
 const fs::path STAGING_DB_PATH = DVCS_PATH / fs::path{"staging.db"};
+const fs::path FILE_MONITOR_LOCK_PATH = DVCS_PATH / fs::path{"fsmonitor.lock"};
+const fs::path COMMIT_GRAPH_PATH = DVCS_PATH / fs::path{"commit-graph"};
 
 } // namespace dvcs
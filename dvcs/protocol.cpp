@@ -0,0 +1,70 @@
+#include "protocol.h"
+#include "bundle.h"
+
+#include <istream>
+#include <ostream>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// Taille de l'en-tête d'un message: type et taille des champs
+constexpr const std::size_t MESSAGE_HEADER_SIZE = 5;
+
+// Borne sur la taille des champs d'un message, pour ne pas allouer n'importe quoi
+// à la réception d'un message invalide
+constexpr const std::uint32_t MAX_MESSAGE_SIZE = 16U * 1024U * 1024U;
+
+} // namespace
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit dans <output> le message <type> dont les champs sont <fields>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteMessage(std::ostream &output, MessageType type, const std::vector<char> &fields) noexcept
+{
+    RETURN_IF(fields.size() > MAX_MESSAGE_SIZE, false);
+    try
+    {
+        std::vector<char> header;
+        BundleFieldsWriter headerWriter{header};
+        headerWriter.AddU8(static_cast<std::uint8_t>(type));
+        headerWriter.AddU32(static_cast<std::uint32_t>(fields.size()));
+        output.write(header.data(), static_cast<std::streamsize>(header.size()));
+        output.write(fields.data(), static_cast<std::streamsize>(fields.size()));
+        return output.good();
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lit de <input> un message, son type <type> et ses champs <fields>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ReadMessage(std::istream &input, MessageType &type, std::vector<char> &fields)
+{
+    std::vector<char> header(MESSAGE_HEADER_SIZE);
+    RETURN_IF(!input.read(header.data(), static_cast<std::streamsize>(header.size())), false);
+
+    BundleFieldsReader headerReader{header};
+    std::uint8_t rawType{};
+    std::uint32_t size{};
+    RETURN_IF(!headerReader.ReadU8(rawType) || !headerReader.ReadU32(size), false);
+    RETURN_IF((rawType < static_cast<std::uint8_t>(MessageType::Hello)) || (rawType > static_cast<std::uint8_t>(MessageType::Error)), false);
+    RETURN_IF(size > MAX_MESSAGE_SIZE, false);
+
+    type = static_cast<MessageType>(rawType);
+    fields.resize(size);
+    return (size == 0) || static_cast<bool>(input.read(fields.data(), static_cast<std::streamsize>(size)));
+}
+
+} // namespace dvcs
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace dvcs
+{
+
+// Version du protocole de dvcsusd. Un client et un service de versions
+// différentes refusent de travailler ensemble.
+constexpr const std::uint32_t PROTOCOL_VERSION = 1;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Messages échangés entre un client et dvcsusd.
+// NOTE: Les valeurs circulent sur le réseau et ne doivent donc jamais changer.
+// Champs de chacun des types (encodés comme ceux des bundles):
+//  Hello:  version du protocole, service demandé, chemin du dépôt
+//  Refs:   algorithme de hachage, nombre de branches, puis nom et tête de chacune
+//  Want:   hash d'un commit annoncé que le client veut recevoir
+//  Have:   hash d'un commit que le client a déjà
+//  Done:   (aucun) fin de la négociation
+//  Status: nombre de commits, d'objets et de morceaux importés
+//  Error:  message d'erreur
+// Une session se déroule ainsi:
+//  1. Le client envoie Hello et le service répond par Refs (ou Error)
+//  2. Pull: le client envoie ses Want et ses Have d'un coup, suivis de Done, et
+//     le service répond par un bundle contenant ce qui manque au client
+//  3. Push: le client envoie un bundle de ce qui manque au service, d'après Refs,
+//     et le service répond par Status (ou Error) une fois le bundle importé
+////////////////////////////////////////////////////////////////////////////////////
+enum class MessageType : std::uint8_t
+{
+    Hello = 1,
+    Refs = 2,
+    Want = 3,
+    Have = 4,
+    Done = 5,
+    Status = 6,
+    Error = 7
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Services offerts par dvcsusd
+////////////////////////////////////////////////////////////////////////////////////
+enum class RemoteService : std::uint8_t
+{
+    Pull = 1, // Le service envoie des commits au client
+    Push = 2  // Le service reçoit des commits du client
+};
+
+// Un message est composé de son type, de la taille de ses champs puis des champs.
+// Les messages ne sont pas vidés du flux: c'est à l'appelant de le faire lorsqu'il
+// attend une réponse.
+[[nodiscard]] bool WriteMessage(std::ostream &output, MessageType type, const std::vector<char> &fields) noexcept;
+[[nodiscard]] bool ReadMessage(std::istream &input, MessageType &type, std::vector<char> &fields);
+
+} // namespace dvcs
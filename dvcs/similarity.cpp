@@ -0,0 +1,198 @@
+#include "similarity.h"
+
+#include <algorithm>
+#include <bit>
+#include <tuple>
+#include <utility>
+
+namespace
+{
+
+static_assert(std::has_single_bit(dvcs::SKETCH_SIZE) && (dvcs::SKETCH_SIZE % dvcs::SKETCH_NB_BANDS == 0));
+
+// Nombre de bits de poids fort d'une empreinte qui désignent sa valeur
+constexpr const int SKETCH_INDEX_BITS = std::countr_zero(dvcs::SKETCH_SIZE);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Mélange final de SplitMix64: chacun des bits du résultat dépend de tous ceux de
+// <value>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::uint64_t Mix(std::uint64_t value) noexcept
+{
+    value = (value ^ (value >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27U)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31U);
+}
+
+// Empreinte FNV-1a d'un morceau de fichier
+[[nodiscard]] std::uint64_t ComputeChunkHash(std::string_view chunk) noexcept
+{
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const char character : chunk)
+    {
+        hash ^= static_cast<std::uint8_t>(character);
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+SimilaritySketch::SimilaritySketch(std::string_view data)
+{
+    if (data.empty())
+    {
+        return;
+    }
+
+    // Chacune des occurrences d'un morceau a sa propre empreinte
+    std::unordered_map<std::uint64_t, std::uint32_t> nbOccurrences;
+    std::vector<std::uint64_t> values(SKETCH_SIZE);
+    std::vector<bool> isSet(SKETCH_SIZE, false);
+    for (std::size_t chunkStart = 0; chunkStart < data.size();)
+    {
+        const auto lineEnd = data.find('\n', chunkStart);
+        const auto chunkEnd =
+            std::min({(lineEnd == std::string_view::npos) ? data.size() : lineEnd + 1, chunkStart + SIMILARITY_CHUNK_SIZE, data.size()});
+        const auto chunkHash = ComputeChunkHash(data.substr(chunkStart, chunkEnd - chunkStart));
+        const auto hash = Mix(chunkHash + (0x9E3779B97F4A7C15ULL * nbOccurrences[chunkHash]++));
+        chunkStart = chunkEnd;
+
+        const auto index = static_cast<std::size_t>(hash >> (64 - SKETCH_INDEX_BITS));
+        if (!isSet[index] || (hash < values[index]))
+        {
+            values[index] = hash;
+            isSet[index] = true;
+        }
+    }
+
+    // Une valeur qu'aucun morceau n'a désignée est copiée de l'une de celles qui
+    // l'ont été, choisie par une suite d'empreintes propre à sa position: deux
+    // signatures copient ainsi les mêmes positions, sauf là où elles diffèrent déjà
+    for (std::size_t index = 0; index < SKETCH_SIZE; ++index)
+    {
+        if (isSet[index])
+        {
+            continue;
+        }
+        auto iSource = static_cast<std::size_t>(Mix(index) % SKETCH_SIZE);
+        for (std::uint64_t attempt = 1; !isSet[iSource]; ++attempt)
+        {
+            iSource = static_cast<std::size_t>(Mix((index * SKETCH_SIZE) + attempt) % SKETCH_SIZE);
+        }
+        values[index] = values[iSource];
+    }
+    m_values = std::move(values);
+}
+
+[[nodiscard]] std::size_t SimilaritySketch::GetSimilarity(const SimilaritySketch &other) const noexcept
+{
+    if (IsEmpty() || other.IsEmpty())
+    {
+        return 0;
+    }
+
+    std::size_t nbEqualValues{};
+    for (std::size_t index = 0; index < SKETCH_SIZE; ++index)
+    {
+        nbEqualValues += (m_values[index] == other.m_values[index]) ? 1U : 0U;
+    }
+    return nbEqualValues * 100U / SKETCH_SIZE;
+}
+
+[[nodiscard]] std::uint64_t SimilaritySketch::GetBandHash(std::size_t iBand) const noexcept
+{
+    // Une bande identique à une autre, mais à une autre position, n'a pas la même
+    // empreinte
+    auto hash = Mix(iBand);
+    for (std::size_t iRow = 0; iRow < SKETCH_ROWS_PER_BAND; ++iRow)
+    {
+        hash = Mix(hash ^ m_values[(iBand * SKETCH_ROWS_PER_BAND) + iRow]);
+    }
+    return hash;
+}
+
+void SimilarityIndex::Add(const SimilaritySketch &sketch, std::size_t id)
+{
+    if (sketch.IsEmpty())
+    {
+        return;
+    }
+    for (std::size_t iBand = 0; iBand < SKETCH_NB_BANDS; ++iBand)
+    {
+        m_buckets[sketch.GetBandHash(iBand)].push_back(id);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Seuls les <maxCandidates> premiers fichiers d'une bande sont considérés: des
+// milliers de fichiers presque identiques n'en deviennent pas tous candidats.
+////////////////////////////////////////////////////////////////////////////////////
+void SimilarityIndex::FindCandidates(const SimilaritySketch &sketch, std::size_t maxCandidates, std::vector<std::size_t> &candidates) const
+{
+    if (sketch.IsEmpty() || (maxCandidates == 0))
+    {
+        return;
+    }
+
+    std::unordered_map<std::size_t, std::size_t> nbSharedBands;
+    for (std::size_t iBand = 0; iBand < SKETCH_NB_BANDS; ++iBand)
+    {
+        const auto bucketIt = m_buckets.find(sketch.GetBandHash(iBand));
+        if (bucketIt == m_buckets.end())
+        {
+            continue;
+        }
+        const auto &ids = bucketIt->second;
+        std::for_each(ids.cbegin(), ids.cbegin() + static_cast<std::ptrdiff_t>(std::min(ids.size(), maxCandidates)),
+                      [&nbSharedBands](std::size_t id) { ++nbSharedBands[id]; });
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> sortedCandidates{nbSharedBands.cbegin(), nbSharedBands.cend()};
+    std::sort(sortedCandidates.begin(), sortedCandidates.end(), [](const auto &lhs, const auto &rhs) {
+        return std::tie(rhs.second, lhs.first) < std::tie(lhs.second, rhs.first);
+    });
+    sortedCandidates.resize(std::min(sortedCandidates.size(), maxCandidates));
+    for (const auto &[id, nbBands] : sortedCandidates)
+    {
+        candidates.push_back(id);
+    }
+}
+
+[[nodiscard]] std::vector<SimilarPair> FindSimilarPairs(const std::vector<SimilaritySketch> &sources,
+                                                        const std::vector<SimilaritySketch> &destinations, std::size_t threshold,
+                                                        std::size_t maxCandidates)
+{
+    SimilarityIndex index;
+    for (std::size_t iSource = 0; iSource < sources.size(); ++iSource)
+    {
+        index.Add(sources[iSource], iSource);
+    }
+
+    std::vector<SimilarPair> pairs;
+    std::vector<std::size_t> candidates;
+    for (std::size_t iDestination = 0; iDestination < destinations.size(); ++iDestination)
+    {
+        candidates.clear();
+        index.FindCandidates(destinations[iDestination], maxCandidates, candidates);
+        for (const auto iSource : candidates)
+        {
+            const auto similarity = sources[iSource].GetSimilarity(destinations[iDestination]);
+            if (similarity >= threshold)
+            {
+                pairs.push_back(SimilarPair{iSource, iDestination, similarity});
+            }
+        }
+    }
+
+    // À similarité égale, l'ordre des fichiers est conservé
+    std::sort(pairs.begin(), pairs.end(), [](const SimilarPair &lhs, const SimilarPair &rhs) {
+        return std::tie(rhs.m_similarity, lhs.m_destination, lhs.m_source) < std::tie(lhs.m_similarity, rhs.m_destination, rhs.m_source);
+    });
+    return pairs;
+}
+
+} // namespace dvcs
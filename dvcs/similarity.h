@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dvcs
+{
+
+// Taille maximale d'un morceau de fichier comparé. Un morceau se termine à la fin
+// d'une ligne ou après ce nombre d'octets (comme le fait git).
+constexpr const std::size_t SIMILARITY_CHUNK_SIZE = 64U;
+
+// Nombre de valeurs (MinHash) d'une signature et leur regroupement en bandes par
+// l'index: deux fichiers deviennent candidats dès que l'une de leurs bandes est
+// identique. Avec 32 bandes de 4 valeurs, deux fichiers semblables à 50% le
+// deviennent environ 9 fois sur 10, et à 70% presque toujours.
+constexpr const std::size_t SKETCH_SIZE = 128U;
+constexpr const std::size_t SKETCH_NB_BANDS = 32U;
+constexpr const std::size_t SKETCH_ROWS_PER_BAND = SKETCH_SIZE / SKETCH_NB_BANDS;
+
+// Similarité minimale (en pourcentage) d'un renommage ou d'une copie
+constexpr const std::size_t DEFAULT_SIMILARITY_THRESHOLD = 50U;
+
+// Nombre maximal de candidats comparés à chacun des fichiers
+constexpr const std::size_t DEFAULT_SIMILARITY_CANDIDATES = 16U;
+
+// Nombre maximal de fichiers sources d'une détection de renommages approximative
+constexpr const std::size_t DEFAULT_RENAME_LIMIT = 1000U;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Signature MinHash du contenu d'un fichier, vu comme l'ensemble de ses morceaux
+// (voir SIMILARITY_CHUNK_SIZE). Un morceau répété compte autant de fois qu'il
+// apparaît. La proportion des valeurs identiques de deux signatures estime la
+// similarité de Jaccard des deux fichiers.
+// Les valeurs sont calculées en une seule passe (one permutation hashing, Li et
+// al., 2012): l'empreinte de chacun des morceaux désigne la valeur qu'elle peut
+// remplacer. Les valeurs qu'aucun morceau n'a désignées sont empruntées à d'autres
+// (Shrivastava, 2017), ce qui garde l'estimation fiable pour les petits fichiers.
+////////////////////////////////////////////////////////////////////////////////////
+class SimilaritySketch
+{
+  public:
+    SimilaritySketch() = default;
+    explicit SimilaritySketch(std::string_view data);
+
+    // Un fichier vide n'a aucune valeur: il ne ressemble à aucun autre
+    [[nodiscard]] bool IsEmpty() const noexcept { return m_values.empty(); }
+
+    // Similarité estimée, en pourcentage, entre le fichier et celui de <other>
+    [[nodiscard]] std::size_t GetSimilarity(const SimilaritySketch &other) const noexcept;
+
+    // Empreinte des valeurs de la bande <iBand>
+    [[nodiscard]] std::uint64_t GetBandHash(std::size_t iBand) const noexcept;
+
+  private:
+    std::vector<std::uint64_t> m_values;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Index des signatures d'un ensemble de fichiers qui trouve, sans les comparer
+// toutes, celles qui ressemblent probablement à une signature donnée (locality
+// sensitive hashing): chacune des bandes des signatures indexées est rangée selon
+// son empreinte.
+////////////////////////////////////////////////////////////////////////////////////
+class SimilarityIndex
+{
+  public:
+    // Ajoute la signature <sketch> du fichier <id>. Une signature vide est ignorée.
+    void Add(const SimilaritySketch &sketch, std::size_t id);
+
+    // Ajoute à <candidates> au plus <maxCandidates> des fichiers ayant au moins une
+    // bande identique à celles de <sketch>, ceux qui en partagent le plus d'abord
+    void FindCandidates(const SimilaritySketch &sketch, std::size_t maxCandidates, std::vector<std::size_t> &candidates) const;
+
+  private:
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> m_buckets;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Paire de fichiers semblables: un fichier source et un fichier destination
+////////////////////////////////////////////////////////////////////////////////////
+struct SimilarPair
+{
+    std::size_t m_source{};
+    std::size_t m_destination{};
+    std::size_t m_similarity{}; // En pourcentage
+
+    bool operator==(const SimilarPair &) const noexcept = default;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Paires des fichiers <sources> et <destinations> dont la similarité atteint
+// <threshold>, de la plus semblable à la moins semblable. Chacune des destinations
+// n'est comparée qu'à au plus <maxCandidates> sources trouvées par un index
+// (voir SimilarityIndex): le coût est linéaire plutôt que quadratique.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] std::vector<SimilarPair> FindSimilarPairs(const std::vector<SimilaritySketch> &sources,
+                                                        const std::vector<SimilaritySketch> &destinations, std::size_t threshold,
+                                                        std::size_t maxCandidates);
+
+} // namespace dvcs
@@ -0,0 +1,64 @@
+#include "storage.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Description d'un profil de stockage
+////////////////////////////////////////////////////////////////////////////////////
+struct StorageProfileInfo
+{
+    dvcs::StorageProfile m_profile;
+    std::string_view m_name;
+    dvcs::StorageSettings m_settings;
+};
+
+constexpr const std::int64_t MB = 1024 * 1024;
+
+// NOTE: Les noms sont consignés dans les dépôts et ne doivent donc jamais changer.
+//       La taille de mmap est bornée par SQLite (SQLITE_MAX_MMAP_SIZE).
+constexpr const std::array<StorageProfileInfo, 3> STORAGE_PROFILE_INFOS{{
+    // Le WAL permet aux lecteurs de travailler pendant une écriture. Avec une
+    // synchronisation complète, chaque commit est sur le disque à son retour.
+    {dvcs::StorageProfile::Durable, "durable", {"WAL", "FULL", 256 * MB, 4096, 8 * 1024}},
+    // Une panne de courant peut perdre les dernières transactions, voire corrompre
+    // le dépôt. Un plantage de l'application, lui, reste sans conséquence.
+    {dvcs::StorageProfile::FastCI, "ci", {"WAL", "OFF", 1024 * MB, 4096, 32 * 1024}},
+    // Une importation produit de très grosses transactions: le journal en mémoire
+    // évite d'écrire deux fois les objets tout en permettant l'annulation. Les
+    // grandes pages réduisent le nombre de pages de débordement des gros objets.
+    {dvcs::StorageProfile::BulkImport, "bulk", {"MEMORY", "OFF", 1024 * MB, 16384, 128 * 1024}},
+}};
+
+[[nodiscard]] const StorageProfileInfo &GetStorageProfileInfo(dvcs::StorageProfile profile) noexcept
+{
+    const auto infoIt = std::find_if(STORAGE_PROFILE_INFOS.cbegin(), STORAGE_PROFILE_INFOS.cend(),
+                                     [profile](const StorageProfileInfo &info) { return info.m_profile == profile; });
+    return (infoIt != STORAGE_PROFILE_INFOS.cend()) ? *infoIt : STORAGE_PROFILE_INFOS.front();
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] std::string_view GetStorageProfileName(StorageProfile profile) noexcept { return GetStorageProfileInfo(profile).m_name; }
+
+[[nodiscard]] bool ParseStorageProfile(std::string_view name, StorageProfile &profile) noexcept
+{
+    const auto infoIt = std::find_if(STORAGE_PROFILE_INFOS.cbegin(), STORAGE_PROFILE_INFOS.cend(),
+                                     [name](const StorageProfileInfo &info) { return info.m_name == name; });
+    if (infoIt == STORAGE_PROFILE_INFOS.cend())
+    {
+        return false;
+    }
+    profile = infoIt->m_profile;
+    return true;
+}
+
+[[nodiscard]] const StorageSettings &GetStorageSettings(StorageProfile profile) noexcept { return GetStorageProfileInfo(profile).m_settings; }
+
+} // namespace dvcs
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Profil de stockage d'un dépôt.
+// Un profil regroupe les réglages SQLite (journalisation, synchronisation, mmap,
+// taille des pages) selon l'usage prévu du dépôt. Il est choisi au moment de
+// l'init, consigné dans le dépôt et appliqué à chacune de ses ouvertures.
+////////////////////////////////////////////////////////////////////////////////////
+enum class StorageProfile
+{
+    Durable, // WAL et synchronisation complète: aucune transaction confirmée n'est perdue
+    FastCI, // WAL sans synchronisation: pour les dépôts jetables (intégration continue, builds)
+    BulkImport // Journal en mémoire et grandes pages: pour les importations massives
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Réglages SQLite d'un profil de stockage
+////////////////////////////////////////////////////////////////////////////////////
+struct StorageSettings
+{
+    std::string_view m_journalMode; // PRAGMA journal_mode
+    std::string_view m_synchronous; // PRAGMA synchronous
+    std::int64_t m_mmapSize{}; // PRAGMA mmap_size, en octets
+    int m_pageSize{}; // PRAGMA page_size, en octets (à la création seulement)
+    int m_cacheSizeKB{}; // PRAGMA cache_size, en Kio
+};
+
+[[nodiscard]] std::string_view GetStorageProfileName(StorageProfile profile) noexcept;
+[[nodiscard]] bool ParseStorageProfile(std::string_view name, StorageProfile &profile) noexcept;
+[[nodiscard]] const StorageSettings &GetStorageSettings(StorageProfile profile) noexcept;
+
+} // namespace dvcs
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichier temporaire détruit automatiquement lorsqu'on n'en a plus besoin
+////////////////////////////////////////////////////////////////////////////////////
+class TemporaryFile
+{
+  public:
+    TemporaryFile() = default;
+    explicit TemporaryFile(fs::path path) : m_path{std::move(path)} {}
+    TemporaryFile(const TemporaryFile &) = delete;
+    TemporaryFile &operator=(const TemporaryFile &) = delete;
+    TemporaryFile(TemporaryFile &&other) noexcept : m_path{std::exchange(other.m_path, {})} {}
+    TemporaryFile &operator=(TemporaryFile &&other) noexcept
+    {
+        Remove();
+        m_path = std::exchange(other.m_path, {});
+        return *this;
+    }
+    ~TemporaryFile() { Remove(); }
+
+    [[nodiscard]] const fs::path &GetPath() const noexcept { return m_path; }
+
+  private:
+    void Remove() noexcept
+    {
+        if (!m_path.empty())
+        {
+            std::error_code errorCode;
+            fs::remove(m_path, errorCode);
+        }
+    }
+
+    fs::path m_path{};
+};
+
+} // namespace dvcs
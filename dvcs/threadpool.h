@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Nombre de fils d'exécution à utiliser pour paralléliser un traitement.
+// On se limite au nombre de coeurs de la machine.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] inline std::size_t GetWorkerCount() noexcept { return std::max<std::size_t>(1U, std::thread::hardware_concurrency()); }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Exécute <function> pour chacun des indices de l'intervalle [0, <count>[ à l'aide
+// d'un bassin de fils d'exécution dimensionné au nombre de coeurs de la machine.
+// Les indices sont distribués dynamiquement pour que les tâches plus longues (gros
+// fichiers par exemple) ne bloquent pas les autres fils d'exécution.
+// NOTE: <function> ne doit pas lancer d'exceptions. Les erreurs doivent être
+//       consignées dans les résultats produits pour chacun des indices.
+////////////////////////////////////////////////////////////////////////////////////
+template <typename TFunction>
+requires std::invocable<TFunction &, std::size_t> void ParallelFor(const std::size_t count, TFunction &&function)
+{
+    std::atomic<std::size_t> nextIndex{0};
+    auto worker = [&nextIndex, &function, count]() {
+        for (std::size_t index = nextIndex++; index < count; index = nextIndex++)
+        {
+            function(index);
+        }
+    };
+
+    // Le fil d'exécution courant participe lui aussi au travail
+    const std::size_t nbThreads = std::min(count, GetWorkerCount());
+    std::vector<std::jthread> threads;
+    threads.reserve(nbThreads > 0 ? nbThreads - 1 : 0);
+    for (std::size_t iThread = 1; iThread < nbThreads; ++iThread)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Exécute <function> pour chacun des indices de l'intervalle [0, <count>[ à l'aide
+// d'un bassin de fils d'exécution et remet chacun des résultats à <consumer>, dans
+// l'ordre des indices, dès qu'il est disponible: le fil d'exécution courant
+// consomme les résultats pendant que le bassin les produit. Au plus <window>
+// résultats sont produits d'avance, ce qui borne la mémoire utilisée lorsque le
+// consommateur est plus lent (écriture dans un terminal par exemple).
+// <function> reçoit l'indice de son fil d'exécution, dans [0, GetWorkerCount()[,
+// pour que chacun puisse utiliser ses propres ressources (connexion SQLite...).
+// NOTE: Comme pour ParallelFor, <function> ne doit pas lancer d'exceptions. Si
+//       <consumer> en lance une, le bassin est arrêté avant qu'elle ne soit propagée.
+////////////////////////////////////////////////////////////////////////////////////
+template <typename TFunction, typename TConsumer>
+requires std::invocable<TFunction &, std::size_t, std::size_t> &&
+         std::invocable<TConsumer &, std::size_t, std::invoke_result_t<TFunction &, std::size_t, std::size_t> &&>
+void ParallelForOrdered(const std::size_t count, const std::size_t window, TFunction &&function, TConsumer &&consumer)
+{
+    using TResult = std::invoke_result_t<TFunction &, std::size_t, std::size_t>;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::optional<TResult>> results(std::max<std::size_t>(1U, window));
+    std::size_t nextIndex{0};
+    std::size_t nbConsumed{0};
+    bool isCancelled{false};
+
+    auto worker = [&](std::size_t iWorker) {
+        while (true)
+        {
+            std::size_t index{};
+            {
+                std::unique_lock lock{mutex};
+                condition.wait(lock, [&] { return isCancelled || (nextIndex >= count) || (nextIndex < nbConsumed + results.size()); });
+                if (isCancelled || (nextIndex >= count))
+                {
+                    return;
+                }
+                index = nextIndex++;
+            }
+
+            auto result = function(iWorker, index);
+            {
+                std::lock_guard lock{mutex};
+                results[index % results.size()].emplace(std::move(result));
+            }
+            condition.notify_all();
+        }
+    };
+
+    const std::size_t nbThreads = std::min(count, GetWorkerCount());
+    std::vector<std::jthread> threads;
+    threads.reserve(nbThreads);
+    for (std::size_t iThread = 0; iThread < nbThreads; ++iThread)
+    {
+        threads.emplace_back(worker, iThread);
+    }
+
+    try
+    {
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            std::optional<TResult> result;
+            {
+                std::unique_lock lock{mutex};
+                auto &slot = results[index % results.size()];
+                condition.wait(lock, [&slot] { return slot.has_value(); });
+                result.swap(slot);
+                ++nbConsumed;
+            }
+            condition.notify_all();
+            consumer(index, std::move(*result));
+        }
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard lock{mutex};
+            isCancelled = true;
+        }
+        condition.notify_all();
+        throw;
+    }
+}
+
+} // namespace dvcs
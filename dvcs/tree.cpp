@@ -0,0 +1,499 @@
+#include "tree.h"
+#include "paths.h"
+#include "tempfile.h"
+#include "threadpool.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+// Entrées d'un arbre, selon leur nom
+using TTreeItems = std::map<std::string, dvcs::TreeItem>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère les entrées <items> de l'arbre <tree>. Un arbre inconnu n'a aucune
+// entrée.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool LoadTreeItems(dvcs::StatementCache &statements, const dvcs::THash &tree, TTreeItems &items)
+{
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT TreesEntries.Name, TreesEntries.EntryHash, TreesEntries.IsTree, Objects.Size FROM TreesEntries "
+                                  "LEFT JOIN Objects ON NOT TreesEntries.IsTree AND Objects.Hash = TreesEntries.EntryHash "
+                                  "WHERE TreesEntries.TreeHash = @tree;",
+                                  pStmt),
+              false);
+    RETURN_IF(!dvcs::BindValue(pStmt, 1, tree), false);
+
+    items.clear();
+    int stepResult{};
+    while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+    {
+        auto &item = items[std::string{dvcs::GetColumnText(pStmt, 0)}];
+        bool isPresent{};
+        RETURN_IF(!dvcs::GetColumnHash(pStmt, 1, item.m_hash, isPresent) || !isPresent, false);
+        item.m_isTree = sqlite3_column_int(pStmt.get(), 2) != 0;
+        item.m_size = static_cast<std::uintmax_t>(sqlite3_column_int64(pStmt.get(), 3));
+    }
+    return stepResult == SQLITE_DONE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichiers ajoutés, modifiés ou retirés (sans hash) dans un répertoire et dans ses
+// sous-répertoires
+////////////////////////////////////////////////////////////////////////////////////
+struct TreeUpdate
+{
+    std::map<std::string, std::optional<dvcs::THash>> m_files;
+    std::map<std::string, std::unique_ptr<TreeUpdate>> m_directories;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit l'arbre <tree> obtenu en appliquant les modifications <update> à l'arbre
+// <baseTree>. Seuls les sous-arbres modifiés sont écrits: les autres demeurent
+// partagés avec <baseTree>. Un répertoire dont tous les fichiers sont retirés est
+// retiré à son tour.
+// Le hash d'un arbre est celui de ses entrées triées selon leur nom, chacune
+// représentée par son type, son nom et le hash de son contenu sous forme
+// hexadécimale (comme le parent d'un commit, voir Commit).
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteTree(dvcs::StatementCache &statements, dvcs::HashAlgorithm algorithm, const dvcs::THash &baseTree, const TreeUpdate &update,
+                             dvcs::THash &tree)
+{
+    // NOTE: Les entrées sont chargées avant d'écrire les sous-arbres puisqu'une
+    //       requête préparée ne peut servir à deux appels à la fois.
+    TTreeItems items;
+    RETURN_IF(!LoadTreeItems(statements, baseTree, items), false);
+
+    // Les fichiers retirés le sont en premier puisqu'un répertoire peut remplacer
+    // l'un d'eux
+    for (const auto &[name, hash] : update.m_files)
+    {
+        if (!hash)
+        {
+            items.erase(name);
+        }
+    }
+    const auto emptyTree = dvcs::ComputeHash(algorithm, nullptr, 0);
+    for (const auto &[name, pDirectoryUpdate] : update.m_directories)
+    {
+        auto &item = items[name];
+        const auto baseSubtree = item.m_isTree ? item.m_hash : dvcs::THash{0};
+        RETURN_IF(!WriteTree(statements, algorithm, baseSubtree, *pDirectoryUpdate, item.m_hash), false);
+        item.m_isTree = true;
+        if (item.m_hash == emptyTree)
+        {
+            items.erase(name);
+        }
+    }
+    for (const auto &[name, hash] : update.m_files)
+    {
+        if (hash)
+        {
+            items[name] = dvcs::TreeItem{*hash, false};
+        }
+    }
+
+    std::string treeData;
+    for (const auto &[name, item] : items)
+    {
+        treeData += item.m_isTree ? "tree " : "blob ";
+        treeData += name;
+        treeData += '\0';
+        treeData += ToHex(item.m_hash);
+        treeData += '\n';
+    }
+    tree = dvcs::ComputeHash(algorithm, treeData.data(), treeData.size());
+
+    // Un arbre déjà connu est partagé plutôt que réécrit
+    RETURN_IF(!dvcs::ValidateNoResult(statements, "SELECT COUNT(*) FROM TreesEntries WHERE TreeHash = @tree;", {{"@tree", tree}}), true);
+
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("INSERT INTO TreesEntries (TreeHash, Name, EntryHash, IsTree) VALUES (@tree, @name, @entry, @isTree);", pStmt),
+              false);
+    for (const auto &[name, item] : items)
+    {
+        RETURN_IF(!dvcs::BindValue(pStmt, 1, tree) || !dvcs::BindValue(pStmt, 2, std::string_view{name}) || !dvcs::BindValue(pStmt, 3, item.m_hash) ||
+                      (sqlite3_bind_int(pStmt.get(), 4, item.m_isTree ? 1 : 0) != SQLITE_OK) || (sqlite3_step(pStmt.get()) != SQLITE_DONE),
+                  false);
+        sqlite3_reset(pStmt.get());
+    }
+    return true;
+}
+
+// Fichiers de l'arbre <tree>, dont les chemins d'accès sont représentés comme
+// ceux des objets
+constexpr const char *TREE_FILES_QUERY =
+    "WITH RECURSIVE Entries(Path, Hash, IsTree) AS ("
+    "   SELECT '../' || Name, EntryHash, IsTree FROM TreesEntries WHERE TreeHash = @tree "
+    "   UNION ALL "
+    "   SELECT Entries.Path || '/' || TreesEntries.Name, TreesEntries.EntryHash, TreesEntries.IsTree FROM Entries "
+    "   JOIN TreesEntries ON TreesEntries.TreeHash = Entries.Hash WHERE Entries.IsTree) "
+    "SELECT Entries.Path, Entries.Hash, Objects.Size FROM Entries JOIN Objects ON Objects.Hash = Entries.Hash WHERE NOT Entries.IsTree;";
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit à <filePath> les données produites par <writeData> dans le flux qu'elle
+// reçoit (voir dvcs::WriteWorkingTreeData)
+////////////////////////////////////////////////////////////////////////////////////
+template <typename TWriter>
+[[nodiscard]] bool WriteWorkingTreeStream(const fs::path &filePath, TWriter writeData) noexcept
+{
+    try
+    {
+        fs::create_directories(filePath.parent_path());
+        dvcs::TemporaryFile tempFile{fs::path{filePath}.concat(".dvcs-checkout")};
+        {
+            std::ofstream fileStream{tempFile.GetPath(), std::ios::out | std::ios::binary | std::ios::trunc};
+            RETURN_IF(!fileStream.good() || !writeData(fileStream) || !fileStream.flush(), false);
+        }
+        fs::rename(tempFile.GetPath(), filePath);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit à <filePath> les données de l'objet <entry>, lues par morceaux à l'aide
+// de <reader> (voir dvcs::WriteWorkingTreeData): un gros objet n'est jamais
+// entièrement en mémoire. Peut être appelée de façon concurrente, chacun des
+// appelants ayant son propre <reader>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteWorkingTreeFile(dvcs::ObjectReader &reader, const dvcs::TreeEntry &entry, const fs::path &filePath) noexcept
+{
+    return WriteWorkingTreeStream(filePath, [&reader, &entry](std::ostream &fileStream) {
+        std::uintmax_t nbWritten{};
+        RETURN_IF(!reader.ReadTo(entry.m_hash, fileStream, nbWritten), false);
+        if (nbWritten != entry.m_size)
+        {
+            fmt::print(std::cerr, "Corrupted object {}\n", dvcs::ToHex(entry.m_hash));
+            return false;
+        }
+        return true;
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retire du dépôt dont la racine est <rootPath> le fichier <filePath>, ainsi que
+// les répertoires qu'il laisse vides.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool RemoveWorkingTreeFile(const fs::path &rootPath, const fs::path &filePath)
+{
+    std::error_code errorCode;
+    fs::remove(filePath, errorCode);
+    RETURN_IF(errorCode, false);
+
+    for (auto dirPath = filePath.parent_path(); (dirPath != rootPath) && fs::is_empty(dirPath, errorCode) && !errorCode;
+         dirPath = dirPath.parent_path())
+    {
+        fs::remove(dirPath, errorCode);
+    }
+    return true;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] bool BuildCommitTree(StatementCache &statements, HashAlgorithm algorithm, const THash &commit,
+                                   const THash parentTree, THash &tree)
+{
+    TreeUpdate update;
+    {
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Path, ObjectHash FROM CommitsObjects WHERE CommitHash = @commit;", pStmt), false);
+        RETURN_IF(!BindValue(pStmt, 1, commit), false);
+
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+        {
+            // Les chemins stockés sont relatifs au répertoire .dvcs: seuls ceux
+            // menant à l'arbre de travail en font partie
+            auto path = GetColumnText(pStmt, 0);
+            if (!path.starts_with("../"))
+            {
+                continue;
+            }
+            path.remove_prefix(3);
+
+            auto *pUpdate = &update;
+            for (auto separatorPos = path.find('/'); separatorPos != std::string_view::npos; separatorPos = path.find('/'))
+            {
+                if (separatorPos != 0)
+                {
+                    auto &pDirectoryUpdate = pUpdate->m_directories[std::string{path.substr(0, separatorPos)}];
+                    if (!pDirectoryUpdate)
+                    {
+                        pDirectoryUpdate = std::make_unique<TreeUpdate>();
+                    }
+                    pUpdate = pDirectoryUpdate.get();
+                }
+                path.remove_prefix(separatorPos + 1);
+            }
+
+            // Un fichier retiré n'a pas d'objet
+            THash hash{};
+            bool isPresent{};
+            RETURN_IF(path.empty() || !GetColumnHash(pStmt, 1, hash, isPresent), false);
+            auto &file = pUpdate->m_files[std::string{path}];
+            if (isPresent)
+            {
+                file = hash;
+            }
+        }
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+    }
+
+    RETURN_IF(!WriteTree(statements, algorithm, parentTree, update, tree), false);
+    return statements.Execute("INSERT INTO CommitsTrees (CommitHash, TreeHash) VALUES (@commit, @tree);", {{"@commit", commit}, {"@tree", tree}});
+}
+
+[[nodiscard]] bool GetCommitTree(StatementCache &statements, const THash &commit, THash &tree)
+{
+    // Commits dont l'arbre reste à construire, du plus récent au plus ancien
+    std::vector<THash> pendingCommits;
+    tree = THash{0};
+    for (auto currentCommit = commit;;)
+    {
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT CommitsTrees.TreeHash, Commits.ParentHash FROM Commits "
+                                      "LEFT JOIN CommitsTrees ON CommitsTrees.CommitHash = Commits.Hash WHERE Commits.Hash = @commit;",
+                                      pStmt),
+                  false);
+        RETURN_IF(!BindValue(pStmt, 1, currentCommit), false);
+
+        const int stepResult = sqlite3_step(pStmt.get());
+        if (stepResult == SQLITE_DONE)
+        {
+            break;
+        }
+        RETURN_IF(stepResult != SQLITE_ROW, false);
+
+        bool hasTree{};
+        RETURN_IF(!GetColumnHash(pStmt, 0, tree, hasTree), false);
+        if (hasTree)
+        {
+            break;
+        }
+        pendingCommits.push_back(currentCommit);
+
+        bool hasParent{};
+        RETURN_IF(!GetColumnHash(pStmt, 1, currentCommit, hasParent), false);
+        if (!hasParent)
+        {
+            break;
+        }
+    }
+    RETURN_IF(pendingCommits.empty(), true);
+
+    auto &pDB = statements.GetDatabase();
+    HashAlgorithm algorithm{};
+    RETURN_IF(!GetHashAlgorithm(pDB, "main", algorithm), false);
+
+    const bool isInTransaction = sqlite3_get_autocommit(pDB.get()) == 0;
+    std::optional<TransactionGuard> transactionGuard;
+    if (!isInTransaction)
+    {
+        transactionGuard.emplace(pDB);
+        RETURN_IF(!ExecuteQuery(pDB, "BEGIN TRANSACTION;"), false);
+    }
+    for (auto commitIt = pendingCommits.crbegin(); commitIt != pendingCommits.crend(); ++commitIt)
+    {
+        RETURN_IF(!BuildCommitTree(statements, algorithm, *commitIt, tree, tree), false);
+    }
+    return isInTransaction || ExecuteQuery(pDB, "END TRANSACTION;");
+}
+
+[[nodiscard]] bool LoadCommitTree(StatementCache &statements, const THash &commit, std::vector<TreeEntry> &tree)
+{
+    THash rootTree{};
+    RETURN_IF(!GetCommitTree(statements, commit, rootTree), false);
+
+    TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare(TREE_FILES_QUERY, pStmt), false);
+    RETURN_IF(!BindValue(pStmt, 1, rootTree), false);
+
+    tree.clear();
+    int stepResult{};
+    while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+    {
+        auto &entry = tree.emplace_back();
+        bool isPresent{};
+        entry.m_path = GetColumnText(pStmt, 0);
+        RETURN_IF(!GetColumnHash(pStmt, 1, entry.m_hash, isPresent) || !isPresent, false);
+        entry.m_size = static_cast<std::uintmax_t>(sqlite3_column_int64(pStmt.get(), 2));
+    }
+    return stepResult == SQLITE_DONE;
+}
+
+[[nodiscard]] bool DiffTrees(StatementCache &statements, const THash &oldTree, const THash &newTree, const std::string &directoryPath,
+                             std::vector<TreeChange> &changes)
+{
+    RETURN_IF(oldTree == newTree, true);
+
+    TTreeItems oldItems;
+    TTreeItems newItems;
+    RETURN_IF(!LoadTreeItems(statements, oldTree, oldItems) || !LoadTreeItems(statements, newTree, newItems), false);
+
+    std::map<std::string_view, std::pair<const TreeItem *, const TreeItem *>> items;
+    for (const auto &[name, item] : oldItems)
+    {
+        items[name].first = &item;
+    }
+    for (const auto &[name, item] : newItems)
+    {
+        items[name].second = &item;
+    }
+
+    for (const auto &[name, itemPair] : items)
+    {
+        const auto [pOldItem, pNewItem] = itemPair;
+        if ((pOldItem != nullptr) && (pNewItem != nullptr) && (pOldItem->m_isTree == pNewItem->m_isTree) && (pOldItem->m_hash == pNewItem->m_hash))
+        {
+            continue;
+        }
+
+        const auto path = directoryPath + std::string{name};
+        const bool isOldTree = (pOldItem != nullptr) && pOldItem->m_isTree;
+        const bool isNewTree = (pNewItem != nullptr) && pNewItem->m_isTree;
+        if (isOldTree || isNewTree)
+        {
+            RETURN_IF(!DiffTrees(statements, isOldTree ? pOldItem->m_hash : THash{0}, isNewTree ? pNewItem->m_hash : THash{0}, path + '/',
+                                 changes),
+                      false);
+        }
+        if (((pOldItem != nullptr) && !isOldTree) || ((pNewItem != nullptr) && !isNewTree))
+        {
+            auto &change = changes.emplace_back();
+            change.m_path = path;
+            if ((pOldItem != nullptr) && !isOldTree)
+            {
+                change.m_oldItem = *pOldItem;
+            }
+            if ((pNewItem != nullptr) && !isNewTree)
+            {
+                change.m_newItem = *pNewItem;
+            }
+        }
+    }
+    return true;
+}
+
+std::string GetDisplayPath(std::string_view storedPath)
+{
+    RETURN_IF(storedPath.starts_with("../"), std::string{storedPath.substr(3)});
+    return (DVCS_PATH / fs::path{storedPath}).lexically_normal().generic_string();
+}
+
+[[nodiscard]] bool ResolveWorkingTreePath(const fs::path &rootPath, std::string_view storedPath, fs::path &filePath)
+{
+    const auto relativePath = (DVCS_PATH / fs::path{storedPath}).lexically_normal();
+    if (relativePath.empty() || relativePath.is_absolute() || !relativePath.has_filename() || (*relativePath.begin() == "..") ||
+        (*relativePath.begin() == ".") || (*relativePath.begin() == DVCS_PATH))
+    {
+        fmt::print(std::cerr, "Invalid file path '{}'\n", storedPath);
+        return false;
+    }
+    filePath = rootPath / relativePath;
+    return true;
+}
+
+[[nodiscard]] bool WriteWorkingTreeData(const fs::path &filePath, std::string_view data) noexcept
+{
+    return WriteWorkingTreeStream(filePath, [data](std::ostream &fileStream) {
+        return static_cast<bool>(fileStream.write(data.data(), static_cast<std::streamsize>(data.size())));
+    });
+}
+
+[[nodiscard]] bool ReadWorkingTreeData(const fs::path &rootPath, std::string_view storedPath, std::vector<char> &data)
+{
+    fs::path filePath;
+    RETURN_IF(!ResolveWorkingTreePath(rootPath, storedPath, filePath), false);
+    std::error_code error;
+    const auto fileSize = fs::file_size(filePath, error);
+    RETURN_IF(error, false);
+    std::ifstream fileStream{filePath, std::ios::in | std::ios::binary};
+    data.resize(fileSize);
+    return static_cast<bool>(fileStream.read(data.data(), static_cast<std::streamsize>(data.size())));
+}
+
+[[nodiscard]] bool UpdateWorkingTree(const fs::path &rootPath, const std::vector<TreeChange> &changes, CheckoutCounts &counts)
+{
+    std::vector<TreeEntry> entriesToWrite;
+    std::vector<fs::path> filePaths;
+    std::vector<fs::path> filePathsToRemove;
+    for (const auto &change : changes)
+    {
+        fs::path filePath;
+        RETURN_IF(!ResolveWorkingTreePath(rootPath, change.m_path, filePath), false);
+        if (!change.m_newItem)
+        {
+            filePathsToRemove.push_back(std::move(filePath));
+            continue;
+        }
+        entriesToWrite.push_back(TreeEntry{change.m_path, change.m_newItem->m_hash, change.m_newItem->m_size});
+        filePaths.push_back(std::move(filePath));
+        counts.m_writtenSize += change.m_newItem->m_size;
+    }
+
+    // Les fichiers retirés le sont en premier puisqu'un répertoire de l'arbre
+    // visé peut remplacer l'un d'eux
+    for (const auto &filePath : filePathsToRemove)
+    {
+        if (!RemoveWorkingTreeFile(rootPath, filePath))
+        {
+            fmt::print(std::cerr, "Can't remove '{}'\n", filePath.string());
+            return false;
+        }
+        ++counts.m_nbRemoved;
+    }
+
+    // NOTE: Une connexion SQLite ne doit servir qu'à un seul fil d'exécution à la
+    //       fois: chacun des fils ouvre donc la sienne et pige ses fichiers à
+    //       écrire à même une liste commune.
+    const auto repoDBPath = rootPath / REPO_DB_PATH;
+    std::vector<char> isWritten(entriesToWrite.size(), 0);
+    std::atomic<std::size_t> nextIndex{0};
+    ParallelFor(std::min(entriesToWrite.size(), GetWorkerCount()), [&](std::size_t /* iWorker */) {
+        TDatabasePtr pDB{nullptr, sqlite3_close};
+        if (!OpenDatabaseConnection(repoDBPath, pDB, SQLITE_OPEN_READONLY) || (sqlite3_busy_timeout(pDB.get(), BUSY_TIMEOUT_MS) != SQLITE_OK))
+        {
+            return;
+        }
+        ObjectReader reader{pDB, "main"};
+        for (std::size_t index = nextIndex++; index < entriesToWrite.size(); index = nextIndex++)
+        {
+            isWritten[index] = WriteWorkingTreeFile(reader, entriesToWrite[index], filePaths[index]) ? 1 : 0;
+        }
+    });
+    for (std::size_t index = 0; index < entriesToWrite.size(); ++index)
+    {
+        if (isWritten[index] == 0)
+        {
+            fmt::print(std::cerr, "Can't write '{}'\n", filePaths[index].string());
+            return false;
+        }
+    }
+    counts.m_nbWritten = entriesToWrite.size();
+    return true;
+}
+
+} // namespace dvcs
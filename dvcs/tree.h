@@ -0,0 +1,128 @@
+#pragma once
+
+#include "database.h"
+#include "hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Nombre de fichiers traités lors de la mise à jour d'un arbre de travail
+////////////////////////////////////////////////////////////////////////////////////
+struct CheckoutCounts
+{
+    std::size_t m_nbWritten{};
+    std::size_t m_nbRemoved{};
+    std::uintmax_t m_writtenSize{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichier de l'arbre de travail d'un commit
+////////////////////////////////////////////////////////////////////////////////////
+struct TreeEntry
+{
+    std::string m_path; // Chemin d'accès stocké avec l'objet (relatif au répertoire .dvcs)
+    THash m_hash{};     // Objet contenant les données du fichier
+    std::uintmax_t m_size{};
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Entrée d'un arbre: un fichier (objet) ou un sous-répertoire (arbre)
+////////////////////////////////////////////////////////////////////////////////////
+struct TreeItem
+{
+    THash m_hash{};
+    bool m_isTree{false};
+    std::uintmax_t m_size{}; // Taille des données d'un fichier
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Construit l'arbre <tree> du commit <commit> à partir de l'arbre <parentTree> de
+// son parent et des fichiers ajoutés, modifiés ou retirés par le commit.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool BuildCommitTree(StatementCache &statements, HashAlgorithm algorithm, const THash &commit,
+                                   const THash parentTree, THash &tree);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère l'arbre racine <tree> du commit <commit>. Les arbres des commits qui
+// n'en ont pas encore (ceux reçus d'un autre dépôt ou antérieurs à la version 10
+// du schéma) sont construits à partir de l'arbre du plus proche de leurs ancêtres
+// qui en a un. Un commit inconnu (celui d'un dépôt vide, par exemple) a un arbre
+// vide.
+// NOTE: Les arbres sont construits dans la transaction de l'appelant s'il y en a
+//       une, sinon dans la leur.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetCommitTree(StatementCache &statements, const THash &commit, THash &tree);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère les fichiers <tree> de l'arbre de travail du commit <commit>. Un commit
+// inconnu (celui d'un dépôt vide, par exemple) n'a aucun fichier.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool LoadCommitTree(StatementCache &statements, const THash &commit, std::vector<TreeEntry> &tree);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichier qui diffère d'un arbre à l'autre
+////////////////////////////////////////////////////////////////////////////////////
+struct TreeChange
+{
+    std::string m_path;                // Chemin d'accès représenté comme celui des objets
+    std::optional<TreeItem> m_oldItem; // Absent d'un fichier ajouté
+    std::optional<TreeItem> m_newItem; // Absent d'un fichier retiré
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve les fichiers <changes> qui diffèrent entre les arbres <oldTree> et
+// <newTree> du répertoire <directoryPath> ('/' final compris). Les sous-arbres
+// identiques ne sont pas parcourus: le coût de la comparaison dépend du nombre de
+// répertoires modifiés plutôt que de la taille des arbres.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool DiffTrees(StatementCache &statements, const THash &oldTree, const THash &newTree, const std::string &directoryPath,
+                             std::vector<TreeChange> &changes);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retourne le chemin d'accès, relatif à la racine du dépôt, du fichier stocké sous
+// le chemin <storedPath>
+////////////////////////////////////////////////////////////////////////////////////
+std::string GetDisplayPath(std::string_view storedPath);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve l'emplacement <filePath> dans le dépôt dont la racine est <rootPath> du
+// fichier stocké sous le chemin <storedPath>. Un chemin menant hors du dépôt ou
+// dans le répertoire interne de DVCSUS est refusé.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ResolveWorkingTreePath(const fs::path &rootPath, std::string_view storedPath, fs::path &filePath);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Écrit les données <data> à <filePath>. Elles sont d'abord écrites dans un
+// fichier temporaire voisin qui remplace ensuite le fichier d'un coup: un fichier
+// n'est donc jamais laissé à moitié écrit.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool WriteWorkingTreeData(const fs::path &filePath, std::string_view data) noexcept;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Lit les données <data> du fichier stocké sous le chemin <storedPath> dans
+// l'arbre de travail du dépôt dont la racine est <rootPath>
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ReadWorkingTreeData(const fs::path &rootPath, std::string_view storedPath, std::vector<char> &data);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Met à jour l'arbre de travail du dépôt dont la racine est <rootPath> selon les
+// fichiers <changes> qui diffèrent entre l'arbre du commit courant et l'arbre
+// visé (voir DiffTrees).
+// Les données des fichiers ajoutés ou modifiés sont décompressées et écrites par
+// un bassin de fils d'exécution ayant chacun sa propre connexion au dépôt. Les
+// fichiers absents de l'arbre visé sont retirés. Les autres ne sont pas touchés.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool UpdateWorkingTree(const fs::path &rootPath, const std::vector<TreeChange> &changes, CheckoutCounts &counts);
+
+} // namespace dvcs
@@ -0,0 +1,630 @@
+#include "worktree.h"
+#include "filemonitor.h"
+#include "paths.h"
+#include "threadpool.h"
+#include "tree.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#define RETURN_IF(cond, val)                                                                                                                         \
+    if (cond)                                                                                                                                        \
+    {                                                                                                                                                \
+        return val;                                                                                                                                  \
+    }
+
+namespace
+{
+
+struct DirectoryScan
+{
+    bool m_isValid{false};
+    std::vector<dvcs::WorkingFile> m_files;
+    std::vector<dvcs::WorkingDirectory> m_directories;
+};
+
+// Un fichier modifié peu avant que ses attributs ne soient consignés pourrait être
+// modifié à nouveau sans que sa date de modification ne change (les systèmes de
+// fichiers n'ont pas tous une résolution à la nanoseconde). Un tel fichier est
+// consigné dans le cache comme non vérifié (UNVERIFIED_FILE_SIZE) tant que cette
+// marge n'est pas écoulée: il est alors relu à chaque fois.
+constexpr const std::int64_t RACY_MODIFICATION_MARGIN_NS = 2'000'000'000;
+
+constexpr const std::int64_t UNVERIFIED_FILE_SIZE = -1;
+
+// Délai pendant lequel une commande attend que le moniteur de fichiers consigne son
+// fichier témoin avant de se rabattre sur un parcours complet de l'arbre de travail
+constexpr const auto FILE_MONITOR_TIMEOUT = std::chrono::milliseconds{1000};
+
+constexpr const auto FILE_MONITOR_POLL_INTERVAL = std::chrono::milliseconds{1};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Consigne dans <file> les attributs <fileStat> rapportés par stat
+////////////////////////////////////////////////////////////////////////////////////
+void SetFileAttributes(const struct stat &fileStat, dvcs::WorkingFile &file) noexcept
+{
+    file.m_size = static_cast<std::int64_t>(fileStat.st_size);
+    file.m_modifiedTime = static_cast<std::int64_t>(fileStat.st_mtim.tv_sec) * 1'000'000'000 + fileStat.st_mtim.tv_nsec;
+    file.m_inode = static_cast<std::int64_t>(fileStat.st_ino);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Liste les fichiers et les sous-répertoires du répertoire <directory>, sans
+// descendre dans ces derniers. Les attributs des fichiers sont obtenus à l'aide
+// de stat (les liens symboliques vers des fichiers sont suivis, comme dans Add).
+// Le répertoire interne de DVCSUS est ignoré.
+// NOTE: Les chemins d'accès des entrées sont construits à partir de celui du
+//       répertoire plutôt qu'à l'aide de fs::relative, trop coûteux pour
+//       l'ensemble des fichiers d'un arbre de travail.
+// Peut être appelée de façon concurrente.
+////////////////////////////////////////////////////////////////////////////////////
+DirectoryScan ScanDirectory(const dvcs::WorkingDirectory &directory) noexcept
+{
+    try
+    {
+        std::unique_ptr<DIR, int (*)(DIR *)> pDir{opendir(directory.m_fullPath.c_str()), closedir};
+        RETURN_IF(pDir == nullptr, {});
+        const int dirDescriptor = dirfd(pDir.get());
+
+        DirectoryScan scan;
+        while (const dirent *pEntry = readdir(pDir.get()))
+        {
+            const std::string_view name{pEntry->d_name};
+            if ((name == ".") || (name == ".."))
+            {
+                continue;
+            }
+
+            // NOTE: Un fichier peut disparaître entre sa lecture et son stat
+            struct stat fileStat
+            {
+            };
+            if (fstatat(dirDescriptor, pEntry->d_name, &fileStat, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                RETURN_IF(errno != ENOENT, {});
+                continue;
+            }
+            if (S_ISDIR(fileStat.st_mode))
+            {
+                if (name != dvcs::DVCS_PATH.native())
+                {
+                    scan.m_directories.push_back({directory.m_fullPath / name, fmt::format("{0}{1}/", directory.m_path, name)});
+                }
+                continue;
+            }
+            if (S_ISLNK(fileStat.st_mode) && (fstatat(dirDescriptor, pEntry->d_name, &fileStat, 0) != 0))
+            {
+                continue;
+            }
+            if (!S_ISREG(fileStat.st_mode))
+            {
+                continue;
+            }
+
+            auto &file = scan.m_files.emplace_back();
+            file.m_path.reserve(directory.m_path.size() + name.size());
+            file.m_path.append(directory.m_path).append(name);
+            SetFileAttributes(fileStat, file);
+        }
+        scan.m_isValid = true;
+        return scan;
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        return {};
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Type d'une entrée de l'arbre de travail (voir StatWorkingPath)
+////////////////////////////////////////////////////////////////////////////////////
+enum class WorkingPathType
+{
+    Missing, // Absente ou d'un type qui n'est pas suivi
+    File,
+    Directory
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Obtient le type <type> de l'entrée <fullPath> de l'arbre de travail et, s'il
+// s'agit d'un fichier, ses attributs <file> (comme ScanDirectory)
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool StatWorkingPath(const fs::path &fullPath, dvcs::WorkingFile &file, WorkingPathType &type) noexcept
+{
+    type = WorkingPathType::Missing;
+    struct stat fileStat
+    {
+    };
+    if (lstat(fullPath.c_str(), &fileStat) != 0)
+    {
+        return (errno == ENOENT) || (errno == ENOTDIR);
+    }
+    if (S_ISDIR(fileStat.st_mode))
+    {
+        type = WorkingPathType::Directory;
+        return true;
+    }
+    RETURN_IF(S_ISLNK(fileStat.st_mode) && (stat(fullPath.c_str(), &fileStat) != 0), true);
+    if (S_ISREG(fileStat.st_mode))
+    {
+        type = WorkingPathType::File;
+        SetFileAttributes(fileStat, file);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si le chemin <path> ou l'un de ses répertoires parents fait partie des
+// chemins <paths>
+////////////////////////////////////////////////////////////////////////////////////
+bool IsUnderPaths(const std::set<std::string, std::less<>> &paths, std::string_view path) noexcept
+{
+    while (true)
+    {
+        RETURN_IF(paths.contains(path), true);
+        const auto separatorPos = path.rfind('/');
+        RETURN_IF(separatorPos == std::string_view::npos, false);
+        path = path.substr(0, separatorPos);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// État du moniteur de fichiers du point de vue d'une commande (voir dvcsusmon)
+////////////////////////////////////////////////////////////////////////////////////
+struct FileMonitorState
+{
+    std::string m_session;          // Vide si aucun moniteur ne tient le journal à jour
+    bool m_isSynced{false};         // Faux tant qu'un parcours complet n'a pas eu lieu
+    std::int64_t m_lastChangeId{};  // Dernier chemin du journal couvert par la commande
+    std::vector<std::string> m_changedPaths;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Indique si un moniteur de fichiers s'exécute pour le dépôt dont la racine est
+// <rootPath>: le moniteur garde un verrou exclusif sur FILE_MONITOR_LOCK_PATH.
+////////////////////////////////////////////////////////////////////////////////////
+bool IsFileMonitorRunning(const fs::path &rootPath)
+{
+    const int descriptor = open((rootPath / dvcs::FILE_MONITOR_LOCK_PATH).c_str(), O_RDONLY | O_CLOEXEC);
+    RETURN_IF(descriptor < 0, false);
+    const bool isLocked = (flock(descriptor, LOCK_SH | LOCK_NB) != 0) && (errno == EWOULDBLOCK);
+    close(descriptor);
+    return isLocked;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Récupère l'état <state> du moniteur de fichiers du dépôt dont la racine est
+// <rootPath>, ainsi que les chemins qu'il a vus changer.
+// Pour ne rien manquer des modifications survenues avant la commande, celle-ci crée
+// un fichier témoin et attend que le moniteur le consigne: tous les chemins qui le
+// précèdent dans le journal sont alors connus. Un moniteur absent ou qui tarde à
+// répondre laisse <state> vide; l'arbre de travail doit alors être parcouru au
+// complet, tout comme lorsque la session n'est pas synchronisée.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool QueryFileMonitor(dvcs::StatementCache &statements, const fs::path &rootPath, FileMonitorState &state)
+{
+    state = {};
+    RETURN_IF(!IsFileMonitorRunning(rootPath), true);
+
+    std::int64_t lastChangeId{};
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT IFNULL(MAX(Id), 0) FROM Staging.ChangedPaths;", pStmt), false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_ROW, false);
+        lastChangeId = sqlite3_column_int64(pStmt.get(), 0);
+    }
+
+    const auto cookie =
+        fmt::format("{0}{1}-{2}", dvcs::FILE_MONITOR_COOKIE_PREFIX, getpid(), std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto cookiePath = rootPath / dvcs::DVCS_PATH / cookie;
+    const int descriptor = open(cookiePath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    RETURN_IF(descriptor < 0, true);
+    close(descriptor);
+
+    std::int64_t cookieId{};
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Id FROM Staging.ChangedPaths WHERE Id > @lastChangeId AND Path = @cookie;", pStmt), false);
+        const auto deadline = std::chrono::steady_clock::now() + FILE_MONITOR_TIMEOUT;
+        while ((cookieId == 0) && (std::chrono::steady_clock::now() < deadline))
+        {
+            RETURN_IF(sqlite3_bind_int64(pStmt.get(), 1, lastChangeId) != SQLITE_OK, false);
+            RETURN_IF(sqlite3_bind_text(pStmt.get(), 2, cookie.c_str(), static_cast<int>(cookie.size()), SQLITE_STATIC) != SQLITE_OK, false);
+            if (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+            {
+                cookieId = sqlite3_column_int64(pStmt.get(), 0);
+            }
+            else
+            {
+                std::this_thread::sleep_for(FILE_MONITOR_POLL_INTERVAL);
+            }
+            sqlite3_reset(pStmt.get());
+        }
+    }
+    unlink(cookiePath.c_str());
+    RETURN_IF(cookieId == 0, true);
+
+    // NOTE: Un débordement de la file d'événements du moniteur pourrait survenir
+    //       entre les deux lectures, d'où la transaction.
+    const dvcs::TransactionGuard transactionGuard{statements.GetDatabase()};
+    RETURN_IF(!statements.Execute("BEGIN TRANSACTION;", {}), false);
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Session, IsSynced FROM Staging.FileMonitor;", pStmt), false);
+        if (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+        {
+            state.m_session = dvcs::GetColumnText(pStmt, 0);
+            state.m_isSynced = sqlite3_column_int(pStmt.get(), 1) != 0;
+            state.m_lastChangeId = cookieId;
+        }
+    }
+    if (state.m_isSynced)
+    {
+        // Les fichiers témoins, créés dans le répertoire interne de DVCSUS, ne font
+        // pas partie de l'arbre de travail
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT DISTINCT Path FROM Staging.ChangedPaths WHERE Id <= @lastChangeId AND Path LIKE '../%' ORDER BY Path;",
+                                      pStmt),
+                  false);
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 1, cookieId) != SQLITE_OK, false);
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+        {
+            state.m_changedPaths.emplace_back(dvcs::GetColumnText(pStmt, 0));
+        }
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+    }
+    return statements.Execute("END TRANSACTION;", {});
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retire du journal du moniteur de fichiers les chemins couverts par <state>, une
+// fois le cache des attributs mis à jour. La session est dès lors synchronisée.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool AcknowledgeFileMonitor(dvcs::StatementCache &statements, const FileMonitorState &state) noexcept
+{
+    RETURN_IF(state.m_session.empty(), true);
+
+    const dvcs::TransactionGuard transactionGuard{statements.GetDatabase()};
+    RETURN_IF(!statements.Execute("BEGIN TRANSACTION;", {}), false);
+    {
+        dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("DELETE FROM Staging.ChangedPaths WHERE Id <= @lastChangeId;", pStmt), false);
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 1, state.m_lastChangeId) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+    }
+    // NOTE: Une session recommencée entre-temps (voir FileMonitor) reste à synchroniser
+    RETURN_IF(!statements.Execute("UPDATE Staging.FileMonitor SET IsSynced = 1 WHERE Session = @session;", {{"@session", state.m_session}}),
+              false);
+    return statements.Execute("END TRANSACTION;", {});
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve les fichiers <files> de l'arbre de travail du dépôt dont la racine est
+// <rootPath> à l'aide du cache des attributs, tenu à jour grâce au moniteur de
+// fichiers: seuls les chemins <changedPaths> qu'il a rapportés (et le contenu de
+// ceux qui sont des répertoires) ainsi que les fichiers non vérifiés du cache sont
+// examinés. Le nombre d'entrées examinées est donné par <nbScanned>.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool CollectMonitoredFiles(dvcs::StatementCache &statements, const fs::path &rootPath, const std::vector<std::string> &changedPaths,
+                                         std::vector<dvcs::WorkingFile> &files, std::size_t &nbScanned)
+{
+    // Un chemin se trouvant sous un répertoire modifié est couvert par celui-ci.
+    // NOTE: Les chemins triés voient leurs répertoires parents avant eux.
+    std::set<std::string, std::less<>> scannedPaths;
+    for (const auto &path : changedPaths)
+    {
+        if (!IsUnderPaths(scannedPaths, path))
+        {
+            scannedPaths.insert(path);
+        }
+    }
+
+    std::vector<dvcs::WorkingDirectory> directories;
+    for (const auto &path : scannedPaths)
+    {
+        const auto fullPath = rootPath / dvcs::GetDisplayPath(path);
+        dvcs::WorkingFile file{path};
+        WorkingPathType type{};
+        RETURN_IF(!StatWorkingPath(fullPath, file, type), false);
+        if (type == WorkingPathType::Directory)
+        {
+            directories.push_back({fullPath, path + '/'});
+        }
+        else if (type == WorkingPathType::File)
+        {
+            files.push_back(std::move(file));
+        }
+    }
+    const auto nbChangedFiles = files.size();
+    RETURN_IF(!dvcs::ScanWorkingTree(std::move(directories), files), false);
+    nbScanned = scannedPaths.size() + files.size() - nbChangedFiles;
+
+    // Les autres fichiers sont tels que consignés dans le cache
+    dvcs::TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("SELECT Path, Size, ModifiedTime, Inode FROM Staging.FileStats;", pStmt), false);
+    int stepResult{};
+    while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+    {
+        const auto path = dvcs::GetColumnText(pStmt, 0);
+        if (!scannedPaths.empty() && IsUnderPaths(scannedPaths, path))
+        {
+            continue;
+        }
+
+        dvcs::WorkingFile file{std::string{path}, sqlite3_column_int64(pStmt.get(), 1), sqlite3_column_int64(pStmt.get(), 2),
+                         sqlite3_column_int64(pStmt.get(), 3)};
+        if (file.m_size == UNVERIFIED_FILE_SIZE)
+        {
+            WorkingPathType type{};
+            RETURN_IF(!StatWorkingPath(rootPath / dvcs::GetDisplayPath(file.m_path), file, type), false);
+            ++nbScanned;
+            if (type != WorkingPathType::File)
+            {
+                continue;
+            }
+        }
+        files.push_back(std::move(file));
+    }
+    return stepResult == SQLITE_DONE;
+}
+
+} // namespace
+
+namespace dvcs
+{
+
+[[nodiscard]] bool ScanWorkingTree(std::vector<WorkingDirectory> directories, std::vector<WorkingFile> &files)
+{
+    while (!directories.empty())
+    {
+        std::vector<DirectoryScan> scans(directories.size());
+        ParallelFor(scans.size(), [&scans, &directories](std::size_t index) { scans[index] = ScanDirectory(directories[index]); });
+
+        directories.clear();
+        for (auto &scan : scans)
+        {
+            RETURN_IF(!scan.m_isValid, false);
+            std::move(scan.m_files.begin(), scan.m_files.end(), std::back_inserter(files));
+            std::move(scan.m_directories.begin(), scan.m_directories.end(), std::back_inserter(directories));
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool HashWorkingFiles(StatementCache &statements, const fs::path &rootPath, HashAlgorithm algorithm,
+                                    std::vector<WorkingFile> &files, std::size_t &nbHashed)
+{
+    std::sort(files.begin(), files.end(), [](const WorkingFile &lhs, const WorkingFile &rhs) { return lhs.m_path < rhs.m_path; });
+
+    std::vector<std::size_t> filesToHash;
+    std::vector<std::string> removedPaths;
+    {
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Path, Size, ModifiedTime, Inode, Hash FROM Staging.FileStats ORDER BY Path;", pStmt), false);
+        std::size_t iFile{};
+        int stepResult{};
+        while ((stepResult = sqlite3_step(pStmt.get())) == SQLITE_ROW)
+        {
+            const auto path = GetColumnText(pStmt, 0);
+            for (; (iFile < files.size()) && (files[iFile].m_path < path); ++iFile)
+            {
+                filesToHash.push_back(iFile);
+            }
+            if ((iFile == files.size()) || (files[iFile].m_path != path))
+            {
+                removedPaths.emplace_back(path);
+                continue;
+            }
+
+            // Seuls les fichiers dont les attributs ont changé sont relus
+            auto &file = files[iFile++];
+            bool isPresent{};
+            if ((sqlite3_column_int64(pStmt.get(), 1) == file.m_size) && (sqlite3_column_int64(pStmt.get(), 2) == file.m_modifiedTime) &&
+                (sqlite3_column_int64(pStmt.get(), 3) == file.m_inode) && GetColumnHash(pStmt, 4, file.m_hash, isPresent))
+            {
+                file.m_isHashed = true;
+            }
+            else
+            {
+                filesToHash.push_back(iFile - 1);
+            }
+        }
+        RETURN_IF(stepResult != SQLITE_DONE, false);
+        for (; iFile < files.size(); ++iFile)
+        {
+            filesToHash.push_back(iFile);
+        }
+    }
+
+    ParallelFor(filesToHash.size(), [&files, &filesToHash, &rootPath, algorithm](std::size_t index) {
+        auto &file = files[filesToHash[index]];
+        std::ifstream fileStream{rootPath / GetDisplayPath(file.m_path), std::ios::in | std::ios::binary};
+        file.m_isHashed = dvcs::ComputeStreamHash(fileStream, algorithm, file.m_hash);
+    });
+    nbHashed = filesToHash.size();
+
+    // Un status sur un arbre de travail inchangé n'écrit rien
+    RETURN_IF(filesToHash.empty() && removedPaths.empty(), true);
+
+    const TransactionGuard transactionGuard{statements.GetDatabase()};
+    RETURN_IF(!statements.Execute("BEGIN TRANSACTION;", {}), false);
+    for (const auto &path : removedPaths)
+    {
+        RETURN_IF(!statements.Execute("DELETE FROM Staging.FileStats WHERE Path = @path;", {{"@path", path}}), false);
+    }
+
+    const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    TStatementPtr pStmt{nullptr, sqlite3_reset};
+    RETURN_IF(!statements.Prepare("INSERT OR REPLACE INTO Staging.FileStats (Path, Size, ModifiedTime, Inode, Hash) "
+                                  "VALUES (@path, @size, @modifiedTime, @inode, @hash);",
+                                  pStmt),
+              false);
+    for (const auto iFile : filesToHash)
+    {
+        const auto &file = files[iFile];
+        if (!file.m_isHashed)
+        {
+            fmt::print(std::cerr, "Can't read '{}'\n", GetDisplayPath(file.m_path));
+            return false;
+        }
+        const bool isRacy = file.m_modifiedTime + RACY_MODIFICATION_MARGIN_NS > now;
+        RETURN_IF(sqlite3_bind_text(pStmt.get(), 1, file.m_path.c_str(), static_cast<int>(file.m_path.size()), SQLITE_STATIC) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 2, isRacy ? UNVERIFIED_FILE_SIZE : file.m_size) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 3, file.m_modifiedTime) != SQLITE_OK, false);
+        RETURN_IF(sqlite3_bind_int64(pStmt.get(), 4, file.m_inode) != SQLITE_OK, false);
+        RETURN_IF(!BindValue(pStmt, 5, file.m_hash), false);
+        RETURN_IF(sqlite3_step(pStmt.get()) != SQLITE_DONE, false);
+        sqlite3_reset(pStmt.get());
+    }
+    pStmt.reset();
+    return statements.Execute("END TRANSACTION;", {});
+}
+
+[[nodiscard]] bool GetWorkingTreeChanges(TDatabasePtr &pDB, StatementCache &statements, const fs::path &rootPath,
+                                         std::vector<TFileChange> &changes, WorkingTreeScan &scan)
+{
+    HashAlgorithm algorithm{};
+    RETURN_IF(!GetHashAlgorithm(pDB, "main", algorithm), false);
+
+    THash currentCommit{};
+    RETURN_IF(!QueryHash(statements, "SELECT Value FROM Staging.Metadata WHERE Name = \"CurrentCommit\";", currentCommit), false);
+    std::vector<TreeEntry> tree;
+    RETURN_IF(!LoadCommitTree(statements, currentCommit, tree), false);
+
+    // Contenu de chacun des fichiers suivis: celui du commit courant, remplacé
+    // par celui de la zone de staging le cas échéant. Un fichier dont le retrait
+    // est consigné n'a plus de contenu.
+    std::unordered_map<std::string, std::pair<const THash *, char>> trackedFiles;
+    for (const auto &entry : tree)
+    {
+        trackedFiles.emplace(entry.m_path, std::make_pair(&entry.m_hash, ' '));
+    }
+
+    std::vector<std::tuple<std::string, THash, bool>> stagedObjects;
+    {
+        TStatementPtr pStmt{nullptr, sqlite3_reset};
+        RETURN_IF(!statements.Prepare("SELECT Path, Hash FROM Staging.Paths;", pStmt), false);
+        while (sqlite3_step(pStmt.get()) == SQLITE_ROW)
+        {
+            auto &[path, hash, isPresent] = stagedObjects.emplace_back(GetColumnText(pStmt, 0), THash{}, false);
+            RETURN_IF(!GetColumnHash(pStmt, 1, hash, isPresent), false);
+        }
+    }
+    for (const auto &[path, hash, isPresent] : stagedObjects)
+    {
+        auto trackedIt = trackedFiles.find(path);
+        if (!isPresent)
+        {
+            if (trackedIt != trackedFiles.end())
+            {
+                trackedIt->second = std::make_pair(nullptr, 'D');
+            }
+        }
+        else if (trackedIt == trackedFiles.end())
+        {
+            trackedFiles.emplace(path, std::make_pair(&hash, 'A'));
+        }
+        else if (*trackedIt->second.first != hash)
+        {
+            trackedIt->second = std::make_pair(&hash, (trackedIt->second.second == 'A') ? 'A' : 'M');
+        }
+    }
+
+    FileMonitorState monitorState;
+    RETURN_IF(!QueryFileMonitor(statements, rootPath, monitorState), false);
+    std::vector<WorkingFile> files;
+    scan.m_isMonitored = monitorState.m_isSynced;
+    if (scan.m_isMonitored)
+    {
+        RETURN_IF(!CollectMonitoredFiles(statements, rootPath, monitorState.m_changedPaths, files, scan.m_nbScanned), false);
+    }
+    else
+    {
+        // Les chemins d'accès des objets sont relatifs au répertoire interne de DVCSUS
+        RETURN_IF(!ScanWorkingTree({{rootPath, "../"}}, files), false);
+        scan.m_nbScanned = files.size();
+    }
+    RETURN_IF(!HashWorkingFiles(statements, rootPath, algorithm, files, scan.m_nbHashed), false);
+    RETURN_IF(!AcknowledgeFileMonitor(statements, monitorState), false);
+    scan.m_nbFiles = files.size();
+
+    // Chacun des fichiers est accompagné de son état sur deux colonnes
+    for (const auto &file : files)
+    {
+        const auto trackedIt = trackedFiles.find(file.m_path);
+        if (trackedIt == trackedFiles.end())
+        {
+            changes.emplace_back(GetDisplayPath(file.m_path), "??");
+            continue;
+        }
+        const auto [pHash, stagedState] = trackedIt->second;
+        trackedFiles.erase(trackedIt);
+        if (pHash == nullptr)
+        {
+            // Le fichier retiré de la zone de staging n'est plus suivi
+            changes.emplace_back(GetDisplayPath(file.m_path), "D ");
+            changes.emplace_back(GetDisplayPath(file.m_path), "??");
+            continue;
+        }
+        const bool isModified = *pHash != file.m_hash;
+        if ((stagedState != ' ') || isModified)
+        {
+            changes.emplace_back(GetDisplayPath(file.m_path), std::string{stagedState, isModified ? 'M' : ' '});
+        }
+    }
+    // Les fichiers suivis restants ne se trouvent plus dans l'arbre de travail
+    for (const auto &[path, trackedFile] : trackedFiles)
+    {
+        changes.emplace_back(GetDisplayPath(path), std::string{trackedFile.second, (trackedFile.first == nullptr) ? ' ' : 'D'});
+    }
+    std::sort(changes.begin(), changes.end());
+    return true;
+}
+
+[[nodiscard]] bool ValidateNoLocalChanges(TDatabasePtr &pDB, StatementCache &statements, const fs::path &rootPath,
+                                          const std::vector<std::string_view> &paths, std::string_view command)
+{
+    std::vector<TFileChange> changes;
+    WorkingTreeScan scan;
+    RETURN_IF(!GetWorkingTreeChanges(pDB, statements, rootPath, changes, scan), false);
+
+    std::unordered_set<std::string_view> changedPaths;
+    for (const auto &[path, state] : changes)
+    {
+        changedPaths.insert(path);
+    }
+    for (const auto path : paths)
+    {
+        const auto displayPath = GetDisplayPath(path);
+        if (changedPaths.contains(displayPath))
+        {
+            fmt::print(std::cerr, "Can't {0}. Local changes to '{1}' would be overwritten.\n", command, displayPath);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace dvcs
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "database.h"
+#include "hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dvcs
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Fichier trouvé dans l'arbre de travail. Ses attributs sont ceux rapportés par
+// stat; son hash est celui consigné dans le cache lorsque ceux-ci n'ont pas
+// changé, sinon il doit être recalculé.
+////////////////////////////////////////////////////////////////////////////////////
+struct WorkingFile
+{
+    std::string m_path;               // Chemin d'accès représenté comme celui des objets
+    std::int64_t m_size{};
+    std::int64_t m_modifiedTime{};    // En nanosecondes
+    std::int64_t m_inode{};
+    THash m_hash{};
+    bool m_isHashed{false};           // Faux tant que <m_hash> n'est pas connu
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Répertoire de l'arbre de travail et son contenu
+////////////////////////////////////////////////////////////////////////////////////
+struct WorkingDirectory
+{
+    fs::path m_fullPath;
+    std::string m_path; // Chemin d'accès représenté comme celui des objets, '/' final compris
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Trouve tous les fichiers <files> se trouvant sous les répertoires <directories>
+// de l'arbre de travail.
+// Les répertoires sont parcourus un niveau à la fois: tous ceux d'un même niveau
+// sont listés en parallèle et leurs sous-répertoires forment le niveau suivant.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ScanWorkingTree(std::vector<WorkingDirectory> directories, std::vector<WorkingFile> &files);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retrouve dans le cache des attributs le hash des fichiers <files> dont les
+// attributs n'ont pas changé et calcule en parallèle celui des autres, qui se
+// trouvent dans le dépôt dont la racine est <rootPath>. Le cache est ensuite mis à
+// jour: les fichiers hachés y sont consignés (comme non vérifiés s'ils sont trop
+// récents, voir RACY_MODIFICATION_MARGIN_NS) et les fichiers disparus en sont
+// retirés. Le nombre de fichiers hachés est donné par <nbHashed>.
+// Les fichiers sont triés selon leur chemin d'accès, ce qui permet de les apparier
+// aux entrées du cache en un seul parcours de celui-ci.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool HashWorkingFiles(StatementCache &statements, const fs::path &rootPath, HashAlgorithm algorithm,
+                                    std::vector<WorkingFile> &files, std::size_t &nbHashed);
+
+// État d'un fichier de l'arbre de travail: son chemin d'accès relatif à la racine
+// du dépôt et son état sur deux colonnes (voir Status)
+using TFileChange = std::pair<std::string, std::string>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Statistiques de l'examen de l'arbre de travail (voir GetWorkingTreeChanges)
+////////////////////////////////////////////////////////////////////////////////////
+struct WorkingTreeScan
+{
+    std::size_t m_nbFiles{};
+    std::size_t m_nbScanned{}; // Entrées examinées à l'aide de stat
+    std::size_t m_nbHashed{};
+    bool m_isMonitored{false}; // Le moniteur de fichiers a évité un parcours complet
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compare l'arbre de travail du dépôt dont la racine est <rootPath> à la zone de
+// staging et au commit courant. Les fichiers ayant changé sont donnés par
+// <changes>, triés selon leur chemin d'accès (voir Status).
+// Lorsqu'un moniteur de fichiers synchronisé s'exécute, seuls les chemins qu'il a
+// rapportés sont examinés; sinon, l'arbre de travail est parcouru au complet.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool GetWorkingTreeChanges(TDatabasePtr &pDB, StatementCache &statements, const fs::path &rootPath,
+                                         std::vector<TFileChange> &changes, WorkingTreeScan &scan);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Vérifie qu'aucun des fichiers <paths> (représentés comme ceux des objets) n'a de
+// modifications locales dans l'arbre de travail du dépôt dont la racine est
+// <rootPath>, un fichier non suivi comptant comme tel: la commande <command>
+// (une fusion ou un changement de branche) ne doit pas les écraser.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ValidateNoLocalChanges(TDatabasePtr &pDB, StatementCache &statements, const fs::path &rootPath,
+                                          const std::vector<std::string_view> &paths, std::string_view command);
+
+} // namespace dvcs
@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <iostream>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -19,30 +21,58 @@ struct CommandInfo
 {
     const std::string_view m_command;
     const std::vector<std::string> m_args;
+    const bool m_isVariadic{false}; // Le dernier argument peut être répété
 };
 
 // Commandes supportées
 const std::string HELP_COMMAND{"help"};
 const std::string INIT_COMMAND{"init"};
+const std::string MIGRATE_COMMAND{"migrate"};
 const std::string ADD_COMMAND{"add"};
 const std::string COMMIT_COMMAND{"commit"};
+const std::string STATUS_COMMAND{"status"};
 const std::string SET_REMOTE_COMMAND{"set_remote"};
+const std::string SET_COMPRESSION_COMMAND{"set_compression"};
+const std::string TRAIN_DICTIONARY_COMMAND{"train_dictionary"};
+const std::string SET_CHUNKING_COMMAND{"set_chunking"};
+const std::string SET_STORAGE_PROFILE_COMMAND{"set_storage_profile"};
 const std::string PUSH_COMMAND{"push"};
 const std::string PULL_COMMAND{"pull"};
+const std::string BUNDLE_CREATE_COMMAND{"bundle_create"};
+const std::string BUNDLE_UNBUNDLE_COMMAND{"bundle_unbundle"};
 const std::string BRANCH_CREATE_COMMAND{"branch_create"};
 const std::string BRANCH_CHECKOUT_COMMAND{"branch_checkout"};
+const std::string MERGE_BASE_COMMAND{"merge_base"};
+const std::string MERGE_COMMAND{"merge"};
+const std::string LOG_COMMAND{"log"};
+const std::string DIFF_COMMAND{"diff"};
 
 // Informations sur les commandes supportées
 std::vector<CommandInfo> cmdInfos{
     {HELP_COMMAND, std::vector<std::string>{}},
-    {INIT_COMMAND, std::vector<std::string>{}},
-    {ADD_COMMAND, std::vector<std::string>{"<filepath>"}},
-    {COMMIT_COMMAND, std::vector<std::string>{"<author>", "<email>", "<msg>"}},
-    {SET_REMOTE_COMMAND, std::vector<std::string>{"<filepath>"}},
+    {INIT_COMMAND, std::vector<std::string>{"[<object-format>]", "[<storage-profile>]"}},
+    {MIGRATE_COMMAND, std::vector<std::string>{}},
+    {ADD_COMMAND, std::vector<std::string>{"<--all|<pathspec>...>"}, true},
+    {COMMIT_COMMAND, std::vector<std::string>{"[-a]", "<author>", "<email>", "<msg>"}},
+    {STATUS_COMMAND, std::vector<std::string>{}},
+    {SET_REMOTE_COMMAND, std::vector<std::string>{"<filepath|url>"}},
+    {SET_COMPRESSION_COMMAND, std::vector<std::string>{"<codec>[:<level>]"}},
+    {TRAIN_DICTIONARY_COMMAND, std::vector<std::string>{"[<max-samples>]"}},
+    {SET_CHUNKING_COMMAND, std::vector<std::string>{"<on|off>"}},
+    {SET_STORAGE_PROFILE_COMMAND, std::vector<std::string>{"<durable|ci|bulk>"}},
     {PUSH_COMMAND, std::vector<std::string>{}},
     {PULL_COMMAND, std::vector<std::string>{}},
+    {BUNDLE_CREATE_COMMAND, std::vector<std::string>{"<file>", "[[<base>..]<branchname>]"}},
+    {BUNDLE_UNBUNDLE_COMMAND, std::vector<std::string>{"<file>"}},
     {BRANCH_CREATE_COMMAND, std::vector<std::string>{"<branchname>"}},
     {BRANCH_CHECKOUT_COMMAND, std::vector<std::string>{"<branchname>"}},
+    {MERGE_BASE_COMMAND, std::vector<std::string>{"[--is-ancestor]", "<revision>", "<revision>"}},
+    {MERGE_COMMAND, std::vector<std::string>{"[--algorithm=<myers|histogram>]", "[--no-renames|--find-renames=<n>]", "<author>", "<email>",
+                                              "<revision>"}},
+    {LOG_COMMAND, std::vector<std::string>{"[--max-count=<n>]", "[--skip=<n>]", "[--format=<medium|json>]", "[--path=<path> [--follow]]",
+                                            "[[<base>..]<revision>]"}},
+    {DIFF_COMMAND, std::vector<std::string>{"[--algorithm=<myers|histogram>]", "[--unified=<n>]", "[--find-renames[=<n>]]", "[--find-copies[=<n>]]",
+                                             "[--find-copies-harder]", "[--rename-limit=<n>]", "[<revision>]", "[<revision>]"}},
 };
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -53,14 +83,96 @@ void ShowHelp()
     fmt::print(std::cout, "usage: dvcsus <command> [<args>]\n\n"
                           "These are common dvcsus commands used in various situations:\n\n"
                           "help             Shows help menu\n"
-                          "init             Creates an empty repository or reinitialize an existing one\n"
-                          "add              Adds file contents to the staging area\n"
-                          "commit           Record changes to the repository\n"
-                          "set_remote       Sets the remote repository to pull/push changes from\n"
+                          "init             Creates an empty repository (identified by sha1 or sha256 hashes)\n"
+                          "                 with a durable, ci or bulk storage profile\n"
+                          "migrate          Upgrades the repository to the current storage format\n"
+                          "add              Adds file contents (or, with --all, every changed file) to the staging area\n"
+                          "commit           Record changes to the repository (with -a, stages modified files first)\n"
+                          "status           Shows the staged, modified, deleted and untracked files\n"
+                          "set_remote       Sets the remote repository (a file or a dvcs:// URL) to pull/push changes from\n"
+                          "set_compression  Sets the codec (zlib, zstd, lz4 or store) and level used for new objects\n"
+                          "train_dictionary Trains a zstd dictionary on small objects and recompresses them with it\n"
+                          "set_chunking     Enables or disables content-defined chunking of large files\n"
+                          "set_storage_profile Sets the storage profile (durable, ci or bulk) used when opening the repository\n"
                           "push             Pushes local changes to the remote repository\n"
                           "pull             Pulls local changes to the remote repository\n"
+                          "bundle_create    Writes commits, branches and objects to a bundle file ('-' for stdout)\n"
+                          "bundle_unbundle  Imports a bundle file ('-' for stdin) into the repository\n"
                           "branch_create    Creates a new branch\n"
-                          "branch_checkout  Checks out a given branch\n");
+                          "branch_checkout  Checks out a given branch and updates the files that differ\n"
+                          "merge_base       Shows the best common ancestor of two commits (with --is-ancestor, succeeds\n"
+                          "                 only if the first one is an ancestor of the second)\n"
+                          "merge            Merges a revision into the current branch and commits the result (or leaves\n"
+                          "                 the conflicts to resolve, add and commit)\n"
+                          "log              Shows the commits reachable from a revision (default: the current commit)\n"
+                          "                 but not from <base>, one page at a time with --skip and --max-count\n"
+                          "                 (with --path, only those that modified a file or directory, and with\n"
+                          "                 --follow, those that modified the file it was copied from)\n"
+                          "diff             Shows the changes between two revisions, or between a revision (default:\n"
+                          "                 the current commit) and the working tree (with --find-renames or\n"
+                          "                 --find-copies, added files similar to at least <n>% of another are shown\n"
+                          "                 as renamed or copied)\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Interprète l'option <arg> de détection des renommages et des copies, si c'en est
+// une: --find-renames[=<n>], --find-copies[=<n>], --find-copies-harder,
+// --rename-limit=<n> ou --no-renames. <isValid> est faux si sa valeur est
+// invalide.
+////////////////////////////////////////////////////////////////////////////////////
+[[nodiscard]] bool ParseRenameOption(std::string_view arg, dvcs::RenameOptions &options, bool &isValid)
+{
+    isValid = true;
+    std::size_t *pValue = nullptr;
+    if (arg == "--no-renames")
+    {
+        options.m_detectRenames = false;
+        options.m_detectCopies = false;
+        return true;
+    }
+    if (arg == "--find-copies-harder")
+    {
+        options.m_detectCopies = true;
+        options.m_findCopiesHarder = true;
+        return true;
+    }
+    if (arg.starts_with("--find-renames") || arg.starts_with("--find-copies"))
+    {
+        (arg.starts_with("--find-renames") ? options.m_detectRenames : options.m_detectCopies) = true;
+        arg.remove_prefix(arg.starts_with("--find-renames") ? std::string_view{"--find-renames"}.size() : std::string_view{"--find-copies"}.size());
+        if (arg.empty())
+        {
+            return true;
+        }
+        if (!arg.starts_with('='))
+        {
+            return false;
+        }
+        arg.remove_prefix(1);
+        if (arg.ends_with('%'))
+        {
+            arg.remove_suffix(1);
+        }
+        pValue = &options.m_threshold;
+    }
+    else if (arg.starts_with("--rename-limit="))
+    {
+        arg.remove_prefix(std::string_view{"--rename-limit="}.size());
+        pValue = &options.m_renameLimit;
+    }
+    else
+    {
+        return false;
+    }
+
+    const auto [pEnd, errorCode] = std::from_chars(arg.data(), arg.data() + arg.size(), *pValue);
+    isValid = !arg.empty() && (errorCode == std::errc{}) && (pEnd == arg.data() + arg.size()) &&
+              ((pValue != &options.m_threshold) || (*pValue <= 100U));
+    if (!isValid)
+    {
+        fmt::print(std::cout, "dvcsus: invalid value '{}'.\n", arg);
+    }
+    return true;
 }
 
 } // namespace
@@ -89,7 +201,8 @@ int main(int argc, char **argv)
 
     // Validation du nombre d'arguments reçus pour la commande.
     // NOTE: Les 2 premières valeurs dans argv sont le nom du programme et la commande à exécuter.
-    if (argc > commandIt->m_args.size() + 2)
+    const auto nbArgs = static_cast<std::size_t>(argc - 2);
+    if (commandIt->m_isVariadic ? (nbArgs < commandIt->m_args.size()) : (nbArgs > commandIt->m_args.size()))
     {
         fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
         return 1;
@@ -101,20 +214,100 @@ int main(int argc, char **argv)
     }
     else if (command == INIT_COMMAND)
     {
-        return dvcs::Init() ? 0 : 1;
+        // Le format des objets et le profil de stockage peuvent être donnés dans
+        // n'importe quel ordre puisque leurs noms ne se recoupent pas.
+        dvcs::HashAlgorithm algorithm{dvcs::HashAlgorithm::SHA1};
+        dvcs::StorageProfile profile{dvcs::StorageProfile::Durable};
+        for (std::size_t iArg = 0; iArg < nbArgs; ++iArg)
+        {
+            const std::string_view arg{argv[iArg + 2]};
+            if (!dvcs::ParseHashAlgorithm(arg, algorithm) && !dvcs::ParseStorageProfile(arg, profile))
+            {
+                fmt::print(std::cout,
+                           "dvcsus: unknown object format or storage profile '{}'. Supported formats are sha1 and sha256, supported profiles "
+                           "are durable, ci and bulk.\n",
+                           arg);
+                return 1;
+            }
+        }
+        return dvcs::Init(algorithm, profile) ? 0 : 1;
+    }
+    else if (command == MIGRATE_COMMAND)
+    {
+        return dvcs::Migrate() ? 0 : 1;
     }
     else if (command == ADD_COMMAND)
     {
-        return dvcs::Add(argv[2]) ? 0 : 1;
+        if ((nbArgs == 1) && (std::string_view{argv[2]} == "--all"))
+        {
+            return dvcs::AddChanges() ? 0 : 1;
+        }
+        const std::vector<fs::path> pathSpecs(argv + 2, argv + argc);
+        return dvcs::Add(pathSpecs) ? 0 : 1;
     }
     else if (command == COMMIT_COMMAND)
     {
-        return dvcs::Commit(argv[2], argv[3], argv[4]) ? 0 : 1;
+        // Avec -a, les fichiers suivis qui ont été modifiés sont d'abord ajoutés
+        const bool addChanges = (nbArgs == 4) && (std::string_view{argv[2]} == "-a");
+        if (nbArgs != (addChanges ? 4U : 3U))
+        {
+            fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+            return 1;
+        }
+        char **pArgs = argv + (addChanges ? 3 : 2);
+        if (addChanges && !dvcs::AddChanges(false))
+        {
+            return 1;
+        }
+        return dvcs::Commit(pArgs[0], pArgs[1], pArgs[2]) ? 0 : 1;
+    }
+    else if (command == STATUS_COMMAND)
+    {
+        return dvcs::Status() ? 0 : 1;
     }
     else if (command == SET_REMOTE_COMMAND)
     {
         return dvcs::SetRemote(argv[2]) ? 0 : 1;
     }
+    else if (command == SET_COMPRESSION_COMMAND)
+    {
+        return dvcs::SetCompression(argv[2]) ? 0 : 1;
+    }
+    else if (command == TRAIN_DICTIONARY_COMMAND)
+    {
+        std::size_t maxSamples{1000};
+        if (nbArgs == 1)
+        {
+            const std::string_view arg{argv[2]};
+            const auto [pEnd, errorCode] = std::from_chars(arg.data(), arg.data() + arg.size(), maxSamples);
+            if ((errorCode != std::errc{}) || (pEnd != arg.data() + arg.size()) || (maxSamples == 0))
+            {
+                fmt::print(std::cout, "dvcsus: invalid number of samples '{}'.\n", arg);
+                return 1;
+            }
+        }
+        return dvcs::TrainCompressionDictionary(maxSamples) ? 0 : 1;
+    }
+    else if (command == SET_CHUNKING_COMMAND)
+    {
+        const std::string_view arg{(nbArgs == 1) ? argv[2] : ""};
+        if ((arg != "on") && (arg != "off"))
+        {
+            fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+            return 1;
+        }
+        return dvcs::SetChunking(arg == "on") ? 0 : 1;
+    }
+    else if (command == SET_STORAGE_PROFILE_COMMAND)
+    {
+        dvcs::StorageProfile profile{};
+        if ((nbArgs != 1) || !dvcs::ParseStorageProfile(argv[2], profile))
+        {
+            fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+            return 1;
+        }
+        return dvcs::SetStorageProfile(profile) ? 0 : 1;
+    }
     else if (command == PUSH_COMMAND)
     {
         return dvcs::Push() ? 0 : 1;
@@ -123,6 +316,19 @@ int main(int argc, char **argv)
     {
         return dvcs::Pull() ? 0 : 1;
     }
+    else if (command == BUNDLE_CREATE_COMMAND || command == BUNDLE_UNBUNDLE_COMMAND)
+    {
+        if (nbArgs == 0)
+        {
+            fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+            return 1;
+        }
+        if (command == BUNDLE_UNBUNDLE_COMMAND)
+        {
+            return dvcs::Unbundle(argv[2]) ? 0 : 1;
+        }
+        return dvcs::CreateBundle(argv[2], (nbArgs == 2) ? argv[3] : "") ? 0 : 1;
+    }
     else if (command == BRANCH_CREATE_COMMAND)
     {
         return dvcs::CreateBranch(argv[2]) ? 0 : 1;
@@ -131,6 +337,171 @@ int main(int argc, char **argv)
     {
         return dvcs::CheckoutBranch(argv[2]) ? 0 : 1;
     }
+    else if (command == MERGE_BASE_COMMAND)
+    {
+        const bool isAncestorQuery = (nbArgs == 3) && (std::string_view{argv[2]} == "--is-ancestor");
+        if (nbArgs != (isAncestorQuery ? 3U : 2U))
+        {
+            fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+            return 1;
+        }
+        char **pArgs = argv + (isAncestorQuery ? 3 : 2);
+        if (isAncestorQuery)
+        {
+            bool isAncestor{};
+            return (dvcs::IsAncestor(pArgs[0], pArgs[1], isAncestor) && isAncestor) ? 0 : 1;
+        }
+
+        std::optional<dvcs::THash> mergeBase;
+        if (!dvcs::FindMergeBase(pArgs[0], pArgs[1], mergeBase) || !mergeBase)
+        {
+            return 1;
+        }
+        fmt::print(std::cout, "{}\n", dvcs::ToHex(*mergeBase));
+    }
+    else if (command == MERGE_COMMAND)
+    {
+        dvcs::MergeOptions options;
+        std::vector<std::string_view> positionalArgs;
+        for (std::size_t iArg = 0; iArg < nbArgs; ++iArg)
+        {
+            const std::string_view arg{argv[iArg + 2]};
+            if (arg.starts_with("--algorithm="))
+            {
+                if (!dvcs::ParseDiffAlgorithm(arg.substr(std::string_view{"--algorithm="}.size()), options.m_algorithm))
+                {
+                    fmt::print(std::cout, "dvcsus: unknown diff algorithm '{}'.\n", arg.substr(std::string_view{"--algorithm="}.size()));
+                    return 1;
+                }
+            }
+            else if ((arg == "--no-renames") || arg.starts_with("--find-renames=") || arg.starts_with("--rename-limit="))
+            {
+                bool isValid{};
+                if (!ParseRenameOption(arg, options.m_renames, isValid) || !isValid)
+                {
+                    return 1;
+                }
+            }
+            else if (!arg.starts_with("--"))
+            {
+                positionalArgs.push_back(arg);
+            }
+            else
+            {
+                positionalArgs.clear();
+                break;
+            }
+        }
+        if (positionalArgs.size() != 3)
+        {
+            fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+            return 1;
+        }
+        options.m_author = positionalArgs[0];
+        options.m_email = positionalArgs[1];
+        options.m_revision = positionalArgs[2];
+        return dvcs::Merge(options) ? 0 : 1;
+    }
+    else if (command == LOG_COMMAND)
+    {
+        // Les options sont de la forme --<nom>=<valeur>
+        dvcs::LogOptions options;
+        for (std::size_t iArg = 0; iArg < nbArgs; ++iArg)
+        {
+            std::string_view arg{argv[iArg + 2]};
+            std::size_t *pCount = nullptr;
+            if (arg.starts_with("--max-count="))
+            {
+                pCount = &options.m_maxCount;
+                arg.remove_prefix(std::string_view{"--max-count="}.size());
+            }
+            else if (arg.starts_with("--skip="))
+            {
+                pCount = &options.m_skip;
+                arg.remove_prefix(std::string_view{"--skip="}.size());
+            }
+            else if ((arg == "--format=medium") || (arg == "--format=json"))
+            {
+                options.m_format = (arg == "--format=json") ? dvcs::LogFormat::JsonLines : dvcs::LogFormat::Medium;
+                continue;
+            }
+            else if (arg.starts_with("--path="))
+            {
+                options.m_path = arg.substr(std::string_view{"--path="}.size());
+                continue;
+            }
+            else if (arg == "--follow")
+            {
+                options.m_follow = true;
+                continue;
+            }
+            else if (!arg.starts_with("--") && options.m_range.empty())
+            {
+                options.m_range = arg;
+                continue;
+            }
+            else
+            {
+                fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+                return 1;
+            }
+
+            const auto [pEnd, errorCode] = std::from_chars(arg.data(), arg.data() + arg.size(), *pCount);
+            if (arg.empty() || (errorCode != std::errc{}) || (pEnd != arg.data() + arg.size()))
+            {
+                fmt::print(std::cout, "dvcsus: invalid number of commits '{}'.\n", arg);
+                return 1;
+            }
+        }
+        return dvcs::Log(options) ? 0 : 1;
+    }
+    else if (command == DIFF_COMMAND)
+    {
+        dvcs::DiffOptions options;
+        for (std::size_t iArg = 0; iArg < nbArgs; ++iArg)
+        {
+            std::string_view arg{argv[iArg + 2]};
+            if (arg.starts_with("--algorithm="))
+            {
+                if (!dvcs::ParseDiffAlgorithm(arg.substr(std::string_view{"--algorithm="}.size()), options.m_algorithm))
+                {
+                    fmt::print(std::cout, "dvcsus: unknown diff algorithm '{}'.\n", arg.substr(std::string_view{"--algorithm="}.size()));
+                    return 1;
+                }
+            }
+            else if (arg.starts_with("--unified="))
+            {
+                arg.remove_prefix(std::string_view{"--unified="}.size());
+                const auto [pEnd, errorCode] = std::from_chars(arg.data(), arg.data() + arg.size(), options.m_nbContextLines);
+                if (arg.empty() || (errorCode != std::errc{}) || (pEnd != arg.data() + arg.size()))
+                {
+                    fmt::print(std::cout, "dvcsus: invalid number of context lines '{}'.\n", arg);
+                    return 1;
+                }
+            }
+            else if (bool isValid{}; ParseRenameOption(arg, options.m_renames, isValid))
+            {
+                if (!isValid)
+                {
+                    return 1;
+                }
+            }
+            else if (!arg.starts_with("--") && options.m_oldRevision.empty())
+            {
+                options.m_oldRevision = arg;
+            }
+            else if (!arg.starts_with("--") && options.m_newRevision.empty())
+            {
+                options.m_newRevision = arg;
+            }
+            else
+            {
+                fmt::print(std::cout, "usage: dvcsus {0} {1}", commandIt->m_command, fmt::join(commandIt->m_args, " "));
+                return 1;
+            }
+        }
+        return dvcs::Diff(options) ? 0 : 1;
+    }
     else
     {
         assert(false);
@@ -0,0 +1,80 @@
+#include <dvcs/daemon.h>
+
+#include <csignal>
+#include <iostream>
+#include <string_view>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+namespace
+{
+
+// Service en cours d'exécution, arrêté à la réception de SIGINT ou de SIGTERM
+dvcs::Daemon *pRunningDaemon = nullptr;
+
+extern "C" void OnStopSignal(int /* signal */)
+{
+    if (pRunningDaemon != nullptr)
+    {
+        pRunningDaemon->Stop();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Manuel d'aide
+////////////////////////////////////////////////////////////////////////////////////
+void ShowHelp()
+{
+    fmt::print(std::cout, "usage: dvcsusd <root> [<address>]\n\n"
+                          "Serves the repositories found under <root> to dvcsus clients, which reach them\n"
+                          "with remotes such as dvcs://<host>:<port>/<repository>.\n\n"
+                          "<address> is <host>[:<port>] (default: all interfaces, port {}) or\n"
+                          "unix:<socket path> (remotes: dvcs+unix://<socket path>:<repository>).\n",
+               dvcs::DEFAULT_DAEMON_PORT);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////
+// Point d'entrée du service réseau
+////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+    if ((argc < 2) || (argc > 3) || (std::string_view{argv[1]} == "help"))
+    {
+        ShowHelp();
+        return (argc == 2) ? 0 : 1;
+    }
+
+    dvcs::NetworkAddress address;
+    if ((argc == 3) && !dvcs::ParseNetworkAddress(argv[2], address))
+    {
+        fmt::print(std::cout, "dvcsusd: invalid address '{}'.\n", argv[2]);
+        return 1;
+    }
+
+    dvcs::Daemon daemon{argv[1]};
+    if (!daemon.Listen(address))
+    {
+        return 1;
+    }
+
+    pRunningDaemon = &daemon;
+    std::signal(SIGINT, OnStopSignal);
+    std::signal(SIGTERM, OnStopSignal);
+
+    if (address.m_socketPath.empty())
+    {
+        fmt::print(std::cout, "serving {0} on port {1}\n", argv[1], daemon.GetPort());
+    }
+    else
+    {
+        fmt::print(std::cout, "serving {0} on {1}\n", argv[1], address.m_socketPath);
+    }
+    std::cout.flush();
+
+    daemon.Run();
+    pRunningDaemon = nullptr;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <dvcs/filemonitor.h>
+
+#include <csignal>
+#include <iostream>
+#include <string_view>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+namespace
+{
+
+// Moniteur en cours d'exécution, arrêté à la réception de SIGINT ou de SIGTERM
+dvcs::FileMonitor *pRunningMonitor = nullptr;
+
+extern "C" void OnStopSignal(int /* signal */)
+{
+    if (pRunningMonitor != nullptr)
+    {
+        pRunningMonitor->Stop();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Manuel d'aide
+////////////////////////////////////////////////////////////////////////////////////
+void ShowHelp()
+{
+    fmt::print(std::cout, "usage: dvcsusmon [<root>]\n\n"
+                          "Watches the working tree of the repository found at <root> (default: the\n"
+                          "current directory) and records the paths that change, so that status,\n"
+                          "add --all and commit -a only examine those. Commands fall back to a full\n"
+                          "scan of the working tree whenever the monitor is not running.\n");
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////
+// Point d'entrée du moniteur de fichiers
+////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+    if ((argc > 2) || ((argc == 2) && (std::string_view{argv[1]} == "help")))
+    {
+        ShowHelp();
+        return (argc == 2) ? 0 : 1;
+    }
+
+    const fs::path rootPath{(argc == 2) ? argv[1] : "."};
+    dvcs::FileMonitor monitor{rootPath};
+    if (!monitor.Start())
+    {
+        return 1;
+    }
+
+    pRunningMonitor = &monitor;
+    std::signal(SIGINT, OnStopSignal);
+    std::signal(SIGTERM, OnStopSignal);
+
+    fmt::print(std::cout, "monitoring {0} ({1} directories)\n", rootPath.string(), monitor.GetNbWatches());
+    std::cout.flush();
+
+    monitor.Run();
+    pRunningMonitor = nullptr;
+    return 0;
+}
@@ -6,8 +6,17 @@
 
 #include "testfolderfixture.h"
 
+#include "../dvcs/bloomfilter.h"
+#include "../dvcs/chunker.h"
+#include "../dvcs/codec.h"
+#include "../dvcs/commitgraph.h"
 #include "../dvcs/commands.h"
+#include "../dvcs/daemon.h"
+#include "../dvcs/diff.h"
+#include "../dvcs/filemonitor.h"
+#include "../dvcs/hash.h"
 #include "../dvcs/paths.h"
+#include "../dvcs/similarity.h"
 
 #include <sqlite3.h>
 
@@ -17,6 +26,9 @@
 #include <algorithm>
 #include <concepts>
 #include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
 
 namespace
 {
@@ -126,6 +138,122 @@ bool StartsWith(const StreamInterceptor<TStream> &interceptor, std::string_view
     return content.starts_with(expected);
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+// Retourne la valeur (unique) produite par la requête <query> sur la base de
+// données <dbPath>
+////////////////////////////////////////////////////////////////////////////////////
+std::string QueryValue(const fs::path &dbPath, const std::string &query)
+{
+    sqlite3 *pDBHandle;
+    BOOST_REQUIRE(sqlite3_open(dbPath.c_str(), &pDBHandle) == SQLITE_OK);
+    BOOST_REQUIRE(pDBHandle != nullptr);
+
+    std::string value;
+    auto callback = [](void *pValue, int argc, char **pArgv, char ** /* pErrMsg */) {
+        BOOST_REQUIRE(argc == 1);
+        *reinterpret_cast<std::string *>(pValue) = (pArgv[0] != nullptr) ? pArgv[0] : "";
+        return SQLITE_OK;
+    };
+    BOOST_CHECK(sqlite3_exec(pDBHandle, query.c_str(), callback, &value, nullptr) == SQLITE_OK);
+    BOOST_REQUIRE(sqlite3_close(pDBHandle) == SQLITE_OK);
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Compte le nombre de rangées de la table <table> de la base de données <dbPath>
+////////////////////////////////////////////////////////////////////////////////////
+int CountRows(const fs::path &dbPath, std::string_view table) { return std::stoi(QueryValue(dbPath, fmt::format("SELECT COUNT(*) FROM {};", table))); }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Crée le fichier <filePath> (ainsi que ses répertoires parents) ayant comme
+// contenu <content>
+////////////////////////////////////////////////////////////////////////////////////
+void WriteTestFile(const fs::path &filePath, std::string_view content)
+{
+    if (filePath.has_parent_path())
+    {
+        fs::create_directories(filePath.parent_path());
+    }
+    std::ofstream fileStream{filePath, std::ios::out | std::ios::binary};
+    BOOST_REQUIRE(fileStream);
+    fileStream << content;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Retourne le contenu du fichier <filePath>
+////////////////////////////////////////////////////////////////////////////////////
+std::string ReadTestFile(const fs::path &filePath)
+{
+    std::ifstream fileStream{filePath, std::ios::in | std::ios::binary};
+    BOOST_REQUIRE(fileStream);
+    return std::string{std::istreambuf_iterator<char>{fileStream}, std::istreambuf_iterator<char>{}};
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Abaisse à <maxBlobSize> la taille maximale d'un blob des connexions SQLite
+// ouvertes pendant sa durée de vie
+// Voir: https://sqlite.org/c3ref/auto_extension.html
+////////////////////////////////////////////////////////////////////////////////////
+template <int maxBlobSize> class BlobLimitOverride
+{
+  public:
+    BlobLimitOverride() { BOOST_REQUIRE(sqlite3_auto_extension(reinterpret_cast<void (*)()>(&LowerBlobLimit)) == SQLITE_OK); }
+    BlobLimitOverride(const BlobLimitOverride &) = delete;
+    BlobLimitOverride &operator=(const BlobLimitOverride &) = delete;
+    ~BlobLimitOverride() { sqlite3_cancel_auto_extension(reinterpret_cast<void (*)()>(&LowerBlobLimit)); }
+
+  private:
+    static int LowerBlobLimit(sqlite3 *pDB, const char ** /* pErrorMessage */, const sqlite3_api_routines * /* pApi */)
+    {
+        sqlite3_limit(pDB, SQLITE_LIMIT_LENGTH, maxBlobSize);
+        return SQLITE_OK;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Service dvcsusd exécuté en arrière-plan le temps d'un test
+////////////////////////////////////////////////////////////////////////////////////
+class BackgroundDaemon
+{
+  public:
+    BackgroundDaemon(const fs::path &rootPath, const dvcs::NetworkAddress &address) : m_daemon{rootPath}
+    {
+        BOOST_REQUIRE(m_daemon.Listen(address));
+        m_thread = std::jthread{[this]() { m_daemon.Run(); }};
+    }
+    BackgroundDaemon(const BackgroundDaemon &) = delete;
+    BackgroundDaemon &operator=(const BackgroundDaemon &) = delete;
+    // NOTE: Le fil d'exécution, détruit en premier, attend la fin du service
+    ~BackgroundDaemon() { m_daemon.Stop(); }
+
+    [[nodiscard]] std::uint16_t GetPort() const noexcept { return m_daemon.GetPort(); }
+
+  private:
+    dvcs::Daemon m_daemon;
+    std::jthread m_thread;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Moniteur de fichiers exécuté en arrière-plan le temps d'un test
+////////////////////////////////////////////////////////////////////////////////////
+class BackgroundFileMonitor
+{
+  public:
+    explicit BackgroundFileMonitor(const fs::path &rootPath) : m_monitor{rootPath}
+    {
+        BOOST_REQUIRE(m_monitor.Start());
+        m_thread = std::jthread{[this]() { m_monitor.Run(); }};
+    }
+    BackgroundFileMonitor(const BackgroundFileMonitor &) = delete;
+    BackgroundFileMonitor &operator=(const BackgroundFileMonitor &) = delete;
+    // NOTE: Le fil d'exécution, détruit en premier, attend la fin du moniteur
+    ~BackgroundFileMonitor() { m_monitor.Stop(); }
+
+  private:
+    dvcs::FileMonitor m_monitor;
+    std::jthread m_thread;
+};
+
 } // namespace
 
 BOOST_AUTO_TEST_SUITE(CommandsTestsSuite)
@@ -187,6 +315,143 @@ BOOST_FIXTURE_TEST_CASE(InitCommandFail, TestFolderFixture)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un dépôt peut identifier ses objets et ses commits à l'aide de SHA256
+//
+// Filtre: --run_test="CommandsTestsSuite/InitCommandSHA256"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(InitCommandSHA256, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init(dvcs::HashAlgorithm::SHA256));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT Value FROM Metadata WHERE Name = \"HashAlgorithm\";"), "sha256");
+
+    WriteTestFile("a.txt", "abc");
+    BOOST_REQUIRE(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT lower(hex(Hash)) FROM Objects;"),
+                      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT length(Hash) FROM Commits;"), "32");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT length(ParentHash) FROM Commits;"), "32");
+
+    // Le commit suivant doit retrouver son parent
+    WriteTestFile("b.txt", "def");
+    BOOST_REQUIRE(dvcs::Add(fs::path{"b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "Commits"), 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que le profil de stockage choisi à l'init est consigné dans le dépôt et
+// appliqué à chacune de ses ouvertures
+//
+// Filtre: --run_test="CommandsTestsSuite/InitCommandStorageProfile"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(InitCommandStorageProfile, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init(dvcs::HashAlgorithm::SHA1, dvcs::StorageProfile::BulkImport));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT Value FROM Metadata WHERE Name = \"StorageProfile\";"), "bulk");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "PRAGMA page_size;"), "16384");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "PRAGMA page_size;"), "16384");
+
+    WriteTestFile("a.txt", "abc");
+    BOOST_REQUIRE(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "PRAGMA journal_mode;"), "delete");
+
+    // Le WAL, lui, est conservé dans les bases de données d'une ouverture à l'autre
+    BOOST_REQUIRE(dvcs::SetStorageProfile(dvcs::StorageProfile::Durable));
+    {
+        dvcs::Repository repository;
+        BOOST_REQUIRE(repository.Open(GetTestFolderPath()));
+        BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "PRAGMA journal_mode;"), "wal");
+        BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "PRAGMA journal_mode;"), "wal");
+        BOOST_CHECK(dvcs::Commit(repository, "Author", "Email", "Message"));
+    }
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "Commits"), 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la migration d'un dépôt créé avec la première version du schéma
+//
+// Filtre: --run_test="CommandsTestsSuite/MigrateCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MigrateCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+
+    BOOST_REQUIRE(fs::create_directory(dvcs::DVCS_PATH));
+    fs::copy_file(TEST_DATA_PATH / "V1Repo.db", dvcs::REPO_DB_PATH);
+    fs::copy_file(TEST_DATA_PATH / "V1Staging.db", dvcs::STAGING_DB_PATH);
+
+    // Un dépôt doit être migré avant de pouvoir être utilisé
+    BOOST_CHECK(!dvcs::Commit("Author", "Email", "Message"));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Repository uses schema version 1"));
+
+    BOOST_CHECK(dvcs::Migrate());
+    BOOST_CHECK(StartsWith(coutInterceptor, "migrated repository from schema version 1 to 15"));
+    ValidateRepositoryContents("MigrateTest.db");
+
+    BOOST_CHECK(dvcs::Migrate());
+    BOOST_CHECK(StartsWith(coutInterceptor, "repository already uses schema version 15"));
+
+    // Le dépôt migré est pleinement fonctionnel: l'arbre du commit existant est
+    // construit avec celui du nouveau commit
+    BOOST_CHECK(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "Commits"), 2);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsTrees"), 2);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsPathFilters"), 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un dépôt récent est migré version par version et qu'il obtient les
+// index secondaires de l'historique
+//
+// Filtre: --run_test="CommandsTestsSuite/MigrateCommandIndexes"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MigrateCommandIndexes, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    const std::string indexesQuery{"SELECT COUNT(*) FROM sqlite_master WHERE type = \"index\" AND name IN (\"ObjectsChunksChunkHash\", "
+                                   "\"CommitsParentHash\", \"CommitsObjectsObjectHash\", \"BranchesCommitsCommitHash\");"};
+
+    CreateNonEmptyRepository();
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, indexesQuery), "4");
+
+    // Retour à la version 6 du schéma, qui n'avait pas ces index (ni les arbres, ni
+    // les filtres des chemins modifiés, ni les commits de fusion, ni les chemins des
+    // fichiers des commits)
+    QueryValue(dvcs::REPO_DB_PATH, "DROP INDEX ObjectsChunksChunkHash;"
+                                   "DROP INDEX CommitsParentHash;"
+                                   "DROP INDEX CommitsObjectsObjectHash;"
+                                   "CREATE TABLE CommitsObjectsV6("
+                                   "   ObjectHash BLOB NOT NULL,"
+                                   "   CommitHash BLOB NOT NULL,"
+                                   "   PRIMARY KEY (CommitHash, ObjectHash)) WITHOUT ROWID;"
+                                   "INSERT INTO CommitsObjectsV6 (ObjectHash, CommitHash) SELECT ObjectHash, CommitHash FROM CommitsObjects;"
+                                   "DROP TABLE CommitsObjects;"
+                                   "ALTER TABLE CommitsObjectsV6 RENAME TO CommitsObjects;"
+                                   "DROP INDEX BranchesCommitsCommitHash;"
+                                   "DROP TABLE CommitsTrees;"
+                                   "DROP TABLE TreesEntries;"
+                                   "DROP TABLE CommitsPathFilters;"
+                                   "DROP INDEX CommitsMergeParentHash;"
+                                   "ALTER TABLE Commits DROP COLUMN MergeParentHash;"
+                                   "UPDATE Metadata SET Value = 6 WHERE Name = \"SchemaVersion\";");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, indexesQuery), "0");
+
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Migrate());
+    BOOST_CHECK(StartsWith(coutInterceptor, "migrated repository from schema version 6 to 15"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, indexesQuery), "4");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT COUNT(*) FROM CommitsObjects JOIN Objects ON Objects.Hash = ObjectHash "
+                                                     "WHERE CommitsObjects.Path = Objects.Path;"),
+                      std::to_string(CountRows(dvcs::REPO_DB_PATH, "CommitsObjects")));
+    BOOST_CHECK(dvcs::CreateBranch("MaBranche"));
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 // Valide la mécanique d'ajout
 //
@@ -240,258 +505,2594 @@ BOOST_FIXTURE_TEST_CASE(AddCommandFailOutsideRepo, TestFolderFixture)
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique de retrait
+// Valide l'ajout récursif du contenu d'un répertoire
 //
-// Filtre: --run_test="CommandsTestsSuite/RevertCommand"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandDirectory"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(RevertCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandDirectory, TestFolderFixture)
 {
-    // StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor coutInterceptor{std::cout};
     BOOST_REQUIRE(dvcs::Init());
+    coutInterceptor.GetStreamContent();
 
-    // Ajout d'un fichier pour de vrai
-    const auto &testFilePath{"test.txt"};
+    for (int iFile = 0; iFile < 50; ++iFile)
     {
-        std::ofstream fileStream{testFilePath};
-        BOOST_REQUIRE(fileStream);
+        WriteTestFile(fs::path{"src"} / fmt::format("dir{}", iFile % 5) / fmt::format("file{}.txt", iFile), fmt::format("content {}", iFile));
     }
 
-    BOOST_CHECK(dvcs::Add(testFilePath));
-    BOOST_CHECK(dvcs::Revert());
-    ValidateRepositoryContents("InitTest.db");
+    BOOST_CHECK(dvcs::Add(fs::path{"src"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 50 files"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 50);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique de commit
+// Valide l'ajout de fichiers désignés par un motif
 //
-// Filtre: --run_test="CommandsTestsSuite/CommitCommand"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandGlob"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CommitCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandGlob, TestFolderFixture)
 {
-    CreateNonEmptyRepository();
-    ValidateRepositoryContents("CommitTest.db");
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+
+    WriteTestFile("src/a.cpp", "a");
+    WriteTestFile("src/b.h", "b");
+    WriteTestFile("src/sub/c.cpp", "c");
+
+    BOOST_CHECK(dvcs::Add(std::vector<fs::path>{"src/*.cpp"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 1);
+
+    BOOST_CHECK(dvcs::Revert());
+    BOOST_CHECK(dvcs::Add(std::vector<fs::path>{"src/**/*.cpp"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 2);
+
+    BOOST_CHECK(dvcs::Revert());
+    BOOST_CHECK(!dvcs::Add(std::vector<fs::path>{"src/*.py"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'on ne peut pas créer un commit si des informations sont manquantes.
+// Valide l'ajout d'un fichier assez gros pour être traité par morceaux
 //
-// Filtre: --run_test="CommandsTestsSuite/CommitCommandFailMissingInformation"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandLargeFile"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CommitCommandFailMissingInformation, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandLargeFile, TestFolderFixture)
 {
-    StreamInterceptor cerrInterceptor{std::cerr};
-
+    StreamInterceptor coutInterceptor{std::cout};
     BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "a");
+    BOOST_REQUIRE(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("SansFichier"));
 
-    // Ajout d'un fichier pour de vrai
-    const std::string testFilePath{"test.txt"};
+    constexpr const std::size_t fileSize = 20U * 1024U * 1024U;
+    std::string data(fileSize, '\0');
+    for (std::size_t iByte = 0; iByte < fileSize; ++iByte)
     {
-        std::ofstream fileStream{testFilePath};
-        BOOST_REQUIRE(fileStream);
+        data[iByte] = static_cast<char>((iByte * 7919U) % 251U);
     }
+    WriteTestFile("large.bin", data);
+    const auto nbInternalFiles = std::distance(fs::directory_iterator{dvcs::DVCS_PATH}, fs::directory_iterator{});
 
-    BOOST_CHECK(dvcs::Add(testFilePath));
+    BOOST_CHECK(dvcs::Add(fs::path{"large.bin"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Size FROM Objects;"), std::to_string(fileSize));
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT length(Content) FROM Objects;")) > 0);
 
-    BOOST_CHECK(!dvcs::Commit("", "Email", "Message"));
-    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't commit. Missing information"));
-    BOOST_CHECK(!dvcs::Commit("Author", "", "Message"));
-    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't commit. Missing information"));
-    BOOST_CHECK(!dvcs::Commit("Author", "Email", ""));
-    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't commit. Missing information"));
+    // Les fichiers temporaires doivent avoir été nettoyés
+    BOOST_CHECK_EQUAL(std::distance(fs::directory_iterator{dvcs::DVCS_PATH}, fs::directory_iterator{}), nbInternalFiles);
+
+    // Les données stockées doivent être identiques à celles du fichier, octet par
+    // octet, une fois le fichier retiré puis réécrit par un checkout
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("SansFichier"));
+    BOOST_REQUIRE(!fs::exists("large.bin"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    BOOST_CHECK(ReadTestFile("large.bin") == data);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique d'ajout d'une source de données distantes à un dépôt
+// Valide que les nouvelles versions d'un fichier sont stockées sous forme de delta
+// par rapport à la version précédente, avec des chaînes de longueur bornée
 //
-// Filtre: --run_test="CommandsTestsSuite/SetRemoteCommand"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandDelta"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(SetRemoteCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandDelta, TestFolderFixture)
 {
-    // StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor coutInterceptor{std::cout};
     BOOST_REQUIRE(dvcs::Init());
-    SetupRemoteRepository(TEST_DATA_PATH / fs::path{"TestRemote.db"});
-    ValidateRepositoryContents("SetRemoteTest.db");
+
+    std::string content;
+    for (int iLine = 0; iLine < 5000; ++iLine)
+    {
+        content += fmt::format("line {0} of a file that changes a little at each version ({1})\n", iLine, (iLine * 7919) % 1009);
+    }
+
+    std::vector<std::string> depths;
+    for (int iVersion = 0; iVersion < 12; ++iVersion)
+    {
+        content.insert(content.size() / 2, fmt::format("version {}\n", iVersion));
+        WriteTestFile("file.txt", content);
+        BOOST_REQUIRE(dvcs::Add(fs::path{"file.txt"}));
+        depths.push_back(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Depth FROM Objects;"));
+        if (iVersion == 1)
+        {
+            // Le delta ne contient que ce qui a changé
+            BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT length(Content) FROM Objects;")) < 1024);
+            BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT hex(Base) FROM Objects;"),
+                              QueryValue(dvcs::REPO_DB_PATH, "SELECT hex(Hash) FROM Objects;"));
+        }
+        BOOST_REQUIRE(dvcs::Commit("Author", "Email", fmt::format("Version {}", iVersion)));
+    }
+
+    // Un objet complet est stocké une fois la longueur maximale de la chaîne atteinte
+    const std::vector<std::string> expectedDepths{"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "0"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(depths.cbegin(), depths.cend(), expectedDepths.cbegin(), expectedDepths.cend());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'il n'est pas possible de définir un fichier qui n'est pas une base de
-// données comme étant une source de données distantes
+// Valide que les versions successives d'un gros fichier découpé en morceaux
+// partagent les morceaux qui n'ont pas changé
 //
-// Filtre: --run_test="CommandsTestsSuite/SetRemoteCommandFailNotDB"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandChunked"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(SetRemoteCommandFailNotDB, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandChunked, TestFolderFixture)
 {
+    StreamInterceptor coutInterceptor{std::cout};
     BOOST_REQUIRE(dvcs::Init());
-    const std::string testFilePath{"test.txt"};
-    {
-        std::ofstream fileStream{testFilePath};
-        BOOST_REQUIRE(fileStream);
-    }
-    BOOST_CHECK(dvcs::SetRemote(testFilePath));
+    BOOST_REQUIRE(dvcs::SetChunking(true));
+
+    std::mt19937 generator{42};
+    std::string content(4U * 1024U * 1024U, '\0');
+    std::generate(content.begin(), content.end(), [&generator]() { return static_cast<char>(generator()); });
+    WriteTestFile("file.bin", content);
+    BOOST_REQUIRE(dvcs::Add(fs::path{"file.bin"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Content IS NULL FROM Objects;"), "1");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT sum(Size) FROM Chunks;"), std::to_string(content.size()));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Version 0"));
+    const auto nbChunks = std::stoul(QueryValue(dvcs::REPO_DB_PATH, "SELECT count(*) FROM Chunks;"));
+    BOOST_CHECK(nbChunks > 1);
+
+    // Seuls les morceaux touchés par l'insertion sont nouveaux
+    content.insert(content.size() / 2, "x");
+    WriteTestFile("file.bin", content);
+    BOOST_REQUIRE(dvcs::Add(fs::path{"file.bin"}));
+    BOOST_CHECK(CountRows(dvcs::STAGING_DB_PATH, "Chunks") <= 2);
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT count(*) FROM ObjectsChunks;")) + 2 >= nbChunks);
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Version 1"));
+
+    // Un objet découpé est identifié par le hash de son contenu brut, comme les autres
+    BOOST_REQUIRE(dvcs::SetChunking(false));
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Add(fs::path{"file.bin"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 0 files, 1 unchanged"));
+
+    // Un objet découpé peut servir de base à un delta, ce qui requiert de le reconstruire
+    content.insert(content.size() / 4, "y");
+    WriteTestFile("file.bin", content);
+    BOOST_REQUIRE(dvcs::Add(fs::path{"file.bin"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Depth FROM Objects;"), "1");
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT length(Content) FROM Objects;")) < 1024);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'il n'est pas possible de définir un fichier qui n'existe pas
+// Valide qu'un fichier plus gros que la taille maximale d'un blob SQLite est
+// découpé en morceaux même si le découpage n'est pas activé
 //
-// Filtre: --run_test="CommandsTestsSuite/SetRemoteCommandFailNotExisting"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandBlobLimit"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(SetRemoteCommandFailNotExisting, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandBlobLimit, TestFolderFixture)
 {
+    StreamInterceptor coutInterceptor{std::cout};
+    const BlobLimitOverride<1024 * 1024> blobLimitOverride;
     BOOST_REQUIRE(dvcs::Init());
-    BOOST_CHECK(dvcs::SetRemote("NotAFile"));
+    WriteTestFile("a.txt", "a");
+    BOOST_REQUIRE(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("SansFichier"));
+
+    // Des données aléatoires sont incompressibles: elles sont stockées telles quelles
+    std::mt19937 generator{42};
+    std::string content(3U * 1024U * 1024U, '\0');
+    std::generate(content.begin(), content.end(), [&generator]() { return static_cast<char>(generator()); });
+    WriteTestFile("file.bin", content);
+    BOOST_REQUIRE(dvcs::Add(fs::path{"file.bin"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Content IS NULL FROM Objects;"), "1");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT sum(Size) FROM Chunks;"), std::to_string(content.size()));
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT max(length(Content)) FROM Chunks;")) <= 1024U * 1024U);
+
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("SansFichier"));
+    BOOST_REQUIRE(!fs::exists("file.bin"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    BOOST_CHECK(ReadTestFile("file.bin") == content);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique permettant d'aller chercher des changements sur un dépôt distant
+// Valide qu'un contenu déjà connu n'est pas stocké de nouveau, mais que le chemin
+// de chacun des fichiers ajoutés est tout de même consigné
 //
-// Filtre: --run_test="CommandsTestsSuite/PullCommand"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandUnchanged"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(PullCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandUnchanged, TestFolderFixture)
 {
+    StreamInterceptor coutInterceptor{std::cout};
     BOOST_REQUIRE(dvcs::Init());
-    SetupRemoteRepository(TEST_DATA_PATH / fs::path{"PullRemote.db"});
-    BOOST_CHECK(dvcs::Pull());
-    ValidateRepositoryContents("Remote.db");
+
+    // Un objet est identifié par le hash de son contenu brut
+    WriteTestFile("a.txt", "abc");
+    BOOST_CHECK(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT lower(hex(Hash)) FROM Objects;"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+    // Déjà dans la zone de staging
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 0 files, 1 unchanged"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 1);
+
+    // Déjà dans le dépôt
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 0 files, 1 unchanged"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 0);
+
+    // Même contenu présent deux fois dans un même ajout
+    WriteTestFile("b.txt", "def");
+    WriteTestFile("c.txt", "def");
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Add(std::vector<fs::path>{"b.txt", "c.txt"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 2 files, 0 unchanged"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 1);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Paths"), 2);
+
+    // Copie d'un fichier déjà dans le dépôt
+    fs::copy_file("a.txt", "d.txt");
+    BOOST_CHECK(dvcs::Add(fs::path{"d.txt"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 1);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Paths"), 3);
+
+    // Les fichiers font tous partie du commit et de son arbre
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "Objects"), 2);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsObjects"), 4);
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT group_concat(Name) FROM (SELECT DISTINCT Name FROM TreesEntries JOIN CommitsTrees ON "
+                                                     "CommitsTrees.TreeHash = TreesEntries.TreeHash ORDER BY Name);"),
+                      "a.txt,b.txt,c.txt,d.txt");
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Status());
+    BOOST_CHECK(StartsWith(coutInterceptor, "on branch default\nscanned 4 files"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'il n'est pas possible d'aller chercher des changements sur un dépôt
-// distant si celui-ci n'a pas été spécifié au préalable
+// Valide le choix du codec utilisé pour compresser les nouveaux objets
 //
-// Filtre: --run_test="CommandsTestsSuite/PushCommandFailNoRemote"
+// Filtre: --run_test="CommandsTestsSuite/SetCompressionCommand"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(PullCommandFailNoRemote, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(SetCompressionCommand, TestFolderFixture)
 {
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
     BOOST_REQUIRE(dvcs::Init());
-    BOOST_CHECK(!dvcs::Pull());
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT Value FROM Metadata WHERE Name = 'Compression';"), "zstd:3");
+
+    BOOST_CHECK(!dvcs::SetCompression("brotli"));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Invalid compression settings"));
+    BOOST_CHECK(!dvcs::SetCompression("zstd:99"));
+
+    BOOST_CHECK(dvcs::SetCompression("lz4:9"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT Value FROM Metadata WHERE Name = 'Compression';"), "lz4:9");
+
+    // Un contenu compressible l'est avec le codec choisi...
+    WriteTestFile("a.txt", std::string(4096, 'a'));
+    BOOST_CHECK(dvcs::Add(fs::path{"a.txt"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Codec FROM Objects;"), std::to_string(static_cast<int>(dvcs::Codec::LZ4)));
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT length(Content) FROM Objects;")) < 4096);
+
+    // ... alors qu'un contenu qui ne l'est pas est conservé tel quel
+    std::string randomContent(4096, '\0');
+    std::uint32_t state{12345};
+    std::generate(randomContent.begin(), randomContent.end(), [&state]() {
+        state = state * 1664525U + 1013904223U;
+        return static_cast<char>(state >> 24U);
+    });
+    BOOST_CHECK(dvcs::Revert());
+    WriteTestFile("b.bin", randomContent);
+    BOOST_CHECK(dvcs::Add(fs::path{"b.bin"}));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Codec FROM Objects;"), std::to_string(static_cast<int>(dvcs::Codec::Store)));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT length(Content) FROM Objects;"), "4096");
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique permettant d'envoyer des changements sur un dépôt distant
+// Valide l'entraînement d'un dictionnaire de compression et son utilisation pour
+// les objets existants et les nouveaux objets
 //
-// Filtre: --run_test="CommandsTestsSuite/PushCommand"
+// Filtre: --run_test="CommandsTestsSuite/TrainDictionaryCommand"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(PushCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(TrainDictionaryCommand, TestFolderFixture)
 {
-    CreateNonEmptyRepository();
-    const auto remoteRepoPath = TEST_DATA_PATH / fs::path{"Empty.db"};
-    SetupRemoteRepository(remoteRepoPath);
-    BOOST_CHECK(dvcs::Push());
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
 
-    sqlite3 *pDBHandle;
-    BOOST_REQUIRE(sqlite3_open(remoteRepoPath.c_str(), &pDBHandle) == SQLITE_OK);
-    BOOST_REQUIRE(pDBHandle != nullptr);
+    // Il faut assez de petits objets pour entraîner un dictionnaire
+    BOOST_CHECK(!dvcs::TrainCompressionDictionary());
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Not enough small objects"));
 
-    try
-    {
-        const auto contentQuery = fmt::format("ATTACH DATABASE \"{}\" as Expected;"
-                                              "BEGIN TRANSACTION;"
-                                              "SELECT * FROM Objects			EXCEPT SELECT * FROM Expected.Objects;"
-                                              "SELECT * FROM Commits			EXCEPT SELECT * FROM Expected.Commits;"
-                                              "SELECT * FROM CommitsObjects		EXCEPT SELECT * FROM Expected.CommitsObjects;"
-                                              "SELECT * FROM Branches			EXCEPT SELECT * FROM Expected.Branches;"
-                                              "SELECT * FROM BranchesCommits	EXCEPT SELECT * FROM Expected.BranchesCommits;"
-                                              "END TRANSACTION;"
-                                              "DETACH DATABASE Expected;",
-                                              dvcs::REPO_DB_PATH.c_str());
-        char *pErrMsg = nullptr;
-        auto callback = [](void *count, int argc, char **pArgv, char ** /* pErrMsg */) {
-            for (int iRes = 0; iRes < argc; ++iRes)
-            {
-                fmt::print(std::cout, "{0}\n", pArgv[iRes]);
-            }
-            int *pCount = reinterpret_cast<int *>(count);
-            ++(*pCount);
-            return SQLITE_OK;
-        };
-        int nbResults{};
-        const auto res = sqlite3_exec(pDBHandle, contentQuery.c_str(), callback, &nbResults, &pErrMsg);
-        if (res != SQLITE_OK)
+    auto writeSourceFile = [](int iFile) {
+        std::string content;
+        for (int iFunction = 0; iFunction < 10; ++iFunction)
         {
-            fmt::print(std::cerr, "SQLite error: {}\n", pErrMsg);
+            content += fmt::format("int Function{0}_{1}(const std::vector<int> &values)\n{{\n    return values[{1}] * {0};\n}}\n\n", iFile,
+                                   iFunction);
         }
-        BOOST_CHECK(nbResults == 0);
-        BOOST_REQUIRE(sqlite3_close(pDBHandle) == SQLITE_OK);
-    }
-    catch (const std::exception &e)
+        WriteTestFile(fmt::format("src/file{}.cpp", iFile), content);
+    };
+    for (int iFile = 0; iFile < 100; ++iFile)
     {
-        fmt::print(std::cerr, "{}\n", e.what());
-        BOOST_REQUIRE(false);
+        writeSourceFile(iFile);
     }
+    BOOST_REQUIRE(dvcs::Add(fs::path{"src"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    const auto sizeBefore = std::stoul(QueryValue(dvcs::REPO_DB_PATH, "SELECT SUM(length(Content)) FROM Objects;"));
+
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::TrainCompressionDictionary());
+    BOOST_CHECK(StartsWith(coutInterceptor, "trained dictionary"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "Dictionaries"), 1);
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT Value FROM Metadata WHERE Name = 'Dictionary';"),
+                      QueryValue(dvcs::REPO_DB_PATH, "SELECT Id FROM Dictionaries;"));
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::REPO_DB_PATH, "SELECT SUM(length(Content)) FROM Objects;")) < sizeBefore);
+
+    // Les nouveaux objets profitent aussi du dictionnaire
+    writeSourceFile(100);
+    BOOST_CHECK(dvcs::Add(fs::path{"src/file100.cpp"}));
+    BOOST_CHECK(std::stoul(QueryValue(dvcs::STAGING_DB_PATH, "SELECT length(Content) FROM Objects;")) < sizeBefore / 100);
+
+    // Un dictionnaire ne sert qu'avec zstd
+    BOOST_CHECK(dvcs::SetCompression("lz4"));
+    BOOST_CHECK(!dvcs::TrainCompressionDictionary());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'il n'est pas possible d'envoyer des changements sur un dépôt distant si
-// celui-ci n'a pas été spécifié au préalable
+// Valide que l'ajout est annulé en entier si un des fichiers ne peut être ajouté
 //
-// Filtre: --run_test="CommandsTestsSuite/PushCommandFailNoRemote"
+// Filtre: --run_test="CommandsTestsSuite/AddCommandFailAtomic"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(PushCommandFailNoRemote, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(AddCommandFailAtomic, TestFolderFixture)
 {
+    StreamInterceptor cerrInterceptor{std::cerr};
     BOOST_REQUIRE(dvcs::Init());
-    BOOST_CHECK(!dvcs::Push());
+
+    WriteTestFile("a.txt", "a");
+    BOOST_CHECK(!dvcs::Add(std::vector<fs::path>{"a.txt", "nope"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique de créations de branches
+// Valide l'état des fichiers rapporté par status et que les fichiers dont les
+// attributs n'ont pas changé ne sont pas relus
 //
-// Filtre: --run_test="CommandsTestsSuite/CreateBranchCommand"
+// Filtre: --run_test="CommandsTestsSuite/StatusCommand"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CreateBranchCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(StatusCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "a1");
+    WriteTestFile("dir/b.txt", "b1");
+    WriteTestFile("dir/c.txt", "c");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "dir"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+
+    // Les fichiers trop récents sont consignés dans le cache comme non vérifiés
+    const auto oldTime = fs::last_write_time("a.txt") - std::chrono::hours{1};
+    WriteTestFile("dir/b.txt", "b2");
+    fs::remove("dir/c.txt");
+    WriteTestFile("d.txt", "d");
+    WriteTestFile("e.txt", "e");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"e.txt"}));
+    WriteTestFile("sub/dir/f.txt", "f");
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Status());
+    BOOST_CHECK(StartsWith(coutInterceptor, "on branch default\n"
+                                            "?? d.txt\n"
+                                            " M dir/b.txt\n"
+                                            " D dir/c.txt\n"
+                                            "A  e.txt\n"
+                                            "?? sub/dir/f.txt\n"
+                                            "scanned 5 files, 5 hashed"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "FileStats"), 5);
+
+    for (const auto *pFile : {"a.txt", "dir/b.txt", "d.txt", "e.txt", "sub/dir/f.txt"})
+    {
+        fs::last_write_time(pFile, oldTime);
+    }
+    BOOST_REQUIRE(dvcs::Status());
+    BOOST_CHECK(coutInterceptor.GetStreamContent().find("scanned 5 files, 5 hashed") != std::string::npos);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "FileStats"), 5);
+    BOOST_REQUIRE(dvcs::Status());
+    BOOST_CHECK(coutInterceptor.GetStreamContent().find("scanned 5 files, 0 hashed") != std::string::npos);
+
+    // Une modification qui conserve la taille du fichier est tout de même détectée
+    WriteTestFile("a.txt", "a2");
+    fs::last_write_time("a.txt", oldTime + std::chrono::seconds{1});
+    BOOST_REQUIRE(dvcs::Status());
+    const auto status = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(status.find(" M a.txt\n") != std::string::npos);
+    BOOST_CHECK(status.find("scanned 5 files, 1 hashed") != std::string::npos);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que status, add --all et commit -a n'examinent que les chemins rapportés
+// par le moniteur de fichiers et qu'ils parcourent l'arbre de travail au complet
+// lorsque le moniteur n'est pas synchronisé ou ne s'exécute plus
+//
+// Filtre: --run_test="CommandsTestsSuite/StatusCommandFileMonitor"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(StatusCommandFileMonitor, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "a1");
+    WriteTestFile("dir/b.txt", "b1");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "dir"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    const auto oldTime = fs::last_write_time("a.txt") - std::chrono::hours{1};
+    fs::last_write_time("a.txt", oldTime);
+    fs::last_write_time("dir/b.txt", oldTime);
+
+    {
+        BackgroundFileMonitor monitor{fs::current_path()};
+        dvcs::FileMonitor otherMonitor{fs::current_path()};
+        BOOST_CHECK(!otherMonitor.Start());
+
+        // Une nouvelle session est synchronisée par un parcours complet
+        coutInterceptor.GetStreamContent();
+        BOOST_REQUIRE(dvcs::Status());
+        BOOST_CHECK(coutInterceptor.GetStreamContent().find("scanned 2 files, 2 hashed") != std::string::npos);
+        BOOST_REQUIRE(dvcs::Status());
+        BOOST_CHECK(coutInterceptor.GetStreamContent().find("scanned 0 of 2 files (file monitor), 0 hashed") != std::string::npos);
+
+        // Un nouveau répertoire est examiné au complet
+        WriteTestFile("dir/b.txt", "b2");
+        WriteTestFile("new/c.txt", "c");
+        BOOST_REQUIRE(dvcs::Status());
+        BOOST_CHECK(StartsWith(coutInterceptor, "on branch default\n"
+                                                " M dir/b.txt\n"
+                                                "?? new/c.txt\n"
+                                                "scanned 3 of 3 files (file monitor), 2 hashed"));
+
+        // add --all ajoute aussi les fichiers non suivis, contrairement à commit -a
+        BOOST_REQUIRE(dvcs::AddChanges());
+        BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 2);
+        WriteTestFile("a.txt", "a2");
+        WriteTestFile("d.txt", "d");
+        BOOST_REQUIRE(dvcs::AddChanges(false));
+        BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 3);
+        coutInterceptor.GetStreamContent();
+        BOOST_REQUIRE(dvcs::Status());
+        BOOST_CHECK(StartsWith(coutInterceptor, "on branch default\n"
+                                                "M  a.txt\n"
+                                                "?? d.txt\n"
+                                                "M  dir/b.txt\n"
+                                                "A  new/c.txt\n"
+                                                "scanned 4 of 4 files (file monitor)"));
+    }
+
+    // Sans moniteur, l'arbre de travail est parcouru au complet
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "FileMonitor"), 0);
+    fs::remove("d.txt");
+    BOOST_REQUIRE(dvcs::Status());
+    const auto status = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(status.find("?? d.txt") == std::string::npos);
+    BOOST_CHECK(status.find("scanned 3 files") != std::string::npos);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la mécanique de retrait
+//
+// Filtre: --run_test="CommandsTestsSuite/RevertCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(RevertCommand, TestFolderFixture)
 {
     // StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+
+    // Ajout d'un fichier pour de vrai
+    const auto &testFilePath{"test.txt"};
+    {
+        std::ofstream fileStream{testFilePath};
+        BOOST_REQUIRE(fileStream);
+    }
+
+    BOOST_CHECK(dvcs::Add(testFilePath));
+    BOOST_CHECK(dvcs::Revert());
+    ValidateRepositoryContents("InitTest.db");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la mécanique de commit
+//
+// Filtre: --run_test="CommandsTestsSuite/CommitCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CommitCommand, TestFolderFixture)
+{
     CreateNonEmptyRepository();
+    ValidateRepositoryContents("CommitTest.db");
+}
 
-    BOOST_CHECK(dvcs::CreateBranch("MaBranche"));
-    ValidateRepositoryContents("CreateBranchTest.db");
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que les répertoires inchangés d'un commit à l'autre partagent leur arbre
+// et que l'arbre d'un commit qui n'en a pas est reconstruit au besoin
+//
+// Filtre: --run_test="CommandsTestsSuite/CommitCommandTrees"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CommitCommandTrees, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "a1");
+    WriteTestFile("dir/b.txt", "b");
+    WriteTestFile("dir/sub/c.txt", "c");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "dir"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+
+    // Racine (a.txt, dir), dir (b.txt, sub) et dir/sub (c.txt)
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsTrees"), 1);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "TreesEntries"), 5);
+
+    // Seule la racine change: dir est partagé par les deux commits
+    WriteTestFile("a.txt", "a2");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsTrees"), 2);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "TreesEntries"), 7);
+
+    // Les arbres retirés (comme ceux de commits reçus d'un autre dépôt) sont
+    // reconstruits à l'identique
+    const std::string treesQuery{"SELECT group_concat(hex(TreeHash), ',') FROM (SELECT TreeHash FROM CommitsTrees ORDER BY CommitHash);"};
+    const auto trees = QueryValue(dvcs::REPO_DB_PATH, treesQuery);
+    QueryValue(dvcs::REPO_DB_PATH, "DELETE FROM CommitsTrees; DELETE FROM TreesEntries;");
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Status());
+    BOOST_CHECK(StartsWith(coutInterceptor, "on branch default\nscanned 3 files"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, treesQuery), trees);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "TreesEntries"), 7);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'il n'est pas possible de créer une même branche deux fois.
+// Valide qu'on ne peut pas créer un commit si des informations sont manquantes.
 //
-// Filtre: --run_test="CommandsTestsSuite/CreateBranchCommandFailAlreadyExists"
+// Filtre: --run_test="CommandsTestsSuite/CommitCommandFailMissingInformation"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CreateBranchCommandFailAlreadyExists, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(CommitCommandFailMissingInformation, TestFolderFixture)
 {
     StreamInterceptor cerrInterceptor{std::cerr};
-    CreateNonEmptyRepository();
 
-    BOOST_CHECK(dvcs::CreateBranch("MaBranche"));
-    BOOST_CHECK(!dvcs::CreateBranch("MaBranche"));
-    BOOST_CHECK(StartsWith(cerrInterceptor, "Branch 'MaBranche' already exists."));
+    BOOST_REQUIRE(dvcs::Init());
+
+    // Ajout d'un fichier pour de vrai
+    const std::string testFilePath{"test.txt"};
+    {
+        std::ofstream fileStream{testFilePath};
+        BOOST_REQUIRE(fileStream);
+    }
+
+    BOOST_CHECK(dvcs::Add(testFilePath));
+
+    BOOST_CHECK(!dvcs::Commit("", "Email", "Message"));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't commit. Missing information"));
+    BOOST_CHECK(!dvcs::Commit("Author", "", "Message"));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't commit. Missing information"));
+    BOOST_CHECK(!dvcs::Commit("Author", "Email", ""));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't commit. Missing information"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'il n'est pas possible de créer une branche dans un dépôt vide
+// Valide la mécanique d'ajout d'une source de données distantes à un dépôt
 //
-// Filtre: --run_test="CommandsTestsSuite/CreateBranchCommandFailEmptyRepository"
+// Filtre: --run_test="CommandsTestsSuite/SetRemoteCommand"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CreateBranchCommandFailEmptyRepository, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(SetRemoteCommand, TestFolderFixture)
 {
     // StreamInterceptor coutInterceptor{std::cout};
-    BOOST_CHECK(!dvcs::CreateBranch("MaBranche"));
+    BOOST_REQUIRE(dvcs::Init());
+    SetupRemoteRepository(TEST_DATA_PATH / fs::path{"TestRemote.db"});
+    ValidateRepositoryContents("SetRemoteTest.db");
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide la mécanique permettant de changer la branche active d'un dépôt
+// Valide qu'il n'est pas possible de définir un fichier qui n'est pas une base de
+// données comme étant une source de données distantes
 //
-// Filtre: --run_test="CommandsTestsSuite/CheckoutBranchCommand"
+// Filtre: --run_test="CommandsTestsSuite/SetRemoteCommandFailNotDB"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CheckoutBranchCommand, TestFolderFixture)
+BOOST_FIXTURE_TEST_CASE(SetRemoteCommandFailNotDB, TestFolderFixture)
+{
+    BOOST_REQUIRE(dvcs::Init());
+    const std::string testFilePath{"test.txt"};
+    {
+        std::ofstream fileStream{testFilePath};
+        BOOST_REQUIRE(fileStream);
+    }
+    BOOST_CHECK(dvcs::SetRemote(testFilePath));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'il n'est pas possible de définir un fichier qui n'existe pas
+//
+// Filtre: --run_test="CommandsTestsSuite/SetRemoteCommandFailNotExisting"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(SetRemoteCommandFailNotExisting, TestFolderFixture)
+{
+    BOOST_REQUIRE(dvcs::Init());
+    BOOST_CHECK(dvcs::SetRemote("NotAFile"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la mécanique permettant d'aller chercher des changements sur un dépôt distant
+//
+// Filtre: --run_test="CommandsTestsSuite/PullCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(PullCommand, TestFolderFixture)
+{
+    BOOST_REQUIRE(dvcs::Init());
+    SetupRemoteRepository(TEST_DATA_PATH / fs::path{"PullRemote.db"});
+    BOOST_CHECK(dvcs::Pull());
+    ValidateRepositoryContents("Remote.db");
+
+    // Les filtres des chemins modifiés des commits reçus sont construits localement
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsPathFilters"), CountRows(dvcs::REPO_DB_PATH, "Commits"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'il n'est pas possible d'aller chercher des changements sur un dépôt
+// distant si celui-ci n'a pas été spécifié au préalable
+//
+// Filtre: --run_test="CommandsTestsSuite/PushCommandFailNoRemote"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(PullCommandFailNoRemote, TestFolderFixture)
+{
+    BOOST_REQUIRE(dvcs::Init());
+    BOOST_CHECK(!dvcs::Pull());
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la mécanique permettant d'envoyer des changements sur un dépôt distant
+//
+// Filtre: --run_test="CommandsTestsSuite/PushCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(PushCommand, TestFolderFixture)
 {
-    // StreamInterceptor coutInterceptor{std::cout};
     CreateNonEmptyRepository();
+    const auto remoteRepoPath = TEST_DATA_PATH / fs::path{"Empty.db"};
+    SetupRemoteRepository(remoteRepoPath);
+    BOOST_CHECK(dvcs::Push());
 
-    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
-    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
-    ValidateRepositoryContents("CheckoutBranchTest.db");
+    sqlite3 *pDBHandle;
+    BOOST_REQUIRE(sqlite3_open(remoteRepoPath.c_str(), &pDBHandle) == SQLITE_OK);
+    BOOST_REQUIRE(pDBHandle != nullptr);
+
+    try
+    {
+        const auto contentQuery = fmt::format("ATTACH DATABASE \"{}\" as Expected;"
+                                              "BEGIN TRANSACTION;"
+                                              "SELECT * FROM Objects			EXCEPT SELECT * FROM Expected.Objects;"
+                                              "SELECT * FROM Commits			EXCEPT SELECT * FROM Expected.Commits;"
+                                              "SELECT * FROM CommitsObjects		EXCEPT SELECT * FROM Expected.CommitsObjects;"
+                                              "SELECT * FROM Branches			EXCEPT SELECT * FROM Expected.Branches;"
+                                              "SELECT * FROM BranchesCommits	EXCEPT SELECT * FROM Expected.BranchesCommits;"
+                                              "END TRANSACTION;"
+                                              "DETACH DATABASE Expected;",
+                                              dvcs::REPO_DB_PATH.c_str());
+        char *pErrMsg = nullptr;
+        auto callback = [](void *count, int argc, char **pArgv, char ** /* pErrMsg */) {
+            for (int iRes = 0; iRes < argc; ++iRes)
+            {
+                fmt::print(std::cout, "{0}\n", pArgv[iRes]);
+            }
+            int *pCount = reinterpret_cast<int *>(count);
+            ++(*pCount);
+            return SQLITE_OK;
+        };
+        int nbResults{};
+        const auto res = sqlite3_exec(pDBHandle, contentQuery.c_str(), callback, &nbResults, &pErrMsg);
+        if (res != SQLITE_OK)
+        {
+            fmt::print(std::cerr, "SQLite error: {}\n", pErrMsg);
+        }
+        BOOST_CHECK(nbResults == 0);
+        BOOST_REQUIRE(sqlite3_close(pDBHandle) == SQLITE_OK);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(std::cerr, "{}\n", e.what());
+        BOOST_REQUIRE(false);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Valide qu'on ne peut se positionner sur une branche non-existante
+// Valide que seuls les commits manquants au dépôt distant, et leurs objets, sont
+// envoyés
 //
-// Filtre: --run_test="CommandsTestsSuite/CheckoutBranchCommandFailDoesntExist"
+// Filtre: --run_test="CommandsTestsSuite/PushCommandIncremental"
 ////////////////////////////////////////////////////////////////////////////////////
-BOOST_FIXTURE_TEST_CASE(CheckoutBranchCommandFailDoesntExist, TestFolderFixture) { BOOST_REQUIRE(!dvcs::CheckoutBranch("MaBranche")); }
+BOOST_FIXTURE_TEST_CASE(PushCommandIncremental, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    CreateNonEmptyRepository();
+    SetupRemoteRepository(TEST_DATA_PATH / fs::path{"Empty.db"});
+    coutInterceptor.GetStreamContent();
+
+    BOOST_CHECK(dvcs::Push());
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 1 commits, 1 objects and 0 chunks"));
+
+    // Seuls le nouveau commit et ses objets sont envoyés
+    WriteTestFile("a.txt", "a");
+    WriteTestFile("b.txt", "b");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Push());
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 1 commits, 2 objects and 0 chunks"));
+
+    BOOST_CHECK(dvcs::Push());
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 0 commits, 0 objects and 0 chunks"));
+    BOOST_CHECK_EQUAL(CountRows("Empty.db", "Commits"), 2);
+    BOOST_CHECK_EQUAL(CountRows("Empty.db", "Objects"), 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un push ne remplace pas la tête d'une branche distante dont
+// l'historique a divergé, et qu'un pull la conserve sous une autre branche
+//
+// Filtre: --run_test="CommandsTestsSuite/PushCommandFailDiverged"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(PushCommandFailDiverged, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    CreateNonEmptyRepository();
+    SetupRemoteRepository(TEST_DATA_PATH / fs::path{"Empty.db"});
+    BOOST_REQUIRE(dvcs::Push());
+
+    // Un autre dépôt envoie un commit au dépôt distant...
+    fs::create_directories("clone");
+    fs::current_path("clone");
+    BOOST_REQUIRE(dvcs::Init());
+    BOOST_REQUIRE(dvcs::SetRemote("../Empty.db"));
+    BOOST_REQUIRE(dvcs::Pull());
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    WriteTestFile("a.txt", "a");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_REQUIRE(dvcs::Push());
+    fs::current_path(GetTestFolderPath());
+    const auto remoteHead = QueryValue("Empty.db", "SELECT hex(HeadCommit) FROM Branches WHERE Name = 'default';");
+
+    // ... qui ne fait pas partie de l'historique du commit local
+    WriteTestFile("b.txt", "b");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Other message"));
+    cerrInterceptor.GetStreamContent();
+    BOOST_CHECK(!dvcs::Push());
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Can't update branch default: its history has diverged"));
+    BOOST_CHECK_EQUAL(QueryValue("Empty.db", "SELECT hex(HeadCommit) FROM Branches WHERE Name = 'default';"), remoteHead);
+    BOOST_CHECK_EQUAL(CountRows("Empty.db", "Commits"), 2);
+
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Pull());
+    BOOST_CHECK(StartsWith(coutInterceptor, "Branch default has diverged: its remote head is in branch remote/default"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches WHERE Name = 'remote/default';"), remoteHead);
+    BOOST_CHECK(QueryValue(dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches WHERE Name = 'default';") != remoteHead);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'il n'est pas possible d'envoyer des changements sur un dépôt distant si
+// celui-ci n'a pas été spécifié au préalable
+//
+// Filtre: --run_test="CommandsTestsSuite/PushCommandFailNoRemote"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(PushCommandFailNoRemote, TestFolderFixture)
+{
+    BOOST_REQUIRE(dvcs::Init());
+    BOOST_CHECK(!dvcs::Push());
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un bundle reproduit le dépôt dans un autre, qu'un bundle incrémental
+// exige que son destinataire ait déjà la base de l'intervalle et qu'un bundle
+// corrompu n'est pas importé
+//
+// Filtre: --run_test="CommandsTestsSuite/BundleCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(BundleCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    CreateNonEmptyRepository();
+    const auto baseCommit = QueryValue(dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches;");
+
+    for (const auto *pFolder : {"clone", "fresh"})
+    {
+        fs::create_directory(pFolder);
+        fs::current_path(pFolder);
+        BOOST_REQUIRE(dvcs::Init());
+        fs::current_path(GetTestFolderPath());
+    }
+    dvcs::Repository clone;
+    dvcs::Repository fresh;
+    BOOST_REQUIRE(clone.Open(GetTestFolderPath() / "clone"));
+    BOOST_REQUIRE(fresh.Open(GetTestFolderPath() / "fresh"));
+    coutInterceptor.GetStreamContent();
+
+    BOOST_CHECK(dvcs::CreateBundle("all.bundle"));
+    BOOST_CHECK(StartsWith(coutInterceptor, "bundled 1 commits, 1 objects and 0 chunks"));
+    BOOST_CHECK(dvcs::Unbundle(clone, "all.bundle"));
+    BOOST_CHECK(StartsWith(coutInterceptor, "unbundled 1 commits, 1 objects and 0 chunks"));
+
+    WriteTestFile("a.txt", "a");
+    WriteTestFile("b.txt", "b");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(!dvcs::CreateBundle("bad.bundle", "nope..default"));
+    BOOST_CHECK(dvcs::CreateBundle("incremental.bundle", baseCommit + "..default"));
+    BOOST_CHECK(StartsWith(coutInterceptor, "bundled 1 commits, 2 objects and 0 chunks"));
+
+    // Un seul octet modifié invalide la somme de contrôle de son enregistrement
+    fs::copy_file("incremental.bundle", "corrupted.bundle");
+    {
+        std::fstream corruptedFile{"corrupted.bundle", std::ios::in | std::ios::out | std::ios::binary};
+        corruptedFile.seekp(static_cast<std::streamoff>(fs::file_size("corrupted.bundle") / 2));
+        corruptedFile.put('\xff');
+    }
+    BOOST_CHECK(!dvcs::Unbundle(clone, "corrupted.bundle"));
+    BOOST_CHECK_EQUAL(CountRows("clone" / dvcs::REPO_DB_PATH, "Commits"), 1);
+    BOOST_CHECK_EQUAL(CountRows("clone" / dvcs::REPO_DB_PATH, "Objects"), 1);
+
+    cerrInterceptor.GetStreamContent();
+    BOOST_CHECK(!dvcs::Unbundle(fresh, "incremental.bundle"));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Bundle requires commit"));
+    BOOST_CHECK_EQUAL(CountRows("fresh" / dvcs::REPO_DB_PATH, "Commits"), 0);
+
+    BOOST_CHECK(dvcs::Unbundle(clone, "incremental.bundle"));
+    BOOST_CHECK(StartsWith(coutInterceptor, "unbundled 1 commits, 2 objects and 0 chunks"));
+    BOOST_CHECK_EQUAL(CountRows("clone" / dvcs::REPO_DB_PATH, "Commits"), 2);
+    BOOST_CHECK_EQUAL(CountRows("clone" / dvcs::REPO_DB_PATH, "Objects"), 3);
+    BOOST_CHECK_EQUAL(QueryValue("clone" / dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches;"),
+                      QueryValue(dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches;"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide les échanges avec des dépôts servis par dvcsusd, en TCP comme par socket
+// Unix, sur la machine locale
+//
+// Filtre: --run_test="CommandsTestsSuite/DaemonPushPull"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(DaemonPushPull, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    CreateNonEmptyRepository();
+
+    for (const auto *pFolder : {"served/central", "clone"})
+    {
+        fs::create_directories(pFolder);
+        fs::current_path(pFolder);
+        BOOST_REQUIRE(dvcs::Init());
+        fs::current_path(GetTestFolderPath());
+    }
+    dvcs::Repository clone;
+    BOOST_REQUIRE(clone.Open(GetTestFolderPath() / "clone"));
+
+    const auto socketPath = (GetTestFolderPath() / "dvcsusd.sock").string();
+    const BackgroundDaemon tcpDaemon{GetTestFolderPath() / "served", dvcs::NetworkAddress{"127.0.0.1", 0, {}}};
+    const BackgroundDaemon unixDaemon{GetTestFolderPath() / "served", dvcs::NetworkAddress{{}, 0, socketPath}};
+    const auto tcpUrl = fmt::format("dvcs://127.0.0.1:{}/central", tcpDaemon.GetPort());
+    coutInterceptor.GetStreamContent();
+
+    BOOST_CHECK(!dvcs::SetRemote("dvcs://:12/central"));
+    BOOST_REQUIRE(dvcs::SetRemote(tcpUrl));
+    BOOST_CHECK(dvcs::Push());
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 1 commits, 1 objects and 0 chunks"));
+    BOOST_CHECK(dvcs::Push());
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 0 commits, 0 objects and 0 chunks"));
+    BOOST_CHECK_EQUAL(CountRows("served/central" / dvcs::REPO_DB_PATH, "Commits"), 1);
+
+    BOOST_REQUIRE(dvcs::SetRemote(clone, "dvcs+unix://" + socketPath + ":central"));
+    BOOST_CHECK(dvcs::Pull(clone));
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 1 commits, 1 objects and 0 chunks"));
+    BOOST_CHECK_EQUAL(QueryValue("clone" / dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches;"),
+                      QueryValue(dvcs::REPO_DB_PATH, "SELECT hex(HeadCommit) FROM Branches;"));
+
+    // Seul le nouveau commit fait le voyage
+    WriteTestFile("a.txt", "a");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(dvcs::Push());
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 1 commits, 1 objects and 0 chunks"));
+    BOOST_CHECK(dvcs::Pull(clone));
+    BOOST_CHECK(StartsWith(coutInterceptor, "transferred 1 commits, 1 objects and 0 chunks"));
+    BOOST_CHECK_EQUAL(CountRows("clone" / dvcs::REPO_DB_PATH, "Commits"), 2);
+
+    // Le service ne sert que les dépôts se trouvant sous sa racine
+    cerrInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::SetRemote(clone, fmt::format("dvcs://127.0.0.1:{}/../clone", tcpDaemon.GetPort())));
+    BOOST_CHECK(!dvcs::Pull(clone));
+    BOOST_CHECK(cerrInterceptor.GetStreamContent().find("remote: No repository '../clone'") != std::string::npos);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la mécanique de créations de branches
+//
+// Filtre: --run_test="CommandsTestsSuite/CreateBranchCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CreateBranchCommand, TestFolderFixture)
+{
+    // StreamInterceptor coutInterceptor{std::cout};
+    CreateNonEmptyRepository();
+
+    BOOST_CHECK(dvcs::CreateBranch("MaBranche"));
+    ValidateRepositoryContents("CreateBranchTest.db");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'il n'est pas possible de créer une même branche deux fois.
+//
+// Filtre: --run_test="CommandsTestsSuite/CreateBranchCommandFailAlreadyExists"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CreateBranchCommandFailAlreadyExists, TestFolderFixture)
+{
+    StreamInterceptor cerrInterceptor{std::cerr};
+    CreateNonEmptyRepository();
+
+    BOOST_CHECK(dvcs::CreateBranch("MaBranche"));
+    BOOST_CHECK(!dvcs::CreateBranch("MaBranche"));
+    BOOST_CHECK(StartsWith(cerrInterceptor, "Branch 'MaBranche' already exists."));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'il n'est pas possible de créer une branche dans un dépôt vide
+//
+// Filtre: --run_test="CommandsTestsSuite/CreateBranchCommandFailEmptyRepository"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CreateBranchCommandFailEmptyRepository, TestFolderFixture)
+{
+    // StreamInterceptor coutInterceptor{std::cout};
+    BOOST_CHECK(!dvcs::CreateBranch("MaBranche"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la mécanique permettant de changer la branche active d'un dépôt
+//
+// Filtre: --run_test="CommandsTestsSuite/CheckoutBranchCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CheckoutBranchCommand, TestFolderFixture)
+{
+    // StreamInterceptor coutInterceptor{std::cout};
+    CreateNonEmptyRepository();
+
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    ValidateRepositoryContents("CheckoutBranchTest.db");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'on ne peut se positionner sur une branche non-existante
+//
+// Filtre: --run_test="CommandsTestsSuite/CheckoutBranchCommandFailDoesntExist"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CheckoutBranchCommandFailDoesntExist, TestFolderFixture) { BOOST_REQUIRE(!dvcs::CheckoutBranch("MaBranche")); }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que le changement de branche met à jour les fichiers du dépôt et que seuls
+// les fichiers qui diffèrent sont réécrits
+//
+// Filtre: --run_test="CommandsTestsSuite/CheckoutBranchCommandWorkingTree"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CheckoutBranchCommandWorkingTree, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "a1");
+    WriteTestFile("dir/b.txt", "b");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "dir"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    WriteTestFile("a.txt", "a2");
+    WriteTestFile("new/c.txt", "c");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "new/c.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    coutInterceptor.GetStreamContent();
+
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    BOOST_CHECK(StartsWith(coutInterceptor, "checked out 'default': 1 files written (0.00 MB), 1 removed in"));
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "a1");
+    BOOST_CHECK_EQUAL(ReadTestFile("dir/b.txt"), "b");
+    BOOST_CHECK(!fs::exists("new"));
+
+    // Un fichier identique dans les deux commits n'est pas touché: sa suppression
+    // demeure une modification locale
+    fs::remove("dir/b.txt");
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    BOOST_CHECK(StartsWith(coutInterceptor, "checked out 'MaBranche': 2 files written"));
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "a2");
+    BOOST_CHECK(!fs::exists("dir/b.txt"));
+    BOOST_CHECK_EQUAL(ReadTestFile("new/c.txt"), "c");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que le changement de branche n'écrase pas les modifications locales des
+// fichiers qu'il réécrirait, ni les fichiers non suivis qu'il remplacerait
+//
+// Filtre: --run_test="CommandsTestsSuite/CheckoutBranchCommandFailLocalChanges"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(CheckoutBranchCommandFailLocalChanges, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("f.txt", "v1");
+    BOOST_REQUIRE(dvcs::Add(fs::path{"f.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("other"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("other"));
+    WriteTestFile("f.txt", "v2");
+    WriteTestFile("g.txt", "g");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"f.txt", "g.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    cerrInterceptor.GetStreamContent();
+
+    // Fichier suivi modifié
+    WriteTestFile("f.txt", "LOCALWORK");
+    BOOST_CHECK(!dvcs::CheckoutBranch("other"));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Can't checkout. Local changes to 'f.txt' would be overwritten.\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("f.txt"), "LOCALWORK");
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::STAGING_DB_PATH, "SELECT Value FROM Metadata WHERE Name = \"CurrentBranch\";"), "default");
+
+    // Fichier non suivi qui serait remplacé
+    WriteTestFile("f.txt", "v1");
+    WriteTestFile("g.txt", "mine");
+    BOOST_CHECK(!dvcs::CheckoutBranch("other"));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Can't checkout. Local changes to 'g.txt' would be overwritten.\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("g.txt"), "mine");
+
+    fs::remove("g.txt");
+    BOOST_CHECK(dvcs::CheckoutBranch("other"));
+    BOOST_CHECK_EQUAL(ReadTestFile("f.txt"), "v2");
+    BOOST_CHECK_EQUAL(ReadTestFile("g.txt"), "g");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un même dépôt ouvert peut servir à plusieurs commandes et qu'un échec
+// n'y laisse pas de transaction en cours.
+//
+// Filtre: --run_test="CommandsTestsSuite/RepositoryCommands"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(RepositoryCommands, TestFolderFixture)
+{
+    StreamInterceptor cerrInterceptor{std::cerr};
+
+    dvcs::Repository repository;
+    BOOST_CHECK(!repository.Open(GetTestFolderPath()));
+    BOOST_CHECK(!repository.IsOpen());
+    BOOST_CHECK(!dvcs::Revert(repository));
+
+    BOOST_REQUIRE(dvcs::Init());
+    BOOST_REQUIRE(repository.Open(GetTestFolderPath()));
+    BOOST_CHECK(repository.IsOpen());
+
+    WriteTestFile("test.txt", "");
+    BOOST_CHECK(!dvcs::Add(repository, std::vector<fs::path>{"test.txt", "nope"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "Objects"), 0);
+
+    // Les commandes suivantes réutilisent les requêtes préparées par les précédentes
+    BOOST_CHECK(dvcs::Add(repository, std::vector<fs::path>{"test.txt"}));
+    BOOST_CHECK(dvcs::Commit(repository, "Author", "Email", "Message"));
+    BOOST_CHECK(dvcs::CreateBranch(repository, "MaBranche"));
+    BOOST_CHECK(!dvcs::CreateBranch(repository, "MaBranche"));
+    BOOST_CHECK(dvcs::CheckoutBranch(repository, "MaBranche"));
+    ValidateRepositoryContents("CheckoutBranchTest.db");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide les requêtes d'ascendance et de base commune sur deux branches qui ont
+// divergé, ainsi que la reconstruction du graphe des commits
+//
+// Filtre: --run_test="CommandsTestsSuite/MergeBaseCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MergeBaseCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "a1");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    WriteTestFile("a.txt", "a2");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    WriteTestFile("b.txt", "b");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Other message"));
+    BOOST_CHECK(fs::exists(dvcs::COMMIT_GRAPH_PATH));
+
+    const auto firstCommit = QueryValue(dvcs::REPO_DB_PATH, "SELECT lower(hex(ParentHash)) FROM Commits JOIN Branches ON "
+                                                            "Branches.HeadCommit = Commits.Hash WHERE Branches.Name = \"MaBranche\";");
+    std::optional<dvcs::THash> mergeBase;
+    BOOST_REQUIRE(dvcs::FindMergeBase("default", "MaBranche", mergeBase));
+    BOOST_REQUIRE(mergeBase);
+    BOOST_CHECK_EQUAL(dvcs::ToHex(*mergeBase), firstCommit);
+
+    bool isAncestor{};
+    BOOST_REQUIRE(dvcs::IsAncestor(firstCommit, "MaBranche", isAncestor));
+    BOOST_CHECK(isAncestor);
+    BOOST_REQUIRE(dvcs::IsAncestor("default", "MaBranche", isAncestor));
+    BOOST_CHECK(!isAncestor);
+    BOOST_REQUIRE(dvcs::IsAncestor("MaBranche", "MaBranche", isAncestor));
+    BOOST_CHECK(isAncestor);
+    BOOST_CHECK(!dvcs::IsAncestor("nope", "MaBranche", isAncestor));
+
+    // Le graphe n'est qu'un cache: il est reconstruit s'il manque
+    fs::remove(dvcs::COMMIT_GRAPH_PATH);
+    mergeBase.reset();
+    BOOST_REQUIRE(dvcs::FindMergeBase("MaBranche", "default", mergeBase));
+    BOOST_REQUIRE(mergeBase);
+    BOOST_CHECK_EQUAL(dvcs::ToHex(*mergeBase), firstCommit);
+    BOOST_CHECK(fs::exists(dvcs::COMMIT_GRAPH_PATH));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la sélection, la pagination et les formats de l'historique affiché par
+// la commande log
+//
+// Filtre: --run_test="CommandsTestsSuite/LogCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(LogCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Log());
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), "");
+
+    for (int iCommit = 0; iCommit < 5; ++iCommit)
+    {
+        WriteTestFile("a.txt", fmt::format("a{}", iCommit));
+        BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+        BOOST_REQUIRE(dvcs::Commit("Author", "Email", fmt::format("Message {}", iCommit)));
+        if (iCommit == 2)
+        {
+            BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+        }
+    }
+    coutInterceptor.GetStreamContent();
+
+    const auto getCommit = [](int iCommit) {
+        return QueryValue(dvcs::REPO_DB_PATH, fmt::format("SELECT lower(hex(Hash)) FROM Commits WHERE Message = \"Message {}\";", iCommit));
+    };
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_skip = 1, .m_maxCount = 1}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), fmt::format("commit {}\nAuthor: Author <Email>\n\n    Message 3\n\n", getCommit(3)));
+
+    // Une page au-delà de la fin de l'historique est vide
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_skip = 5}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), "");
+
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_range = "MaBranche", .m_format = dvcs::LogFormat::JsonLines}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(),
+                      fmt::format("{{\"commit\":\"{0}\",\"parent\":\"{1}\",\"generation\":3,\"author\":\"Author\",\"email\":\"Email\",\"message\":\"Message 2\"}}\n"
+                                  "{{\"commit\":\"{1}\",\"parent\":\"{2}\",\"generation\":2,\"author\":\"Author\",\"email\":\"Email\",\"message\":\"Message 1\"}}\n"
+                                  "{{\"commit\":\"{2}\",\"parent\":null,\"generation\":1,\"author\":\"Author\",\"email\":\"Email\",\"message\":\"Message 0\"}}\n",
+                                  getCommit(2), getCommit(1), getCommit(0)));
+
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_range = "MaBranche..default", .m_format = dvcs::LogFormat::JsonLines}));
+    const auto rangeLog = coutInterceptor.GetStreamContent();
+    BOOST_CHECK_EQUAL(std::count(rangeLog.cbegin(), rangeLog.cend(), '\n'), 2);
+    BOOST_CHECK(rangeLog.starts_with(fmt::format("{{\"commit\":\"{}\"", getCommit(4))));
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_range = "default..MaBranche"}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), "");
+
+    BOOST_CHECK(!dvcs::Log(dvcs::LogOptions{.m_range = "nope"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Unknown revision nope\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que l'historique limité à un fichier ou à un répertoire ne contient que
+// les commits qui l'ont modifié, que les filtres des chemins modifiés soient
+// présents ou non
+//
+// Filtre: --run_test="CommandsTestsSuite/LogCommandPath"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(LogCommandPath, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    for (int iCommit = 0; iCommit < 6; ++iCommit)
+    {
+        const auto filePath = (iCommit % 3 == 0) ? fs::path{"src/sub/a.txt"} : ((iCommit % 3 == 1) ? fs::path{"src/b.txt"} : fs::path{"c.txt"});
+        WriteTestFile(filePath, fmt::format("{}", iCommit));
+        BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{filePath}));
+        BOOST_REQUIRE(dvcs::Commit("Author", "Email", fmt::format("Message {}", iCommit)));
+    }
+    BOOST_CHECK_EQUAL(CountRows(dvcs::REPO_DB_PATH, "CommitsPathFilters"), 6);
+
+    const auto getMessages = [&coutInterceptor](std::string_view path, std::size_t skip) {
+        BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_skip = skip, .m_format = dvcs::LogFormat::JsonLines, .m_path = path}));
+        std::string messages;
+        std::istringstream lines{coutInterceptor.GetStreamContent()};
+        for (std::string line; std::getline(lines, line);)
+        {
+            const auto messagePos = line.find("\"message\":\"") + 11;
+            messages += line.substr(messagePos, line.find('"', messagePos) - messagePos) + ";";
+        }
+        return messages;
+    };
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK_EQUAL(getMessages("src/sub/a.txt", 0), "Message 3;Message 0;");
+    BOOST_CHECK_EQUAL(getMessages("./src/", 0), "Message 4;Message 3;Message 1;Message 0;");
+    BOOST_CHECK_EQUAL(getMessages("src", 1), "Message 3;Message 1;Message 0;");
+    BOOST_CHECK_EQUAL(getMessages("sr", 0), "");
+
+    // Sans filtres, les objets des commits sont consultés
+    QueryValue(dvcs::REPO_DB_PATH, "DELETE FROM CommitsPathFilters;");
+    BOOST_CHECK_EQUAL(getMessages("src/b.txt", 0), "Message 4;Message 1;");
+
+    BOOST_CHECK(!dvcs::Log(dvcs::LogOptions{.m_path = "../c.txt"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Invalid path ../c.txt\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que l'historique d'un commit de fusion contient les commits de la branche
+// fusionnée, par génération décroissante, et que sa pagination en tient compte
+//
+// Filtre: --run_test="CommandsTestsSuite/LogCommandMerge"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(LogCommandMerge, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+    const auto commit = [](const fs::path &filePath, int iCommit) {
+        WriteTestFile(filePath, fmt::format("{}", iCommit));
+        BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{filePath}));
+        BOOST_REQUIRE(dvcs::Commit("Author", "Email", fmt::format("Message {}", iCommit)));
+    };
+    commit("a.txt", 0);
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    commit("b.txt", 1);
+    commit("b.txt", 2);
+    commit("b.txt", 3);
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    commit("a.txt", 4);
+    BOOST_REQUIRE(dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    commit("a.txt", 5);
+
+    const auto getMessages = [&coutInterceptor](std::string_view range, std::size_t skip, std::size_t maxCount, std::string_view path = {}) {
+        BOOST_REQUIRE(dvcs::Log(
+            dvcs::LogOptions{.m_range = range, .m_skip = skip, .m_maxCount = maxCount, .m_format = dvcs::LogFormat::JsonLines, .m_path = path}));
+        std::string messages;
+        std::istringstream lines{coutInterceptor.GetStreamContent()};
+        for (std::string line; std::getline(lines, line);)
+        {
+            const auto messagePos = line.find("\"message\":\"") + 11;
+            messages += line.substr(messagePos, line.find('"', messagePos) - messagePos) + ";";
+        }
+        return messages;
+    };
+    coutInterceptor.GetStreamContent();
+    constexpr const auto ALL = std::numeric_limits<std::size_t>::max();
+    BOOST_CHECK_EQUAL(getMessages({}, 0, ALL), "Message 5;Merge 'MaBranche' into 'default';Message 3;Message 2;Message 4;Message 1;Message 0;");
+    BOOST_CHECK_EQUAL(getMessages({}, 1, 2), "Merge 'MaBranche' into 'default';Message 3;");
+    BOOST_CHECK_EQUAL(getMessages({}, 3, 3), "Message 2;Message 4;Message 1;");
+    BOOST_CHECK_EQUAL(getMessages({}, 7, ALL), "");
+    BOOST_CHECK_EQUAL(getMessages("MaBranche..default", 0, ALL), "Message 5;Merge 'MaBranche' into 'default';Message 4;");
+    BOOST_CHECK_EQUAL(getMessages("default..MaBranche", 0, ALL), "");
+    BOOST_CHECK_EQUAL(getMessages({}, 1, ALL, "b.txt"), "Message 3;Message 2;Message 1;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que les commits sautés d'un coup au-dessus d'une fusion, puis au-delà de
+// celle-ci, mènent à la même page qu'un parcours commit par commit
+//
+// Filtre: --run_test="CommandsTestsSuite/LogCommandSkip"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(LogCommandSkip, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    BOOST_REQUIRE(dvcs::Init());
+    const auto commit = [](const fs::path &filePath, int iCommit) {
+        WriteTestFile(filePath, fmt::format("{}", iCommit));
+        BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{filePath}));
+        BOOST_REQUIRE(dvcs::Commit("Author", "Email", fmt::format("Message {}", iCommit)));
+    };
+    for (int iCommit = 0; iCommit < 4; ++iCommit)
+    {
+        commit((iCommit % 2 == 0) ? "a.txt" : "c.txt", iCommit);
+    }
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    commit("b.txt", 4);
+    commit("b.txt", 5);
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    commit("a.txt", 6);
+    BOOST_REQUIRE(dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    for (int iCommit = 7; iCommit < 10; ++iCommit)
+    {
+        commit((iCommit % 2 == 0) ? "a.txt" : "c.txt", iCommit);
+    }
+
+    const auto getMessages = [&coutInterceptor](std::string_view range, std::size_t skip, std::size_t maxCount, std::string_view path) {
+        BOOST_REQUIRE(dvcs::Log(
+            dvcs::LogOptions{.m_range = range, .m_skip = skip, .m_maxCount = maxCount, .m_format = dvcs::LogFormat::JsonLines, .m_path = path}));
+        std::vector<std::string> messages;
+        std::istringstream lines{coutInterceptor.GetStreamContent()};
+        for (std::string line; std::getline(lines, line);)
+        {
+            const auto messagePos = line.find("\"message\":\"") + 11;
+            messages.push_back(line.substr(messagePos, line.find('"', messagePos) - messagePos));
+        }
+        return messages;
+    };
+    coutInterceptor.GetStreamContent();
+    constexpr const auto ALL = std::numeric_limits<std::size_t>::max();
+    const auto history = getMessages({}, 0, ALL, {});
+    const std::vector<std::string> expectedHistory{"Message 9", "Message 8", "Message 7", "Merge 'MaBranche' into 'default'", "Message 5",
+                                                   "Message 6", "Message 4", "Message 3", "Message 2", "Message 1", "Message 0"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(history.cbegin(), history.cend(), expectedHistory.cbegin(), expectedHistory.cend());
+
+    // Chacune des pages, avec ou sans base et chemin, est la portion correspondante de l'historique complet
+    for (const auto &[range, path] : {std::pair<std::string_view, std::string_view>{{}, {}}, {"MaBranche..default", {}}, {{}, "a.txt"}})
+    {
+        const auto fullHistory = getMessages(range, 0, ALL, path);
+        for (std::size_t skip = 0; skip <= fullHistory.size(); ++skip)
+        {
+            const auto page = getMessages(range, skip, 2, path);
+            const auto pageEnd = fullHistory.cbegin() + static_cast<std::ptrdiff_t>(std::min(skip + 2, fullHistory.size()));
+            BOOST_CHECK_EQUAL_COLLECTIONS(page.cbegin(), page.cend(), fullHistory.cbegin() + static_cast<std::ptrdiff_t>(skip), pageEnd);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide les différences affichées par la commande diff entre le commit courant et
+// l'arbre de travail, puis entre deux commits
+//
+// Filtre: --run_test="CommandsTestsSuite/DiffCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(DiffCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "1\n2\n3\n4\n5\n6\n7\n8\n9\n");
+    WriteTestFile("b.bin", std::string_view{"a\0b", 3});
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.bin"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("Initiale"));
+    coutInterceptor.GetStreamContent();
+
+    // Les fichiers qui ne sont pas suivis sont ignorés
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\n5\n6\n7\n8\n9\n");
+    WriteTestFile("b.bin", std::string_view{"a\0bc", 4});
+    WriteTestFile("c.txt", "c");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"c.txt"}));
+    WriteTestFile("d.txt", "d");
+    coutInterceptor.GetStreamContent();
+    const std::string expectedDiff{"diff a/a.txt b/a.txt\n"
+                                   "--- a/a.txt\n"
+                                   "+++ b/a.txt\n"
+                                   "@@ -1,5 +1,5 @@\n"
+                                   " 1\n"
+                                   "-2\n"
+                                   "+deux\n"
+                                   " 3\n"
+                                   " 4\n"
+                                   " 5\n"
+                                   "diff a/b.bin b/b.bin\n"
+                                   "Binary files a/b.bin and b/b.bin differ\n"
+                                   "diff a/c.txt b/c.txt\n"
+                                   "--- /dev/null\n"
+                                   "+++ b/c.txt\n"
+                                   "@@ -0,0 +1 @@\n"
+                                   "+c\n"
+                                   "\\ No newline at end of file\n"};
+    BOOST_REQUIRE(dvcs::Diff());
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), expectedDiff);
+
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.bin"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Diff());
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), "");
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "Initiale", .m_newRevision = "default", .m_algorithm = dvcs::DiffAlgorithm::Histogram}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), expectedDiff);
+
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "default", .m_newRevision = "Initiale", .m_nbContextLines = 0}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), "diff a/a.txt b/a.txt\n"
+                                                          "--- a/a.txt\n"
+                                                          "+++ b/a.txt\n"
+                                                          "@@ -2 +2 @@\n"
+                                                          "-deux\n"
+                                                          "+2\n"
+                                                          "diff a/b.bin b/b.bin\n"
+                                                          "Binary files a/b.bin and b/b.bin differ\n"
+                                                          "diff a/c.txt b/c.txt\n"
+                                                          "--- a/c.txt\n"
+                                                          "+++ /dev/null\n"
+                                                          "@@ -1 +0,0 @@\n"
+                                                          "-c\n"
+                                                          "\\ No newline at end of file\n");
+
+    BOOST_CHECK(!dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "nope"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Unknown revision nope\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la détection des renommages et des copies par la commande diff (dans
+// l'arbre de travail et entre deux commits) et l'historique d'un fichier suivi
+// jusqu'à sa source
+//
+// Filtre: --run_test="CommandsTestsSuite/RenameDetection"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(RenameDetection, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    std::string oldContent;
+    std::string otherContent;
+    for (int iLine = 0; iLine < 20; ++iLine)
+    {
+        oldContent += fmt::format("line {}\n", iLine);
+        otherContent += fmt::format("other {}\n", iLine);
+    }
+    auto newContent = oldContent;
+    newContent.replace(newContent.find("line 10\n"), 8, "ligne 10\n");
+    const auto similarity = std::min<std::size_t>(dvcs::SimilaritySketch{oldContent}.GetSimilarity(dvcs::SimilaritySketch{newContent}), 99);
+    BOOST_REQUIRE_GE(similarity, dvcs::DEFAULT_SIMILARITY_THRESHOLD);
+
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", oldContent);
+    WriteTestFile("b.txt", otherContent);
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("Initiale"));
+
+    // Le fichier déplacé et modifié est un renommage du fichier retiré
+    fs::remove("a.txt");
+    WriteTestFile("src/a.txt", newContent);
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"src/a.txt"}));
+    coutInterceptor.GetStreamContent();
+    const auto expectedHunk = "@@ -8,7 +8,7 @@\n line 7\n line 8\n line 9\n-line 10\n+ligne 10\n line 11\n line 12\n line 13\n";
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_renames = {.m_detectRenames = true}}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), fmt::format("diff a/a.txt b/src/a.txt\n"
+                                                                      "similarity index {}%\n"
+                                                                      "rename from a.txt\n"
+                                                                      "rename to src/a.txt\n"
+                                                                      "--- a/a.txt\n"
+                                                                      "+++ b/src/a.txt\n{}",
+                                                                      similarity, expectedHunk));
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_renames = {.m_detectRenames = true, .m_threshold = similarity + 1}}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().starts_with("diff a/a.txt b/a.txt\n--- a/a.txt\n+++ /dev/null\n"));
+
+    // Le fichier dont le retrait n'est pas consigné demeure dans le commit: entre
+    // deux commits, le fichier déplacé en est une copie
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    WriteTestFile("src/a.txt", newContent + "line 20\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"src/a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 2"));
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "Initiale", .m_newRevision = "default", .m_renames = {.m_detectRenames = true}}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().starts_with("diff a/src/a.txt b/src/a.txt\n--- /dev/null\n"));
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "Initiale", .m_newRevision = "default", .m_renames = {.m_findCopiesHarder = true}}));
+    const auto copyDiff = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(copyDiff.starts_with("diff a/a.txt b/src/a.txt\nsimilarity index "));
+    BOOST_CHECK(copyDiff.find("copy from a.txt\ncopy to src/a.txt\n--- a/a.txt\n+++ b/src/a.txt\n") != std::string::npos);
+
+    // Au-delà de la limite, seuls les fichiers identiques sont détectés
+    BOOST_REQUIRE(dvcs::Diff(
+        dvcs::DiffOptions{.m_oldRevision = "Initiale", .m_newRevision = "default", .m_renames = {.m_findCopiesHarder = true, .m_renameLimit = 1}}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().starts_with("diff a/src/a.txt b/src/a.txt\n--- /dev/null\n"));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "warning: inexact rename detection was skipped due to too many files.\n");
+
+    // L'historique du fichier suivi se poursuit par celui de sa source
+    const auto getMessages = [&coutInterceptor](bool follow) {
+        BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_format = dvcs::LogFormat::JsonLines, .m_path = "src/a.txt", .m_follow = follow}));
+        std::string messages;
+        std::istringstream lines{coutInterceptor.GetStreamContent()};
+        for (std::string line; std::getline(lines, line);)
+        {
+            const auto messagePos = line.find("\"message\":\"") + 11;
+            messages += line.substr(messagePos, line.find('"', messagePos) - messagePos) + ";";
+        }
+        return messages;
+    };
+    BOOST_CHECK_EQUAL(getMessages(false), "Message 2;Message 1;");
+    BOOST_CHECK_EQUAL(getMessages(true), "Message 2;Message 1;Message 0;");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un fichier déplacé dont le retrait de la source est consigné est un
+// renommage entre deux commits, pour la commande diff comme pour l'historique du
+// fichier suivi jusqu'à sa source
+//
+// Filtre: --run_test="CommandsTestsSuite/RenameDetectionCommitted"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(RenameDetectionCommitted, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    std::string content;
+    for (int iLine = 0; iLine < 20; ++iLine)
+    {
+        content += fmt::format("line {}\n", iLine);
+    }
+
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", content);
+    WriteTestFile("b.txt", "b\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("Initiale"));
+
+    // Le retrait du fichier déplacé est consigné avec sa nouvelle version
+    fs::create_directory("src");
+    fs::rename("a.txt", "src/a.txt");
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "src"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 2 files, 0 unchanged"));
+    BOOST_REQUIRE(dvcs::Status());
+    const auto status = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(status.find("D  a.txt\nA  src/a.txt\n") != std::string::npos);
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "added 0 files, 1 unchanged"));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    WriteTestFile("src/a.txt", content + "line 20\n");
+    BOOST_REQUIRE(dvcs::AddChanges(false));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 2"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT COUNT(*) FROM CommitsObjects WHERE ObjectHash IS NULL;"), "1");
+
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "Initiale", .m_newRevision = "default"}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().starts_with("diff a/a.txt b/a.txt\n--- a/a.txt\n+++ /dev/null\n"));
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "Initiale", .m_newRevision = "default", .m_renames = {.m_detectRenames = true}}));
+    const auto renameDiff = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(renameDiff.starts_with("diff a/a.txt b/src/a.txt\nsimilarity index "));
+    BOOST_CHECK(renameDiff.find("rename from a.txt\nrename to src/a.txt\n--- a/a.txt\n+++ b/src/a.txt\n") != std::string::npos);
+
+    // L'historique du fichier suivi se poursuit par celui de sa source
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_format = dvcs::LogFormat::JsonLines, .m_path = "src/a.txt", .m_follow = true}));
+    std::string messages;
+    std::istringstream lines{coutInterceptor.GetStreamContent()};
+    for (std::string line; std::getline(lines, line);)
+    {
+        const auto messagePos = line.find("\"message\":\"") + 11;
+        messages += line.substr(messagePos, line.find('"', messagePos) - messagePos) + ";";
+    }
+    BOOST_CHECK_EQUAL(messages, "Message 2;Message 1;Message 0;");
+
+    // Le fichier retiré ne fait plus partie de l'arbre extrait
+    BOOST_REQUIRE(dvcs::CheckoutBranch("Initiale"));
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), content);
+    BOOST_CHECK(!fs::exists("src"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    BOOST_CHECK(!fs::exists("a.txt"));
+    BOOST_CHECK_EQUAL(ReadTestFile("src/a.txt"), content + "line 20\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la fusion de deux branches qui ont divergé (avec et sans conflit), la
+// fusion déjà faite et l'avance rapide
+//
+// Filtre: --run_test="CommandsTestsSuite/MergeCommand"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MergeCommand, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    const auto getHead = [](std::string_view branch) {
+        return QueryValue(dvcs::REPO_DB_PATH, fmt::format("SELECT lower(hex(HeadCommit)) FROM Branches WHERE Name = \"{}\";", branch));
+    };
+    const auto getMergeParent = [](const std::string &commit) {
+        return QueryValue(dvcs::REPO_DB_PATH,
+                          fmt::format("SELECT lower(hex(MergeParentHash)) FROM Commits WHERE lower(hex(Hash)) = \"{}\";", commit));
+    };
+
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "1\n2\n3\n4\n5\n6\n7\n8\n9\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\n5\n6\n7\n8\n9\n");
+    WriteTestFile("c.txt", "c");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "c.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    WriteTestFile("a.txt", "1\n2\n3\n4\n5\n6\n7\nhuit\n9\n");
+    WriteTestFile("b.txt", "b");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 2"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+
+    // Les modifications des deux côtés sont réunies dans un commit de fusion
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Can't merge. Missing information\n");
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "nope", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Unknown revision nope\n");
+    const auto branchHead = getHead("MaBranche");
+    BOOST_REQUIRE(dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "1\ndeux\n3\n4\n5\n6\n7\nhuit\n9\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("b.txt"), "b");
+    BOOST_CHECK_EQUAL(ReadTestFile("c.txt"), "c");
+    BOOST_CHECK_EQUAL(getMergeParent(getHead("default")), branchHead);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "PendingMerge"), 0);
+    bool isAncestor{};
+    BOOST_REQUIRE(dvcs::IsAncestor("MaBranche", "default", isAncestor));
+    BOOST_CHECK(isAncestor);
+
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Log(dvcs::LogOptions{.m_maxCount = 1}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().find("\nMerge: ") != std::string::npos);
+
+    // Le fichier repris tel quel du commit fusionné fait partie du commit de fusion
+    BOOST_REQUIRE(dvcs::Diff(dvcs::DiffOptions{.m_oldRevision = "MaBranche", .m_newRevision = "default"}));
+    const auto mergeDiff = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(mergeDiff.starts_with("diff a/a.txt b/a.txt\n"));
+    BOOST_CHECK(mergeDiff.find("b.txt") == std::string::npos);
+
+    // Une branche déjà fusionnée ne change rien, une branche en retard est avancée
+    BOOST_REQUIRE(dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK_EQUAL(coutInterceptor.GetStreamContent(), "already up to date\n");
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    BOOST_REQUIRE(dvcs::Merge(dvcs::MergeOptions{.m_revision = "default", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK_EQUAL(getHead("MaBranche"), getHead("default"));
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "1\ndeux\n3\n4\n5\n6\n7\nhuit\n9\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("c.txt"), "c");
+
+    // Les modifications d'une même ligne entrent en conflit
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\ncinq\n6\n7\nhuit\n9\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 3"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\nfive\n6\n7\nhuit\n9\n");
+    WriteTestFile("d.txt", "d");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "d.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 4"));
+    cerrInterceptor.GetStreamContent();
+
+    // Un fichier modifié localement n'est pas écrasé
+    WriteTestFile("a.txt", "local\n");
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Can't merge. Local changes to 'a.txt' would be overwritten.\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "local\n");
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\nfive\n6\n7\nhuit\n9\n");
+
+    coutInterceptor.GetStreamContent();
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().starts_with("CONFLICT (content): Merge conflict in a.txt\n"));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Automatic merge failed; fix conflicts, add the files and commit the result.\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "1\ndeux\n3\n4\n<<<<<<< default\nfive\n=======\ncinq\n>>>>>>> MaBranche\n6\n7\nhuit\n9\n");
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "PendingMerge"), 1);
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Can't merge. Uncommitted changes detected.\n");
+
+    // Le commit qui suit la résolution du conflit est le commit de fusion
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\n5\n6\n7\nhuit\n9\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 5"));
+    BOOST_CHECK_EQUAL(getMergeParent(getHead("default")), getHead("MaBranche"));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "PendingMerge"), 0);
+    std::optional<dvcs::THash> mergeBase;
+    BOOST_REQUIRE(dvcs::FindMergeBase("default", "MaBranche", mergeBase));
+    BOOST_REQUIRE(mergeBase);
+    BOOST_CHECK_EQUAL(dvcs::ToHex(*mergeBase), getHead("MaBranche"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un fichier binaire modifié des deux côtés d'une fusion est un conflit
+// qui empêche le commit de fusion tant qu'une version du fichier n'est pas ajoutée
+//
+// Filtre: --run_test="CommandsTestsSuite/MergeCommandBinaryConflict"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MergeCommandBinaryConflict, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    const std::string oursData{"ours\0data", 9};
+    const std::string theirsData{"theirs\0data", 11};
+
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("image.bin", std::string{"base\0data", 9});
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"image.bin"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    WriteTestFile("image.bin", oursData);
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"image.bin"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    WriteTestFile("image.bin", theirsData);
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"image.bin"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 2"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    coutInterceptor.GetStreamContent();
+    cerrInterceptor.GetStreamContent();
+
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().starts_with("CONFLICT (binary): Merge conflict in image.bin\n"));
+    BOOST_CHECK_EQUAL(ReadTestFile("image.bin"), oursData);
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "UnmergedPaths"), 1);
+
+    // La version du commit courant n'est pas reprise en silence
+    cerrInterceptor.GetStreamContent();
+    BOOST_CHECK(!dvcs::Commit("Author", "Email", "Message 3"));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Can't commit. Unmerged files must be fixed and added first:\n  image.bin\n");
+
+    WriteTestFile("image.bin", theirsData);
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"image.bin"}));
+    BOOST_CHECK_EQUAL(CountRows(dvcs::STAGING_DB_PATH, "UnmergedPaths"), 0);
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 3"));
+    BOOST_CHECK_EQUAL(QueryValue(dvcs::REPO_DB_PATH, "SELECT COUNT(*) FROM Commits WHERE MergeParentHash IS NOT NULL;"), "1");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un fichier copié d'un côté d'une fusion reçoit les modifications de sa
+// source faites de l'autre côté, que la copie soit du côté du commit courant ou du
+// commit fusionné
+//
+// Filtre: --run_test="CommandsTestsSuite/MergeCommandRenames"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MergeCommandRenames, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\n5\n6\n7\n8\n9\n10\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    WriteTestFile("src/a.txt", "1\n2\n3\n4\n5\n6\n7\n8\nneuf\n10\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"src/a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 2"));
+    BOOST_REQUIRE(dvcs::CreateBranch("Copie"));
+    coutInterceptor.GetStreamContent();
+
+    // Sans détection, la copie est reprise telle quelle
+    BOOST_REQUIRE(dvcs::CheckoutBranch("Copie"));
+    BOOST_REQUIRE(
+        dvcs::Merge(dvcs::MergeOptions{.m_revision = "default", .m_author = "Author", .m_email = "Email", .m_renames = {.m_detectRenames = false}}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().ends_with("merged 'default' into 'Copie': 1 files taken, 0 merged, 0 conflicts\n"));
+    BOOST_CHECK_EQUAL(ReadTestFile("src/a.txt"), "1\n2\n3\n4\n5\n6\n7\n8\nneuf\n10\n");
+
+    // La copie du commit courant reçoit les modifications du commit fusionné
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    coutInterceptor.GetStreamContent();
+    BOOST_REQUIRE(dvcs::Merge(dvcs::MergeOptions{.m_revision = "default", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK(coutInterceptor.GetStreamContent().ends_with("merged 'default' into 'MaBranche': 1 files taken, 1 merged, 0 conflicts\n"));
+    BOOST_CHECK_EQUAL(ReadTestFile("a.txt"), "1\ndeux\n3\n4\n5\n6\n7\n8\n9\n10\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("src/a.txt"), "1\ndeux\n3\n4\n5\n6\n7\n8\nneuf\n10\n");
+
+    // La copie du commit fusionné reçoit les modifications du commit courant, et un
+    // conflit nomme la source de la copie. La deuxième ligne de la copie diffère de
+    // celle de sa source depuis l'ancêtre commun: la copie l'emporte.
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\n5\n6\n7\n8\nnine\n10\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 3"));
+    coutInterceptor.GetStreamContent();
+    cerrInterceptor.GetStreamContent();
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "Copie", .m_author = "Author", .m_email = "Email"}));
+    BOOST_CHECK(StartsWith(coutInterceptor, "CONFLICT (content): Merge conflict in src/a.txt (copy of a.txt)\n"));
+    BOOST_CHECK_EQUAL(ReadTestFile("src/a.txt"), "1\n2\n3\n4\n5\n6\n7\n8\n<<<<<<< default\nnine\n=======\nneuf\n>>>>>>> Copie\n10\n");
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Automatic merge failed; fix conflicts, add the files and commit the result.\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'une fusion retire les fichiers retirés d'un seul côté, que le retrait
+// d'un fichier renommé n'entre pas en conflit avec les modifications reçues par sa
+// copie et qu'un fichier retiré d'un côté et modifié de l'autre est un conflit
+//
+// Filtre: --run_test="CommandsTestsSuite/MergeCommandRemovals"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MergeCommandRemovals, TestFolderFixture)
+{
+    StreamInterceptor coutInterceptor{std::cout};
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_REQUIRE(dvcs::Init());
+    WriteTestFile("a.txt", "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n");
+    WriteTestFile("b.txt", "b\n");
+    WriteTestFile("c.txt", "c\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "b.txt", "c.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 0"));
+    BOOST_REQUIRE(dvcs::CreateBranch("MaBranche"));
+    WriteTestFile("a.txt", "1\ndeux\n3\n4\n5\n6\n7\n8\n9\n10\n");
+    fs::remove("c.txt");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"a.txt", "c.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 1"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    fs::remove("a.txt");
+    fs::remove("b.txt");
+    WriteTestFile("src/a.txt", "1\n2\n3\n4\n5\n6\n7\n8\nneuf\n10\n");
+    WriteTestFile("c.txt", "cc\n");
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"."}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 2"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    coutInterceptor.GetStreamContent();
+
+    BOOST_CHECK(!dvcs::Merge(dvcs::MergeOptions{.m_revision = "MaBranche", .m_author = "Author", .m_email = "Email"}));
+    const std::string mergeOutput = coutInterceptor.GetStreamContent();
+    BOOST_CHECK(mergeOutput.starts_with("CONFLICT (modify/delete): c.txt deleted in default and modified in MaBranche\n"));
+    BOOST_CHECK(mergeOutput.ends_with("merged 'MaBranche' into 'default': 2 files taken, 1 merged, 1 conflicts\n"));
+    BOOST_CHECK_EQUAL(cerrInterceptor.GetStreamContent(), "Automatic merge failed; fix conflicts, add the files and commit the result.\n");
+    BOOST_CHECK(!fs::exists("a.txt"));
+    BOOST_CHECK(!fs::exists("b.txt"));
+    BOOST_CHECK_EQUAL(ReadTestFile("src/a.txt"), "1\ndeux\n3\n4\n5\n6\n7\n8\nneuf\n10\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("c.txt"), "cc\n");
+
+    // Le conflit est résolu en conservant le fichier modifié
+    BOOST_REQUIRE(dvcs::Add(std::vector<fs::path>{"c.txt"}));
+    BOOST_REQUIRE(dvcs::Commit("Author", "Email", "Message 3"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("MaBranche"));
+    BOOST_REQUIRE(dvcs::CheckoutBranch("default"));
+    BOOST_CHECK(!fs::exists("a.txt"));
+    BOOST_CHECK(!fs::exists("b.txt"));
+    BOOST_CHECK_EQUAL(ReadTestFile("src/a.txt"), "1\ndeux\n3\n4\n5\n6\n7\n8\nneuf\n10\n");
+    BOOST_CHECK_EQUAL(ReadTestFile("c.txt"), "cc\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(DiffTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Plus longue sous-séquence commune des lignes de deux textes, par programmation
+// dynamique
+////////////////////////////////////////////////////////////////////////////////////
+std::size_t ComputeLCSLength(const dvcs::DiffText &oldText, const dvcs::DiffText &newText)
+{
+    std::vector<std::vector<std::size_t>> lengths(oldText.GetNbLines() + 1, std::vector<std::size_t>(newText.GetNbLines() + 1, 0));
+    for (std::size_t iOldLine = 1; iOldLine <= oldText.GetNbLines(); ++iOldLine)
+    {
+        for (std::size_t iNewLine = 1; iNewLine <= newText.GetNbLines(); ++iNewLine)
+        {
+            lengths[iOldLine][iNewLine] = (oldText.GetLine(iOldLine - 1) == newText.GetLine(iNewLine - 1))
+                                              ? lengths[iOldLine - 1][iNewLine - 1] + 1
+                                              : std::max(lengths[iOldLine - 1][iNewLine], lengths[iOldLine][iNewLine - 1]);
+        }
+    }
+    return lengths.back().back();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide, sur des textes aléatoires, que toutes les implémentations du découpage
+// en lignes supportées par le processeur courant s'accordent, que les
+// modifications trouvées par les deux algorithmes transforment bien l'ancien texte
+// en le nouveau et que celles de Myers sont minimales
+//
+// Filtre: --run_test="DiffTestsSuite/RandomEdits"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(RandomEdits)
+{
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<int> lineDistribution{0, 7};
+    std::uniform_int_distribution<int> editDistribution{0, 5};
+    const auto generateLine = [&]() { return fmt::format("line {}\n", lineDistribution(generator)); };
+
+    for (int iText = 0; iText < 50; ++iText)
+    {
+        std::string oldData;
+        std::string newData;
+        for (int iLine = 0; iLine < 120; ++iLine)
+        {
+            const auto line = generateLine();
+            oldData += line;
+            const int edit = editDistribution(generator);
+            newData += (edit == 0) ? generateLine() : ((edit == 1) ? std::string{} : line);
+        }
+        // Une dernière ligne sans '\n' diffère de la même ligne qui en a un
+        newData += "line 0";
+
+        const dvcs::DiffText oldText{oldData};
+        const dvcs::DiffText newText{newData};
+        for (const auto backend : {dvcs::LineScanBackend::Generic, dvcs::LineScanBackend::SSE2, dvcs::LineScanBackend::AVX2})
+        {
+            if (!dvcs::IsLineScanBackendSupported(backend))
+            {
+                continue;
+            }
+            const dvcs::DiffText backendText{newData, backend};
+            BOOST_REQUIRE_EQUAL(backendText.GetNbLines(), newText.GetNbLines());
+            for (std::size_t iLine = 0; iLine < newText.GetNbLines(); ++iLine)
+            {
+                BOOST_CHECK_EQUAL(backendText.GetLine(iLine), newText.GetLine(iLine));
+            }
+        }
+
+        for (const auto algorithm : {dvcs::DiffAlgorithm::Myers, dvcs::DiffAlgorithm::Histogram})
+        {
+            // Les lignes inchangées sont copiées, les autres sont remplacées
+            const auto changes = dvcs::ComputeDiff(oldText, newText, algorithm);
+            std::string patchedData;
+            std::size_t iOldLine = 0;
+            std::size_t nbEdits = 0;
+            for (const auto &change : changes)
+            {
+                for (; iOldLine < change.m_oldStart; ++iOldLine)
+                {
+                    patchedData += oldText.GetLine(iOldLine);
+                }
+                for (std::size_t iNewLine = change.m_newStart; iNewLine < change.m_newStart + change.m_newCount; ++iNewLine)
+                {
+                    patchedData += newText.GetLine(iNewLine);
+                }
+                iOldLine += change.m_oldCount;
+                nbEdits += change.m_oldCount + change.m_newCount;
+            }
+            for (; iOldLine < oldText.GetNbLines(); ++iOldLine)
+            {
+                patchedData += oldText.GetLine(iOldLine);
+            }
+            BOOST_CHECK_EQUAL(patchedData, newData);
+
+            if (algorithm == dvcs::DiffAlgorithm::Myers)
+            {
+                BOOST_CHECK_EQUAL(nbEdits, oldText.GetNbLines() + newText.GetNbLines() - (2 * ComputeLCSLength(oldText, newText)));
+            }
+        }
+    }
+
+    const std::string binaryData{"abc\0def\n", 8};
+    BOOST_CHECK(dvcs::DiffText{binaryData}.IsBinary());
+    BOOST_CHECK_EQUAL(dvcs::DiffText{binaryData}.GetNbLines(), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'Histogram s'ancre sur les lignes rares plutôt que sur les lignes
+// fréquentes (accolades) comme le fait Myers
+//
+// Filtre: --run_test="DiffTestsSuite/HistogramAnchors"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(HistogramAnchors)
+{
+    const dvcs::DiffText oldText{"void a()\n{\n    one();\n}\n\nvoid b()\n{\n    two();\n}\n"};
+    const dvcs::DiffText newText{"void b()\n{\n    two();\n}\n\nvoid c()\n{\n    three();\n}\n"};
+
+    std::string myersOutput;
+    dvcs::WriteUnifiedDiff(oldText, newText, dvcs::ComputeDiff(oldText, newText, dvcs::DiffAlgorithm::Myers), dvcs::DEFAULT_DIFF_CONTEXT,
+                           myersOutput);
+    BOOST_CHECK_EQUAL(myersOutput, "@@ -1,9 +1,9 @@\n"
+                                   "-void a()\n"
+                                   "+void b()\n"
+                                   " {\n"
+                                   "-    one();\n"
+                                   "+    two();\n"
+                                   " }\n"
+                                   " \n"
+                                   "-void b()\n"
+                                   "+void c()\n"
+                                   " {\n"
+                                   "-    two();\n"
+                                   "+    three();\n"
+                                   " }\n");
+
+    std::string histogramOutput;
+    dvcs::WriteUnifiedDiff(oldText, newText, dvcs::ComputeDiff(oldText, newText, dvcs::DiffAlgorithm::Histogram), dvcs::DEFAULT_DIFF_CONTEXT,
+                           histogramOutput);
+    BOOST_CHECK_EQUAL(histogramOutput, "@@ -1,9 +1,9 @@\n"
+                                       "-void a()\n"
+                                       "-{\n"
+                                       "-    one();\n"
+                                       "-}\n"
+                                       "-\n"
+                                       " void b()\n"
+                                       " {\n"
+                                       "     two();\n"
+                                       "+}\n"
+                                       "+\n"
+                                       "+void c()\n"
+                                       "+{\n"
+                                       "+    three();\n"
+                                       " }\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la fusion à trois voies de textes modifiés d'un seul côté, des deux côtés
+// à des endroits différents et des deux côtés au même endroit
+//
+// Filtre: --run_test="DiffTestsSuite/MergeTexts"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(MergeTexts)
+{
+    const auto merge = [](std::string_view base, std::string_view ours, std::string_view theirs, std::size_t &nbConflicts) {
+        std::string output;
+        nbConflicts = dvcs::MergeTexts(dvcs::DiffText{base}, dvcs::DiffText{ours}, dvcs::DiffText{theirs}, dvcs::DiffAlgorithm::Myers, "ours",
+                                       "theirs", output);
+        return output;
+    };
+
+    std::size_t nbConflicts{};
+    const std::string base{"1\n2\n3\n4\n5\n6\n7\n8\n9\n"};
+    BOOST_CHECK_EQUAL(merge(base, "1\ndeux\n3\n4\n5\n6\n7\n8\n9\n", "1\n2\n3\n4\n5\n6\n7\nhuit\n9\n10\n", nbConflicts),
+                      "1\ndeux\n3\n4\n5\n6\n7\nhuit\n9\n10\n");
+    BOOST_CHECK_EQUAL(nbConflicts, 0);
+    BOOST_CHECK_EQUAL(merge(base, "1\n2\n3\n4\ncinq\n6\n7\n8\n9\n", "1\n2\n3\n4\ncinq\n6\n7\n8\n9\n", nbConflicts), "1\n2\n3\n4\ncinq\n6\n7\n8\n9\n");
+    BOOST_CHECK_EQUAL(nbConflicts, 0);
+    BOOST_CHECK_EQUAL(merge(base, "1\ndeux\n3\n4\ncinq\n6\n7\n8\n9\n", "1\n2\n3\n4\nfive\nsix\n7\n8\n", nbConflicts),
+                      "1\ndeux\n3\n4\n<<<<<<< ours\ncinq\n6\n=======\nfive\nsix\n>>>>>>> theirs\n7\n8\n");
+    BOOST_CHECK_EQUAL(nbConflicts, 1);
+
+    // Un marqueur se trouve toujours sur sa propre ligne
+    BOOST_CHECK_EQUAL(merge("a\nb", "a\nB", "a\nbee", nbConflicts), "a\n<<<<<<< ours\nB\n=======\nbee\n>>>>>>> theirs\n");
+    BOOST_CHECK_EQUAL(nbConflicts, 1);
+    BOOST_CHECK_EQUAL(merge("", "a\n", "b\n", nbConflicts), "<<<<<<< ours\na\n=======\nb\n>>>>>>> theirs\n");
+    BOOST_CHECK_EQUAL(nbConflicts, 1);
+
+    // Les modifications d'un seul côté sont reprises telles quelles
+    std::mt19937 generator{7};
+    std::uniform_int_distribution<int> lineDistribution{0, 7};
+    std::uniform_int_distribution<int> editDistribution{0, 5};
+    const auto generateLine = [&]() { return fmt::format("line {}\n", lineDistribution(generator)); };
+    for (int iText = 0; iText < 20; ++iText)
+    {
+        std::string baseData;
+        std::string newData;
+        for (int iLine = 0; iLine < 80; ++iLine)
+        {
+            const auto line = generateLine();
+            baseData += line;
+            const int edit = editDistribution(generator);
+            newData += (edit == 0) ? generateLine() : ((edit == 1) ? std::string{} : line);
+        }
+        BOOST_CHECK_EQUAL(merge(baseData, newData, baseData, nbConflicts), newData);
+        BOOST_CHECK_EQUAL(nbConflicts, 0);
+        BOOST_CHECK_EQUAL(merge(baseData, baseData, newData, nbConflicts), newData);
+        BOOST_CHECK_EQUAL(nbConflicts, 0);
+        BOOST_CHECK_EQUAL(merge(baseData, newData, newData, nbConflicts), newData);
+        BOOST_CHECK_EQUAL(nbConflicts, 0);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(BloomFilterTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide qu'un filtre contient toutes ses clés, que son taux de faux positifs est
+// près de celui visé et qu'un filtre saturé contient toutes les clés
+//
+// Filtre: --run_test="BloomFilterTestsSuite/FalsePositiveRate"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(FalsePositiveRate)
+{
+    constexpr std::size_t NB_KEYS = 500;
+    constexpr std::size_t NB_OTHER_KEYS = 20000;
+
+    dvcs::BloomFilter filter{NB_KEYS};
+    for (std::size_t iKey = 0; iKey < NB_KEYS; ++iKey)
+    {
+        filter.Add(dvcs::BloomKey{fmt::format("src/module{}/file{}.cpp", iKey % 17, iKey)});
+    }
+    BOOST_CHECK_EQUAL(filter.GetBits().size(), NB_KEYS * dvcs::BLOOM_BITS_PER_KEY / 8);
+    for (std::size_t iKey = 0; iKey < NB_KEYS; ++iKey)
+    {
+        BOOST_CHECK(dvcs::BloomFilter::MayContain(filter.GetBits(), dvcs::BloomKey{fmt::format("src/module{}/file{}.cpp", iKey % 17, iKey)}));
+    }
+
+    std::size_t nbFalsePositives{};
+    for (std::size_t iKey = NB_KEYS; iKey < NB_KEYS + NB_OTHER_KEYS; ++iKey)
+    {
+        nbFalsePositives +=
+            dvcs::BloomFilter::MayContain(filter.GetBits(), dvcs::BloomKey{fmt::format("src/module{}/file{}.cpp", iKey % 17, iKey)}) ? 1 : 0;
+    }
+    BOOST_CHECK_LT(nbFalsePositives, NB_OTHER_KEYS / 50);
+
+    const dvcs::BloomFilter emptyFilter{0};
+    BOOST_CHECK(!dvcs::BloomFilter::MayContain(emptyFilter.GetBits(), dvcs::BloomKey{"src"}));
+    const dvcs::BloomFilter saturatedFilter{dvcs::BLOOM_MAX_KEYS + 1};
+    BOOST_CHECK(dvcs::BloomFilter::MayContain(saturatedFilter.GetBits(), dvcs::BloomKey{"src"}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(SimilarityTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que la similarité estimée par les signatures est près de la similarité de
+// Jaccard des lignes de deux fichiers, et que l'index retrouve la source de chacun
+// des fichiers modifiés parmi des centaines d'autres sans fausse paire
+//
+// Filtre: --run_test="SimilarityTestsSuite/SketchAccuracy"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(SketchAccuracy)
+{
+    constexpr std::size_t NB_LINES = 200;
+    constexpr std::size_t NB_FILES = 300;
+
+    std::mt19937 generator{42};
+    const auto generateFile = [&generator]() {
+        std::string content;
+        for (std::size_t iLine = 0; iLine < NB_LINES; ++iLine)
+        {
+            content += fmt::format("    value = {};\n", generator());
+        }
+        return content;
+    };
+    // Remplace <nbChanges> lignes sur NB_LINES
+    const auto changeFile = [&generator](const std::string &content, std::size_t nbChanges) {
+        std::vector<std::string> lines;
+        std::istringstream stream{content};
+        for (std::string line; std::getline(stream, line);)
+        {
+            lines.push_back(line + '\n');
+        }
+        for (std::size_t iLine = 0; iLine < nbChanges; ++iLine)
+        {
+            lines[iLine * NB_LINES / nbChanges] = fmt::format("    other = {};\n", generator());
+        }
+        std::string changedContent;
+        for (const auto &line : lines)
+        {
+            changedContent += line;
+        }
+        return changedContent;
+    };
+
+    const auto content = generateFile();
+    BOOST_CHECK_EQUAL(dvcs::SimilaritySketch{content}.GetSimilarity(dvcs::SimilaritySketch{content}), 100);
+    BOOST_CHECK(dvcs::SimilaritySketch{""}.IsEmpty());
+    BOOST_CHECK_EQUAL(dvcs::SimilaritySketch{""}.GetSimilarity(dvcs::SimilaritySketch{content}), 0);
+    for (const std::size_t nbChanges : {20U, 50U, 100U})
+    {
+        // Les lignes remplacées manquent d'un côté et s'ajoutent de l'autre
+        const auto expectedSimilarity = (NB_LINES - nbChanges) * 100 / (NB_LINES + nbChanges);
+        const auto similarity = dvcs::SimilaritySketch{content}.GetSimilarity(dvcs::SimilaritySketch{changeFile(content, nbChanges)});
+        BOOST_CHECK_LE(std::max(similarity, expectedSimilarity) - std::min(similarity, expectedSimilarity), 12U);
+    }
+
+    // Chacun des fichiers modifiés au quart (similarité de 60%) retrouve sa source
+    std::vector<dvcs::SimilaritySketch> sources;
+    std::vector<dvcs::SimilaritySketch> destinations;
+    for (std::size_t iFile = 0; iFile < NB_FILES; ++iFile)
+    {
+        const auto sourceContent = generateFile();
+        sources.emplace_back(sourceContent);
+        destinations.emplace_back(changeFile(sourceContent, NB_LINES / 4));
+    }
+    const auto pairs = dvcs::FindSimilarPairs(sources, destinations, 40, dvcs::DEFAULT_SIMILARITY_CANDIDATES);
+    std::size_t nbFound{};
+    for (const auto &pair : pairs)
+    {
+        BOOST_CHECK_EQUAL(pair.m_source, pair.m_destination);
+        nbFound += (pair.m_source == pair.m_destination) ? 1 : 0;
+    }
+    BOOST_CHECK_GE(nbFound, NB_FILES * 95 / 100);
+    BOOST_CHECK(std::is_sorted(pairs.cbegin(), pairs.cend(), [](const dvcs::SimilarPair &lhs, const dvcs::SimilarPair &rhs) {
+        return lhs.m_similarity > rhs.m_similarity;
+    }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(HashTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que toutes les implémentations des algorithmes de hachage supportées par
+// le processeur courant produisent les empreintes attendues, peu importe la façon
+// dont les données leur sont fournies.
+//
+// Filtre: --run_test="HashTestsSuite/HashEngineBackends"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(HashEngineBackends)
+{
+    const std::string message{"abc"};
+    const std::string longMessage(1000, 'a');
+
+    for (const auto backend : {dvcs::HashBackend::Generic, dvcs::HashBackend::SHANI})
+    {
+        if (!dvcs::IsHashBackendSupported(backend))
+        {
+            continue;
+        }
+
+        auto pSHA1 = dvcs::CreateHashEngine(dvcs::HashAlgorithm::SHA1, backend);
+        BOOST_REQUIRE(pSHA1 != nullptr);
+        pSHA1->Update(message.data(), message.size());
+        BOOST_CHECK_EQUAL(dvcs::ToHex(pSHA1->Finalize()), "a9993e364706816aba3e25717850c26c9cd0d89d");
+        pSHA1->Update(message.data(), 0);
+        BOOST_CHECK_EQUAL(dvcs::ToHex(pSHA1->Finalize()), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+        auto pSHA256 = dvcs::CreateHashEngine(dvcs::HashAlgorithm::SHA256, backend);
+        BOOST_REQUIRE(pSHA256 != nullptr);
+        pSHA256->Update(message.data(), message.size());
+        BOOST_CHECK_EQUAL(dvcs::ToHex(pSHA256->Finalize()), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+        // Données fournies par morceaux de tailles variées (blocs partiels et complets)
+        for (auto *pEngine : {pSHA1.get(), pSHA256.get()})
+        {
+            const auto expected = dvcs::CreateHashEngine(pEngine->GetAlgorithm(), dvcs::HashBackend::Generic);
+            expected->Update(longMessage.data(), longMessage.size());
+            for (std::size_t offset = 0, chunkSize = 1; offset < longMessage.size(); offset += chunkSize, chunkSize += 7)
+            {
+                pEngine->Update(longMessage.data() + offset, std::min(chunkSize, longMessage.size() - offset));
+            }
+            BOOST_CHECK(pEngine->Finalize() == expected->Finalize());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(CodecTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que les données compressées par chacun des codecs, d'un coup ou par
+// morceaux, sont restituées intégralement
+//
+// Filtre: --run_test="CodecTestsSuite/CodecRoundTrip"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(CodecRoundTrip)
+{
+    std::string rawData;
+    for (int iLine = 0; iLine < 10000; ++iLine)
+    {
+        rawData += fmt::format("line {}\n", iLine);
+    }
+
+    for (const auto *pText : {"zlib", "zlib:9", "store", "zstd", "zstd:19", "lz4", "lz4:12"})
+    {
+        dvcs::CompressionSettings settings;
+        BOOST_REQUIRE(dvcs::ParseCompressionSettings(pText, settings));
+
+        std::vector<char> contents;
+        BOOST_REQUIRE(dvcs::Compress(settings, rawData.data(), rawData.size(), contents));
+        std::vector<char> decompressed;
+        BOOST_REQUIRE(dvcs::Decompress(settings.m_codec, contents.data(), contents.size(), decompressed));
+        BOOST_CHECK(std::equal(decompressed.cbegin(), decompressed.cend(), rawData.cbegin(), rawData.cend()));
+
+        std::istringstream input{rawData};
+        std::ostringstream output;
+        std::uintmax_t nbWritten{};
+        BOOST_REQUIRE(dvcs::CompressStream(settings, input, output, nbWritten));
+        const auto streamed = output.str();
+        BOOST_CHECK_EQUAL(nbWritten, streamed.size());
+        decompressed.clear();
+        BOOST_REQUIRE(dvcs::Decompress(settings.m_codec, streamed.data(), streamed.size(), decompressed));
+        BOOST_CHECK(std::equal(decompressed.cbegin(), decompressed.cend(), rawData.cbegin(), rawData.cend()));
+
+        std::istringstream compressedInput{std::string{contents.cbegin(), contents.cend()}};
+        std::ostringstream decompressedOutput;
+        BOOST_REQUIRE(dvcs::DecompressStream(settings.m_codec, compressedInput, decompressedOutput, nbWritten));
+        BOOST_CHECK_EQUAL(nbWritten, rawData.size());
+        BOOST_CHECK(decompressedOutput.str() == rawData);
+    }
+
+    dvcs::CompressionSettings settings;
+    BOOST_CHECK(!dvcs::ParseCompressionSettings("zstd:0", settings));
+    BOOST_CHECK(!dvcs::ParseCompressionSettings("lz4:", settings));
+    BOOST_CHECK(!dvcs::ParseCompressionSettings("gzip", settings));
+    BOOST_CHECK(dvcs::IsLikelyIncompressible(rawData.data(), rawData.size()) == false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que les données compressées à l'aide d'un dictionnaire ne peuvent être
+// décompressées qu'avec celui-ci
+//
+// Filtre: --run_test="CodecTestsSuite/DictionaryRoundTrip"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(DictionaryRoundTrip)
+{
+    std::vector<std::vector<char>> samples;
+    for (int iSample = 0; iSample < 200; ++iSample)
+    {
+        const auto sample = fmt::format("{{\"id\": {0}, \"name\": \"object{0}\", \"tags\": [\"small\", \"json\"], \"size\": {1}}}", iSample, iSample * 37);
+        samples.emplace_back(sample.cbegin(), sample.cend());
+    }
+
+    std::vector<char> content;
+    BOOST_REQUIRE(dvcs::TrainDictionary(samples, 4096, content));
+    const dvcs::CompressionDictionary dictionary{content, 3};
+    BOOST_REQUIRE(dictionary.IsValid());
+
+    const auto &rawData = samples.front();
+    std::vector<char> compressed;
+    BOOST_REQUIRE(dvcs::Compress(dvcs::CompressionSettings{}, rawData.data(), rawData.size(), compressed, &dictionary));
+    BOOST_CHECK_EQUAL(dvcs::GetDictionaryId(dvcs::Codec::Zstd, compressed.data(), compressed.size()), dictionary.GetId());
+
+    std::vector<char> decompressed;
+    BOOST_CHECK(dvcs::Decompress(dvcs::Codec::Zstd, compressed.data(), compressed.size(), decompressed, &dictionary));
+    BOOST_CHECK(decompressed == rawData);
+
+    std::istringstream compressedInput{std::string{compressed.cbegin(), compressed.cend()}};
+    std::ostringstream decompressedOutput;
+    std::uintmax_t nbWritten{};
+    BOOST_CHECK(dvcs::DecompressStream(dvcs::Codec::Zstd, compressedInput, decompressedOutput, nbWritten, &dictionary));
+    BOOST_CHECK(decompressedOutput.str() == std::string(rawData.cbegin(), rawData.cend()));
+
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_CHECK(!dvcs::Decompress(dvcs::Codec::Zstd, compressed.data(), compressed.size(), decompressed));
+
+    // Trop peu d'échantillons
+    samples.resize(2);
+    BOOST_CHECK(!dvcs::TrainDictionary(samples, 4096, content));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ChunkerTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide que le découpage couvre toutes les données et qu'une insertion ne
+// déplace que les frontières des morceaux qui la touchent
+//
+// Filtre: --run_test="ChunkerTestsSuite/ChunkBoundaries"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(ChunkBoundaries)
+{
+    std::mt19937 generator{7};
+    std::string rawData(2U * 1024U * 1024U, '\0');
+    std::generate(rawData.begin(), rawData.end(), [&generator]() { return static_cast<char>(generator()); });
+
+    auto chunkData = [](const std::string &data, std::vector<dvcs::Chunk> &chunks) {
+        std::istringstream input{data};
+        dvcs::THash hash{};
+        BOOST_REQUIRE(dvcs::ChunkStream(input, dvcs::HashAlgorithm::SHA1, chunks, hash));
+        BOOST_CHECK(hash == dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, data.data(), data.size()));
+    };
+
+    std::vector<dvcs::Chunk> chunks;
+    chunkData(rawData, chunks);
+    BOOST_REQUIRE(chunks.size() > 4);
+
+    // Les morceaux sont contigus, respectent les bornes de taille et sont identifiés par leur contenu
+    std::uintmax_t offset{};
+    for (std::size_t iChunk = 0; iChunk < chunks.size(); ++iChunk)
+    {
+        const auto &chunk = chunks[iChunk];
+        BOOST_CHECK_EQUAL(chunk.m_offset, offset);
+        BOOST_CHECK(chunk.m_size <= dvcs::MAX_CHUNK_SIZE);
+        BOOST_CHECK((chunk.m_size >= dvcs::MIN_CHUNK_SIZE) || (iChunk + 1 == chunks.size()));
+        BOOST_CHECK(chunk.m_hash == dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, rawData.data() + chunk.m_offset, chunk.m_size));
+        offset += chunk.m_size;
+    }
+    BOOST_CHECK_EQUAL(offset, rawData.size());
+
+    // Tous les morceaux sauf ceux touchés par l'insertion se retrouvent après celle-ci
+    std::string modifiedData = rawData;
+    modifiedData.insert(modifiedData.size() / 2, "abc");
+    std::vector<dvcs::Chunk> modifiedChunks;
+    chunkData(modifiedData, modifiedChunks);
+    const auto nbShared = std::count_if(modifiedChunks.cbegin(), modifiedChunks.cend(), [&chunks](const dvcs::Chunk &modifiedChunk) {
+        return std::any_of(chunks.cbegin(), chunks.cend(), [&modifiedChunk](const dvcs::Chunk &chunk) { return chunk.m_hash == modifiedChunk.m_hash; });
+    });
+    BOOST_CHECK(static_cast<std::size_t>(nbShared) + 2 >= chunks.size());
+
+    // Les données vides ne produisent aucun morceau
+    chunkData(std::string{}, chunks);
+    BOOST_CHECK(chunks.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(CommitGraphTestsSuite)
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide les requêtes d'ascendance et de base commune du graphe des commits sur un
+// historique aléatoire ajouté en plusieurs fois, en les comparant à un parcours
+// naïf de l'historique
+//
+// Filtre: --run_test="CommitGraphTestsSuite/AncestryQueries"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(AncestryQueries, TestFolderFixture)
+{
+    // Deux historiques disjoints, dont les commits ont surtout pour parent le
+    // commit précédent (comme une branche) et parfois un commit plus ancien
+    constexpr const std::size_t NB_COMMITS = 3000;
+    constexpr const std::size_t SECOND_ROOT = 1200;
+    std::mt19937 generator{11};
+    std::vector<dvcs::THash> hashes;
+    std::vector<std::size_t> parents;
+    for (std::size_t iCommit = 0; iCommit < NB_COMMITS; ++iCommit)
+    {
+        hashes.push_back(dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, &iCommit, sizeof(iCommit)));
+        const std::size_t firstCommit = (iCommit < SECOND_ROOT) ? 0 : SECOND_ROOT;
+        if (iCommit == firstCommit)
+        {
+            parents.push_back(NB_COMMITS);
+        }
+        else
+        {
+            parents.push_back(((generator() % 4) != 0) ? iCommit - 1 : firstCommit + (generator() % (iCommit - firstCommit)));
+        }
+    }
+
+    // Les premiers commits sont ajoutés un à un (dans la table existante), les
+    // suivants par lots (qui la font grandir). Les commits déjà présents sont ignorés.
+    dvcs::CommitGraph graph;
+    BOOST_REQUIRE(graph.Open("commit-graph", dvcs::SHA1_SIZE));
+    BOOST_CHECK_EQUAL(graph.GetNbCommits(), 0);
+    for (std::size_t iBegin = 0; iBegin < NB_COMMITS;)
+    {
+        const auto iEnd = std::min(NB_COMMITS, iBegin + ((iBegin < 600) ? 1 : 700));
+        std::vector<dvcs::GraphCommit> commits;
+        for (std::size_t iCommit = (iBegin > 0) ? iBegin - 1 : 0; iCommit < iEnd; ++iCommit)
+        {
+            commits.push_back({hashes[iCommit], (parents[iCommit] == NB_COMMITS) ? dvcs::THash{0} : hashes[parents[iCommit]]});
+        }
+        BOOST_REQUIRE(graph.Append(commits));
+        iBegin = iEnd;
+    }
+    BOOST_REQUIRE_EQUAL(graph.GetNbCommits(), NB_COMMITS);
+
+    // Les commits d'un parent inconnu sont refusés
+    StreamInterceptor cerrInterceptor{std::cerr};
+    BOOST_CHECK(!graph.Append({{dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, "x", 1), dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, "y", 1)}}));
+
+    // Le graphe relu du disque donne les mêmes réponses que le parcours naïf
+    dvcs::CommitGraph reopenedGraph;
+    BOOST_REQUIRE(reopenedGraph.Open("commit-graph", dvcs::SHA1_SIZE));
+    BOOST_REQUIRE_EQUAL(reopenedGraph.GetNbCommits(), NB_COMMITS);
+    BOOST_CHECK_EQUAL(reopenedGraph.Find(dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, "x", 1)), dvcs::NO_COMMIT);
+    for (std::size_t iCommit = 0; iCommit < NB_COMMITS; ++iCommit)
+    {
+        BOOST_REQUIRE_EQUAL(reopenedGraph.Find(hashes[iCommit]), iCommit);
+        BOOST_CHECK_EQUAL(reopenedGraph.GetParent(static_cast<dvcs::TCommitId>(iCommit)),
+                          (parents[iCommit] == NB_COMMITS) ? dvcs::NO_COMMIT : parents[iCommit]);
+    }
+
+    auto getAncestors = [&parents](std::size_t iCommit) {
+        std::vector<std::size_t> ancestors;
+        for (; iCommit != NB_COMMITS; iCommit = parents[iCommit])
+        {
+            ancestors.push_back(iCommit);
+        }
+        return ancestors;
+    };
+    for (int iQuery = 0; iQuery < 2000; ++iQuery)
+    {
+        const auto first = generator() % NB_COMMITS;
+        const auto second = generator() % NB_COMMITS;
+        const auto firstAncestors = getAncestors(first);
+        const auto secondAncestors = getAncestors(second);
+
+        const bool isAncestor = std::find(secondAncestors.cbegin(), secondAncestors.cend(), first) != secondAncestors.cend();
+        BOOST_CHECK_EQUAL(reopenedGraph.IsAncestor(static_cast<dvcs::TCommitId>(first), static_cast<dvcs::TCommitId>(second)), isAncestor);
+
+        const auto mergeBaseIt = std::find_first_of(secondAncestors.cbegin(), secondAncestors.cend(), firstAncestors.cbegin(), firstAncestors.cend());
+        const auto mergeBase = (mergeBaseIt != secondAncestors.cend()) ? static_cast<dvcs::TCommitId>(*mergeBaseIt) : dvcs::NO_COMMIT;
+        BOOST_CHECK_EQUAL(reopenedGraph.FindMergeBase(static_cast<dvcs::TCommitId>(first), static_cast<dvcs::TCommitId>(second)), mergeBase);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Valide la profondeur, la génération et les requêtes d'ascendance et de base
+// commune du graphe des commits sur un historique aléatoire comprenant des commits
+// de fusion, en les comparant aux ensembles d'ancêtres de chacun des commits
+//
+// Filtre: --run_test="CommitGraphTestsSuite/MergeQueries"
+////////////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_CASE(MergeQueries, TestFolderFixture)
+{
+    // Deux historiques disjoints dont un commit sur six est une fusion d'un commit
+    // plus ancien du même historique
+    constexpr const std::size_t NB_COMMITS = 1500;
+    constexpr const std::size_t SECOND_ROOT = 600;
+    std::mt19937 generator{13};
+    std::vector<dvcs::THash> hashes;
+    std::vector<std::size_t> parents;
+    std::vector<std::size_t> mergeParents;
+    for (std::size_t iCommit = 0; iCommit < NB_COMMITS; ++iCommit)
+    {
+        hashes.push_back(dvcs::ComputeHash(dvcs::HashAlgorithm::SHA1, &iCommit, sizeof(iCommit)));
+        const std::size_t firstCommit = (iCommit < SECOND_ROOT) ? 0 : SECOND_ROOT;
+        parents.push_back(NB_COMMITS);
+        mergeParents.push_back(NB_COMMITS);
+        if (iCommit == firstCommit)
+        {
+            continue;
+        }
+        parents.back() = ((generator() % 3) != 0) ? iCommit - 1 : firstCommit + (generator() % (iCommit - firstCommit));
+        const auto mergeParent = firstCommit + (generator() % (iCommit - firstCommit));
+        if (((generator() % 6) == 0) && (mergeParent != parents.back()))
+        {
+            mergeParents.back() = mergeParent;
+        }
+    }
+
+    dvcs::CommitGraph graph;
+    BOOST_REQUIRE(graph.Open("commit-graph", dvcs::SHA1_SIZE));
+    for (std::size_t iBegin = 0; iBegin < NB_COMMITS;)
+    {
+        const auto iEnd = std::min(NB_COMMITS, iBegin + ((iBegin < 300) ? 1 : 500));
+        std::vector<dvcs::GraphCommit> commits;
+        for (auto iCommit = iBegin; iCommit < iEnd; ++iCommit)
+        {
+            commits.push_back({hashes[iCommit], (parents[iCommit] == NB_COMMITS) ? dvcs::THash{0} : hashes[parents[iCommit]],
+                               (mergeParents[iCommit] == NB_COMMITS) ? dvcs::THash{0} : hashes[mergeParents[iCommit]]});
+        }
+        BOOST_REQUIRE(graph.Append(commits));
+        iBegin = iEnd;
+    }
+
+    // Les ancêtres de chacun des commits (lui compris), sa profondeur et sa
+    // génération
+    std::vector<std::vector<bool>> ancestors(NB_COMMITS, std::vector<bool>(NB_COMMITS, false));
+    std::vector<std::uint32_t> depths(NB_COMMITS, 1);
+    std::vector<std::uint32_t> generations(NB_COMMITS, 1);
+    for (std::size_t iCommit = 0; iCommit < NB_COMMITS; ++iCommit)
+    {
+        ancestors[iCommit][iCommit] = true;
+        for (const auto parent : {parents[iCommit], mergeParents[iCommit]})
+        {
+            if (parent == NB_COMMITS)
+            {
+                continue;
+            }
+            for (std::size_t iAncestor = 0; iAncestor < iCommit; ++iAncestor)
+            {
+                if (ancestors[parent][iAncestor])
+                {
+                    ancestors[iCommit][iAncestor] = true;
+                }
+            }
+            generations[iCommit] = std::max(generations[iCommit], generations[parent] + 1);
+        }
+        if (parents[iCommit] != NB_COMMITS)
+        {
+            depths[iCommit] = depths[parents[iCommit]] + 1;
+        }
+    }
+
+    dvcs::CommitGraph reopenedGraph;
+    BOOST_REQUIRE(reopenedGraph.Open("commit-graph", dvcs::SHA1_SIZE));
+    BOOST_REQUIRE_EQUAL(reopenedGraph.GetNbCommits(), NB_COMMITS);
+    for (std::size_t iCommit = 0; iCommit < NB_COMMITS; ++iCommit)
+    {
+        const auto id = static_cast<dvcs::TCommitId>(iCommit);
+        BOOST_REQUIRE_EQUAL(reopenedGraph.Find(hashes[iCommit]), id);
+        BOOST_CHECK_EQUAL(reopenedGraph.GetMergeParent(id), (mergeParents[iCommit] == NB_COMMITS) ? dvcs::NO_COMMIT : mergeParents[iCommit]);
+        BOOST_CHECK_EQUAL(reopenedGraph.GetDepth(id), depths[iCommit]);
+        BOOST_CHECK_EQUAL(reopenedGraph.GetGeneration(id), generations[iCommit]);
+    }
+
+    // La base commune trouvée est un ancêtre commun qui n'est l'ancêtre d'aucun
+    // autre ancêtre commun
+    for (int iQuery = 0; iQuery < 2000; ++iQuery)
+    {
+        const auto first = generator() % NB_COMMITS;
+        const auto second = generator() % NB_COMMITS;
+        BOOST_CHECK_EQUAL(reopenedGraph.IsAncestor(static_cast<dvcs::TCommitId>(first), static_cast<dvcs::TCommitId>(second)),
+                          ancestors[second][first]);
+
+        const auto mergeBase = reopenedGraph.FindMergeBase(static_cast<dvcs::TCommitId>(first), static_cast<dvcs::TCommitId>(second));
+        bool hasCommonAncestor{};
+        for (std::size_t iAncestor = 0; iAncestor < NB_COMMITS; ++iAncestor)
+        {
+            if (!ancestors[first][iAncestor] || !ancestors[second][iAncestor])
+            {
+                continue;
+            }
+            hasCommonAncestor = true;
+            if ((mergeBase != dvcs::NO_COMMIT) && (iAncestor != mergeBase))
+            {
+                BOOST_CHECK(!ancestors[iAncestor][mergeBase]);
+            }
+        }
+        BOOST_CHECK_EQUAL(mergeBase != dvcs::NO_COMMIT, hasCommonAncestor);
+        if (mergeBase != dvcs::NO_COMMIT)
+        {
+            BOOST_CHECK(ancestors[first][mergeBase] && ancestors[second][mergeBase]);
+        }
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()